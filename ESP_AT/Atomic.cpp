@@ -13,6 +13,14 @@ CipsendHandler Cipsend;
 CipsendHandler::CipsendHandler()
 {
   segmentID = 0;
+  pendingHead = pendingCount = 0;
+  totalBytes = 0;
+  lastThroughput = 0;
+  active = false;
+  failed = false;
+  draining = false;
+  received = 0;
+  ringHead = ringCount = 0;
 }
 //------------------------------------------------------------------------------------------------------------------------------------------------------------------------
 CipsendHandler::~CipsendHandler()
@@ -20,91 +28,153 @@ CipsendHandler::~CipsendHandler()
   
 }
 //------------------------------------------------------------------------------------------------------------------------------------------------------------------------
-void CipsendHandler::add(size_t dataLength,uint8_t linkID)
+bool CipsendHandler::add(size_t dataLength,uint8_t linkID)
 {
-  CipsendData dt;
+  if(pendingCount >= CIPSEND_MAX_PENDING)
+    return false;
+    
+  CipsendData& dt = pending[(pendingHead + pendingCount) % CIPSEND_MAX_PENDING];
   dt.dataLength = dataLength;
   dt.linkID = linkID;
 
-  data.push_back(dt);
+  pendingCount++;
+  return true;
 }
 //------------------------------------------------------------------------------------------------------------------------------------------------------------------------
 void CipsendHandler::clear()
 {
-  data.clear();
+  pendingHead = pendingCount = 0;
+  active = false;
+  draining = false;
+  ringHead = ringCount = 0;
 }
 //------------------------------------------------------------------------------------------------------------------------------------------------------------------------
-void CipsendHandler::update()
+void CipsendHandler::printStats(Stream& s)
 {
-  if(CriticalSection::Triggered() || !data.size())
-    return;
+  s << "+CIPSENDSTAT:" << pendingCount << "," << (CIPSEND_MAX_PENDING - pendingCount) << "," << totalBytes << "," << lastThroughput << ENDLINE;
+}
+//------------------------------------------------------------------------------------------------------------------------------------------------------------------------
+void CipsendHandler::start()
+{
+  current = pending[pendingHead];
+  pendingHead = (pendingHead + 1) % CIPSEND_MAX_PENDING;
+  pendingCount--;
 
-  CRITICAL_SECTION;
-
-  CipsendData dt = data[0];
-  for(size_t i=1;i<data.size();i++)
-    data[i-1] = data[i];
-
-  data.pop();
-
-   Serial << '>'; // выводим приглашение
-   Serial.flush();
-   
-   // читаем данные
-   size_t readed = 0;
-
-   uint8_t* data = new uint8_t[dt.dataLength];
-   memset(data,0,dt.dataLength);
-   
-   while(readed < dt.dataLength)
-   {
-      if(!Serial.available())
-      {
-        delay(0);
-        continue;
-      }
-
-      uint8_t ch = Serial.read();
-      data[readed] = ch;
-      readed++;
-   } // while
-
-   String sendFail = ENDLINE;
-   sendFail += dt.linkID;
-   sendFail += ",SEND FAIL";
-   sendFail += ENDLINE;
-
-   // данные получили, можно их писать в клиента
-   if(!Clients[dt.linkID].connected())
-   {
-    Serial << sendFail;
-    Serial.flush();
-    delete [] data;
-    return;    
-   }   
-
-   if(!Clients[dt.linkID].write((const uint8_t*)data,dt.dataLength))
-   {
-     delete [] data;
-     Serial << sendFail;
-     Serial.flush();
-     return;
-   }
-
-   String sendOK = ENDLINE;
-   sendOK += dt.linkID;
-   sendOK += ",";
-   sendOK += segmentID;
-   segmentID++;
-   sendOK += ",SEND OK";
-   sendOK += ENDLINE;
-
-   delete [] data;
+  active = true;
+  failed = !Clients[current.linkID].connected();
+  received = 0;
+  ringHead = ringCount = 0;
+  startedAt = lastDataAt = millis();
+
+  Serial << '>'; // выводим приглашение
+  Serial.flush();
+}
+//------------------------------------------------------------------------------------------------------------------------------------------------------------------------
+void CipsendHandler::flushRing()
+{
+  // пишем в сокет непрерывный кусок с начала буфера
+  uint16_t len = CIPSEND_RING_SIZE - ringHead;
+  if(len > ringCount)
+    len = ringCount;
+  if(len > CIPSEND_CHUNK_SIZE)
+    len = CIPSEND_CHUNK_SIZE;
+
+  size_t written = len;
   
-   Serial << sendOK;
-   Serial.flush();
+  if(!failed)
+  {
+    if(!Clients[current.linkID].connected())
+      failed = true;
+    else
+      written = Clients[current.linkID].write((const uint8_t*)&(ring[ringHead]),len);
+  }
+
+  if(!written) // сокет не принял данные - остаток отсылки просто вычитываем из UART
+  {
+    failed = true;
+    written = len;
+  }
+
+  ringHead = (ringHead + written) % CIPSEND_RING_SIZE;
+  ringCount -= written;
+}
+//------------------------------------------------------------------------------------------------------------------------------------------------------------------------
+void CipsendHandler::finish()
+{
+  active = false;
+
+  if(failed)
+  {
+    Serial << ENDLINE << current.linkID << ",SEND FAIL" << ENDLINE;
+    Serial.flush();
+    return;
+  }
+
+  uint32_t elapsed = millis() - startedAt;
+  lastThroughput = elapsed ? (current.dataLength*1000ul)/elapsed : current.dataLength*1000ul;
+  totalBytes += current.dataLength;
 
+  Serial << ENDLINE << current.linkID << "," << segmentID << ",SEND OK" << ENDLINE;
+  segmentID++;
+  Serial.flush();
+}
+//------------------------------------------------------------------------------------------------------------------------------------------------------------------------
+void CipsendHandler::update()
+{
+  if(draining)
+  {
+    // контроллер может досылать данные уже отменённой отсылки - они не должны попасть в парсер команд
+    while(received < current.dataLength && Serial.available())
+    {
+      Serial.read();
+      received++;
+      lastDataAt = millis();
+    }
+
+    if(received >= current.dataLength || millis() - lastDataAt > CIPSEND_DRAIN_GAP)
+      draining = false;
+
+    return;
+  }
   
+  if(!active)
+  {
+    // новую отсылку начинаем только вне обработки команды, иначе приглашение вклинится в её ответ
+    if(__semaphor || !pendingCount)
+      return;
+
+    start();
+  }
+
+  // принимаем из UART, сколько есть и сколько влезает
+  while(received < current.dataLength && ringCount < CIPSEND_RING_SIZE && Serial.available())
+  {
+    ring[(ringHead + ringCount) % CIPSEND_RING_SIZE] = Serial.read();
+    ringCount++;
+    received++;
+    lastDataAt = millis();
+  }
+
+  if(received < current.dataLength && millis() - lastDataAt > CIPSEND_DATA_TIMEOUT)
+  {
+    // контроллер не дослал данные - не держим UART вечно
+    failed = true;
+    ringCount = 0;
+    finish();
+
+    // опоздавший остаток данных ещё может прийти - вычитываем его, пока UART не замолчит
+    draining = true;
+    lastDataAt = millis();
+    return;
+  }
+
+  // в сокет пишем полными кусками, хвост - когда отсылка принята целиком
+  bool allReceived = received >= current.dataLength;
+  while(ringCount && (ringCount >= CIPSEND_CHUNK_SIZE || allReceived))
+    flushRing();
+
+  if(allReceived && !ringCount)
+    finish();
 }
 //------------------------------------------------------------------------------------------------------------------------------------------------------------------------
 // CriticalSection
@@ -123,7 +193,7 @@ CriticalSection::~CriticalSection()
 //------------------------------------------------------------------------------------------------------------------------------------------------------------------------
 bool CriticalSection::Triggered()
 {
-  return __semaphor;
+  return __semaphor || Cipsend.busy(); // пока идёт приём данных отсылки, события в UART не пишем
 }
 //------------------------------------------------------------------------------------------------------------------------------------------------------------------------
 // EventsList
@@ -158,33 +228,83 @@ void onStationGotIP(const WiFiEventStationModeGotIP& evt)
 //------------------------------------------------------------------------------------------------------------------------------------------------------------------------
 EventsList::EventsList()
 {
-  
+  head = count = 0;
+  highWater = 0;
+  droppedEvents = droppedBytes = 0;
+}
+//------------------------------------------------------------------------------------------------------------------------------------------------------------------------
+void EventsList::put(const uint8_t* data, size_t len)
+{
+  size_t writeIdx = (head + count) % EVENTS_RING_SIZE;
+  size_t part = EVENTS_RING_SIZE - writeIdx;
+  if(part > len)
+    part = len;
+
+  memcpy(&(ring[writeIdx]),data,part);
+  memcpy(ring,data + part,len - part);
+  count += len;
+}
+//------------------------------------------------------------------------------------------------------------------------------------------------------------------------
+void EventsList::get(uint8_t* data, size_t len)
+{
+  size_t part = EVENTS_RING_SIZE - head;
+  if(part > len)
+    part = len;
+
+  memcpy(data,&(ring[head]),part);
+  memcpy(data + part,ring,len - part);
+  head = (head + len) % EVENTS_RING_SIZE;
+  count -= len;
+}
+//------------------------------------------------------------------------------------------------------------------------------------------------------------------------
+size_t EventsList::freeSpace()
+{
+  size_t freeBytes = EVENTS_RING_SIZE - count;
+  return freeBytes > 2 ? freeBytes - 2 : 0;
+}
+//------------------------------------------------------------------------------------------------------------------------------------------------------------------------
+size_t EventsList::dataSpace()
+{
+  size_t freeBytes = freeSpace();
+  return freeBytes > EVENTS_RESERVE ? freeBytes - EVENTS_RESERVE : 0;
+}
+//------------------------------------------------------------------------------------------------------------------------------------------------------------------------
+void EventsList::printStats(Stream& s)
+{
+  s << "+EVENTSTAT:" << count << "," << EVENTS_RING_SIZE << "," << highWater << "," << droppedEvents << "," << droppedBytes << ENDLINE;
 }
 //------------------------------------------------------------------------------------------------------------------------------------------------------------------------
 void EventsList::update()
 {
-  if(!CriticalSection::Triggered())
+  if(!count || CriticalSection::Triggered())
+    return;
+
+  // выводим накопившиеся события, каждое - непрерывными кусками прямо из буфера
+  while(count)
   {
-    MessagesList thisMessages = messages;
-    messages.empty();
+    uint8_t lenBytes[2];
+    get(lenBytes,2);
+    size_t len = lenBytes[0] | (lenBytes[1] << 8);
 
-    for(size_t i=0;i<thisMessages.size();i++)
+    while(len)
     {
-      Serial.write(thisMessages[i].data,thisMessages[i].dataLength);
-      Serial.flush();
-      delete [] thisMessages[i].data;
+      size_t part = EVENTS_RING_SIZE - head;
+      if(part > len)
+        part = len;
+
+      Serial.write(&(ring[head]),part);
+      head = (head + part) % EVENTS_RING_SIZE;
+      count -= part;
+      len -= part;
     }
   }
+
+  Serial.flush();
 }
 //------------------------------------------------------------------------------------------------------------------------------------------------------------------------
 void EventsList::clear()
 {
-   for(size_t i=0;i<messages.size();i++)
-  {
-    delete [] messages[i].data;
-  }
-
-  messages.clear(); 
+  head = count = 0;
 }
 //------------------------------------------------------------------------------------------------------------------------------------------------------------------------
 void EventsList::begin()
@@ -203,25 +323,28 @@ void EventsList::raise(const char* evt)
 //------------------------------------------------------------------------------------------------------------------------------------------------------------------------
 void EventsList::raise(const char* data, size_t dataLength)
 {
-  if(!CriticalSection::Triggered())
+  // сразу в UART - только если он свободен и раньше нас никто не ждёт, иначе нарушится порядок событий
+  if(!CriticalSection::Triggered() && !count)
   {
     Serial.write(data,dataLength);
     Serial.flush();
     return;
   }
-  
-  for(size_t i=0;i<messages.size();i++)
+
+  if(dataLength > freeSpace())
   {
-    if(messages[i].dataLength == dataLength && !memcmp(messages[i].data,data, dataLength)) // same message
-      return;
+    // места нет - событие теряем, но не выделяем под него память
+    droppedEvents++;
+    droppedBytes += dataLength;
+    return;
   }
 
-  EventData dt;
-  dt.data = new char[dataLength];
-  dt.dataLength = dataLength;
-  memcpy(dt.data,data,dataLength);
-  
-  messages.push_back(dt);
+  uint8_t lenBytes[2] = { (uint8_t) (dataLength & 0xFF), (uint8_t) (dataLength >> 8) };
+  put(lenBytes,2);
+  put((const uint8_t*) data,dataLength);
+
+  if(count > highWater)
+    highWater = count;
 }
 //------------------------------------------------------------------------------------------------------------------------------------------------------------------------
 
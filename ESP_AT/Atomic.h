@@ -7,6 +7,13 @@
 #include "TinyVector.h"
 //------------------------------------------------------------------------------------------------------------------------------------------------------------------------
 #define MAX_CLIENTS 4
+#define CIPSEND_MAX_PENDING 4 // сколько отсылок может ждать своей очереди, на следующую команда CIPSENDBUF ответит ERROR
+#define CIPSEND_RING_SIZE 1024 // кольцевой буфер между UART и сокетом
+#define CIPSEND_CHUNK_SIZE 256 // сколько байт за раз пишем в сокет
+#define EVENTS_RING_SIZE 4096 // кольцевой буфер событий, которые ждут, пока UART освободится
+#define EVENTS_RESERVE 128 // столько места в буфере событий данные сокетов не занимают - оно под статусы соединений
+#define CIPSEND_DATA_TIMEOUT 5000 // сколько мс ждать очередного байта данных отсылки, потом - SEND FAIL
+#define CIPSEND_DRAIN_GAP 100 // после SEND FAIL по таймауту вычитываем опоздавшие данные отсылки, пока UART не замолчит на столько мс, и только потом принимаем команды
 //------------------------------------------------------------------------------------------------------------------------------------------------------------------------
 class CriticalSection
 {
@@ -17,14 +24,9 @@ class CriticalSection
    static bool Triggered();
 };
 //------------------------------------------------------------------------------------------------------------------------------------------------------------------------
-typedef struct
-{
-  char* data;
-  size_t dataLength;
-  
-} EventData;
-//------------------------------------------------------------------------------------------------------------------------------------------------------------------------
-typedef Vector<EventData> MessagesList;
+// события, которые нельзя писать в UART прямо сейчас, лежат в кольцевом буфере одно за другим:
+// 2 байта длины (младший первым), затем данные события. Если буфер заполнен - событие теряется
+// и учитывается в счётчиках, поэтому данные из сокетов читаются, только пока для них есть место.
 //------------------------------------------------------------------------------------------------------------------------------------------------------------------------
 class EventsList
 {
@@ -37,8 +39,19 @@ class EventsList
     void raise(const char* evt);
     void raise(const char* data, size_t dataLength);
 
+    size_t freeSpace(); // сколько байт данных поместится в одно событие
+    size_t dataSpace(); // сколько байт данных сокета можно поднять в одно событие, не трогая резерв
+    void printStats(Stream& s);
+
   private:
-    MessagesList messages;
+    uint8_t ring[EVENTS_RING_SIZE];
+    size_t head, count;
+
+    size_t highWater; // максимальное заполнение буфера
+    uint32_t droppedEvents, droppedBytes;
+
+    void put(const uint8_t* data, size_t len);
+    void get(uint8_t* data, size_t len);
 };
 //------------------------------------------------------------------------------------------------------------------------------------------------------------------------
 extern EventsList Events;
@@ -60,12 +73,34 @@ class CipsendHandler
    void clear();
    void update();
 
-   void add(size_t dataLength,uint8_t linkID);
+   bool add(size_t dataLength,uint8_t linkID); // false - очередь отсылок заполнена
+   bool busy() { return active || draining; } // идёт приём данных отсылки, UART занят под них
+
+   void printStats(Stream& s);
 
   private:
 
-    Vector<CipsendData> data;
+    CipsendData pending[CIPSEND_MAX_PENDING]; // очередь отсылок
+    uint8_t pendingHead, pendingCount;
     uint32_t segmentID;
+
+    // текущая отсылка: данные из UART идут в кольцевой буфер и оттуда кусками - в сокет, не дожидаясь приёма всего блока
+    bool active;
+    bool failed;
+    bool draining; // отсылка прервана по таймауту, остаток её данных из UART выбрасываем
+    CipsendData current;
+    size_t received; // сколько байт отсылки уже принято из UART
+    uint8_t ring[CIPSEND_RING_SIZE];
+    uint16_t ringHead, ringCount;
+
+    uint32_t startedAt;
+    uint32_t lastDataAt;
+    uint32_t totalBytes; // всего отослано байт
+    uint32_t lastThroughput; // скорость последней отсылки, байт в секунду
+
+    void start();
+    void finish();
+    void flushRing();
   
 };
 //------------------------------------------------------------------------------------------------------------------------------------------------------------------------
@@ -12,6 +12,15 @@
 #define AT_ERROR "ERROR"
 #define AT_FAIL "FAIL"
 //----------------------------------------------------------------------------------------------------------------------------------------------------------
+// двоичные кадры с данными клиентов, включаются командой AT+CIPFRAME=1 (формат - см. CoreTransport.h прошивки контроллера):
+// 0xF5, тип (старший бит - последний кадр порции), номер клиента, номер кадра, длина (2 байта, младший первым), данные, CRC-8
+//----------------------------------------------------------------------------------------------------------------------------------------------------------
+#define FRAME_START 0xF5
+#define FRAME_DATA 1
+#define FRAME_LAST 0x80
+#define FRAME_HEADER_SIZE 6
+#define FRAME_MAX_PAYLOAD 192 // больше контроллер в свой приёмный буфер не примет
+//----------------------------------------------------------------------------------------------------------------------------------------------------------
 // variables
 //----------------------------------------------------------------------------------------------------------------------------------------------------------
 bool echoOn = true;
@@ -26,6 +35,8 @@ String apName;
 String apPassword;
 WiFiMode_t cwMode = WIFI_OFF;
 uint8_t statusHelper = 0;
+bool binaryFraming = false; // данные клиентов отдаём кадрами, а не строками +IPD
+uint8_t frameNumber = 0;
 //uint32_t segmentID = 0;
 //----------------------------------------------------------------------------------------------------------------------------------------------------------
 SerialCommand* commandStream = NULL;
@@ -655,6 +666,14 @@ void CIPSENDBUF(const char* command)
     return;    
    }
 
+   // отсылки ставятся в очередь, их данные принимаются по одной, после приглашения '>'.
+   // если очередь заполнена - контроллер должен подождать SEND OK по одной из предыдущих
+   if(!Cipsend.add(dataLength,linkID))
+   {
+    echo(command, AT_ERROR);
+    return;
+   }
+
    echo(command, AT_OK);
 
    // вот тут приглашение выводить нельзя, поскольку у нас команда могла дойти
@@ -665,8 +684,6 @@ void CIPSENDBUF(const char* command)
    // для этого надо заводить отдельную очередь для отсыла приглашений на ввод данных, сохраняя там
    // переданного клиента.
 
-   Cipsend.add(dataLength,linkID);
-
    /*
 
    Serial << '>'; // выводим приглашение
@@ -722,6 +739,26 @@ void CIPSENDBUF(const char* command)
 
 }
 //----------------------------------------------------------------------------------------------------------------------------------------------------------
+void CIPSENDSTAT(const char* command)
+{
+  CRITICAL_SECTION;
+
+  // ждут отсылки, свободных мест в очереди, всего отослано байт, скорость последней отсылки (байт/с)
+  echo(command, AT_OK,[](){
+      Cipsend.printStats(Serial);
+    });
+}
+//----------------------------------------------------------------------------------------------------------------------------------------------------------
+void EVENTSTAT(const char* command)
+{
+  CRITICAL_SECTION;
+
+  // занято байт в очереди событий, её размер, максимальное заполнение, потеряно событий, потеряно байт
+  echo(command, AT_OK,[](){
+      Events.printStats(Serial);
+    });
+}
+//----------------------------------------------------------------------------------------------------------------------------------------------------------
 void raiseClientStatus(uint8_t clientNumber, bool connected)
 {
   String message;
@@ -802,6 +839,75 @@ void handleIncomingConnections()
   }    
 }
 //----------------------------------------------------------------------------------------------------------------------------------------------------------
+void CIPFRAME(const char* command)
+{
+  CRITICAL_SECTION;
+
+   char* arg = commandStream->next();
+   if(!arg || (*arg != '0' && *arg != '1'))
+   {
+    echo(command, AT_ERROR);
+    return;
+   }
+
+   // OK уходит ещё в текстовом режиме, всё, что после него - уже кадрами
+   echo(command, AT_OK);
+   binaryFraming = (*arg == '1');
+}
+//----------------------------------------------------------------------------------------------------------------------------------------------------------
+// CRC-8, полином 0x8C, по полбайта за шаг - должна совпадать с Main/Crc8.cpp (прошивка ESP собирается отдельным скетчем)
+const uint8_t crc8Table[16] PROGMEM = {
+  0x00, 0x9D, 0x23, 0xBE, 0x46, 0xDB, 0x65, 0xF8, 0x8C, 0x11, 0xAF, 0x32, 0xCA, 0x57, 0xE9, 0x74
+};
+//----------------------------------------------------------------------------------------------------------------------------------------------------------
+uint8_t crc8(const uint8_t* data, size_t len)
+{
+  uint8_t crc = 0;
+  while(len--)
+  {
+    crc ^= *data++;
+    crc = (crc >> 4) ^ pgm_read_byte(&crc8Table[crc & 0x0F]);
+    crc = (crc >> 4) ^ pgm_read_byte(&crc8Table[crc & 0x0F]);
+  }
+  return crc;
+}
+//----------------------------------------------------------------------------------------------------------------------------------------------------------
+void handleClientFrames(uint8_t clientNumber, WiFiClient& client)
+{
+  // читаем данные сразу на место в кадре - без посимвольной сборки строки
+  static uint8_t frame[FRAME_HEADER_SIZE + FRAME_MAX_PAYLOAD + 1];
+
+  // порция данных, которая уже есть у клиента, уходит несколькими кадрами, последний помечается флагом
+  int available = client.available();
+  while(available > 0)
+  {
+    // читаем из сокета, только пока кадр влезет в очередь событий, остальное подождёт в сокете
+    size_t room = Events.dataSpace();
+    if(room <= FRAME_HEADER_SIZE + 1)
+      break;
+
+    int toRead = min(available, FRAME_MAX_PAYLOAD);
+    if((size_t) toRead > room - FRAME_HEADER_SIZE - 1)
+      toRead = room - FRAME_HEADER_SIZE - 1;
+      
+    int readed = client.read(frame + FRAME_HEADER_SIZE, toRead);
+    if(readed <= 0)
+      break;
+
+    available -= readed;
+
+    frame[0] = FRAME_START;
+    frame[1] = FRAME_DATA | (available > 0 ? 0 : FRAME_LAST);
+    frame[2] = clientNumber;
+    frame[3] = frameNumber++; // кадры с одинаковыми данными не должны склеиться в очереди событий
+    frame[4] = readed & 0xFF;
+    frame[5] = readed >> 8;
+    frame[FRAME_HEADER_SIZE + readed] = crc8(frame + 1, FRAME_HEADER_SIZE - 1 + readed);
+
+    Events.raise((const char*) frame, FRAME_HEADER_SIZE + readed + 1);
+  }
+}
+//----------------------------------------------------------------------------------------------------------------------------------------------------------
 void handleClientData(uint8_t clientNumber, WiFiClient& client)
 {
   const uint16_t buf_sz = 2048;
@@ -809,10 +915,24 @@ void handleClientData(uint8_t clientNumber, WiFiClient& client)
 
   if(!client.available())
     return;
+
+  if(binaryFraming)
+  {
+    handleClientFrames(clientNumber,client);
+    return;
+  }
+  
+  // читаем столько, сколько строка +IPD,ID,LEN:...\r\n поместит в очередь событий, остальное подождёт в сокете
+  const size_t ipd_overhead = 16;
+  size_t room = Events.dataSpace();
+  if(room <= ipd_overhead)
+    return;
+
+  size_t toRead = min((size_t) buf_sz, room - ipd_overhead);
   
   memset(read_buff,0,buf_sz);
 
-  int readed = client.read(read_buff,buf_sz);
+  int readed = client.read(read_buff,toRead);
   if(readed > 0)
   {
     // есть данные, сообщаем о них. Приходится через raise, чтобы не вклиниться между команд
@@ -921,6 +1041,9 @@ void setup()
   commandStream->addCommand("AT+CIPSTART",CIPSTART);
   commandStream->addCommand("AT+CIPSENDBUF",CIPSENDBUF);
   commandStream->addCommand("AT+CIPSEND",CIPSENDBUF);
+  commandStream->addCommand("AT+CIPFRAME",CIPFRAME);
+  commandStream->addCommand("AT+CIPSENDSTAT?",CIPSENDSTAT);
+  commandStream->addCommand("AT+EVENTSTAT?",EVENTSTAT);
   
   DBGLN(F("Known commands inited."));
   
@@ -935,8 +1058,9 @@ void loop()
 {
   
   // здесь мы уже обработали входящую команду, если это запрос на подсоединение -
-  // слот клиента будет занят
-  commandStream->readSerial();
+  // слот клиента будет занят. Пока принимаются данные отсылки - UART принадлежит им
+  if(!Cipsend.busy())
+    commandStream->readSerial();
 
   // теперь отрабатываем соединения от сервера
   if(!commandStream->waitingCommand())
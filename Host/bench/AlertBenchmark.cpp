@@ -0,0 +1,353 @@
+//--------------------------------------------------------------------------------------------------------------------------------
+// Бенчмарк проверки правил модуля ALERT: MAX_ALERT_RULES правил разных видов (температура, влажность, освещённость, пин,
+// порог из настроек, слежение за отсутствием показаний) проверяются на синтетических показаниях датчиков:
+//  - прежним способом - switch по виду правила, копия пары показаний, switch по операнду (перенесён сюда как был);
+//  - AlertRule::HasAlert, когда показания изменились - полная проверка скомпилированного правила;
+//  - AlertRule::HasAlert, когда показания не менялись - закэшированный результат.
+//
+// Запуск: alert_benchmark [кол-во проходов по всем правилам, тысяч; по умолчанию - 100]
+// Код возврата ненулевой, если скомпилированные правила и прежняя проверка разошлись хоть в одном результате
+//--------------------------------------------------------------------------------------------------------------------------------
+#include <time.h>
+#include <Arduino.h>
+#include <HostHardware.h>
+#include "ModuleController.h"
+#include "CommandParser.h"
+#include "AlertModule.h"
+//--------------------------------------------------------------------------------------------------------------------------------
+typedef struct
+{
+  const char* Module; // модуль, за показаниями которого следит правило
+  const char* Target; // за чем следим
+  uint8_t Type; // RuleTarget
+  ModuleStates State; // тип состояния, которое читает правило
+  const char* Operand;
+  uint8_t Op; // RuleOperand
+  const char* Value; // порог
+
+} RuleTemplate;
+//--------------------------------------------------------------------------------------------------------------------------------
+static const RuleTemplate TEMPLATES[] =
+{
+  { "STATE", "TEMP", rtTemp, StateTemperature, ">", roGreaterThan, "25" },
+  { "STATE", "TEMP", rtTemp, StateTemperature, "<", roLessThan, "%TO%" },
+  { "STATE", "TEMP", rtTemp, StateTemperature, ">=", roGreaterOrEqual, "%TC%" },
+  { "STATE", "TEMP", rtTemp, StateTemperature, "<=", roLessOrEqual, "-128" }, // нет показаний
+  { "HUMIDITY", "HUMIDITY", rtHumidity, StateHumidity, ">=", roGreaterOrEqual, "70" },
+  { "HUMIDITY", "HUMIDITY", rtHumidity, StateHumidity, "<", roLessThan, "40" },
+  { "HUMIDITY", "TEMP", rtTemp, StateTemperature, "<=", roLessOrEqual, "18" },
+  { "LIGHT", "LIGHT", rtLuminosity, StateLuminosity, "<", roLessThan, "1500" },
+  { "LIGHT", "LIGHT", rtLuminosity, StateLuminosity, "<=", roLessOrEqual, "-1" }, // нет показаний
+  { "0", "PIN", rtPinState, StateUnknown, ">=", roGreaterOrEqual, "1" },
+};
+#define TEMPLATES_COUNT (sizeof(TEMPLATES)/sizeof(TEMPLATES[0]))
+#define RULE_PIN 30 // пин, за которым следят правила PIN
+#define NO_DATA_EVERY 7 // каждый такой проход первый датчик модуля STATE теряется
+//--------------------------------------------------------------------------------------------------------------------------------
+static uint64_t realNanos()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t) ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+// прежняя проверка правила, как она была до компиляции правил - для сравнения
+//--------------------------------------------------------------------------------------------------------------------------------
+class LegacyRule
+{
+  public:
+    LegacyRule() : module(NULL), state(NULL), resolved(false) {}
+
+    void Construct(AbstractModule* m, uint8_t target, uint8_t sensorIndex, uint8_t operand, const char* value)
+    {
+      module = m;
+      Target = target;
+      SensorIndex = sensorIndex;
+      Operand = operand;
+      DataSource = tsPassed;
+      if(!strcmp(value, "%TO%"))
+        DataSource = tsOpenTemperature;
+      else if(!strcmp(value, "%TC%"))
+        DataSource = tsCloseTemperature;
+      DataAlert = atol(value);
+      resolved = false;
+    }
+
+    bool Check()
+    {
+      switch(Target)
+      {
+        case rtTemp:
+        {
+          OneState* os = getState(StateTemperature);
+          if(!os)
+            return false;
+
+          TemperaturePair tp = *os;
+          int8_t curTemp = tp.Current.Value;
+          int8_t tAlert = (int8_t) DataAlert;
+
+          if(curTemp == NO_TEMPERATURE_DATA)
+          {
+            OneState* reservedState = MainController->GetReservedState(module, StateTemperature, SensorIndex);
+            if(!reservedState)
+              return (curTemp == tAlert);
+
+            TemperaturePair rtp = *reservedState;
+            curTemp = rtp.Current.Value;
+          }
+
+          switch(DataSource)
+          {
+            case tsOpenTemperature: tAlert = MainController->GetSettings()->GetOpenTemp(); break;
+            case tsCloseTemperature: tAlert = MainController->GetSettings()->GetCloseTemp(); break;
+          }
+
+          return compare(curTemp, tAlert);
+        }
+
+        case rtLuminosity:
+        {
+          if(DataAlert == -2)
+            return true;
+
+          OneState* os = getState(StateLuminosity);
+          if(!os)
+            return false;
+
+          LuminosityPair lp = *os;
+          long lum = lp.Current;
+          if(lum == NO_LUMINOSITY_DATA)
+          {
+            OneState* reservedState = MainController->GetReservedState(module, StateLuminosity, SensorIndex);
+            if(!reservedState)
+              return (lum == DataAlert);
+
+            LuminosityPair rlp = *reservedState;
+            lum = rlp.Current;
+          }
+
+          return compare(lum, DataAlert);
+        }
+
+        case rtHumidity:
+        {
+          OneState* os = getState(StateHumidity);
+          if(!os)
+            return false;
+
+          HumidityPair hp = *os;
+          int8_t curHumidity = hp.Current.Value;
+          int8_t humidityAlert = DataAlert;
+          if(curHumidity == NO_TEMPERATURE_DATA)
+          {
+            OneState* reservedState = MainController->GetReservedState(module, StateHumidity, SensorIndex);
+            if(!reservedState)
+              return (curHumidity == DataAlert);
+
+            HumidityPair rhp = *reservedState;
+            curHumidity = rhp.Current.Value;
+          }
+
+          return compare(curHumidity, humidityAlert);
+        }
+
+        case rtPinState:
+        {
+          WORK_STATUS.PinMode(SensorIndex, INPUT);
+          int pinState = digitalRead(SensorIndex);
+          switch(Operand)
+          {
+            case roLessThan:
+            case roLessOrEqual: return pinState < DataAlert;
+            default: return pinState >= DataAlert;
+          }
+        }
+      } // switch
+
+      return true;
+    }
+
+  private:
+    AbstractModule* module;
+    OneState* state;
+    bool resolved;
+    uint8_t Target, SensorIndex, Operand, DataSource;
+    long DataAlert;
+
+    OneState* getState(ModuleStates type)
+    {
+      if(!resolved)
+      {
+        state = module->State.HasState(type) ? module->State.GetState(type, SensorIndex) : NULL;
+        resolved = true;
+      }
+      return state;
+    }
+
+    bool compare(long value, long threshold)
+    {
+      switch(Operand)
+      {
+        case roLessThan: return value < threshold;
+        case roLessOrEqual: return value <= threshold;
+        case roGreaterThan: return value > threshold;
+        case roGreaterOrEqual: return value >= threshold;
+        default: return false;
+      }
+    }
+};
+//--------------------------------------------------------------------------------------------------------------------------------
+static AlertRule* rules[MAX_ALERT_RULES];
+static LegacyRule legacyRules[MAX_ALERT_RULES];
+static size_t rulesCount = 0;
+//--------------------------------------------------------------------------------------------------------------------------------
+static uint8_t sensorsCount(AbstractModule* m, ModuleStates type)
+{
+  return (m && type != StateUnknown) ? m->State.GetStateCount(type) : 0;
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+static bool buildRules()
+{
+  CommandParser parser;
+  char buff[128];
+
+  for(size_t i = 0; i < MAX_ALERT_RULES; i++)
+  {
+    const RuleTemplate* t = &TEMPLATES[i % TEMPLATES_COUNT];
+    AbstractModule* m = MainController->GetModuleByID(t->Module);
+    if(!m)
+      continue;
+
+    uint8_t cnt = sensorsCount(m, t->State);
+    uint8_t sensorIndex = t->Type == rtPinState ? RULE_PIN : (cnt ? (i / TEMPLATES_COUNT) % cnt : 0);
+
+    sprintf(buff, "CTSET=ALERT|RULE_ADD|R%u|%s|%s|%u|%s|%s|0|0|255|_|0|CTSET=STATE|WINDOW|ALL|OPEN",
+      (unsigned) i, t->Module, t->Target, sensorIndex, t->Operand, t->Value);
+
+    Command cmd;
+    if(!parser.ParseCommand(buff, cmd))
+      return false;
+
+    AlertRule* rule = new AlertRule;
+    if(!rule->Construct(m, cmd))
+      return false;
+
+    rule->Update(0, 12, 0, 3); // правила работают в любое время, день недели - любой из маски
+
+    rules[rulesCount] = rule;
+    legacyRules[rulesCount].Construct(m, t->Type, sensorIndex, t->Op, t->Value);
+    rulesCount++;
+  }
+
+  return rulesCount == MAX_ALERT_RULES;
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+static void updateModule(AbstractModule* m, uint32_t pass)
+{
+  if(!m)
+    return;
+
+  static const ModuleStates types[] = { StateTemperature, StateHumidity };
+  for(size_t t = 0; t < sizeof(types)/sizeof(types[0]); t++)
+  {
+    uint8_t cnt = m->State.GetStateCount(types[t]);
+    for(uint8_t i = 0; i < cnt; i++)
+    {
+      OneState* os = m->State.GetStateByOrder(types[t], i);
+      Temperature val;
+      val.Value = (int8_t) ((types[t] == StateTemperature ? 10 : 30) + (pass * 7 + i * 13) % 40);
+      val.Fract = (pass * 3) % 100;
+      if(types[t] == StateTemperature && i == 0 && pass % NO_DATA_EVERY == 0 && !strcmp(m->GetID(), "STATE"))
+        val.Value = NO_TEMPERATURE_DATA;
+      m->State.UpdateState(types[t], os->GetIndex(), &val);
+    }
+  }
+
+  uint8_t cnt = m->State.GetStateCount(StateLuminosity);
+  for(uint8_t i = 0; i < cnt; i++)
+  {
+    OneState* os = m->State.GetStateByOrder(StateLuminosity, i);
+    long lum = (pass % NO_DATA_EVERY == 3) ? NO_LUMINOSITY_DATA : (long) ((pass * 211 + i * 500) % 4000);
+    m->State.UpdateState(StateLuminosity, os->GetIndex(), &lum);
+  }
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+static void updateSensors(uint32_t pass)
+{
+  updateModule(MainController->GetModuleByID("STATE"), pass);
+  updateModule(MainController->GetModuleByID("HUMIDITY"), pass);
+  updateModule(MainController->GetModuleByID("LIGHT"), pass);
+  Host::SetDigital(RULE_PIN, (pass / 3) & 1);
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+  long thousands = argc > 1 ? atol(argv[1]) : 100;
+  if(thousands < 1)
+    thousands = 1;
+  uint32_t passes = (uint32_t) thousands * 1000;
+
+  setup();
+  Serial.ClearSent();
+
+  if(!buildRules())
+  {
+    printf("ERROR: built %lu of %d rules\n", (unsigned long) rulesCount, MAX_ALERT_RULES);
+    return 1;
+  }
+
+  uint64_t legacyNanos = 0, compiledNanos = 0, cachedNanos = 0;
+  uint32_t mismatches = 0, raised = 0;
+  bool results[MAX_ALERT_RULES];
+
+  for(uint32_t pass = 0; pass < passes; pass++)
+  {
+    updateSensors(pass);
+
+    uint64_t startedAt = realNanos();
+    for(size_t i = 0; i < rulesCount; i++)
+      results[i] = rules[i]->HasAlert();
+    compiledNanos += realNanos() - startedAt;
+
+    startedAt = realNanos();
+    for(size_t i = 0; i < rulesCount; i++)
+    {
+      bool legacy = legacyRules[i].Check();
+      if(legacy != results[i])
+      {
+        if(!mismatches)
+          printf("ERROR: rule %s: compiled %d, legacy %d on pass %lu\n", rules[i]->GetName(), results[i], legacy, (unsigned long) pass);
+        mismatches++;
+      }
+      raised += legacy ? 1 : 0;
+    }
+    legacyNanos += realNanos() - startedAt;
+
+    // показания не менялись - правила, не зависящие от пина и настроек, отдают закэшированный результат
+    startedAt = realNanos();
+    for(size_t i = 0; i < rulesCount; i++)
+    {
+      if(rules[i]->HasAlert() != results[i])
+        mismatches++;
+    }
+    cachedNanos += realNanos() - startedAt;
+  }
+
+  double evaluations = (double) passes * rulesCount;
+  printf("%lu rules, %lu passes, %.1f%% raised\n", (unsigned long) rulesCount, (unsigned long) passes, raised * 100.0 / evaluations);
+  printf("\n%-32s %12s\n", "CHECK", "NS/RULE");
+  printf("%-32s %12.1f\n", "legacy switch", legacyNanos / evaluations);
+  printf("%-32s %12.1f\n", "HasAlert, data changed", compiledNanos / evaluations);
+  printf("%-32s %12.1f\n", "HasAlert, data unchanged", cachedNanos / evaluations);
+  printf("\nsizeof(AlertRule) = %lu, sizeof(RulePredicate) = %lu\n", (unsigned long) sizeof(AlertRule), (unsigned long) sizeof(RulePredicate));
+
+  if(mismatches)
+  {
+    printf("ERROR: %lu mismatches\n", (unsigned long) mismatches);
+    return 1;
+  }
+
+  return 0;
+}
+//--------------------------------------------------------------------------------------------------------------------------------
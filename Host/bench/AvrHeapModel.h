@@ -0,0 +1,187 @@
+#ifndef _AVR_HEAP_MODEL_H
+#define _AVR_HEAP_MODEL_H
+//--------------------------------------------------------------------------------------------------------------------------------
+// Модель кучи avr-libc для оценки фрагментации на хосте. Получает выделения/освобождения прошивки через
+// Host::SetHeapTrace и раскладывает их так же, как malloc из avr-libc:
+//  - у каждого блока 2 байта заголовка, меньше 2 байт не выделяется;
+//  - из списка свободных кусков берётся точно подходящий, иначе - наименьший из подходящих, от которого
+//    отрезается верхняя часть (остаток меньше 4 байт не отрезается);
+//  - если подходящего куска нет - куча растёт вверх (__brkval);
+//  - освобождённые соседние куски сливаются, кусок у вершины кучи возвращается в зазор между кучей и стеком.
+// realloc моделируется как free + malloc (avr-libc умеет расширять блок на месте - модель чуть пессимистичнее).
+//--------------------------------------------------------------------------------------------------------------------------------
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+//--------------------------------------------------------------------------------------------------------------------------------
+#define AVR_HEAP_MAX_BLOCKS 1024 // живых блоков одновременно
+#define AVR_HEAP_MAX_CHUNKS 1024 // свободных кусков одновременно
+#define AVR_HEAP_HEADER 2 // заголовок блока - его длина
+#define AVR_HEAP_MIN_SPLIT 4 // sizeof(struct __freelist): меньший остаток не отрезается
+//--------------------------------------------------------------------------------------------------------------------------------
+class AvrHeapModel
+{
+  private:
+
+    typedef struct
+    {
+      void* ptr;
+      size_t offset;
+      size_t size;
+      
+    } Block;
+
+    typedef struct
+    {
+      size_t offset;
+      size_t size;
+      
+    } Chunk;
+
+    Block blocks[AVR_HEAP_MAX_BLOCKS];
+    size_t blocksCount;
+    Chunk chunks[AVR_HEAP_MAX_CHUNKS]; // отсортированы по адресу
+    size_t chunksCount;
+    size_t brk; // вершина кучи
+    size_t brkHighWater;
+
+    size_t Take(size_t& need) // need - размер блока; если кусок отдан целиком, становится размером куска
+    {
+      int best = -1;
+      for(size_t i = 0; i < chunksCount; i++)
+      {
+        if(chunks[i].size == need)
+        {
+          best = (int) i;
+          break;
+        }
+        if(chunks[i].size > need && (best < 0 || chunks[i].size < chunks[best].size))
+          best = (int) i;
+      }
+
+      if(best < 0) // подходящего куска нет - растим кучу
+      {
+        size_t offset = brk;
+        brk += need;
+        if(brk > brkHighWater)
+          brkHighWater = brk;
+        return offset;
+      }
+
+      Chunk& c = chunks[best];
+      if(c.size - need < AVR_HEAP_MIN_SPLIT) // остаток мал - отдаём кусок целиком
+      {
+        size_t offset = c.offset;
+        need = c.size;
+        memmove(chunks + best, chunks + best + 1, (chunksCount - best - 1) * sizeof(Chunk));
+        chunksCount--;
+        return offset;
+      }
+
+      c.size -= need;
+      return c.offset + c.size;
+    }
+
+    void Release(size_t offset, size_t size)
+    {
+      size_t pos = 0;
+      while(pos < chunksCount && chunks[pos].offset < offset)
+        pos++;
+
+      if(chunksCount >= AVR_HEAP_MAX_CHUNKS)
+        return;
+
+      memmove(chunks + pos + 1, chunks + pos, (chunksCount - pos) * sizeof(Chunk));
+      chunks[pos].offset = offset;
+      chunks[pos].size = size;
+      chunksCount++;
+
+      // сливаем с соседями
+      if(pos + 1 < chunksCount && chunks[pos].offset + chunks[pos].size == chunks[pos + 1].offset)
+      {
+        chunks[pos].size += chunks[pos + 1].size;
+        memmove(chunks + pos + 1, chunks + pos + 2, (chunksCount - pos - 2) * sizeof(Chunk));
+        chunksCount--;
+      }
+      if(pos > 0 && chunks[pos - 1].offset + chunks[pos - 1].size == chunks[pos].offset)
+      {
+        chunks[pos - 1].size += chunks[pos].size;
+        memmove(chunks + pos, chunks + pos + 1, (chunksCount - pos - 1) * sizeof(Chunk));
+        chunksCount--;
+      }
+
+      // последний кусок у вершины - возвращаем его
+      if(chunksCount && chunks[chunksCount - 1].offset + chunks[chunksCount - 1].size == brk)
+      {
+        brk = chunks[chunksCount - 1].offset;
+        chunksCount--;
+      }
+    }
+
+  public:
+
+    AvrHeapModel() { Reset(); }
+
+    void Reset()
+    {
+      blocksCount = 0;
+      chunksCount = 0;
+      brk = 0;
+      brkHighWater = 0;
+    }
+
+    void Trace(void* ptr, size_t size)
+    {
+      if(size) // выделение
+      {
+        if(blocksCount >= AVR_HEAP_MAX_BLOCKS)
+          return;
+
+        size_t need = AVR_HEAP_HEADER + (size < 2 ? 2 : size);
+        Block& b = blocks[blocksCount++];
+        b.ptr = ptr;
+        b.offset = Take(need);
+        b.size = need;
+        return;
+      }
+
+      for(size_t i = 0; i < blocksCount; i++)
+      {
+        if(blocks[i].ptr != ptr)
+          continue;
+
+        Block b = blocks[i];
+        blocks[i] = blocks[--blocksCount];
+        Release(b.offset, b.size);
+        return;
+      }
+    }
+
+    size_t Break() const { return brk; } // сколько занимает куча сейчас, вместе с дырами
+    size_t BreakHighWater() const { return brkHighWater; } // на сколько куча максимально подходила к стеку
+    size_t LiveBlocks() const { return blocksCount; }
+    size_t LiveBytes() const // занято блоками, вместе с заголовками
+    {
+      size_t sum = 0;
+      for(size_t i = 0; i < blocksCount; i++)
+        sum += blocks[i].size;
+      return sum;
+    }
+    size_t FreeBytes() const // дыры под вершиной кучи
+    {
+      size_t sum = 0;
+      for(size_t i = 0; i < chunksCount; i++)
+        sum += chunks[i].size;
+      return sum;
+    }
+    size_t LargestFree() const
+    {
+      size_t largest = 0;
+      for(size_t i = 0; i < chunksCount; i++)
+        if(chunks[i].size > largest)
+          largest = chunks[i].size;
+      return largest;
+    }
+};
+//--------------------------------------------------------------------------------------------------------------------------------
+#endif
@@ -0,0 +1,266 @@
+//--------------------------------------------------------------------------------------------------------------------------------
+// Воспроизведение трафика ESP8266 через CoreESPTransport: прошивка целиком (setup()/loop()), на Serial2 - модель
+// ESP8266 (HostEsp8266.h). Сеанс повторяет запись обмена с ESP-01: инициализация модуля, опрос контроллера
+// вебмордой/приложением (соединение, команда CTGET/CTSET, ответ через AT+CIPSENDBUF, разрыв) и поток больших
+// пакетов по 1460 байт, как при загрузке файла. Прогоняется дважды - данные клиентов через +IPD и двоичными кадрами.
+// Выводит:
+//  - скорость приёма данных клиентов (байт полезных данных и байт из UART в секунду);
+//  - пиковое занятие кучи за время воспроизведения и статическую память транспорта.
+//
+// Запуск: esp_replay_benchmark [кол-во повторов сеанса; по умолчанию - 200]
+// Код возврата ненулевой, если данные дошли до подписчика не целиком или не в том порядке, или на запрос не пришёл ответ
+//--------------------------------------------------------------------------------------------------------------------------------
+#include <time.h>
+#include <Arduino.h>
+#include <HostHardware.h>
+#include <HostEsp8266.h>
+#include "CoreTransport.h"
+#include "ModuleController.h"
+//--------------------------------------------------------------------------------------------------------------------------------
+#define LOOP_STEP_MS 5 // модельное время одного прохода loop()
+#define MAX_WAIT_LOOPS 2000 // столько проходов loop() ждём ответа, прежде чем считать, что его не будет
+#define BULK_CLIENT 3 // клиент, который шлёт большие пакеты
+#define BULK_PACKETS 8 // больших пакетов на сеанс
+#define BULK_PACKET_SIZE 1460 // ESP отдаёт не больше одного TCP-сегмента за раз
+//--------------------------------------------------------------------------------------------------------------------------------
+typedef struct
+{
+  uint8_t client;
+  const char* request;
+  
+} ReplayRequest;
+//--------------------------------------------------------------------------------------------------------------------------------
+// запросы из записи сеанса: приложение опрашивает состояние, вебморда меняет настройки
+static const ReplayRequest SESSION[] =
+{
+  { 0, "CTGET=0|PING\r\n" },
+  { 0, "CTGET=STAT|FREERAM\r\n" },
+  { 1, "CTGET=STATE|TEMP|ALL\r\n" },
+  { 0, "CTGET=0|STATUS\r\n" },
+  { 2, "GET / HTTP/1.1\r\nHost: 192.168.4.1\r\nUser-Agent: Mozilla/5.0\r\nAccept: */*\r\n\r\nCTGET=STATE|TOPEN\r\n" },
+  { 1, "CTSET=STATE|TOPEN|24\r\n" },
+  { 0, "CTGET=WATER|T_SETT\r\n" },
+  { 1, "CTGET=LIGHT|STATE\r\n" },
+};
+#define SESSION_COUNT (sizeof(SESSION)/sizeof(SESSION[0]))
+//--------------------------------------------------------------------------------------------------------------------------------
+static HostEsp8266 esp;
+//--------------------------------------------------------------------------------------------------------------------------------
+// подписчик транспорта, который сверяет поток данных каждого клиента с тем, что отдала модель ESP
+//--------------------------------------------------------------------------------------------------------------------------------
+class PayloadChecker : public IClientEventsSubscriber
+{
+  public:
+    uint32_t crc[ESP_MAX_CLIENTS]; // контрольная сумма принятого
+    uint32_t bytes[ESP_MAX_CLIENTS];
+    uint32_t done[ESP_MAX_CLIENTS]; // сколько раз пришёл флаг "все данные приняты"
+
+    PayloadChecker() { Reset(); }
+    void Reset()
+    {
+      memset(crc, 0, sizeof(crc));
+      memset(bytes, 0, sizeof(bytes));
+      memset(done, 0, sizeof(done));
+    }
+
+    static uint32_t Update(uint32_t c, const uint8_t* data, size_t len)
+    {
+      while(len--)
+        c = (c << 5) + c + *data++; // djb2 - важен порядок байт
+      return c;
+    }
+
+    virtual void OnClientConnect(CoreTransportClient&, bool, int16_t) {}
+    virtual void OnClientDataWritten(CoreTransportClient&, int16_t) {}
+    virtual void OnClientDataAvailable(CoreTransportClient& client, uint8_t* data, size_t dataSize, bool isDone)
+    {
+      // номер клиента снаружи не виден - находим его по пулу транспорта через сравнение клиентов
+      for(uint8_t i = 0; i < ESP_MAX_CLIENTS; i++)
+      {
+        if(client != *clients[i])
+          continue;
+
+        crc[i] = Update(crc[i], data, dataSize);
+        bytes[i] += dataSize;
+        if(isDone)
+          done[i]++;
+        break;
+      }
+    }
+
+    CoreTransportClient* clients[ESP_MAX_CLIENTS];
+};
+//--------------------------------------------------------------------------------------------------------------------------------
+// клиент с заданным номером сокета, только чтобы сравнивать с ним клиентов из событий
+class ProbeClient : public CoreTransportClient
+{
+  public:
+    ProbeClient(uint8_t s) { bind(s); }
+};
+//--------------------------------------------------------------------------------------------------------------------------------
+static PayloadChecker checker;
+static uint32_t expectedCRC[ESP_MAX_CLIENTS];
+static uint32_t expectedBytes[ESP_MAX_CLIENTS];
+static uint64_t loopMicros; // реальное время, проведённое в loop() во время воспроизведения
+//--------------------------------------------------------------------------------------------------------------------------------
+static uint64_t realMicros()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t) ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000;
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+static void runLoop()
+{
+  uint64_t startedAt = realMicros();
+  Host::RunLoop();
+  loopMicros += realMicros() - startedAt;
+  Host::AdvanceMillis(LOOP_STEP_MS);
+  Serial.ClearSent();
+  Serial2.ClearSent();
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+static bool waitReady(bool framing)
+{
+  for(int i = 0; i < MAX_WAIT_LOOPS; i++)
+  {
+    if(ESP.ready() && esp.ServerStarted() && esp.FramingEnabled() == framing)
+      return true;
+    runLoop();
+  }
+  return false;
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+static void sendData(uint8_t client, const uint8_t* data, size_t len)
+{
+  expectedCRC[client] = PayloadChecker::Update(expectedCRC[client], data, len);
+  expectedBytes[client] += len;
+  esp.SendData(client, data, len);
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+static bool waitDelivered(uint8_t client)
+{
+  for(int i = 0; i < MAX_WAIT_LOOPS && checker.bytes[client] < expectedBytes[client]; i++)
+    runLoop();
+  return checker.bytes[client] == expectedBytes[client];
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+static bool replaySession(uint32_t& answered)
+{
+  bool ok = true;
+
+  for(size_t i = 0; i < SESSION_COUNT; i++)
+  {
+    const ReplayRequest& r = SESSION[i];
+    esp.ClearReply(r.client);
+    esp.Connect(r.client);
+    runLoop();
+
+    uint32_t sends = esp.SendsCompleted();
+    sendData(r.client, (const uint8_t*) r.request, strlen(r.request));
+    ok = waitDelivered(r.client) && ok;
+
+    // ждём ответа контроллера клиенту
+    for(int j = 0; j < MAX_WAIT_LOOPS && esp.SendsCompleted() == sends; j++)
+      runLoop();
+
+    if(esp.SendsCompleted() != sends && esp.ReplyLength(r.client))
+      answered++;
+
+    esp.Close(r.client);
+    runLoop();
+  }
+
+  // поток больших пакетов, как при загрузке файла: данные без команды контроллер просто выбрасывает
+  static uint8_t packet[BULK_PACKET_SIZE];
+  esp.Connect(BULK_CLIENT);
+  runLoop();
+  for(int i = 0; i < BULK_PACKETS; i++)
+  {
+    for(size_t j = 0; j < sizeof(packet); j++)
+      packet[j] = (uint8_t) ('a' + (i * 7 + j) % 26);
+
+    sendData(BULK_CLIENT, packet, sizeof(packet));
+    ok = waitDelivered(BULK_CLIENT) && ok;
+  }
+  esp.Close(BULK_CLIENT);
+  runLoop();
+
+  return ok;
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+static bool replay(const char* title, bool framing, uint32_t rounds)
+{
+  esp.SetFramingSupported(framing);
+  ESP.restart();
+  if(!waitReady(framing))
+  {
+    printf("ERROR: %s: ESP transport not ready\n", title);
+    return false;
+  }
+
+  checker.Reset();
+  memset(expectedCRC, 0, sizeof(expectedCRC));
+  memset(expectedBytes, 0, sizeof(expectedBytes));
+  loopMicros = 0;
+  unsigned long wireStart = Serial2.TotalRead();
+  uint32_t payloadStart = esp.PayloadBytes();
+  Host::ResetHeapStat();
+  size_t heapStart = Host::GetHeapStat()->Current;
+
+  bool ok = true;
+  uint32_t answered = 0;
+  for(uint32_t i = 0; i < rounds; i++)
+    ok = replaySession(answered) && ok;
+
+  const HostHeapStat* hs = Host::GetHeapStat();
+  unsigned long wireBytes = Serial2.TotalRead() - wireStart;
+  uint32_t payloadBytes = esp.PayloadBytes() - payloadStart;
+  double seconds = loopMicros / 1e6;
+
+  printf("%-8s %10.0f %12.0f %10lu %10lu %10lu %9lu/%lu\n", title, seconds > 0 ? payloadBytes / seconds : 0.0,
+    seconds > 0 ? wireBytes / seconds : 0.0, (unsigned long) (hs->Peak - heapStart), (unsigned long) hs->Allocs,
+    (unsigned long) payloadBytes, (unsigned long) answered, (unsigned long) (rounds * SESSION_COUNT));
+
+  for(uint8_t i = 0; i < ESP_MAX_CLIENTS; i++)
+  {
+    if(checker.bytes[i] != expectedBytes[i] || checker.crc[i] != expectedCRC[i])
+    {
+      printf("ERROR: %s: client #%d got %lu of %lu bytes%s\n", title, i, (unsigned long) checker.bytes[i],
+        (unsigned long) expectedBytes[i], checker.crc[i] != expectedCRC[i] ? ", data mismatch" : "");
+      ok = false;
+    }
+  }
+
+  if(answered != rounds * SESSION_COUNT)
+  {
+    printf("ERROR: %s: %lu of %lu requests answered\n", title, (unsigned long) answered, (unsigned long) (rounds * SESSION_COUNT));
+    ok = false;
+  }
+
+  return ok;
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+  long rounds = argc > 1 ? atol(argv[1]) : 200;
+  if(rounds < 1)
+    rounds = 1;
+
+  esp.Attach(Serial2);
+  setup();
+
+  for(uint8_t i = 0; i < ESP_MAX_CLIENTS; i++)
+    checker.clients[i] = new ProbeClient(i);
+  ESP.subscribe(&checker);
+
+  printf("%-8s %10s %12s %10s %10s %10s %12s\n", "MODE", "PAYLOAD B/s", "UART B/s", "HEAP PEAK", "ALLOCS", "PAYLOAD", "ANSWERED");
+  bool ok = replay("+IPD", false, (uint32_t) rounds);
+  ok = replay("frames", true, (uint32_t) rounds) && ok;
+
+  printf("\nstatic RAM: CoreESPTransport %lu bytes (receive ring %d bytes)\n", (unsigned long) sizeof(CoreESPTransport), ESP_RECEIVE_BUFFER_SIZE);
+  printf("AT commands received by ESP model: %lu\n", (unsigned long) esp.Commands());
+
+  return ok ? 0 : 1;
+}
+//--------------------------------------------------------------------------------------------------------------------------------
@@ -0,0 +1,244 @@
+//--------------------------------------------------------------------------------------------------------------------------------
+// Бенчмарк главного цикла прошивки на хосте.
+// Запускает setup() из Main.ino, затем N тысяч проходов loop() с меняющимися по сценарию показаниями датчиков и
+// командами в Serial, и выводит:
+//  - стоимость Update() каждого модуля (по данным USE_LOOP_PROFILER);
+//  - пиковое занятие кучи в setup() и в главном цикле;
+//  - скорость разбора команд CommandParser::ParseCommand и полной обработки команды контроллером.
+//
+// Запуск: loop_benchmark [кол-во проходов loop(), тысяч; по умолчанию - 10]
+// Время модельное: каждый проход прокручивает LOOP_STEP_MS, поэтому периодические модули отрабатывают как в поле,
+// а реальное время выполнения Update() всё равно входит в micros() и попадает в статистику
+//--------------------------------------------------------------------------------------------------------------------------------
+#include <time.h>
+#include <Arduino.h>
+#include <HostHardware.h>
+#include <HostDevices.h>
+#include <OneWire.h>
+#include <SdFat.h>
+#include "ModuleController.h"
+#include "CommandParser.h"
+#include "Memory.h"
+//--------------------------------------------------------------------------------------------------------------------------------
+#define LOOP_STEP_MS 10 // модельное время одного прохода loop()
+#define SENSORS_SCRIPT_STEP 100 // каждые столько проходов меняем показания датчиков
+#define COMMAND_EVERY_LOOPS 50 // каждые столько проходов в Serial приходит команда
+#define PARSE_ITERATIONS 200000 // сколько раз разбирать команды при замере ParseCommand
+#define PROCESS_ITERATIONS 20000 // сколько команд прогонять через контроллер при замере полной обработки
+//--------------------------------------------------------------------------------------------------------------------------------
+static const char* const COMMANDS[] =
+{
+  "CTGET=0|PING",
+  "CTGET=STAT|FREERAM",
+  "CTGET=STAT|UPTIME",
+  "CTGET=STATE|TOPEN",
+  "CTSET=STATE|TOPEN|24",
+  "CTGET=LIGHT|STATE",
+  "CTGET=WATER|T_SETT",
+  "CTGET=0|STATUS",
+};
+#define COMMANDS_COUNT (sizeof(COMMANDS)/sizeof(COMMANDS[0]))
+//--------------------------------------------------------------------------------------------------------------------------------
+static HostDS3231 rtc;
+static HostBH1750 bh1750;
+static HostMax44009 max44009;
+static HostSi7021 si7021;
+static HostDS18B20 ds18b20;
+//--------------------------------------------------------------------------------------------------------------------------------
+static uint64_t realMicros()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t) ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000;
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+static void attachDevices()
+{
+  Wire.Attach(0x68, &rtc);
+  Wire.Attach(0x23, &bh1750);
+  Wire.Attach(0x4A, &max44009);
+  Wire.Attach(0x40, &si7021);
+  OneWire::Attach(A11, &ds18b20);
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+static void scriptSensors(uint32_t step)
+{
+  // медленные "суточные" колебания и шум - показания меняются, но не на каждом опросе
+  float phase = step * 0.05f;
+  ds18b20.SetTemperature(22.0f + 6.0f * sinf(phase));
+  si7021.SetTemperature(21.5f + 5.0f * sinf(phase));
+  si7021.SetHumidity(55.0f + 20.0f * cosf(phase));
+  bh1750.SetLux(2000 + (long)(1500 * sinf(phase * 0.5f)));
+  max44009.SetLux(1800 + (long)(1200 * cosf(phase * 0.5f)));
+  Host::SetAnalog(A2, 400 + (step * 37) % 300);
+
+  // расходомеры: по несколько импульсов на шаг сценария
+  for(uint32_t i = 0; i < (step % 5); i++)
+  {
+    Host::FireInterrupt(0);
+    Host::FireInterrupt(1);
+  }
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+static void injectCommand(uint32_t idx)
+{
+  Serial.Inject(COMMANDS[idx % COMMANDS_COUNT]);
+  Serial.Inject("\r\n");
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+static void printHeap(const char* title, const HostHeapStat* hs, uint32_t loops)
+{
+  printf("%-18s current %6lu bytes, peak %6lu bytes, allocs %8lu, frees %8lu", title,
+    (unsigned long) hs->Current, (unsigned long) hs->Peak, (unsigned long) hs->Allocs, (unsigned long) hs->Frees);
+  if(loops)
+    printf(" (%.3f allocs/loop)", (double) hs->Allocs / loops);
+  printf("\n");
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+static void printModules()
+{
+  printf("\n%-10s %10s %12s %10s %10s %10s %12s\n", "MODULE", "CALLS", "TOTAL, us", "AVG, us", "MAX, us", "OVERRUNS", "LATENESS, ms");
+
+  size_t cnt = MainController->GetModulesCount();
+  for(size_t i = 0; i < cnt; i++)
+  {
+    AbstractModule* mod = MainController->GetModule(i);
+    ModuleProfileData* pd = MainController->GetModuleProfile(i);
+    printf("%-10s %10lu %12lu %10.2f %10lu %10lu %12lu\n", mod->GetID(), (unsigned long) pd->Calls, (unsigned long) pd->TotalMicros,
+      pd->Calls ? (double) pd->TotalMicros / pd->Calls : 0.0, (unsigned long) pd->MaxMicros, (unsigned long) pd->Overruns, (unsigned long) pd->MaxLateness);
+  }
+
+  LoopProfileData* lp = MainController->GetLoopProfile();
+  printf("%-10s %10lu %12lu %10.2f %10lu\n", "(loop)", (unsigned long) lp->Loops, (unsigned long) lp->TotalMicros,
+    lp->Loops ? (double) lp->TotalMicros / lp->Loops : 0.0, (unsigned long) lp->MaxMicros);
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+static bool benchParser()
+{
+  CommandParser parser;
+  char buff[64];
+  uint32_t parsed = 0;
+
+  // разбор по месту - без выделения памяти
+  uint64_t startedAt = realMicros();
+  for(uint32_t i = 0; i < PARSE_ITERATIONS; i++)
+  {
+    strcpy(buff, COMMANDS[i % COMMANDS_COUNT]);
+    Command cmd;
+    if(parser.ParseCommand(buff, cmd))
+      parsed++;
+  }
+  uint64_t inPlaceMicros = realMicros() - startedAt;
+
+  // разбор копии String
+  String strCommands[COMMANDS_COUNT];
+  for(size_t i = 0; i < COMMANDS_COUNT; i++)
+    strCommands[i] = COMMANDS[i];
+
+  startedAt = realMicros();
+  for(uint32_t i = 0; i < PARSE_ITERATIONS; i++)
+  {
+    Command cmd;
+    if(parser.ParseCommand(strCommands[i % COMMANDS_COUNT], cmd))
+      parsed++;
+  }
+  uint64_t stringMicros = realMicros() - startedAt;
+
+  // полная обработка: разбор и выполнение модулем, ответ уходит в Serial
+  startedAt = realMicros();
+  for(uint32_t i = 0; i < PROCESS_ITERATIONS; i++)
+  {
+    strcpy(buff, COMMANDS[i % COMMANDS_COUNT]);
+    Command cmd;
+    if(parser.ParseCommand(buff, cmd))
+    {
+      cmd.SetIncomingStream(&Serial);
+      MainController->ProcessModuleCommand(cmd);
+    }
+    Serial.ClearSent();
+  }
+  uint64_t processMicros = realMicros() - startedAt;
+
+  printf("\nParseCommand(char*):         %10.0f commands/sec\n", PARSE_ITERATIONS * 1e6 / (inPlaceMicros ? inPlaceMicros : 1));
+  printf("ParseCommand(const String&): %10.0f commands/sec\n", PARSE_ITERATIONS * 1e6 / (stringMicros ? stringMicros : 1));
+  printf("Parse + ProcessModuleCommand: %9.0f commands/sec\n", PROCESS_ITERATIONS * 1e6 / (processMicros ? processMicros : 1));
+
+  if(parsed != PARSE_ITERATIONS * 2)
+  {
+    printf("ERROR: parsed %lu of %lu commands\n", (unsigned long) parsed, (unsigned long) PARSE_ITERATIONS * 2);
+    return false;
+  }
+  return true;
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+  long thousands = argc > 1 ? atol(argv[1]) : 10;
+  if(thousands < 1)
+    thousands = 1;
+  uint32_t loops = (uint32_t) thousands * 1000;
+
+  attachDevices();
+  scriptSensors(0);
+
+  Host::ResetHeapStat();
+  setup();
+  HostHeapStat setupHeap = *Host::GetHeapStat();
+
+  MainController->ResetProfile();
+  Host::ResetHeapStat();
+  Serial.ClearSent();
+
+  uint32_t commandsSent = 0;
+  uint64_t startedAt = realMicros();
+  for(uint32_t i = 0; i < loops; i++)
+  {
+    if(i % SENSORS_SCRIPT_STEP == 0)
+      scriptSensors(i / SENSORS_SCRIPT_STEP);
+
+    if(i % COMMAND_EVERY_LOOPS == 0)
+      injectCommand(commandsSent++);
+
+    Host::RunLoop();
+    Host::AdvanceMillis(LOOP_STEP_MS);
+    Serial.ClearSent(); // ответы никто не читает
+  }
+  uint64_t loopMicros = realMicros() - startedAt;
+  HostHeapStat loopHeap = *Host::GetHeapStat();
+
+  LoopProfileData* lp = MainController->GetLoopProfile();
+
+  printf("loop(): %lu passes, %.3f s real, %.2f us/pass, %lu simulated seconds\n", (unsigned long) loops, loopMicros / 1e6,
+    (double) loopMicros / loops, (unsigned long) (loops * LOOP_STEP_MS / 1000));
+  printf("commands via Serial: %lu sent, %lu processed\n", (unsigned long) commandsSent, (unsigned long) lp->Commands);
+  printModules();
+
+  printf("\n");
+  printHeap("heap in setup():", &setupHeap, 0);
+  printHeap("heap in loop():", &loopHeap, loops);
+  printf("%-18s %d bytes\n", "min freeRam():", lp->MinFreeRam);
+
+  MemoryStatData* ms = MemGetStat();
+  printf("%-18s %lu flushes, %lu bytes written, %lu skipped\n", "EEPROM:", (unsigned long) ms->Flushes, (unsigned long) ms->BytesWritten, (unsigned long) ms->BytesSkipped);
+
+  const HostSdStat* sd = SdFat::HostGetStat();
+  printf("%-18s %lu writes, %lu bytes, %lu flushes, %lu opens\n", "SD:", (unsigned long) sd->Writes, (unsigned long) sd->BytesWritten, (unsigned long) sd->Flushes, (unsigned long) sd->Opens);
+  printf("%-18s %lu transactions\n", "I2C:", (unsigned long) Wire.Transactions());
+
+  bool ok = benchParser();
+
+  if(lp->Loops != loops)
+  {
+    printf("ERROR: profiler counted %lu passes of %lu\n", (unsigned long) lp->Loops, (unsigned long) loops);
+    ok = false;
+  }
+
+  if(lp->Commands + 1 < commandsSent) // последняя команда могла остаться необработанной
+  {
+    printf("ERROR: %lu of %lu commands processed\n", (unsigned long) lp->Commands, (unsigned long) commandsSent);
+    ok = false;
+  }
+
+  return ok ? 0 : 1;
+}
+//--------------------------------------------------------------------------------------------------------------------------------
@@ -0,0 +1,215 @@
+//--------------------------------------------------------------------------------------------------------------------------------
+// Бенчмарк разбора команд: выделения памяти и задержка разбора одной команды для
+//  - прежнего пути (копия каждого аргумента и имени модуля в куче, аргументы в Vector<char*>);
+//  - CommandParser::ParseCommand(const String&) - одна копия строки на команду;
+//  - CommandParser::ParseCommand(char*) - разбор по месту, без кучи.
+//
+// Запуск: parse_benchmark [кол-во разборов на путь, тысяч; по умолчанию - 200]
+// Код возврата ненулевой, если разбор по месту выделял память или пути разошлись в результатах
+//--------------------------------------------------------------------------------------------------------------------------------
+#include <time.h>
+#include <Arduino.h>
+#include <HostHardware.h>
+#include "CommandParser.h"
+#include "TinyVector.h"
+//--------------------------------------------------------------------------------------------------------------------------------
+static const char* const COMMANDS[] =
+{
+  "CTGET=0|PING",
+  "CTGET=STAT|FREERAM",
+  "CTSET=STATE|TOPEN|24",
+  "CTGET=WATER|T_SETT",
+  "CTSET=PIN|13|T",
+  "CTGET=0|STATUS",
+  "CTSET=WATER|T_SETT|1|0|127|12|0|10|25|1|0|1",
+  "CTGET=STAT",
+};
+#define COMMANDS_COUNT (sizeof(COMMANDS)/sizeof(COMMANDS[0]))
+//--------------------------------------------------------------------------------------------------------------------------------
+// прежний разбор, как он был до перехода на разбор по месту - для сравнения
+//--------------------------------------------------------------------------------------------------------------------------------
+class LegacyCommand
+{
+  public:
+    Vector<char*> arguments;
+    String ModuleID;
+    uint8_t Type;
+
+    LegacyCommand() : Type(ctUNKNOWN) {}
+    ~LegacyCommand() { Clear(); }
+
+    void Clear()
+    {
+      Type = ctUNKNOWN;
+      ModuleID = F("");
+      for(size_t i = 0; i < arguments.size(); i++)
+        delete[] arguments[i];
+      arguments.clear();
+    }
+
+    void Construct(const char* id, const char* rawArgs, uint8_t ct)
+    {
+      Clear();
+      Type = ct;
+      ModuleID = id;
+
+      if(!rawArgs)
+        return;
+
+      const char* startPtr = rawArgs;
+      while(*startPtr)
+      {
+        const char* delimPtr = strchr(startPtr, '|');
+        size_t len = delimPtr ? (size_t) (delimPtr - startPtr) : strlen(startPtr);
+
+        char* newArg = new char[len + 1];
+        memset(newArg, 0, len + 1);
+        strncpy(newArg, startPtr, len);
+        arguments.push_back(newArg);
+
+        if(!delimPtr)
+          return;
+
+        startPtr = delimPtr + 1;
+      }
+    }
+};
+//--------------------------------------------------------------------------------------------------------------------------------
+static bool legacyParse(const String& command, LegacyCommand& outCommand)
+{
+  if(command.length() < MIN_COMMAND_LENGTH)
+    return false;
+
+  const char* readPtr = command.c_str();
+  if(strncmp_P(readPtr, (const char*) CMD_PREFIX, CMD_PREFIX_LEN))
+    return false;
+
+  readPtr += CMD_PREFIX_LEN;
+  bool isGet = !strncmp_P(readPtr, (const char*) CMD_GET, CMD_TYPE_LEN);
+  if(!isGet && strncmp_P(readPtr, (const char*) CMD_SET, CMD_TYPE_LEN))
+    return false;
+
+  uint8_t commandType = isGet ? ctGET : ctSET;
+  readPtr += CMD_TYPE_LEN + 1;
+
+  const char* delimPtr = strchr(readPtr, '|');
+  if(!delimPtr)
+  {
+    outCommand.Construct(readPtr, NULL, commandType);
+    return true;
+  }
+
+  size_t len = (delimPtr - readPtr);
+  char* moduleName = new char[len + 1];
+  memset(moduleName, 0, len + 1);
+  strncpy(moduleName, readPtr, len);
+
+  outCommand.Construct(moduleName, delimPtr + 1, commandType);
+  delete[] moduleName;
+  return true;
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+static uint64_t realMicros()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t) ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000;
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+static void printResult(const char* title, uint32_t iterations, uint64_t elapsed, const HostHeapStat* hs)
+{
+  printf("%-28s %8.1f ns/command %12.0f commands/sec %8.3f allocs/command, peak heap %5lu bytes\n", title,
+    elapsed * 1000.0 / iterations, iterations * 1e6 / (elapsed ? elapsed : 1), (double) hs->Allocs / iterations, (unsigned long) hs->Peak);
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+  long thousands = argc > 1 ? atol(argv[1]) : 200;
+  if(thousands < 1)
+    thousands = 1;
+  uint32_t iterations = (uint32_t) thousands * 1000;
+
+  String strCommands[COMMANDS_COUNT];
+  for(size_t i = 0; i < COMMANDS_COUNT; i++)
+    strCommands[i] = COMMANDS[i];
+
+  bool ok = true;
+  CommandParser parser;
+  char buff[64];
+
+  // результаты всех путей должны совпадать
+  for(size_t i = 0; i < COMMANDS_COUNT; i++)
+  {
+    LegacyCommand legacy;
+    Command inPlace;
+    strcpy(buff, COMMANDS[i]);
+
+    bool same = legacyParse(strCommands[i], legacy) && parser.ParseCommand(buff, inPlace)
+      && legacy.Type == inPlace.GetType() && legacy.ModuleID == inPlace.GetTargetModuleID()
+      && legacy.arguments.size() == inPlace.GetArgsCount();
+
+    for(size_t j = 0; same && j < legacy.arguments.size(); j++)
+      same = !strcmp(legacy.arguments[j], inPlace.GetArg(j));
+
+    if(!same)
+    {
+      printf("ERROR: paths differ on \"%s\"\n", COMMANDS[i]);
+      ok = false;
+    }
+  }
+
+  uint32_t parsed = 0;
+
+  Host::ResetHeapStat();
+  uint64_t startedAt = realMicros();
+  for(uint32_t i = 0; i < iterations; i++)
+  {
+    LegacyCommand cmd;
+    if(legacyParse(strCommands[i % COMMANDS_COUNT], cmd))
+      parsed++;
+  }
+  uint64_t legacyMicros = realMicros() - startedAt;
+  HostHeapStat legacyHeap = *Host::GetHeapStat();
+
+  Host::ResetHeapStat();
+  startedAt = realMicros();
+  for(uint32_t i = 0; i < iterations; i++)
+  {
+    Command cmd;
+    if(parser.ParseCommand(strCommands[i % COMMANDS_COUNT], cmd))
+      parsed++;
+  }
+  uint64_t stringMicros = realMicros() - startedAt;
+  HostHeapStat stringHeap = *Host::GetHeapStat();
+
+  Host::ResetHeapStat();
+  startedAt = realMicros();
+  for(uint32_t i = 0; i < iterations; i++)
+  {
+    strcpy(buff, COMMANDS[i % COMMANDS_COUNT]);
+    Command cmd;
+    if(parser.ParseCommand(buff, cmd))
+      parsed++;
+  }
+  uint64_t inPlaceMicros = realMicros() - startedAt;
+  HostHeapStat inPlaceHeap = *Host::GetHeapStat();
+
+  printResult("legacy (copy per argument):", iterations, legacyMicros, &legacyHeap);
+  printResult("ParseCommand(const String&):", iterations, stringMicros, &stringHeap);
+  printResult("ParseCommand(char*):", iterations, inPlaceMicros, &inPlaceHeap);
+
+  if(parsed != iterations * 3)
+  {
+    printf("ERROR: parsed %lu of %lu commands\n", (unsigned long) parsed, (unsigned long) iterations * 3);
+    ok = false;
+  }
+
+  if(inPlaceHeap.Allocs)
+  {
+    printf("ERROR: in-place parsing made %lu allocations\n", (unsigned long) inPlaceHeap.Allocs);
+    ok = false;
+  }
+
+  return ok ? 0 : 1;
+}
+//--------------------------------------------------------------------------------------------------------------------------------
@@ -0,0 +1,254 @@
+//--------------------------------------------------------------------------------------------------------------------------------
+// Бенчмарк фрагментации кучи контейнерами из TinyVector.h. Каждый сценарий повторяет типичную работу прошивки
+// в прежнем варианте и в нынешнем, перемежая её выделениями короткоживущих String (как это и происходит в loop()),
+// и прогоняет все выделения через модель кучи avr-libc (AvrHeapModel.h). Выводит:
+//  - выделений на цикл;
+//  - на сколько куча максимально подошла к стеку;
+//  - дыры под вершиной кучи (в среднем за цикл и наибольшие) и их среднюю долю в занятой кучей памяти.
+//
+// Запуск: vector_benchmark [кол-во циклов в сценарии, тысяч; по умолчанию - 20]
+// Код возврата ненулевой, если нынешний вариант выделяет память чаще прежнего или модель кучи разошлась
+//--------------------------------------------------------------------------------------------------------------------------------
+#include <Arduino.h>
+#include <HostHardware.h>
+#include "TinyVector.h"
+#include "CoreTransport.h"
+#include "AvrHeapModel.h"
+//--------------------------------------------------------------------------------------------------------------------------------
+#define STRINGS_RING 4 // столько строк живёт одновременно, перемежаясь с памятью контейнеров
+#define BIG_ANSWER_EVERY 16 // каждый такой ответ ESP - длинный (+IPD, список точек доступа)
+#define BIG_ANSWER_LENGTH 400
+#define GROWTH_ITEMS 64
+#define GROWTH_STRING_EVERY 8
+//--------------------------------------------------------------------------------------------------------------------------------
+class AlertRule;
+//--------------------------------------------------------------------------------------------------------------------------------
+static AvrHeapModel heapModel;
+static uint32_t rndState = 1;
+//--------------------------------------------------------------------------------------------------------------------------------
+static void traceHeap(void* ptr, size_t size)
+{
+  heapModel.Trace(ptr, size);
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+static uint32_t rnd(uint32_t range)
+{
+  rndState = rndState * 1103515245UL + 12345UL;
+  return (rndState >> 16) % range;
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+typedef struct
+{
+  uint32_t Allocs;
+  size_t HighWater;
+  uint64_t HolesSum; // сумма дыр по всем циклам
+  uint64_t BreakSum; // сумма размеров кучи по всем циклам
+  size_t MaxHoles;
+  uint32_t Samples;
+  bool Consistent;
+  
+} ScenarioResult;
+//--------------------------------------------------------------------------------------------------------------------------------
+// строки, которые живут по несколько циклов и не дают дырам от контейнеров слиться
+//--------------------------------------------------------------------------------------------------------------------------------
+class StringsRing
+{
+  private:
+    String strings[STRINGS_RING];
+    size_t writeIdx;
+
+  public:
+    StringsRing() : writeIdx(0) {}
+
+    void Put(size_t len)
+    {
+      char buff[128];
+      for(size_t i = 0; i < len && i < sizeof(buff) - 1; i++)
+        buff[i] = 'A' + i % 26;
+      buff[min(len, sizeof(buff) - 1)] = '\0';
+
+      strings[writeIdx] = String(buff); // новая строка в куче, самая старая освобождается
+      writeIdx = (writeIdx + 1) % STRINGS_RING;
+    }
+};
+//--------------------------------------------------------------------------------------------------------------------------------
+static void beginScenario(ScenarioResult& r)
+{
+  memset(&r, 0, sizeof(r));
+  rndState = 1;
+  heapModel.Reset();
+  Host::ResetHeapStat();
+  Host::SetHeapTrace(traceHeap);
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+static void sample(ScenarioResult& r) // состояние кучи в конце цикла
+{
+  size_t holes = heapModel.FreeBytes();
+  r.HolesSum += holes;
+  r.BreakSum += heapModel.Break();
+  if(holes > r.MaxHoles)
+    r.MaxHoles = holes;
+  r.Samples++;
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+static void endScenario(ScenarioResult& r)
+{
+  r.Allocs = Host::GetHeapStat()->Allocs;
+  r.HighWater = heapModel.BreakHighWater();
+
+  // всё, что выделил сценарий, освобождено - модель должна вернуться в исходное состояние
+  r.Consistent = !heapModel.LiveBlocks() && !heapModel.Break();
+  Host::SetHeapTrace(NULL);
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+// приёмный буфер транспорта: раньше - Vector в куче, освобождаемый после каждого ответа, сейчас - в пуле приёмных
+// буферов, освобождается, только если разросся; в кучу уходят лишь ответы, не влезшие в пул
+//--------------------------------------------------------------------------------------------------------------------------------
+static ScenarioResult receiveBuffer(uint32_t cycles, bool legacy)
+{
+  ScenarioResult r;
+  beginScenario(r);
+  {
+    StringsRing ring;
+    Vector<uint8_t> legacyBuffer;
+    TransportReceiveBuffer buffer;
+
+    for(uint32_t i = 0; i < cycles; i++)
+    {
+      size_t len = (i % BIG_ANSWER_EVERY) ? 8 + rnd(120) : BIG_ANSWER_LENGTH;
+      for(size_t j = 0; j < len; j++)
+      {
+        if(legacy)
+          legacyBuffer.push_back('0' + j % 10);
+        else
+          buffer.push_back('0' + j % 10);
+      }
+
+      ring.Put(4 + rnd(40)); // ответ разобран - его часть куда-то сохранена
+
+      if(legacy)
+        legacyBuffer.clear();
+      else
+      {
+        buffer.empty();
+        buffer.shrink(TRANSPORT_RECEIVE_BUFFER_KEEP);
+      }
+      sample(r);
+    }
+  }
+  endScenario(r);
+  return r;
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+// список сработавших правил AlertModule: раньше - Vector в куче на каждый проход, сейчас - FixedVector
+//--------------------------------------------------------------------------------------------------------------------------------
+static ScenarioResult rulesList(uint32_t cycles, bool legacy)
+{
+  ScenarioResult r;
+  beginScenario(r);
+  {
+    StringsRing ring;
+    Vector<AlertRule*> legacyList;
+    FixedVector<AlertRule*, MAX_ALERT_RULES> fixedList;
+
+    for(uint32_t i = 0; i < cycles; i++)
+    {
+      size_t raised = rnd(MAX_ALERT_RULES + 1);
+      for(size_t j = 0; j < raised; j++)
+      {
+        AlertRule* rule = (AlertRule*) (uintptr_t) (j + 1);
+        if(legacy)
+          legacyList.push_back(rule);
+        else
+          fixedList.push_back(rule);
+      }
+
+      ring.Put(8 + rnd(60)); // текст оповещения
+
+      legacyList.clear();
+      fixedList.clear();
+      sample(r);
+    }
+  }
+  endScenario(r);
+  return r;
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+// наполнение вектора известного размера: раньше - удвоением ёмкости, сейчас - с reserve()
+//--------------------------------------------------------------------------------------------------------------------------------
+static ScenarioResult growth(uint32_t cycles, bool legacy)
+{
+  ScenarioResult r;
+  beginScenario(r);
+  {
+    StringsRing ring;
+    Vector<uint16_t> list;
+
+    for(uint32_t i = 0; i < cycles; i++)
+    {
+      if(!legacy)
+        list.reserve(GROWTH_ITEMS);
+
+      for(uint16_t j = 0; j < GROWTH_ITEMS; j++)
+      {
+        list.push_back(j);
+        if(j % GROWTH_STRING_EVERY == 0)
+          ring.Put(4 + rnd(24));
+      }
+      list.clear();
+      sample(r);
+    }
+  }
+  endScenario(r);
+  return r;
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+static void printResult(const char* title, const char* variant, uint32_t cycles, const ScenarioResult& r)
+{
+  printf("%-16s %-10s %10.2f %10lu %10.1f %10lu %7.1f%%\n", title, variant, (double) r.Allocs / cycles,
+    (unsigned long) r.HighWater, r.Samples ? (double) r.HolesSum / r.Samples : 0.0, (unsigned long) r.MaxHoles,
+    r.BreakSum ? r.HolesSum * 100.0 / r.BreakSum : 0.0);
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+typedef ScenarioResult (*ScenarioFunc)(uint32_t cycles, bool legacy);
+//--------------------------------------------------------------------------------------------------------------------------------
+static bool runScenario(const char* title, ScenarioFunc func, uint32_t cycles)
+{
+  ScenarioResult legacy = func(cycles, true);
+  ScenarioResult current = func(cycles, false);
+
+  printResult(title, "legacy", cycles, legacy);
+  printResult(title, "current", cycles, current);
+
+  bool ok = true;
+  if(!legacy.Consistent || !current.Consistent)
+  {
+    printf("ERROR: %s: heap model has blocks left after the scenario\n", title);
+    ok = false;
+  }
+
+  if(current.Allocs > legacy.Allocs)
+  {
+    printf("ERROR: %s: current variant allocates more often than legacy (%lu > %lu)\n", title,
+      (unsigned long) current.Allocs, (unsigned long) legacy.Allocs);
+    ok = false;
+  }
+  return ok;
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+  long thousands = argc > 1 ? atol(argv[1]) : 20;
+  if(thousands < 1)
+    thousands = 1;
+  uint32_t cycles = (uint32_t) thousands * 1000;
+
+  printf("%-16s %-10s %10s %10s %10s %10s %8s\n", "SCENARIO", "VARIANT", "ALLOCS/CYC", "HIGHWATER", "AVG HOLES", "MAX HOLES", "FRAG");
+
+  bool ok = runScenario("receive buffer", receiveBuffer, cycles);
+  ok = runScenario("alert rules", rulesList, cycles) && ok;
+  ok = runScenario("growth", growth, cycles) && ok;
+
+  return ok ? 0 : 1;
+}
+//--------------------------------------------------------------------------------------------------------------------------------
@@ -0,0 +1,182 @@
+#ifndef Arduino_h
+#define Arduino_h
+//--------------------------------------------------------------------------------------------------------------------------------
+// Прослойка Arduino API для сборки прошивки под Linux (см. Host/CMakeLists.txt).
+// Повторяет то подмножество ядра Arduino AVR, которым пользуется Main/, поведение железа задаётся через HostHardware.h
+//--------------------------------------------------------------------------------------------------------------------------------
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <ctype.h>
+#include <math.h>
+#include <avr/pgmspace.h>
+#include <avr/io.h>
+#include "binary.h"
+//--------------------------------------------------------------------------------------------------------------------------------
+typedef uint8_t byte;
+typedef bool boolean;
+typedef unsigned int word;
+//--------------------------------------------------------------------------------------------------------------------------------
+#define HIGH 0x1
+#define LOW  0x0
+
+#define INPUT 0x0
+#define OUTPUT 0x1
+#define INPUT_PULLUP 0x2
+
+#define CHANGE 1
+#define FALLING 2
+#define RISING 3
+
+#define LSBFIRST 0
+#define MSBFIRST 1
+
+#define DEC 10
+#define HEX 16
+#define OCT 8
+#define BIN 2
+
+#define DEFAULT 1
+#define EXTERNAL 0
+#define INTERNAL1V1 2
+#define INTERNAL2V56 3
+
+#define SERIAL_8N1 0x06
+//--------------------------------------------------------------------------------------------------------------------------------
+// выводы Arduino Mega
+#define NUM_DIGITAL_PINS 70
+#define NUM_ANALOG_INPUTS 16
+
+#define A0 54
+#define A1 55
+#define A2 56
+#define A3 57
+#define A4 58
+#define A5 59
+#define A6 60
+#define A7 61
+#define A8 62
+#define A9 63
+#define A10 64
+#define A11 65
+#define A12 66
+#define A13 67
+#define A14 68
+#define A15 69
+
+#define SDA 20
+#define SCL 21
+#define MISO 50
+#define MOSI 51
+#define SCK 52
+#define SS 53
+
+#define NOT_A_PIN 0
+#define NOT_A_PORT 0
+#define NOT_AN_INTERRUPT -1
+
+#define analogInputToDigitalPin(p) ((p < 16) ? (p) + 54 : -1)
+#define digitalPinToInterrupt(p) ((p) == 2 ? 0 : ((p) == 3 ? 1 : ((p) >= 18 && (p) <= 21 ? 23 - (p) : NOT_AN_INTERRUPT)))
+
+// порты на хосте не эмулируются побитно: каждый вывод - свой "порт" с единственным битом
+#define digitalPinToPort(p) (p)
+#define digitalPinToBitMask(p) (1)
+#define portInputRegister(p) (HostPortRegister(p))
+#define portOutputRegister(p) (HostPortRegister(p))
+#define portModeRegister(p) (HostPortRegister(p))
+
+#define digitalPinToPCICR(p) (&PCICR)
+#define digitalPinToPCICRbit(p) (((p) >= 62 && (p) <= 69) ? 2 : 0)
+#define digitalPinToPCMSK(p) (&PCMSK2)
+#define digitalPinToPCMSKbit(p) (((p) >= 62 && (p) <= 69) ? (p) - 62 : 0)
+//--------------------------------------------------------------------------------------------------------------------------------
+#define F_CPU 16000000UL
+#define clockCyclesPerMicrosecond() (F_CPU / 1000000L)
+//--------------------------------------------------------------------------------------------------------------------------------
+#define min(a,b) ((a)<(b)?(a):(b))
+#define max(a,b) ((a)>(b)?(a):(b))
+#undef abs
+#define abs(x) ((x)>0?(x):-(x))
+#define constrain(amt,low,high) ((amt)<(low)?(low):((amt)>(high)?(high):(amt)))
+#define round(x) ((x)>=0?(long)((x)+0.5):(long)((x)-0.5))
+#define radians(deg) ((deg)*DEG_TO_RAD)
+#define degrees(rad) ((rad)*RAD_TO_DEG)
+#define sq(x) ((x)*(x))
+
+#define PI 3.1415926535897932384626433832795
+#define DEG_TO_RAD 0.017453292519943295769236907684886
+#define RAD_TO_DEG 57.295779513082320876798154814105
+
+#define lowByte(w) ((uint8_t) ((w) & 0xff))
+#define highByte(w) ((uint8_t) ((w) >> 8))
+
+#define bitRead(value, bit) (((value) >> (bit)) & 0x01)
+#define bitSet(value, bit) ((value) |= (1UL << (bit)))
+#define bitClear(value, bit) ((value) &= ~(1UL << (bit)))
+#define bitWrite(value, bit, bitvalue) ((bitvalue) ? bitSet(value, bit) : bitClear(value, bit))
+#define bit(b) (1UL << (b))
+
+#define interrupts() sei()
+#define noInterrupts() cli()
+//--------------------------------------------------------------------------------------------------------------------------------
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef void (*voidFuncPtr)(void);
+
+unsigned long millis(void);
+unsigned long micros(void);
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t val);
+int digitalRead(uint8_t pin);
+int analogRead(uint8_t pin);
+void analogReference(uint8_t mode);
+void analogWrite(uint8_t pin, int val);
+
+void shiftOut(uint8_t dataPin, uint8_t clockPin, uint8_t bitOrder, uint8_t val);
+uint8_t shiftIn(uint8_t dataPin, uint8_t clockPin, uint8_t bitOrder);
+
+void attachInterrupt(uint8_t interruptNum, void (*userFunc)(void), int mode);
+void detachInterrupt(uint8_t interruptNum);
+
+void yield(void);
+
+char* itoa(int value, char* str, int radix);
+char* ltoa(long value, char* str, int radix);
+char* utoa(unsigned value, char* str, int radix);
+char* ultoa(unsigned long value, char* str, int radix);
+char* dtostrf(double val, signed char width, unsigned char prec, char* s);
+
+volatile uint8_t* HostPortRegister(uint8_t pin);
+
+void setup(void);
+void loop(void);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
+//--------------------------------------------------------------------------------------------------------------------------------
+#ifdef __cplusplus
+#include "WString.h"
+#include "HardwareSerial.h"
+
+unsigned long pulseIn(uint8_t pin, uint8_t state, unsigned long timeout = 1000000L);
+void tone(uint8_t pin, unsigned int frequency, unsigned long duration = 0);
+void noTone(uint8_t pin);
+
+long random(long howbig);
+long random(long howsmall, long howbig);
+void randomSeed(unsigned long seed);
+long map(long x, long in_min, long in_max, long out_min, long out_max);
+
+uint16_t makeWord(uint16_t w);
+uint16_t makeWord(byte h, byte l);
+#define word(...) makeWord(__VA_ARGS__)
+#endif
+//--------------------------------------------------------------------------------------------------------------------------------
+#endif
@@ -0,0 +1,4 @@
+#include "EEPROM.h"
+//--------------------------------------------------------------------------------------------------------------------------------
+EEPROMClass EEPROM;
+//--------------------------------------------------------------------------------------------------------------------------------
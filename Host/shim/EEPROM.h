@@ -0,0 +1,50 @@
+#ifndef EEPROM_h
+#define EEPROM_h
+//--------------------------------------------------------------------------------------------------------------------------------
+// встроенная EEPROM Arduino Mega (4 КБ), стёртая - все байты 0xFF. Счётчики показывают, сколько раз прошивка к ней обращалась
+//--------------------------------------------------------------------------------------------------------------------------------
+#include <inttypes.h>
+#include <string.h>
+//--------------------------------------------------------------------------------------------------------------------------------
+#define E2END 0xFFF
+//--------------------------------------------------------------------------------------------------------------------------------
+class EEPROMClass
+{
+  public:
+    EEPROMClass() { Erase(); }
+
+    uint8_t read(int idx) { reads++; return (idx >= 0 && idx <= E2END) ? cells[idx] : 0xFF; }
+    void write(int idx, uint8_t val) { writes++; if(idx >= 0 && idx <= E2END) cells[idx] = val; }
+    void update(int idx, uint8_t val) { if(read(idx) != val) write(idx, val); }
+    uint16_t length() { return E2END + 1; }
+
+    template<typename T> T& get(int idx, T& t)
+    {
+      uint8_t* ptr = (uint8_t*) &t;
+      for(size_t i = 0; i < sizeof(T); i++)
+        *ptr++ = read(idx + i);
+      return t;
+    }
+
+    template<typename T> const T& put(int idx, const T& t)
+    {
+      const uint8_t* ptr = (const uint8_t*) &t;
+      for(size_t i = 0; i < sizeof(T); i++)
+        update(idx + i, *ptr++);
+      return t;
+    }
+
+    // управление со стороны хоста
+    void Erase() { memset(cells, 0xFF, sizeof(cells)); reads = writes = 0; }
+    uint32_t Reads() const { return reads; }
+    uint32_t Writes() const { return writes; }
+    void ResetStat() { reads = writes = 0; }
+
+  private:
+    uint8_t cells[E2END + 1];
+    uint32_t reads, writes;
+};
+//--------------------------------------------------------------------------------------------------------------------------------
+extern EEPROMClass EEPROM;
+//--------------------------------------------------------------------------------------------------------------------------------
+#endif
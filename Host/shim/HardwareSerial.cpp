@@ -0,0 +1,106 @@
+#include "Arduino.h"
+#include "HardwareSerial.h"
+//--------------------------------------------------------------------------------------------------------------------------------
+HardwareSerial Serial(&UCSR0A, TXC0);
+HardwareSerial Serial1(&UCSR1A, TXC1);
+HardwareSerial Serial2(&UCSR2A, TXC2);
+HardwareSerial Serial3(&UCSR3A, TXC3);
+//--------------------------------------------------------------------------------------------------------------------------------
+HardwareSerial::HardwareSerial(volatile uint8_t* a, uint8_t t)
+{
+  ucsra = a;
+  txc = t;
+  active = false;
+  writeHandler = NULL;
+  Reset();
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+void HardwareSerial::Reset()
+{
+  rxHead = rxTail = 0;
+  txHead = txTail = 0;
+  totalWritten = totalRead = 0;
+  *ucsra |= _BV(txc);
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+int HardwareSerial::available(void)
+{
+  return (int)((HOST_SERIAL_RX_SIZE + rxHead - rxTail) % HOST_SERIAL_RX_SIZE);
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+int HardwareSerial::peek(void)
+{
+  if(rxHead == rxTail)
+    return -1;
+  return rxBuffer[rxTail];
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+int HardwareSerial::read(void)
+{
+  if(rxHead == rxTail)
+    return -1;
+
+  uint8_t c = rxBuffer[rxTail];
+  rxTail = (rxTail + 1) % HOST_SERIAL_RX_SIZE;
+  totalRead++;
+  return c;
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+size_t HardwareSerial::write(uint8_t c)
+{
+  size_t next = (txHead + 1) % HOST_SERIAL_TX_SIZE;
+  if(next == txTail) // переполнение - теряем самый старый байт, как при непрочитанном логе
+    txTail = (txTail + 1) % HOST_SERIAL_TX_SIZE;
+
+  txBuffer[txHead] = c;
+  txHead = next;
+  totalWritten++;
+
+  // на хосте байт "уходит" мгновенно - флаг окончания передачи выставлен сразу
+  *ucsra |= _BV(txc);
+
+  if(writeHandler)
+    writeHandler(*this, c);
+
+  return 1;
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+void HardwareSerial::Inject(const uint8_t* data, size_t len)
+{
+  for(size_t i = 0; i < len; i++)
+  {
+    size_t next = (rxHead + 1) % HOST_SERIAL_RX_SIZE;
+    if(next == rxTail) // как и на железе, при переполнении приёмного буфера байты теряются
+      break;
+
+    rxBuffer[rxHead] = data[i];
+    rxHead = next;
+  }
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+size_t HardwareSerial::Sent(char* dest, size_t maxLen)
+{
+  size_t cnt = 0;
+  while(txTail != txHead && cnt < maxLen)
+  {
+    dest[cnt++] = (char) txBuffer[txTail];
+    txTail = (txTail + 1) % HOST_SERIAL_TX_SIZE;
+  }
+  return cnt;
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+// как в ядре Arduino: после каждого loop() зовём serialEventN тех портов, где есть данные (если скетч их определил)
+//--------------------------------------------------------------------------------------------------------------------------------
+void serialEvent() __attribute__((weak));
+void serialEvent1() __attribute__((weak));
+void serialEvent2() __attribute__((weak));
+void serialEvent3() __attribute__((weak));
+//--------------------------------------------------------------------------------------------------------------------------------
+void serialEventRun(void)
+{
+  if(serialEvent && Serial.available()) serialEvent();
+  if(serialEvent1 && Serial1.available()) serialEvent1();
+  if(serialEvent2 && Serial2.available()) serialEvent2();
+  if(serialEvent3 && Serial3.available()) serialEvent3();
+}
+//--------------------------------------------------------------------------------------------------------------------------------
@@ -0,0 +1,69 @@
+#ifndef HardwareSerial_h
+#define HardwareSerial_h
+//--------------------------------------------------------------------------------------------------------------------------------
+// UART на хосте: входящие байты подкладывает тест (Inject), исходящие копятся в кольцевом буфере (Sent) и,
+// при необходимости, отдаются обработчику - так эмулируются устройства на том конце провода (ESP, модем, RS-485)
+//--------------------------------------------------------------------------------------------------------------------------------
+#include <inttypes.h>
+#include "Stream.h"
+//--------------------------------------------------------------------------------------------------------------------------------
+#define HOST_SERIAL_RX_SIZE 4096
+#define HOST_SERIAL_TX_SIZE 4096
+//--------------------------------------------------------------------------------------------------------------------------------
+class HardwareSerial;
+typedef void (*HostSerialWriteHandler)(HardwareSerial& port, uint8_t b);
+//--------------------------------------------------------------------------------------------------------------------------------
+class HardwareSerial : public Stream
+{
+  public:
+    HardwareSerial(volatile uint8_t* ucsra, uint8_t txc);
+
+    void begin(unsigned long baud) { begin(baud, SERIAL_8N1); }
+    void begin(unsigned long, uint8_t) { active = true; }
+    void end() { active = false; }
+
+    virtual int available(void);
+    virtual int peek(void);
+    virtual int read(void);
+    virtual int availableForWrite(void) { return HOST_SERIAL_TX_SIZE; }
+    virtual void flush(void) {}
+    virtual size_t write(uint8_t);
+    inline size_t write(unsigned long n) { return write((uint8_t) n); }
+    inline size_t write(long n) { return write((uint8_t) n); }
+    inline size_t write(unsigned int n) { return write((uint8_t) n); }
+    inline size_t write(int n) { return write((uint8_t) n); }
+    using Print::write;
+    operator bool() { return true; }
+
+    // управление со стороны хоста
+    void Inject(const uint8_t* data, size_t len);
+    void Inject(const char* str) { Inject((const uint8_t*) str, strlen(str)); }
+    void OnWrite(HostSerialWriteHandler h) { writeHandler = h; }
+
+    size_t Sent(char* dest, size_t maxLen); // забирает накопленные исходящие байты, возвращает их кол-во
+    void ClearSent() { txHead = txTail = 0; }
+    unsigned long TotalWritten() const { return totalWritten; }
+    unsigned long TotalRead() const { return totalRead; }
+    void Reset();
+
+  private:
+    volatile uint8_t* ucsra;
+    uint8_t txc;
+    bool active;
+    HostSerialWriteHandler writeHandler;
+
+    uint8_t rxBuffer[HOST_SERIAL_RX_SIZE];
+    size_t rxHead, rxTail;
+
+    uint8_t txBuffer[HOST_SERIAL_TX_SIZE];
+    size_t txHead, txTail;
+
+    unsigned long totalWritten, totalRead;
+};
+//--------------------------------------------------------------------------------------------------------------------------------
+extern HardwareSerial Serial;
+extern HardwareSerial Serial1;
+extern HardwareSerial Serial2;
+extern HardwareSerial Serial3;
+//--------------------------------------------------------------------------------------------------------------------------------
+#endif
@@ -0,0 +1,285 @@
+#include "HostDevices.h"
+//--------------------------------------------------------------------------------------------------------------------------------
+static uint8_t toBcd(uint8_t val)
+{
+  return ((val / 10) << 4) | (val % 10);
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+static uint8_t fromBcd(uint8_t val)
+{
+  return (val >> 4) * 10 + (val & 0x0F);
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+static const uint8_t daysInMonth[12] = {31,28,31,30,31,30,31,31,30,31,30,31};
+//--------------------------------------------------------------------------------------------------------------------------------
+static bool isLeap(uint16_t year)
+{
+  return (year % 4) == 0;
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+HostDS3231::HostDS3231()
+{
+  pointer = 0;
+  memset(regs, 0, sizeof(regs));
+  regs[0x11] = 25; // температура чипа
+  SetDateTime(2018, 1, 1, 12, 0, 0);
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+void HostDS3231::SetDateTime(uint16_t year, uint8_t month, uint8_t day, uint8_t hour, uint8_t minute, uint8_t second)
+{
+  long days = 0;
+  for(uint16_t y = 2000; y < year; y++)
+    days += isLeap(y) ? 366 : 365;
+
+  for(uint8_t m = 1; m < month; m++)
+    days += daysInMonth[m-1] + ((m == 2 && isLeap(year)) ? 1 : 0);
+
+  days += day - 1;
+  baseTime = ((days * 24 + hour) * 60 + minute) * 60L + second;
+  baseMillis = millis();
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+void HostDS3231::fillTime()
+{
+  long t = baseTime + (long)((millis() - baseMillis) / 1000);
+  long days = t / 86400L;
+  long secs = t % 86400L;
+
+  regs[0] = toBcd(secs % 60);
+  regs[1] = toBcd((secs / 60) % 60);
+  regs[2] = toBcd(secs / 3600);
+  regs[3] = toBcd(((days + 5) % 7) + 1); // 2000-01-01 - суббота, понедельник = 1
+
+  uint16_t year = 2000;
+  while(days >= (isLeap(year) ? 366 : 365))
+  {
+    days -= isLeap(year) ? 366 : 365;
+    year++;
+  }
+
+  uint8_t month = 1;
+  while(true)
+  {
+    uint8_t dim = daysInMonth[month-1] + ((month == 2 && isLeap(year)) ? 1 : 0);
+    if(days < dim)
+      break;
+    days -= dim;
+    month++;
+  }
+
+  regs[4] = toBcd(days + 1);
+  regs[5] = toBcd(month);
+  regs[6] = toBcd(year - 2000);
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+void HostDS3231::OnWrite(const uint8_t* data, size_t len)
+{
+  if(!len)
+    return;
+
+  pointer = data[0];
+  data++;
+  len--;
+
+  if(!len)
+    return;
+
+  bool timeWritten = pointer <= 6;
+  if(timeWritten)
+    fillTime();
+
+  while(len-- && pointer < sizeof(regs))
+    regs[pointer++] = *data++;
+
+  if(timeWritten)
+    SetDateTime(2000 + fromBcd(regs[6]), fromBcd(regs[5] & 0x1F), fromBcd(regs[4]), fromBcd(regs[2] & 0x3F), fromBcd(regs[1]), fromBcd(regs[0] & 0x7F));
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+size_t HostDS3231::OnRead(uint8_t* data, size_t len)
+{
+  fillTime();
+  size_t i = 0;
+  for(; i < len; i++)
+  {
+    data[i] = regs[pointer % sizeof(regs)];
+    pointer = (pointer + 1) % sizeof(regs);
+  }
+  return i;
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+size_t HostBH1750::OnRead(uint8_t* data, size_t len)
+{
+  if(len < 2)
+    return 0;
+
+  long raw = (long)(lux * 1.2);
+  if(raw > 0xFFFF)
+    raw = 0xFFFF;
+
+  data[0] = highByte(raw);
+  data[1] = lowByte(raw);
+  return 2;
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+void HostMax44009::OnWrite(const uint8_t* data, size_t len)
+{
+  if(len)
+    pointer = data[0];
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+size_t HostMax44009::OnRead(uint8_t* data, size_t len)
+{
+  // люксы = 2^exponent * mantissa * 0.045
+  long mantissa = (long)(lux / 0.045);
+  uint8_t exponent = 0;
+  while(mantissa > 255 && exponent < 14)
+  {
+    mantissa >>= 1;
+    exponent++;
+  }
+
+  uint8_t regs[2];
+  regs[0] = (exponent << 4) | ((mantissa >> 4) & 0x0F);
+  regs[1] = mantissa & 0x0F;
+
+  size_t i = 0;
+  for(; i < len; i++)
+    data[i] = (pointer == 0x03 && i < 2) ? regs[i] : 0;
+  return i;
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+uint8_t HostSi7021::crc(uint16_t value)
+{
+  uint8_t bytes[2] = { highByte(value), lowByte(value) };
+  uint8_t result = 0;
+  for(uint8_t i = 0; i < 2; i++)
+  {
+    result ^= bytes[i];
+    for(uint8_t j = 8; j > 0; j--)
+      result = (result & 0x80) ? (result << 1) ^ 0x131 : (result << 1);
+  }
+  return result;
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+void HostSi7021::OnWrite(const uint8_t* data, size_t len)
+{
+  if(len)
+    command = data[0];
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+size_t HostSi7021::OnRead(uint8_t* data, size_t len)
+{
+  uint16_t raw;
+  switch(command)
+  {
+    case 0xE5: // влажность
+    case 0xF5:
+      raw = (uint16_t)((humidity + 6) * 65536 / 125);
+    break;
+
+    case 0xE0: // температура последнего измерения влажности
+    case 0xE3:
+    case 0xF3:
+      raw = (uint16_t)((temperature + 46.85) * 65536 / 175.72);
+    break;
+
+    case 0xE7: // пользовательский регистр
+      if(len)
+        data[0] = 0x3A;
+      return len ? 1 : 0;
+
+    default:
+      return 0;
+  }
+
+  uint8_t bytes[3] = { highByte(raw), lowByte(raw), crc(raw) };
+  size_t i = 0;
+  for(; i < len && i < 3; i++)
+    data[i] = bytes[i];
+  return i;
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+//--------------------------------------------------------------------------------------------------------------------------------
+// HostAT24CX
+//--------------------------------------------------------------------------------------------------------------------------------
+HostAT24CX::HostAT24CX(size_t sz, uint8_t ps)
+{
+  size = sz > HOST_AT24CX_MAX_SIZE ? HOST_AT24CX_MAX_SIZE : sz;
+  pageSize = ps;
+  pointer = 0;
+  busy = false;
+  busySince = 0;
+  Fill(0xFF);
+  ResetStat();
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+void HostAT24CX::ResetStat()
+{
+  writeCycles = bytesWritten = busyMicros = nacks = pageWraps = 0;
+  memset(cellWrites, 0, sizeof(cellWrites));
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+uint16_t HostAT24CX::MaxCellWrites() const
+{
+  uint16_t result = 0;
+  for(size_t i = 0; i < size; i++)
+    if(cellWrites[i] > result)
+      result = cellWrites[i];
+  return result;
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+bool HostAT24CX::OnAddress()
+{
+  if(busy && micros() - busySince < HOST_AT24CX_WRITE_CYCLE)
+  {
+    nacks++;
+    return false;
+  }
+
+  busy = false;
+  return true;
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+void HostAT24CX::OnWrite(const uint8_t* data, size_t len)
+{
+  if(len < 2) // только адрес микросхемы - опрос готовности
+    return;
+
+  pointer = ((data[0] << 8) | data[1]) % size;
+  data += 2;
+  len -= 2;
+
+  if(!len) // установка адреса перед чтением
+    return;
+
+  // страничная запись: адрес внутри страницы заворачивается, как у настоящей микросхемы
+  uint16_t pageStart = pointer - (pointer % pageSize);
+  uint16_t offset = pointer % pageSize;
+  for(size_t i = 0; i < len; i++)
+  {
+    uint16_t addr = pageStart + (offset + i) % pageSize;
+    if(i && addr == pageStart)
+      pageWraps++;
+
+    memory[addr] = data[i];
+    cellWrites[addr]++;
+  }
+
+  pointer = pageStart + (offset + len) % pageSize;
+  bytesWritten += len;
+  writeCycles++;
+  busyMicros += HOST_AT24CX_WRITE_CYCLE;
+  busy = true;
+  busySince = micros();
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+size_t HostAT24CX::OnRead(uint8_t* data, size_t len)
+{
+  // последовательное чтение идёт через всю память, не только страницу
+  for(size_t i = 0; i < len; i++)
+  {
+    data[i] = memory[pointer];
+    pointer = (pointer + 1) % size;
+  }
+  return len;
+}
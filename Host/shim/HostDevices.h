@@ -0,0 +1,104 @@
+#ifndef _HOST_DEVICES_H
+#define _HOST_DEVICES_H
+//--------------------------------------------------------------------------------------------------------------------------------
+// модели устройств на шине I2C для тестов и бенчмарков: часы DS3231, датчики освещённости BH1750 и MAX44009, Si7021, EEPROM AT24CX.
+// Подключаются через Wire.Attach(адрес, &модель), показания задаются методами Set*
+//--------------------------------------------------------------------------------------------------------------------------------
+#include <Arduino.h>
+#include <Wire.h>
+//--------------------------------------------------------------------------------------------------------------------------------
+class HostDS3231 : public HostWireDevice // часы идут по millis() от установленного времени
+{
+  public:
+    HostDS3231();
+    void SetDateTime(uint16_t year, uint8_t month, uint8_t day, uint8_t hour, uint8_t minute, uint8_t second);
+
+    virtual void OnWrite(const uint8_t* data, size_t len);
+    virtual size_t OnRead(uint8_t* data, size_t len);
+
+  private:
+    uint8_t pointer;
+    uint8_t regs[0x13];
+    long baseTime; // секунды от 2000-01-01 на момент baseMillis
+    unsigned long baseMillis;
+    void fillTime();
+};
+//--------------------------------------------------------------------------------------------------------------------------------
+class HostBH1750 : public HostWireDevice
+{
+  public:
+    HostBH1750() : lux(0) {}
+    void SetLux(long l) { lux = l; }
+
+    virtual void OnWrite(const uint8_t*, size_t) {}
+    virtual size_t OnRead(uint8_t* data, size_t len);
+
+  private:
+    long lux;
+};
+//--------------------------------------------------------------------------------------------------------------------------------
+class HostMax44009 : public HostWireDevice
+{
+  public:
+    HostMax44009() : lux(0), pointer(0) {}
+    void SetLux(long l) { lux = l; }
+
+    virtual void OnWrite(const uint8_t* data, size_t len);
+    virtual size_t OnRead(uint8_t* data, size_t len);
+
+  private:
+    long lux;
+    uint8_t pointer;
+};
+//--------------------------------------------------------------------------------------------------------------------------------
+class HostSi7021 : public HostWireDevice
+{
+  public:
+    HostSi7021() : humidity(50), temperature(20), command(0) {}
+    void SetHumidity(float h) { humidity = h; }
+    void SetTemperature(float t) { temperature = t; }
+
+    virtual void OnWrite(const uint8_t* data, size_t len);
+    virtual size_t OnRead(uint8_t* data, size_t len);
+
+  private:
+    float humidity, temperature;
+    uint8_t command;
+    static uint8_t crc(uint16_t value);
+};
+//--------------------------------------------------------------------------------------------------------------------------------
+#define HOST_AT24CX_MAX_SIZE 4096 // AT24C32
+#define HOST_AT24CX_WRITE_CYCLE 5000 // tWR по документации, мкс
+//--------------------------------------------------------------------------------------------------------------------------------
+class HostAT24CX : public HostWireDevice // EEPROM с внутренним циклом записи: пока он идёт, микросхема не отвечает на свой адрес
+{
+  public:
+    HostAT24CX(size_t size = HOST_AT24CX_MAX_SIZE, uint8_t pageSize = 32);
+
+    uint8_t* Data() { return memory; }
+    void Fill(uint8_t val) { memset(memory, val, size); }
+
+    uint32_t WriteCycles() const { return writeCycles; } // сколько циклов записи (страничных или побайтных) запущено
+    uint32_t BytesWritten() const { return bytesWritten; }
+    uint32_t BusyMicros() const { return busyMicros; } // суммарная длительность циклов записи
+    uint32_t Nacks() const { return nacks; } // сколько раз мастер получил NACK, опрашивая занятую микросхему
+    uint32_t PageWraps() const { return pageWraps; } // сколько раз запись перешла через конец страницы и затёрла её начало
+    uint16_t MaxCellWrites() const; // износ самой затёртой ячейки
+    void ResetStat();
+
+    virtual bool OnAddress();
+    virtual void OnWrite(const uint8_t* data, size_t len);
+    virtual size_t OnRead(uint8_t* data, size_t len);
+
+  private:
+    uint8_t memory[HOST_AT24CX_MAX_SIZE];
+    uint16_t cellWrites[HOST_AT24CX_MAX_SIZE];
+    size_t size;
+    uint8_t pageSize;
+    uint16_t pointer;
+    unsigned long busySince;
+    bool busy;
+    uint32_t writeCycles, bytesWritten, busyMicros, nacks, pageWraps;
+};
+//--------------------------------------------------------------------------------------------------------------------------------
+#endif
@@ -0,0 +1,260 @@
+#include "HostEsp8266.h"
+//--------------------------------------------------------------------------------------------------------------------------------
+// формат кадра - как в CoreTransport.h (ESP_FRAME_*): 0xF5, тип (старший бит - последний кадр), клиент, номер,
+// длина (младший байт первым), данные, CRC-8 всего между началом кадра и CRC
+//--------------------------------------------------------------------------------------------------------------------------------
+#define FRAME_START 0xF5
+#define FRAME_DATA 1
+#define FRAME_LAST 0x80
+//--------------------------------------------------------------------------------------------------------------------------------
+HostEsp8266* HostEsp8266::attached = NULL;
+//--------------------------------------------------------------------------------------------------------------------------------
+HostEsp8266::HostEsp8266()
+{
+  port = NULL;
+  framingSupported = false;
+  framingEnabled = false;
+  serverStarted = false;
+  frameNumber = 0;
+  lineLength = 0;
+  sendClient = 0;
+  sendRemaining = 0;
+  sendsCompleted = commands = payloadBytes = 0;
+
+  for(uint8_t i = 0; i < HOST_ESP_MAX_CLIENTS; i++)
+    ClearReply(i);
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+void HostEsp8266::Attach(HardwareSerial& p)
+{
+  port = &p;
+  attached = this;
+  port->OnWrite(WriteHandler);
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+void HostEsp8266::Detach()
+{
+  if(port)
+    port->OnWrite(NULL);
+  port = NULL;
+  attached = NULL;
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+void HostEsp8266::WriteHandler(HardwareSerial&, uint8_t b)
+{
+  if(attached)
+    attached->OnByte(b);
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+void HostEsp8266::Answer(const char* str)
+{
+  if(port)
+    port->Inject(str);
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+void HostEsp8266::OnByte(uint8_t b)
+{
+  if(sendRemaining) // данные после приглашения '>'
+  {
+    if(replyLength[sendClient] < HOST_ESP_REPLY_SIZE)
+    {
+      replies[sendClient][replyLength[sendClient]++] = (char) b;
+      replies[sendClient][replyLength[sendClient]] = '\0';
+    }
+
+    if(!--sendRemaining)
+    {
+      sendsCompleted++;
+      Answer("\r\nRecv bytes\r\n\r\nSEND OK\r\n");
+    }
+    return;
+  }
+
+  if(b == '\r')
+    return;
+
+  if(b == '\n')
+  {
+    line[lineLength] = '\0';
+    if(lineLength)
+      OnCommand(line);
+    lineLength = 0;
+    return;
+  }
+
+  if(lineLength < HOST_ESP_LINE_SIZE - 1)
+    line[lineLength++] = (char) b;
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+void HostEsp8266::OnCommand(const char* cmd)
+{
+  commands++;
+
+  if(!strcmp(cmd, "AT+RST"))
+  {
+    framingEnabled = false;
+    serverStarted = false;
+    Answer("\r\nOK\r\n\r\n ets Jan  8 2013,rst cause:2, boot mode:(3,6)\r\n\r\nAi-Thinker Technology Co. Ltd.\r\n\r\nready\r\n");
+    return;
+  }
+
+  if(!strcmp(cmd, "AT+CIPFRAME=1"))
+  {
+    framingEnabled = framingSupported;
+    Answer(framingSupported ? "\r\nOK\r\n" : "\r\nERROR\r\n");
+    return;
+  }
+
+  if(!strncmp(cmd, "AT+CIPSERVER=1", 14))
+  {
+    serverStarted = true;
+    Answer("\r\nOK\r\n");
+    return;
+  }
+
+  if(!strcmp(cmd, "AT+CWJAP?"))
+  {
+    Answer("+CWJAP:\"greenhouse\",\"c8:3a:35:12:34:56\",6,-58\r\n\r\nOK\r\n");
+    return;
+  }
+
+  if(!strncmp(cmd, "AT+CWJAP_CUR=", 13))
+  {
+    Answer("WIFI CONNECTED\r\nWIFI GOT IP\r\n\r\nOK\r\n");
+    return;
+  }
+
+  if(!strncmp(cmd, "AT+CIPSENDBUF=", 14) || !strncmp(cmd, "AT+CIPSEND=", 11))
+  {
+    const char* args = strchr(cmd, '=') + 1;
+    const char* comma = strchr(args, ',');
+    sendClient = (uint8_t) atoi(args);
+    sendRemaining = comma ? (size_t) atol(comma + 1) : 0;
+    if(sendClient >= HOST_ESP_MAX_CLIENTS || !sendRemaining)
+    {
+      sendRemaining = 0;
+      Answer("\r\nERROR\r\n");
+      return;
+    }
+    Answer("\r\nOK\r\n> ");
+    return;
+  }
+
+  if(!strncmp(cmd, "AT+CIPCLOSE=", 12))
+  {
+    char buff[32];
+    sprintf(buff, "%d,CLOSED\r\n\r\nOK\r\n", atoi(cmd + 12));
+    Answer(buff);
+    return;
+  }
+
+  if(!strncmp(cmd, "AT+CIPSTART=", 12)) // наружу модель не ходит
+  {
+    Answer("\r\nERROR\r\n");
+    return;
+  }
+
+  if(!strcmp(cmd, "ATE0") || !strncmp(cmd, "AT+CWMODE", 9) || !strncmp(cmd, "AT+CWSAP", 8) || !strcmp(cmd, "AT+CWQAP")
+    || !strncmp(cmd, "AT+CIPMODE=", 11) || !strncmp(cmd, "AT+CIPMUX=", 10) || !strcmp(cmd, "AT"))
+  {
+    Answer("\r\nOK\r\n");
+    return;
+  }
+
+  Answer("\r\nERROR\r\n");
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+void HostEsp8266::Connect(uint8_t client)
+{
+  char buff[16];
+  sprintf(buff, "%d,CONNECT\r\n", client);
+  Answer(buff);
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+void HostEsp8266::Close(uint8_t client)
+{
+  char buff[16];
+  sprintf(buff, "%d,CLOSED\r\n", client);
+  Answer(buff);
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+void HostEsp8266::SendData(uint8_t client, const uint8_t* data, size_t len)
+{
+  payloadBytes += len;
+
+  if(!framingEnabled)
+  {
+    char header[24];
+    sprintf(header, "+IPD,%d,%lu:", client, (unsigned long) len);
+    Answer(header);
+    SendRaw(data, len);
+    return;
+  }
+
+  // как и прошивка ESP: данные одного чтения из сокета - серия кадров, у последнего флаг FRAME_LAST
+  do
+  {
+    size_t chunk = len > HOST_ESP_FRAME_PAYLOAD ? HOST_ESP_FRAME_PAYLOAD : len;
+    SendFrame(client, data, chunk, chunk == len);
+    data += chunk;
+    len -= chunk;
+  } while(len);
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+void HostEsp8266::SendFrame(uint8_t client, const uint8_t* data, size_t len, bool last)
+{
+  uint8_t frame[6 + HOST_ESP_FRAME_PAYLOAD + 1];
+  frame[0] = FRAME_START;
+  frame[1] = FRAME_DATA | (last ? FRAME_LAST : 0);
+  frame[2] = client;
+  frame[3] = frameNumber++;
+  frame[4] = len & 0xFF;
+  frame[5] = (len >> 8) & 0xFF;
+  memcpy(frame + 6, data, len);
+  frame[6 + len] = FrameCRC(frame + 1, 5 + len);
+  SendRaw(frame, 7 + len);
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+void HostEsp8266::SendRaw(const uint8_t* data, size_t len)
+{
+  if(port)
+    port->Inject(data, len);
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+uint8_t HostEsp8266::FrameCRC(const uint8_t* data, size_t len)
+{
+  uint8_t crc = 0;
+  while(len--)
+  {
+    uint8_t b = *data++;
+    for(uint8_t i = 0; i < 8; i++)
+    {
+      uint8_t mix = (crc ^ b) & 0x01;
+      crc >>= 1;
+      if(mix)
+        crc ^= 0x8C;
+      b >>= 1;
+    }
+  }
+  return crc;
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+size_t HostEsp8266::ReplyLength(uint8_t client) const
+{
+  return client < HOST_ESP_MAX_CLIENTS ? replyLength[client] : 0;
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+const char* HostEsp8266::Reply(uint8_t client) const
+{
+  return client < HOST_ESP_MAX_CLIENTS ? replies[client] : "";
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+void HostEsp8266::ClearReply(uint8_t client)
+{
+  if(client >= HOST_ESP_MAX_CLIENTS)
+    return;
+
+  replyLength[client] = 0;
+  replies[client][0] = '\0';
+}
+//--------------------------------------------------------------------------------------------------------------------------------
@@ -0,0 +1,73 @@
+#ifndef _HOST_ESP8266_H
+#define _HOST_ESP8266_H
+//--------------------------------------------------------------------------------------------------------------------------------
+// модель ESP8266 с AT-прошивкой на UART: отвечает на команды, которые шлёт CoreESPTransport, как это делает модуль
+// (ответы взяты из записи сеанса с ESP-01, AT 1.x), и подкладывает в порт события внешних клиентов - соединение,
+// данные (+IPD или двоичными кадрами, если прошивка их включила по AT+CIPFRAME=1), разрыв.
+// Данные, которые прошивка отсылает клиентам через AT+CIPSENDBUF, копятся по клиентам.
+//--------------------------------------------------------------------------------------------------------------------------------
+#include <Arduino.h>
+//--------------------------------------------------------------------------------------------------------------------------------
+#define HOST_ESP_MAX_CLIENTS 5
+#define HOST_ESP_LINE_SIZE 256
+#define HOST_ESP_REPLY_SIZE 4096 // сколько байт ответа клиенту храним
+#define HOST_ESP_FRAME_PAYLOAD 192 // столько данных кладётся в один двоичный кадр
+//--------------------------------------------------------------------------------------------------------------------------------
+class HostEsp8266
+{
+  public:
+    HostEsp8266();
+
+    void Attach(HardwareSerial& port); // подключает модель к порту, на котором прошивка ждёт ESP
+    void Detach();
+
+    void SetFramingSupported(bool b) { framingSupported = b; } // отвечать ли OK на AT+CIPFRAME=1
+
+    // события внешних клиентов
+    void Connect(uint8_t client);
+    void Close(uint8_t client);
+    void SendData(uint8_t client, const uint8_t* data, size_t len); // +IPD или кадры, смотря что включено
+    void SendData(uint8_t client, const char* str) { SendData(client, (const uint8_t*) str, strlen(str)); }
+    void SendRaw(const uint8_t* data, size_t len); // как есть, например испорченный кадр
+
+    bool FramingEnabled() const { return framingEnabled; }
+    bool ServerStarted() const { return serverStarted; }
+    uint8_t FrameNumber() const { return frameNumber; }
+
+    // что прошивка отослала клиенту через AT+CIPSENDBUF
+    size_t ReplyLength(uint8_t client) const;
+    const char* Reply(uint8_t client) const; // с завершающим нулём
+    void ClearReply(uint8_t client);
+    uint32_t SendsCompleted() const { return sendsCompleted; }
+
+    uint32_t Commands() const { return commands; } // сколько AT-команд получено
+    uint32_t PayloadBytes() const { return payloadBytes; } // сколько байт данных клиентов отдано в порт
+
+    static uint8_t FrameCRC(const uint8_t* data, size_t len); // CRC-8 кадра, как считает прошивка ESP (Dallas/Maxim)
+
+  private:
+    HardwareSerial* port;
+    bool framingSupported, framingEnabled, serverStarted;
+    uint8_t frameNumber;
+
+    char line[HOST_ESP_LINE_SIZE];
+    size_t lineLength;
+
+    uint8_t sendClient;
+    size_t sendRemaining; // сколько байт данных AT+CIPSENDBUF ещё ждём
+
+    char replies[HOST_ESP_MAX_CLIENTS][HOST_ESP_REPLY_SIZE + 1];
+    size_t replyLength[HOST_ESP_MAX_CLIENTS];
+
+    uint32_t sendsCompleted, commands, payloadBytes;
+
+    void Answer(const char* str);
+    void OnByte(uint8_t b);
+    void OnCommand(const char* cmd);
+    void SendFrame(uint8_t client, const uint8_t* data, size_t len, bool last);
+
+    static void WriteHandler(HardwareSerial& port, uint8_t b);
+    static HostEsp8266* attached;
+};
+//--------------------------------------------------------------------------------------------------------------------------------
+#endif
@@ -0,0 +1,493 @@
+#include <malloc.h>
+#include <new>
+#include <time.h>
+#include "Arduino.h"
+#include "HostHardware.h"
+//--------------------------------------------------------------------------------------------------------------------------------
+// регистры ATmega2560, см. avr/io.h
+//--------------------------------------------------------------------------------------------------------------------------------
+volatile uint8_t SREG;
+volatile uint8_t UCSR0A, UCSR1A, UCSR2A, UCSR3A;
+volatile uint8_t UCSR0B, UCSR1B, UCSR2B, UCSR3B;
+volatile uint8_t ADCSRA, ADCSRB, ADMUX, ADCL, ADCH, DIDR0, DIDR2;
+volatile uint16_t ADC;
+volatile uint8_t PCICR, PCIFR, PCMSK0, PCMSK1, PCMSK2;
+volatile uint8_t PINK;
+//--------------------------------------------------------------------------------------------------------------------------------
+// время
+//--------------------------------------------------------------------------------------------------------------------------------
+static HostClockMode clockMode = hostClockRealTime;
+static uint64_t clockOffset = 0; // микросекунды, прокрученные вручную
+static uint64_t clockStartedAt = 0; // реальное время старта, микросекунд
+static uint64_t clockFrozenAt = 0; // модельное время в момент перехода в hostClockFrozen
+//--------------------------------------------------------------------------------------------------------------------------------
+static uint64_t realMicros()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t) ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000;
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+static uint64_t nowMicros()
+{
+  if(clockMode == hostClockFrozen)
+    return clockFrozenAt + clockOffset++;
+
+  if(!clockStartedAt)
+    clockStartedAt = realMicros();
+
+  return realMicros() - clockStartedAt + clockOffset;
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+void Host::SetClockMode(HostClockMode mode)
+{
+  if(mode == clockMode)
+    return;
+
+  uint64_t now = nowMicros();
+  clockOffset = 0;
+  clockMode = mode;
+
+  if(mode == hostClockFrozen)
+  {
+    clockFrozenAt = now;
+  }
+  else
+  {
+    clockStartedAt = realMicros();
+    clockOffset = now;
+  }
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+void Host::AdvanceMicros(unsigned long us)
+{
+  clockOffset += us;
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+void Host::AdvanceMillis(unsigned long ms)
+{
+  clockOffset += (uint64_t) ms * 1000;
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+unsigned long micros(void)
+{
+  return (unsigned long)(uint32_t) nowMicros(); // как на AVR - 32 бита с переполнением
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+unsigned long millis(void)
+{
+  return (unsigned long)(uint32_t)(nowMicros() / 1000);
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+void delay(unsigned long ms)
+{
+  // ждать по-настоящему незачем - просто прокручиваем модельное время, отдавая управление как ядро Arduino
+  yield();
+  Host::AdvanceMillis(ms);
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+void delayMicroseconds(unsigned int us)
+{
+  Host::AdvanceMicros(us);
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+void Host::RunLoop()
+{
+  loop();
+  serialEventRun();
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+// ножки
+//--------------------------------------------------------------------------------------------------------------------------------
+static volatile uint8_t pinLevels[NUM_DIGITAL_PINS]; // он же "регистр порта" для digitalPinToPort/portInputRegister
+static uint8_t pinModes[NUM_DIGITAL_PINS];
+static int analogValues[NUM_DIGITAL_PINS];
+static unsigned long pulseValues[NUM_DIGITAL_PINS];
+static uint32_t digitalWrites = 0;
+static HostPinWriteHandler pinWriteHandler = NULL;
+static uint8_t dummyPort;
+//--------------------------------------------------------------------------------------------------------------------------------
+volatile uint8_t* HostPortRegister(uint8_t pin)
+{
+  if(pin >= NUM_DIGITAL_PINS)
+    return &dummyPort;
+  return &pinLevels[pin];
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+void pinMode(uint8_t pin, uint8_t mode)
+{
+  if(pin >= NUM_DIGITAL_PINS)
+    return;
+
+  pinModes[pin] = mode;
+  if(mode == INPUT_PULLUP)
+    pinLevels[pin] = HIGH;
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+void digitalWrite(uint8_t pin, uint8_t val)
+{
+  if(pin >= NUM_DIGITAL_PINS)
+    return;
+
+  pinLevels[pin] = val ? HIGH : LOW;
+  digitalWrites++;
+
+  if(pinWriteHandler)
+    pinWriteHandler(pin, pinLevels[pin]);
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+int digitalRead(uint8_t pin)
+{
+  if(pin >= NUM_DIGITAL_PINS)
+    return LOW;
+  return pinLevels[pin] ? HIGH : LOW;
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+static uint8_t analogPin(uint8_t pin)
+{
+  if(pin < NUM_ANALOG_INPUTS)
+    pin += A0;
+  return pin < NUM_DIGITAL_PINS ? pin : A0;
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+int analogRead(uint8_t pin)
+{
+  return analogValues[analogPin(pin)];
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+void analogReference(uint8_t)
+{
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+void analogWrite(uint8_t pin, int val)
+{
+  pinMode(pin, OUTPUT);
+  digitalWrite(pin, val > 127 ? HIGH : LOW);
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+unsigned long pulseIn(uint8_t pin, uint8_t, unsigned long)
+{
+  if(pin >= NUM_DIGITAL_PINS)
+    return 0;
+  return pulseValues[pin];
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+void shiftOut(uint8_t dataPin, uint8_t clockPin, uint8_t bitOrder, uint8_t val)
+{
+  for(uint8_t i = 0; i < 8; i++)
+  {
+    if(bitOrder == LSBFIRST)
+      digitalWrite(dataPin, !!(val & (1 << i)));
+    else
+      digitalWrite(dataPin, !!(val & (1 << (7 - i))));
+
+    digitalWrite(clockPin, HIGH);
+    digitalWrite(clockPin, LOW);
+  }
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+uint8_t shiftIn(uint8_t dataPin, uint8_t clockPin, uint8_t bitOrder)
+{
+  uint8_t value = 0;
+  for(uint8_t i = 0; i < 8; ++i)
+  {
+    digitalWrite(clockPin, HIGH);
+    if(bitOrder == LSBFIRST)
+      value |= digitalRead(dataPin) << i;
+    else
+      value |= digitalRead(dataPin) << (7 - i);
+    digitalWrite(clockPin, LOW);
+  }
+  return value;
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+void tone(uint8_t, unsigned int, unsigned long)
+{
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+void noTone(uint8_t)
+{
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+void Host::SetDigital(uint8_t pin, uint8_t level)
+{
+  if(pin < NUM_DIGITAL_PINS)
+    pinLevels[pin] = level ? HIGH : LOW;
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+uint8_t Host::GetDigital(uint8_t pin)
+{
+  return digitalRead(pin);
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+uint8_t Host::GetPinMode(uint8_t pin)
+{
+  return pin < NUM_DIGITAL_PINS ? pinModes[pin] : INPUT;
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+void Host::SetAnalog(uint8_t pin, int value)
+{
+  analogValues[analogPin(pin)] = value;
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+void Host::SetPulse(uint8_t pin, unsigned long us)
+{
+  if(pin < NUM_DIGITAL_PINS)
+    pulseValues[pin] = us;
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+uint32_t Host::DigitalWrites()
+{
+  return digitalWrites;
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+void Host::SetPinWriteHandler(HostPinWriteHandler handler)
+{
+  pinWriteHandler = handler;
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+// внешние прерывания
+//--------------------------------------------------------------------------------------------------------------------------------
+#define HOST_INTERRUPTS_COUNT 6
+static voidFuncPtr interruptHandlers[HOST_INTERRUPTS_COUNT];
+//--------------------------------------------------------------------------------------------------------------------------------
+void attachInterrupt(uint8_t interruptNum, void (*userFunc)(void), int)
+{
+  if(interruptNum < HOST_INTERRUPTS_COUNT)
+    interruptHandlers[interruptNum] = userFunc;
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+void detachInterrupt(uint8_t interruptNum)
+{
+  if(interruptNum < HOST_INTERRUPTS_COUNT)
+    interruptHandlers[interruptNum] = NULL;
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+void Host::FireInterrupt(uint8_t interruptNum)
+{
+  if(interruptNum < HOST_INTERRUPTS_COUNT && interruptHandlers[interruptNum])
+    interruptHandlers[interruptNum]();
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+// прочее из ядра Arduino
+//--------------------------------------------------------------------------------------------------------------------------------
+long random(long howbig)
+{
+  if(howbig == 0)
+    return 0;
+  return ::random() % howbig;
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+long random(long howsmall, long howbig)
+{
+  if(howsmall >= howbig)
+    return howsmall;
+  return random(howbig - howsmall) + howsmall;
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+void randomSeed(unsigned long seed)
+{
+  if(seed != 0)
+    srandom(seed);
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+long map(long x, long in_min, long in_max, long out_min, long out_max)
+{
+  return (x - in_min) * (out_max - out_min) / (in_max - in_min) + out_min;
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+uint16_t makeWord(uint16_t w)
+{
+  return w;
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+uint16_t makeWord(byte h, byte l)
+{
+  return (h << 8) | l;
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+static char* reverseDigits(char* begin, char* end)
+{
+  char* result = begin;
+  end--;
+  while(begin < end)
+  {
+    char c = *begin;
+    *begin++ = *end;
+    *end-- = c;
+  }
+  return result;
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+char* ultoa(unsigned long value, char* str, int radix)
+{
+  char* p = str;
+  do
+  {
+    int d = value % radix;
+    *p++ = d < 10 ? '0' + d : 'a' + d - 10;
+    value /= radix;
+  } while(value);
+  *p = 0;
+  return reverseDigits(str, p);
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+char* ltoa(long value, char* str, int radix)
+{
+  if(value < 0 && radix == 10)
+  {
+    *str = '-';
+    ultoa(-(unsigned long) value, str + 1, radix);
+    return str;
+  }
+  return ultoa((unsigned long) value, str, radix);
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+char* utoa(unsigned value, char* str, int radix)
+{
+  // int на AVR 16-битный: отрицательные значения выводятся так же, как на контроллере
+  return ultoa((uint16_t) value, str, radix);
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+char* itoa(int value, char* str, int radix)
+{
+  return ltoa(radix == 10 ? (long) value : (long)(uint16_t) value, str, radix);
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+char* dtostrf(double val, signed char width, unsigned char prec, char* s)
+{
+  sprintf(s, "%*.*f", width, prec, val);
+  return s;
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+// статистика кучи: malloc/free прошивки заворачиваются линкером (-Wl,--wrap), new/delete переопределены ниже
+//--------------------------------------------------------------------------------------------------------------------------------
+static HostHeapStat heapStat = {0,0,0,0};
+static HostHeapTraceHandler heapTrace = NULL;
+//--------------------------------------------------------------------------------------------------------------------------------
+extern "C" void* __real_malloc(size_t size);
+extern "C" void* __real_calloc(size_t n, size_t size);
+extern "C" void* __real_realloc(void* ptr, size_t size);
+extern "C" void __real_free(void* ptr);
+//--------------------------------------------------------------------------------------------------------------------------------
+static void heapAdd(void* ptr, size_t size)
+{
+  if(!ptr)
+    return;
+
+  if(heapTrace)
+    heapTrace(ptr, size ? size : 1);
+
+  heapStat.Current += malloc_usable_size(ptr);
+  heapStat.Allocs++;
+  if(heapStat.Current > heapStat.Peak)
+    heapStat.Peak = heapStat.Current;
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+static void heapRemove(void* ptr)
+{
+  if(!ptr)
+    return;
+
+  if(heapTrace)
+    heapTrace(ptr, 0);
+
+  size_t sz = malloc_usable_size(ptr);
+  heapStat.Current = heapStat.Current > sz ? heapStat.Current - sz : 0;
+  heapStat.Frees++;
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+extern "C" void* __wrap_malloc(size_t size)
+{
+  void* ptr = __real_malloc(size);
+  heapAdd(ptr, size);
+  return ptr;
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+extern "C" void* __wrap_calloc(size_t n, size_t size)
+{
+  void* ptr = __real_calloc(n, size);
+  heapAdd(ptr, n * size);
+  return ptr;
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+extern "C" void* __wrap_realloc(void* ptr, size_t size)
+{
+  size_t oldSize = ptr ? malloc_usable_size(ptr) : 0;
+  void* result = __real_realloc(ptr, size);
+  if(!result && size) // не удалось - старый блок остался на месте
+    return result;
+
+  if(ptr)
+  {
+    if(heapTrace)
+      heapTrace(ptr, 0);
+
+    heapStat.Current = heapStat.Current > oldSize ? heapStat.Current - oldSize : 0;
+    heapStat.Frees++;
+  }
+  heapAdd(result, size);
+  return result;
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+extern "C" void __wrap_free(void* ptr)
+{
+  heapRemove(ptr);
+  __real_free(ptr);
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+void* operator new(size_t size)
+{
+  void* ptr = __wrap_malloc(size ? size : 1);
+  if(!ptr)
+    throw std::bad_alloc();
+  return ptr;
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+void* operator new[](size_t size)
+{
+  return operator new(size);
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+void operator delete(void* ptr) noexcept
+{
+  __wrap_free(ptr);
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+void operator delete[](void* ptr) noexcept
+{
+  __wrap_free(ptr);
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+void operator delete(void* ptr, size_t) noexcept
+{
+  __wrap_free(ptr);
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+void operator delete[](void* ptr, size_t) noexcept
+{
+  __wrap_free(ptr);
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+void Host::ResetHeapStat()
+{
+  heapStat.Peak = heapStat.Current;
+  heapStat.Allocs = 0;
+  heapStat.Frees = 0;
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+const HostHeapStat* Host::GetHeapStat()
+{
+  return &heapStat;
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+void Host::SetHeapTrace(HostHeapTraceHandler handler)
+{
+  heapTrace = handler;
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+int Host::FreeRam()
+{
+  return heapStat.Current >= HOST_RAM_SIZE ? 0 : (int)(HOST_RAM_SIZE - heapStat.Current);
+}
+//--------------------------------------------------------------------------------------------------------------------------------
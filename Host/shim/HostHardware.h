@@ -0,0 +1,61 @@
+#ifndef _HOST_HARDWARE_H
+#define _HOST_HARDWARE_H
+//--------------------------------------------------------------------------------------------------------------------------------
+// управление "железом" при сборке под Linux: модельное время, уровни на ножках, прерывания, статистика кучи.
+// Прошивка этим не пользуется - только тесты и бенчмарки из Host/
+//--------------------------------------------------------------------------------------------------------------------------------
+#include <stdint.h>
+#include <stddef.h>
+//--------------------------------------------------------------------------------------------------------------------------------
+#define HOST_RAM_SIZE 8192 // объём ОЗУ Arduino Mega - от него считается "свободная память" на хосте
+//--------------------------------------------------------------------------------------------------------------------------------
+typedef enum
+{
+  hostClockRealTime, // модельное время = реальное время с запуска + всё, что прокручено через AdvanceMillis/delay
+  hostClockFrozen // время идёт только через AdvanceMillis/delay (и на 1 мкс за каждый опрос, чтобы не зависали циклы ожидания)
+  
+} HostClockMode;
+//--------------------------------------------------------------------------------------------------------------------------------
+typedef struct
+{
+  size_t Current; // занято сейчас, байт
+  size_t Peak; // максимум занятого с последнего сброса, байт
+  uint32_t Allocs; // кол-во выделений (malloc/realloc/new) с последнего сброса
+  uint32_t Frees; // кол-во освобождений с последнего сброса
+  
+} HostHeapStat;
+//--------------------------------------------------------------------------------------------------------------------------------
+typedef void (*HostHeapTraceHandler)(void* ptr, size_t size); // size - запрошенный размер при выделении, 0 - освобождение
+typedef void (*HostPinWriteHandler)(uint8_t pin, uint8_t level); // прошивка вызвала digitalWrite
+//--------------------------------------------------------------------------------------------------------------------------------
+void serialEventRun(void); // см. HardwareSerial.cpp
+//--------------------------------------------------------------------------------------------------------------------------------
+namespace Host
+{
+  void RunLoop(); // один проход главного цикла, как в main() ядра Arduino: loop() и serialEventRun()
+
+  // время
+  void SetClockMode(HostClockMode mode);
+  void AdvanceMillis(unsigned long ms);
+  void AdvanceMicros(unsigned long us);
+  
+  // ножки: цифровые уровни, аналоговые значения (0-1023), длительность импульса для pulseIn
+  void SetDigital(uint8_t pin, uint8_t level);
+  uint8_t GetDigital(uint8_t pin);
+  uint8_t GetPinMode(uint8_t pin);
+  void SetAnalog(uint8_t pin, int value);
+  void SetPulse(uint8_t pin, unsigned long micros);
+  uint32_t DigitalWrites();
+  void SetPinWriteHandler(HostPinWriteHandler handler); // например, выбор микросхемы на SPI по chip select; NULL - выключить
+
+  // прерывания, подключённые через attachInterrupt
+  void FireInterrupt(uint8_t interruptNum);
+  
+  // куча
+  void ResetHeapStat();
+  const HostHeapStat* GetHeapStat();
+  int FreeRam(); // "свободная память" на хосте: HOST_RAM_SIZE минус занятая куча
+  void SetHeapTrace(HostHeapTraceHandler handler); // каждое выделение/освобождение, например для модели кучи AVR; NULL - выключить
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+#endif
@@ -0,0 +1,165 @@
+#include "HostMcp23x17.h"
+#include "HostHardware.h"
+#include "SPI.h"
+//--------------------------------------------------------------------------------------------------------------------------------
+// HostMCP23x17
+//--------------------------------------------------------------------------------------------------------------------------------
+uint32_t HostMCP23x17::writeCounter = 0;
+//--------------------------------------------------------------------------------------------------------------------------------
+HostMCP23x17::HostMCP23x17()
+{
+  // состояние после подачи питания: все пины - входы
+  memset(regs, 0, sizeof(regs));
+  regs[HOST_MCP_IODIRA] = regs[HOST_MCP_IODIRB] = 0xFF;
+  pointer = 0;
+  ResetStat();
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+void HostMCP23x17::ResetStat()
+{
+  memset(writtenAt, 0, sizeof(writtenAt));
+  transactions = bytesWritten = 0;
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+void HostMCP23x17::writeNext(uint8_t val)
+{
+  uint8_t reg = pointer;
+  if(reg == HOST_MCP_GPIOA || reg == HOST_MCP_GPIOB) // запись в порт - это запись в защёлку
+    reg += 2;
+
+  if(reg == HOST_MCP_IOCONA || reg == HOST_MCP_IOCONB) // IOCON один на оба порта
+    regs[HOST_MCP_IOCONA] = regs[HOST_MCP_IOCONB] = val;
+
+  regs[reg] = val;
+  writtenAt[reg] = ++writeCounter;
+  bytesWritten++;
+
+  pointer = (pointer + 1) % HOST_MCP_REGISTERS;
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+uint8_t HostMCP23x17::readNext()
+{
+  uint8_t val = regs[pointer];
+  if(pointer == HOST_MCP_GPIOA || pointer == HOST_MCP_GPIOB) // на выходах читаем защёлку, на входах - ноль
+    val = regs[pointer + 2] & ~regs[pointer - HOST_MCP_GPIOA];
+  
+  pointer = (pointer + 1) % HOST_MCP_REGISTERS;
+  return val;
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+// HostMCP23017
+//--------------------------------------------------------------------------------------------------------------------------------
+void HostMCP23017::OnWrite(const uint8_t* data, size_t len)
+{
+  if(!len)
+    return;
+
+  transaction();
+  pointer = data[0] % HOST_MCP_REGISTERS;
+  for(size_t i = 1; i < len; i++)
+    writeNext(data[i]);
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+size_t HostMCP23017::OnRead(uint8_t* data, size_t len)
+{
+  transaction();
+  for(size_t i = 0; i < len; i++)
+    data[i] = readNext();
+  return len;
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+// HostMCP23S17
+//--------------------------------------------------------------------------------------------------------------------------------
+HostMCP23S17* HostMCP23S17::chips[HOST_MCP_MAX_SPI_CHIPS] = { NULL };
+uint8_t HostMCP23S17::cs = 0xFF;
+uint8_t HostMCP23S17::frameBytes = 0;
+uint8_t HostMCP23S17::command = 0;
+uint8_t HostMCP23S17::selected = 0;
+//--------------------------------------------------------------------------------------------------------------------------------
+HostMCP23S17::HostMCP23S17(uint8_t addr)
+{
+  address = addr & 0x07;
+  chips[address] = this;
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+HostMCP23S17::~HostMCP23S17()
+{
+  if(chips[address] == this)
+    chips[address] = NULL;
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+void HostMCP23S17::AttachSPI(uint8_t csPin)
+{
+  cs = csPin;
+  frameBytes = 0;
+  Host::SetPinWriteHandler(onPinWrite);
+  SPI.OnTransfer(onTransfer);
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+void HostMCP23S17::DetachSPI()
+{
+  Host::SetPinWriteHandler(NULL);
+  SPI.OnTransfer(NULL);
+  cs = 0xFF;
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+void HostMCP23S17::onPinWrite(uint8_t pin, uint8_t level)
+{
+  if(pin != cs)
+    return;
+
+  // низкий уровень на CS начинает кадр: байт команды, адрес регистра, данные
+  frameBytes = level == LOW ? 1 : 0;
+  selected = 0;
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+uint8_t HostMCP23S17::onTransfer(uint8_t data)
+{
+  if(!frameBytes) // микросхемы не выбраны
+    return 0xFF;
+
+  uint8_t pos = frameBytes;
+  if(frameBytes < 3)
+    frameBytes++;
+
+  if(pos == 1) // команда: 0100 A2 A1 A0 R/W
+  {
+    command = data;
+    if((data & 0xF0) != 0x40)
+      return 0xFF;
+
+    // пока IOCON.HAEN не включён, ножки адреса не учитываются и микросхема отзывается на адрес 0
+    uint8_t addr = (data >> 1) & 0x07;
+    for(uint8_t i = 0; i < HOST_MCP_MAX_SPI_CHIPS; i++)
+    {
+      HostMCP23S17* chip = chips[i];
+      if(chip && ((chip->regs[HOST_MCP_IOCONA] & HOST_MCP_IOCON_HAEN) ? chip->address : 0) == addr)
+      {
+        selected |= (1 << i);
+        chip->transaction();
+      }
+    }
+    return 0xFF;
+  }
+
+  uint8_t result = 0xFF;
+  bool first = true;
+  for(uint8_t i = 0; i < HOST_MCP_MAX_SPI_CHIPS; i++)
+  {
+    if(!(selected & (1 << i)))
+      continue;
+
+    HostMCP23S17* chip = chips[i];
+    if(pos == 2)
+      chip->pointer = data % HOST_MCP_REGISTERS;
+    else if(!(command & 1))
+      chip->writeNext(data);
+    else if(first)
+      result = chip->readNext();
+
+    first = false;
+  }
+
+  return result;
+}
+//--------------------------------------------------------------------------------------------------------------------------------
@@ -0,0 +1,84 @@
+#ifndef _HOST_MCP23X17_H
+#define _HOST_MCP23X17_H
+//--------------------------------------------------------------------------------------------------------------------------------
+// модели расширителей портов MCP23017 (I2C) и MCP23S17 (SPI): файл регистров в режиме IOCON.BANK = 0 с последовательной
+// адресацией, запись в GPIO попадает в OLAT. Считают транзакции и записанные байты, а для каждого регистра помнят,
+// в какой по счёту записи его трогали последний раз - по этому тест видит порядок записи защёлок и направления.
+//
+// MCP23017 подключается через Wire.Attach(0x20 | адрес, &модель), MCP23S17 - через AttachSPI(пин chip select):
+// все модели на одном CS различаются аппаратным адресом в байте команды, когда включён IOCON.HAEN
+//--------------------------------------------------------------------------------------------------------------------------------
+#include <Arduino.h>
+#include <Wire.h>
+//--------------------------------------------------------------------------------------------------------------------------------
+#define HOST_MCP_REGISTERS 22
+#define HOST_MCP_IODIRA 0x00
+#define HOST_MCP_IODIRB 0x01
+#define HOST_MCP_IOCONA 0x0A
+#define HOST_MCP_IOCONB 0x0B
+#define HOST_MCP_IOCON_HAEN 0x08
+#define HOST_MCP_GPPUA 0x0C
+#define HOST_MCP_GPIOA 0x12
+#define HOST_MCP_GPIOB 0x13
+#define HOST_MCP_OLATA 0x14
+#define HOST_MCP_OLATB 0x15
+#define HOST_MCP_MAX_SPI_CHIPS 8
+//--------------------------------------------------------------------------------------------------------------------------------
+class HostMCP23x17
+{
+  public:
+    HostMCP23x17();
+
+    uint8_t Register(uint8_t reg) const { return reg < HOST_MCP_REGISTERS ? regs[reg] : 0; }
+    uint16_t Directions() const { return regs[HOST_MCP_IODIRA] | (regs[HOST_MCP_IODIRB] << 8); } // 1 - вход
+    uint16_t Outputs() const { return regs[HOST_MCP_OLATA] | (regs[HOST_MCP_OLATB] << 8); }
+    uint32_t WrittenAt(uint8_t reg) const { return reg < HOST_MCP_REGISTERS ? writtenAt[reg] : 0; } // 0 - не писался
+
+    uint32_t Transactions() const { return transactions; }
+    uint32_t BytesWritten() const { return bytesWritten; }
+    void ResetStat();
+
+  protected:
+    uint8_t regs[HOST_MCP_REGISTERS];
+    uint8_t pointer;
+
+    void transaction() { transactions++; }
+    void writeNext(uint8_t val);
+    uint8_t readNext();
+    
+  private:
+    uint32_t writtenAt[HOST_MCP_REGISTERS];
+    uint32_t transactions, bytesWritten;
+    static uint32_t writeCounter;
+};
+//--------------------------------------------------------------------------------------------------------------------------------
+class HostMCP23017 : public HostMCP23x17, public HostWireDevice
+{
+  public:
+    virtual void OnWrite(const uint8_t* data, size_t len);
+    virtual size_t OnRead(uint8_t* data, size_t len);
+};
+//--------------------------------------------------------------------------------------------------------------------------------
+class HostMCP23S17 : public HostMCP23x17
+{
+  public:
+    HostMCP23S17(uint8_t address);
+    ~HostMCP23S17();
+
+    static void AttachSPI(uint8_t csPin); // подключает все созданные модели к SPI
+    static void DetachSPI();
+
+  private:
+    uint8_t address;
+
+    static HostMCP23S17* chips[HOST_MCP_MAX_SPI_CHIPS];
+    static uint8_t cs;
+    static uint8_t frameBytes; // этап кадра: 0 - CS не выбран, 1 - ждём команду, 2 - адрес регистра, 3 - данные
+    static uint8_t command;
+    static uint8_t selected; // битовая маска выбранных микросхем по их номеру в chips
+
+    static void onPinWrite(uint8_t pin, uint8_t level);
+    static uint8_t onTransfer(uint8_t data);
+};
+//--------------------------------------------------------------------------------------------------------------------------------
+#endif
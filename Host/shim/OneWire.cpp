@@ -0,0 +1,174 @@
+#include "OneWire.h"
+//--------------------------------------------------------------------------------------------------------------------------------
+uint8_t OneWire::pins[HOST_ONEWIRE_MAX_DEVICES];
+HostOneWireDevice* OneWire::devices[HOST_ONEWIRE_MAX_DEVICES];
+uint32_t OneWire::resets = 0;
+//--------------------------------------------------------------------------------------------------------------------------------
+OneWire::OneWire(uint8_t p)
+{
+  pin = p;
+  device = NULL;
+  for(uint8_t i = 0; i < HOST_ONEWIRE_MAX_DEVICES; i++)
+  {
+    if(devices[i] && pins[i] == pin)
+    {
+      device = devices[i];
+      break;
+    }
+  }
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+void OneWire::Attach(uint8_t pin, HostOneWireDevice* device)
+{
+  for(uint8_t i = 0; i < HOST_ONEWIRE_MAX_DEVICES; i++)
+  {
+    if(devices[i] && pins[i] == pin)
+    {
+      devices[i] = device;
+      return;
+    }
+  }
+
+  if(!device)
+    return;
+
+  for(uint8_t i = 0; i < HOST_ONEWIRE_MAX_DEVICES; i++)
+  {
+    if(!devices[i])
+    {
+      pins[i] = pin;
+      devices[i] = device;
+      return;
+    }
+  }
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+uint8_t OneWire::reset(void)
+{
+  resets++;
+  return device ? device->OnReset() : 0;
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+void OneWire::select(const uint8_t rom[8])
+{
+  write(0x55);
+  for(uint8_t i = 0; i < 8; i++)
+    write(rom[i]);
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+void OneWire::write(uint8_t v, uint8_t)
+{
+  if(device)
+    device->OnWrite(v);
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+void OneWire::write_bytes(const uint8_t* buf, uint16_t count, bool power)
+{
+  for(uint16_t i = 0; i < count; i++)
+    write(buf[i], power);
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+uint8_t OneWire::read(void)
+{
+  return device ? device->OnRead() : 0xFF;
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+void OneWire::read_bytes(uint8_t* buf, uint16_t count)
+{
+  for(uint16_t i = 0; i < count; i++)
+    buf[i] = read();
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+uint8_t OneWire::crc8(const uint8_t* addr, uint8_t len)
+{
+  uint8_t crc = 0;
+  while(len--)
+  {
+    uint8_t inbyte = *addr++;
+    for(uint8_t i = 8; i; i--)
+    {
+      uint8_t mix = (crc ^ inbyte) & 0x01;
+      crc >>= 1;
+      if(mix) crc ^= 0x8C;
+      inbyte >>= 1;
+    }
+  }
+  return crc;
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+HostDS18B20::HostDS18B20()
+{
+  state = waitRom;
+  pos = 0;
+  raw = 0;
+  conversions = 0;
+  memset(scratchpad, 0, sizeof(scratchpad));
+  scratchpad[0] = 0x50; // +85 градусов - значение после включения питания
+  scratchpad[1] = 0x05;
+  scratchpad[4] = 0x7F; // 12 бит
+  scratchpad[8] = OneWire::crc8(scratchpad, 8);
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+void HostDS18B20::SetTemperature(float t)
+{
+  raw = (int16_t)(t * 16.0f);
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+bool HostDS18B20::OnReset()
+{
+  state = waitRom;
+  pos = 0;
+  return true;
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+void HostDS18B20::OnWrite(uint8_t b)
+{
+  switch(state)
+  {
+    case waitRom:
+      if(b == 0xCC) // SKIP ROM
+        state = waitFunction;
+    break;
+
+    case waitFunction:
+      switch(b)
+      {
+        case 0x44: // CONVERT T
+          scratchpad[0] = lowByte(raw);
+          scratchpad[1] = highByte(raw);
+          scratchpad[8] = OneWire::crc8(scratchpad, 8);
+          conversions++;
+        break;
+
+        case 0xBE: // READ SCRATCHPAD
+          state = readingScratchpad;
+          pos = 0;
+        break;
+
+        case 0x4E: // WRITE SCRATCHPAD: TH, TL, конфигурация
+          state = writingScratchpad;
+          pos = 2;
+        break;
+      }
+    break;
+
+    case writingScratchpad:
+      if(pos < 5)
+      {
+        scratchpad[pos++] = b;
+        scratchpad[8] = OneWire::crc8(scratchpad, 8);
+      }
+    break;
+
+    case readingScratchpad:
+    break;
+  }
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+uint8_t HostDS18B20::OnRead()
+{
+  if(state == readingScratchpad && pos < sizeof(scratchpad))
+    return scratchpad[pos++];
+  return 0xFF;
+}
+//--------------------------------------------------------------------------------------------------------------------------------
@@ -0,0 +1,77 @@
+#ifndef OneWire_h
+#define OneWire_h
+//--------------------------------------------------------------------------------------------------------------------------------
+// 1-Wire на хосте: на каждую ножку тест может повесить модель устройства (Attach), без неё на линии никого нет.
+// HostDS18B20 - модель датчика температуры, понимает SKIP ROM и команды, которые шлёт DS18B20Query.cpp
+//--------------------------------------------------------------------------------------------------------------------------------
+#include <inttypes.h>
+#include <Arduino.h>
+//--------------------------------------------------------------------------------------------------------------------------------
+#define HOST_ONEWIRE_MAX_DEVICES 8
+//--------------------------------------------------------------------------------------------------------------------------------
+class HostOneWireDevice
+{
+  public:
+    virtual ~HostOneWireDevice() {}
+    virtual bool OnReset() = 0; // импульс сброса, вернуть true, если устройство ответило присутствием
+    virtual void OnWrite(uint8_t b) = 0;
+    virtual uint8_t OnRead() = 0;
+};
+//--------------------------------------------------------------------------------------------------------------------------------
+class OneWire
+{
+  public:
+    OneWire(uint8_t pin);
+
+    uint8_t reset(void);
+    void select(const uint8_t rom[8]);
+    void skip(void) { write(0xCC); }
+    void write(uint8_t v, uint8_t power = 0);
+    void write_bytes(const uint8_t* buf, uint16_t count, bool power = 0);
+    uint8_t read(void);
+    void read_bytes(uint8_t* buf, uint16_t count);
+    void write_bit(uint8_t) {}
+    uint8_t read_bit(void) { return 1; }
+    void depower(void) {}
+    void reset_search() {}
+    void target_search(uint8_t) {}
+    bool search(uint8_t*, bool = true) { return false; }
+
+    static uint8_t crc8(const uint8_t* addr, uint8_t len);
+
+    // управление со стороны хоста
+    static void Attach(uint8_t pin, HostOneWireDevice* device);
+    static void Detach(uint8_t pin) { Attach(pin, NULL); }
+    static uint32_t Resets() { return resets; }
+    static void ResetStat() { resets = 0; }
+
+  private:
+    uint8_t pin;
+    HostOneWireDevice* device;
+
+    static uint8_t pins[HOST_ONEWIRE_MAX_DEVICES];
+    static HostOneWireDevice* devices[HOST_ONEWIRE_MAX_DEVICES];
+    static uint32_t resets;
+};
+//--------------------------------------------------------------------------------------------------------------------------------
+class HostDS18B20 : public HostOneWireDevice
+{
+  public:
+    HostDS18B20();
+
+    void SetTemperature(float t); // следующее преобразование (0x44) выдаст эту температуру
+    uint32_t Conversions() const { return conversions; }
+
+    virtual bool OnReset();
+    virtual void OnWrite(uint8_t b);
+    virtual uint8_t OnRead();
+
+  private:
+    enum { waitRom, waitFunction, writingScratchpad, readingScratchpad } state;
+    uint8_t scratchpad[9];
+    uint8_t pos;
+    int16_t raw; // температура в 1/16 градуса
+    uint32_t conversions;
+};
+//--------------------------------------------------------------------------------------------------------------------------------
+#endif
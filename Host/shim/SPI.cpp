@@ -0,0 +1,29 @@
+#include "SPI.h"
+//--------------------------------------------------------------------------------------------------------------------------------
+SPIClass SPI;
+HostSPIHandler SPIClass::handler = NULL;
+uint32_t SPIClass::transfers = 0;
+//--------------------------------------------------------------------------------------------------------------------------------
+uint8_t SPIClass::transfer(uint8_t data)
+{
+  transfers++;
+  return handler ? handler(data) : 0xFF;
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+uint16_t SPIClass::transfer16(uint16_t data)
+{
+  uint16_t hi = transfer(data >> 8);
+  uint16_t lo = transfer(data & 0xFF);
+  return (hi << 8) | lo;
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+void SPIClass::transfer(void* buf, size_t count)
+{
+  uint8_t* p = (uint8_t*) buf;
+  while(count--)
+  {
+    *p = transfer(*p);
+    p++;
+  }
+}
+//--------------------------------------------------------------------------------------------------------------------------------
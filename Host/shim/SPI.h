@@ -0,0 +1,58 @@
+#ifndef _SPI_H_INCLUDED
+#define _SPI_H_INCLUDED
+//--------------------------------------------------------------------------------------------------------------------------------
+// SPI на хосте: обмен уходит в обработчик, который ставит тест (без обработчика устройство отвечает 0xFF)
+//--------------------------------------------------------------------------------------------------------------------------------
+#include <Arduino.h>
+//--------------------------------------------------------------------------------------------------------------------------------
+#define SPI_CLOCK_DIV4 0x00
+#define SPI_CLOCK_DIV16 0x01
+#define SPI_CLOCK_DIV64 0x02
+#define SPI_CLOCK_DIV128 0x03
+#define SPI_CLOCK_DIV2 0x04
+#define SPI_CLOCK_DIV8 0x05
+#define SPI_CLOCK_DIV32 0x06
+
+#define SPI_MODE0 0x00
+#define SPI_MODE1 0x04
+#define SPI_MODE2 0x08
+#define SPI_MODE3 0x0C
+//--------------------------------------------------------------------------------------------------------------------------------
+typedef uint8_t (*HostSPIHandler)(uint8_t data);
+//--------------------------------------------------------------------------------------------------------------------------------
+class SPISettings
+{
+  public:
+    SPISettings() {}
+    SPISettings(uint32_t, uint8_t, uint8_t) {}
+};
+//--------------------------------------------------------------------------------------------------------------------------------
+class SPIClass
+{
+  public:
+    static void begin() {}
+    static void end() {}
+    static void beginTransaction(SPISettings) {}
+    static void endTransaction(void) {}
+    static void usingInterrupt(uint8_t) {}
+    static void setBitOrder(uint8_t) {}
+    static void setDataMode(uint8_t) {}
+    static void setClockDivider(uint8_t) {}
+
+    static uint8_t transfer(uint8_t data);
+    static uint16_t transfer16(uint16_t data);
+    static void transfer(void* buf, size_t count);
+
+    // управление со стороны хоста
+    static void OnTransfer(HostSPIHandler h) { handler = h; }
+    static uint32_t Transfers() { return transfers; }
+    static void ResetStat() { transfers = 0; }
+
+  private:
+    static HostSPIHandler handler;
+    static uint32_t transfers;
+};
+//--------------------------------------------------------------------------------------------------------------------------------
+extern SPIClass SPI;
+//--------------------------------------------------------------------------------------------------------------------------------
+#endif
@@ -0,0 +1,468 @@
+#include "SdFat.h"
+//--------------------------------------------------------------------------------------------------------------------------------
+extern "C" void* __real_realloc(void* ptr, size_t size);
+extern "C" void __real_free(void* ptr);
+//--------------------------------------------------------------------------------------------------------------------------------
+typedef struct
+{
+  bool used;
+  bool isDir;
+  char path[HOST_SD_PATH_LENGTH]; // полный путь без ведущего '/', у корня - пустая строка
+  uint8_t* data;
+  uint32_t size;
+  uint32_t capacity;
+  
+} HostSdEntry;
+//--------------------------------------------------------------------------------------------------------------------------------
+#define ROOT_ENTRY 0
+static HostSdEntry sdEntries[HOST_SD_MAX_ENTRIES] = { {true, true, "", NULL, 0, 0} };
+static bool sdInserted = true;
+static bool sdMounted = false;
+static HostSdStat sdStat = {0,0,0,0};
+void (*SdFile::dateTimeFunc)(uint16_t* date, uint16_t* time) = NULL;
+//--------------------------------------------------------------------------------------------------------------------------------
+static bool normalizePath(const char* path, char* out)
+{
+  if(!path)
+    return false;
+
+  size_t len = 0;
+  while(*path)
+  {
+    if(*path == '/' && (len == 0 || out[len-1] == '/')) // ведущие и двойные разделители
+    {
+      path++;
+      continue;
+    }
+
+    if(len >= HOST_SD_PATH_LENGTH - 1)
+      return false;
+
+    out[len++] = *path++;
+  }
+
+  if(len && out[len-1] == '/')
+    len--;
+
+  out[len] = 0;
+  return true;
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+static int16_t findEntry(const char* normalized)
+{
+  for(int16_t i = 0; i < HOST_SD_MAX_ENTRIES; i++)
+  {
+    if(sdEntries[i].used && !strcmp(sdEntries[i].path, normalized))
+      return i;
+  }
+  return -1;
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+static bool isChildOf(const char* path, const char* dir)
+{
+  const char* slash = strrchr(path, '/');
+  size_t parentLen = slash ? (size_t)(slash - path) : 0;
+  return strlen(dir) == parentLen && !strncmp(path, dir, parentLen) && *path;
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+static bool parentIsDir(const char* normalized)
+{
+  char parent[HOST_SD_PATH_LENGTH];
+  strcpy(parent, normalized);
+  char* slash = strrchr(parent, '/');
+  if(!slash)
+    return true; // в корне
+
+  *slash = 0;
+  int16_t idx = findEntry(parent);
+  return idx >= 0 && sdEntries[idx].isDir;
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+static int16_t createEntry(const char* normalized, bool isDir)
+{
+  for(int16_t i = 0; i < HOST_SD_MAX_ENTRIES; i++)
+  {
+    if(!sdEntries[i].used)
+    {
+      HostSdEntry* e = &sdEntries[i];
+      e->used = true;
+      e->isDir = isDir;
+      strcpy(e->path, normalized);
+      e->data = NULL;
+      e->size = e->capacity = 0;
+      return i;
+    }
+  }
+  return -1; // карта переполнена
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+static void freeEntry(int16_t idx)
+{
+  __real_free(sdEntries[idx].data);
+  memset(&sdEntries[idx], 0, sizeof(HostSdEntry));
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+// SdFat
+//--------------------------------------------------------------------------------------------------------------------------------
+bool SdFat::begin(uint8_t, uint8_t)
+{
+  sdMounted = sdInserted;
+  return sdMounted;
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+bool SdFat::exists(const char* path)
+{
+  char p[HOST_SD_PATH_LENGTH];
+  return sdMounted && normalizePath(path, p) && findEntry(p) >= 0;
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+bool SdFat::mkdir(const char* path, bool pFlag)
+{
+  char p[HOST_SD_PATH_LENGTH];
+  if(!sdMounted || !normalizePath(path, p) || !*p || findEntry(p) >= 0)
+    return false;
+
+  if(pFlag) // создаём недостающие папки по пути
+  {
+    for(char* slash = strchr(p, '/'); slash; slash = strchr(slash + 1, '/'))
+    {
+      *slash = 0;
+      int16_t idx = findEntry(p);
+      if(idx < 0)
+        idx = createEntry(p, true);
+      *slash = '/';
+
+      if(idx < 0 || !sdEntries[idx].isDir)
+        return false;
+    }
+  }
+
+  if(!parentIsDir(p))
+    return false;
+
+  return createEntry(p, true) >= 0;
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+bool SdFat::remove(const char* path)
+{
+  char p[HOST_SD_PATH_LENGTH];
+  if(!sdMounted || !normalizePath(path, p))
+    return false;
+
+  int16_t idx = findEntry(p);
+  if(idx < 0 || sdEntries[idx].isDir)
+    return false;
+
+  freeEntry(idx);
+  return true;
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+bool SdFat::rmdir(const char* path)
+{
+  char p[HOST_SD_PATH_LENGTH];
+  if(!sdMounted || !normalizePath(path, p))
+    return false;
+
+  int16_t idx = findEntry(p);
+  if(idx <= ROOT_ENTRY || !sdEntries[idx].isDir)
+    return false;
+
+  for(int16_t i = 0; i < HOST_SD_MAX_ENTRIES; i++)
+  {
+    if(sdEntries[i].used && isChildOf(sdEntries[i].path, p)) // папка не пуста
+      return false;
+  }
+
+  freeEntry(idx);
+  return true;
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+bool SdFat::rename(const char* oldPath, const char* newPath)
+{
+  char from[HOST_SD_PATH_LENGTH], to[HOST_SD_PATH_LENGTH];
+  if(!sdMounted || !normalizePath(oldPath, from) || !normalizePath(newPath, to))
+    return false;
+
+  int16_t idx = findEntry(from);
+  if(idx <= ROOT_ENTRY || sdEntries[idx].isDir || findEntry(to) >= 0 || !parentIsDir(to))
+    return false;
+
+  strcpy(sdEntries[idx].path, to);
+  return true;
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+void SdFat::HostInsertCard(bool inserted)
+{
+  sdInserted = inserted;
+  if(!inserted)
+    sdMounted = false;
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+void SdFat::HostFormat()
+{
+  for(int16_t i = ROOT_ENTRY + 1; i < HOST_SD_MAX_ENTRIES; i++)
+  {
+    if(sdEntries[i].used)
+      freeEntry(i);
+  }
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+const HostSdStat* SdFat::HostGetStat()
+{
+  return &sdStat;
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+void SdFat::HostResetStat()
+{
+  memset(&sdStat, 0, sizeof(sdStat));
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+// SdFile
+//--------------------------------------------------------------------------------------------------------------------------------
+SdFile::SdFile()
+{
+  entry = -1;
+  flags = 0;
+  position = 0;
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+bool SdFile::open(const char* path, uint8_t oflag)
+{
+  char p[HOST_SD_PATH_LENGTH];
+  if(isOpen() || !sdMounted || !normalizePath(path, p))
+    return false;
+
+  int16_t idx = findEntry(p);
+  if(idx < 0)
+  {
+    if(!(oflag & O_CREAT) || !(oflag & O_WRITE) || !parentIsDir(p))
+      return false;
+
+    idx = createEntry(p, false);
+    if(idx < 0)
+      return false;
+  }
+  else
+  {
+    if((oflag & O_CREAT) && (oflag & O_EXCL))
+      return false;
+
+    if(sdEntries[idx].isDir && (oflag & O_WRITE))
+      return false;
+  }
+
+  HostSdEntry* e = &sdEntries[idx];
+  if(!e->isDir && (oflag & O_TRUNC) && (oflag & O_WRITE))
+    e->size = 0;
+
+  entry = idx;
+  flags = oflag;
+  position = (!e->isDir && (oflag & O_AT_END)) ? e->size : 0;
+  sdStat.Opens++;
+  return true;
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+bool SdFile::open(SdFile* dirFile, const char* path, uint8_t oflag)
+{
+  if(!dirFile || !dirFile->isDir() || !path)
+    return false;
+
+  char full[HOST_SD_PATH_LENGTH * 2];
+  snprintf(full, sizeof(full), "%s/%s", sdEntries[dirFile->entry].path, path);
+  return open(full, oflag);
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+bool SdFile::openNext(SdFile* dirFile, uint8_t oflag)
+{
+  if(!dirFile || !dirFile->isDir())
+    return false;
+
+  close();
+
+  const char* dirPath = sdEntries[dirFile->entry].path;
+  for(uint32_t i = dirFile->position; i < HOST_SD_MAX_ENTRIES; i++)
+  {
+    if(!sdEntries[i].used || !isChildOf(sdEntries[i].path, dirPath))
+      continue;
+
+    dirFile->position = i + 1;
+
+    if(sdEntries[i].isDir && (oflag & O_WRITE))
+      return false;
+
+    entry = i;
+    flags = oflag;
+    position = 0;
+    sdStat.Opens++;
+    return true;
+  }
+
+  dirFile->position = HOST_SD_MAX_ENTRIES;
+  return false;
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+bool SdFile::close()
+{
+  if(!isOpen())
+    return false;
+
+  sync();
+  entry = -1;
+  flags = 0;
+  position = 0;
+  return true;
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+bool SdFile::isDir() const
+{
+  return isOpen() && sdEntries[entry].isDir;
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+int SdFile::read()
+{
+  uint8_t b;
+  return read(&b, 1) == 1 ? b : -1;
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+int SdFile::read(void* buf, size_t nbyte)
+{
+  if(!isFile() || !(flags & O_READ) || !sdEntries[entry].used)
+    return -1;
+
+  HostSdEntry* e = &sdEntries[entry];
+  if(position >= e->size)
+    return 0;
+
+  if(nbyte > e->size - position)
+    nbyte = e->size - position;
+
+  memcpy(buf, e->data + position, nbyte);
+  position += nbyte;
+  return (int) nbyte;
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+int SdFile::peek()
+{
+  if(!isFile() || !(flags & O_READ) || position >= sdEntries[entry].size)
+    return -1;
+  return sdEntries[entry].data[position];
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+int SdFile::available()
+{
+  if(!isFile() || position >= sdEntries[entry].size)
+    return 0;
+  uint32_t n = sdEntries[entry].size - position;
+  return n > 0x7FFF ? 0x7FFF : (int) n; // как в SdFat: int на AVR 16-битный
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+size_t SdFile::write(const void* buf, size_t nbyte)
+{
+  if(!isFile() || !(flags & O_WRITE) || !sdEntries[entry].used)
+  {
+    setWriteError();
+    return 0;
+  }
+
+  HostSdEntry* e = &sdEntries[entry];
+  if(flags & O_APPEND)
+    position = e->size;
+
+  uint32_t end = position + nbyte;
+  if(end > e->capacity)
+  {
+    uint32_t newCapacity = e->capacity ? e->capacity : 512;
+    while(newCapacity < end)
+      newCapacity *= 2;
+
+    uint8_t* newData = (uint8_t*) __real_realloc(e->data, newCapacity);
+    if(!newData)
+    {
+      setWriteError();
+      return 0;
+    }
+    e->data = newData;
+    e->capacity = newCapacity;
+  }
+
+  if(position > e->size) // запись после seek за конец файла
+    memset(e->data + e->size, 0, position - e->size);
+
+  memcpy(e->data + position, buf, nbyte);
+  position = end;
+  if(end > e->size)
+    e->size = end;
+
+  sdStat.Writes++;
+  sdStat.BytesWritten += nbyte;
+
+  if(flags & O_SYNC)
+    sync();
+
+  return nbyte;
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+bool SdFile::sync()
+{
+  if(!isOpen())
+    return false;
+
+  if(flags & O_WRITE)
+  {
+    sdStat.Flushes++;
+    if(dateTimeFunc)
+    {
+      uint16_t date, time;
+      dateTimeFunc(&date, &time);
+    }
+  }
+  return true;
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+uint32_t SdFile::fileSize() const
+{
+  return isFile() ? sdEntries[entry].size : 0;
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+bool SdFile::seekSet(uint32_t pos)
+{
+  if(!isFile() || pos > sdEntries[entry].size)
+    return false;
+  position = pos;
+  return true;
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+bool SdFile::truncate(uint32_t length)
+{
+  if(!isFile() || !(flags & O_WRITE) || length > sdEntries[entry].size)
+    return false;
+
+  sdEntries[entry].size = length;
+  if(position > length)
+    position = length;
+  return true;
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+bool SdFile::getName(char* buf, size_t size)
+{
+  if(!isOpen() || !size)
+    return false;
+
+  strncpy(buf, name(), size - 1);
+  buf[size - 1] = 0;
+  return true;
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+const char* SdFile::name() const
+{
+  if(!isOpen())
+    return "";
+
+  if(entry == ROOT_ENTRY)
+    return "/";
+
+  const char* path = sdEntries[entry].path;
+  const char* slash = strrchr(path, '/');
+  return slash ? slash + 1 : path;
+}
+//--------------------------------------------------------------------------------------------------------------------------------
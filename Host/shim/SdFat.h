@@ -0,0 +1,123 @@
+#ifndef SdFat_h
+#define SdFat_h
+//--------------------------------------------------------------------------------------------------------------------------------
+// SdFat на хосте: SD-карта в памяти - плоская таблица файлов и папок с полными путями. Память под содержимое файлов
+// берётся мимо учёта кучи (это память карты, а не контроллера). Без карты (HostInsertCard(false)) begin не проходит
+//--------------------------------------------------------------------------------------------------------------------------------
+#include <Arduino.h>
+#include "Print.h"
+//--------------------------------------------------------------------------------------------------------------------------------
+#undef O_READ
+#undef O_RDONLY
+#undef O_WRITE
+#undef O_WRONLY
+#undef O_RDWR
+#undef O_APPEND
+#undef O_SYNC
+#undef O_TRUNC
+#undef O_AT_END
+#undef O_CREAT
+#undef O_EXCL
+
+#define O_READ 0x01
+#define O_RDONLY O_READ
+#define O_WRITE 0x02
+#define O_WRONLY O_WRITE
+#define O_RDWR (O_READ | O_WRITE)
+#define O_APPEND 0x04
+#define O_SYNC 0x08
+#define O_TRUNC 0x10
+#define O_AT_END 0x20
+#define O_CREAT 0x40
+#define O_EXCL 0x80
+
+#define FILE_READ O_READ
+#define FILE_WRITE (O_RDWR | O_CREAT | O_AT_END)
+
+#define SPI_FULL_SPEED 0
+#define SPI_HALF_SPEED 1
+#define SPI_QUARTER_SPEED 2
+#define SD_SCK_MHZ(mhz) (mhz)
+
+#define FAT_DATE(year, month, day) (((year) - 1980) << 9 | (month) << 5 | (day))
+#define FAT_TIME(hour, minute, second) ((hour) << 11 | (minute) << 5 | (second) >> 1)
+//--------------------------------------------------------------------------------------------------------------------------------
+#define HOST_SD_MAX_ENTRIES 128 // сколько всего файлов и папок помещается на карту
+#define HOST_SD_PATH_LENGTH 64 // максимальная длина полного пути
+//--------------------------------------------------------------------------------------------------------------------------------
+typedef struct
+{
+  uint32_t BytesWritten; // сколько байт записано в файлы
+  uint32_t Writes; // сколько вызовов write дошло до файлов
+  uint32_t Flushes; // сколько раз вызывались flush/sync/close файлов, открытых на запись
+  uint32_t Opens; // сколько раз открывались файлы и папки
+  
+} HostSdStat;
+//--------------------------------------------------------------------------------------------------------------------------------
+class SdFile : public Print
+{
+  public:
+    SdFile();
+    ~SdFile() {}
+
+    bool open(const char* path, uint8_t oflag = O_READ);
+    bool open(SdFile* dirFile, const char* path, uint8_t oflag);
+    bool openNext(SdFile* dirFile, uint8_t oflag = O_READ);
+    bool close();
+    bool isOpen() const { return entry >= 0; }
+    bool isDir() const;
+    bool isFile() const { return isOpen() && !isDir(); }
+    void rewind() { position = 0; }
+
+    int read();
+    int read(void* buf, size_t nbyte);
+    int peek();
+    int available();
+    virtual size_t write(uint8_t b) { return write(&b, 1); }
+    virtual size_t write(const uint8_t* buf, size_t nbyte) { return write((const void*) buf, nbyte); }
+    size_t write(const void* buf, size_t nbyte);
+    size_t write(const char* str) { return write(str, strlen(str)); }
+    size_t write(const char* buf, size_t nbyte) { return write((const void*) buf, nbyte); }
+    virtual void flush() { sync(); }
+    bool sync();
+
+    uint32_t fileSize() const;
+    uint32_t size() const { return fileSize(); }
+    uint32_t curPosition() const { return position; }
+    bool seekSet(uint32_t pos);
+    bool seekEnd(int32_t offset = 0) { return seekSet(fileSize() + offset); }
+    bool seekCur(int32_t offset) { return seekSet(position + offset); }
+    bool truncate(uint32_t length);
+
+    bool getName(char* name, size_t size);
+    const char* name() const;
+
+    static void dateTimeCallback(void (*dateTime)(uint16_t* date, uint16_t* time)) { dateTimeFunc = dateTime; }
+    static void dateTimeCallbackCancel() { dateTimeFunc = NULL; }
+
+  private:
+    int16_t entry; // индекс в таблице карты, -1 - не открыт
+    uint8_t flags;
+    uint32_t position; // для папки - индекс в таблице, с которого продолжать openNext
+
+    static void (*dateTimeFunc)(uint16_t* date, uint16_t* time);
+};
+//--------------------------------------------------------------------------------------------------------------------------------
+class SdFat
+{
+  public:
+    bool begin(uint8_t csPin = SS, uint8_t sckDivisor = SPI_FULL_SPEED);
+    bool exists(const char* path);
+    bool mkdir(const char* path, bool pFlag = true);
+    bool remove(const char* path);
+    bool rmdir(const char* path);
+    bool rename(const char* oldPath, const char* newPath);
+
+    // управление со стороны хоста
+    static void HostInsertCard(bool inserted);
+    static void HostFormat(); // стирает всё содержимое карты
+    static const HostSdStat* HostGetStat();
+    static void HostResetStat();
+};
+//--------------------------------------------------------------------------------------------------------------------------------
+#endif
@@ -0,0 +1,180 @@
+#include "Arduino.h"
+#include "Stream.h"
+//--------------------------------------------------------------------------------------------------------------------------------
+// ожидание данных идёт по millis(), поэтому на хосте таймаут потока отсчитывается по модельному времени
+//--------------------------------------------------------------------------------------------------------------------------------
+int Stream::timedRead()
+{
+  int c;
+  _startMillis = millis();
+  do
+  {
+    c = read();
+    if(c >= 0) return c;
+    yield();
+  } while(millis() - _startMillis < _timeout);
+  return -1;
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+int Stream::timedPeek()
+{
+  int c;
+  _startMillis = millis();
+  do
+  {
+    c = peek();
+    if(c >= 0) return c;
+    yield();
+  } while(millis() - _startMillis < _timeout);
+  return -1;
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+int Stream::peekNextDigit()
+{
+  int c;
+  while(1)
+  {
+    c = timedPeek();
+    if(c < 0) return c;
+    if(c == '-') return c;
+    if(c >= '0' && c <= '9') return c;
+    read();
+  }
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+bool Stream::findUntil(const char* target, size_t targetLen, const char* terminator, size_t termLen)
+{
+  size_t index = 0;
+  size_t termIndex = 0;
+  int c;
+
+  if(*target == 0)
+    return true;
+
+  while((c = timedRead()) > 0)
+  {
+    if(c != target[index])
+      index = 0;
+
+    if(c == target[index])
+    {
+      if(++index >= targetLen)
+        return true;
+    }
+
+    if(termLen > 0 && c == terminator[termIndex])
+    {
+      if(++termIndex >= termLen)
+        return false;
+    }
+    else
+      termIndex = 0;
+  }
+  return false;
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+long Stream::parseInt()
+{
+  bool isNegative = false;
+  long value = 0;
+  int c = peekNextDigit();
+
+  if(c < 0)
+    return 0;
+
+  do
+  {
+    if(c == '-')
+      isNegative = true;
+    else if(c >= '0' && c <= '9')
+      value = value * 10 + c - '0';
+    read();
+    c = timedPeek();
+  } while(c >= '0' && c <= '9');
+
+  return isNegative ? -value : value;
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+float Stream::parseFloat()
+{
+  bool isNegative = false;
+  bool isFraction = false;
+  long value = 0;
+  float fraction = 1.0;
+  int c = peekNextDigit();
+
+  if(c < 0)
+    return 0;
+
+  do
+  {
+    if(c == '-')
+      isNegative = true;
+    else if(c == '.')
+      isFraction = true;
+    else if(c >= '0' && c <= '9')
+    {
+      value = value * 10 + c - '0';
+      if(isFraction)
+        fraction *= 0.1f;
+    }
+    read();
+    c = timedPeek();
+  } while((c >= '0' && c <= '9') || (c == '.' && !isFraction));
+
+  if(isNegative)
+    value = -value;
+
+  return isFraction ? value * fraction : value;
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+size_t Stream::readBytes(char* buffer, size_t length)
+{
+  size_t count = 0;
+  while(count < length)
+  {
+    int c = timedRead();
+    if(c < 0) break;
+    *buffer++ = (char) c;
+    count++;
+  }
+  return count;
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+size_t Stream::readBytesUntil(char terminator, char* buffer, size_t length)
+{
+  size_t index = 0;
+  while(index < length)
+  {
+    int c = timedRead();
+    if(c < 0 || c == terminator) break;
+    *buffer++ = (char) c;
+    index++;
+  }
+  return index;
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+String Stream::readString()
+{
+  String ret;
+  int c = timedRead();
+  while(c >= 0)
+  {
+    ret += (char) c;
+    c = timedRead();
+  }
+  return ret;
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+String Stream::readStringUntil(char terminator)
+{
+  String ret;
+  int c = timedRead();
+  while(c >= 0 && c != terminator)
+  {
+    ret += (char) c;
+    c = timedRead();
+  }
+  return ret;
+}
+//--------------------------------------------------------------------------------------------------------------------------------
@@ -0,0 +1,80 @@
+#ifndef _CPP_U8GLIB
+#define _CPP_U8GLIB
+//--------------------------------------------------------------------------------------------------------------------------------
+// U8glib на хосте: экрана нет, отрисовка только считается (DrawCalls), ширина строки - по моноширинному шрифту 6x10
+//--------------------------------------------------------------------------------------------------------------------------------
+#include <Arduino.h>
+#include "Print.h"
+//--------------------------------------------------------------------------------------------------------------------------------
+typedef uint8_t u8g_uint_t;
+typedef uint8_t u8g_fntpgm_uint8_t;
+typedef uint8_t u8g_pgm_uint8_t;
+#define U8G_PROGMEM PROGMEM
+#define U8G_FONT_SECTION(name)
+#define U8G_PIN_NONE 255
+#define HOST_U8G_CHAR_WIDTH 6
+//--------------------------------------------------------------------------------------------------------------------------------
+class U8GLIB : public Print
+{
+  public:
+    U8GLIB() : drawCalls(0), pages(0) {}
+
+    void begin(void) {}
+    void setFont(const u8g_fntpgm_uint8_t*) {}
+    void setColorIndex(uint8_t) {}
+    void setRot90() {}
+    void setRot180() {}
+    void setRot270() {}
+    void undoRotation() {}
+    void setFontPosTop() {}
+    void setFontPosBaseline() {}
+    void setDefaultForegroundColor() {}
+    void setPrintPos(u8g_uint_t, u8g_uint_t) {}
+    void sleepOn() {}
+    void sleepOff() {}
+
+    void firstPage(void) { pages++; }
+    uint8_t nextPage(void) { return 0; } // вся картинка - одна страница
+
+    u8g_uint_t drawStr(u8g_uint_t, u8g_uint_t, const char* s) { drawCalls++; return getStrWidth(s); }
+    u8g_uint_t drawStr(u8g_uint_t x, u8g_uint_t y, const __FlashStringHelper* s) { return drawStr(x, y, (const char*) s); }
+    u8g_uint_t drawStrP(u8g_uint_t, u8g_uint_t, const u8g_pgm_uint8_t* s) { drawCalls++; return getStrWidth((const char*) s); }
+    void drawBox(u8g_uint_t, u8g_uint_t, u8g_uint_t, u8g_uint_t) { drawCalls++; }
+    void drawFrame(u8g_uint_t, u8g_uint_t, u8g_uint_t, u8g_uint_t) { drawCalls++; }
+    void drawRBox(u8g_uint_t, u8g_uint_t, u8g_uint_t, u8g_uint_t, u8g_uint_t) { drawCalls++; }
+    void drawRFrame(u8g_uint_t, u8g_uint_t, u8g_uint_t, u8g_uint_t, u8g_uint_t) { drawCalls++; }
+    void drawLine(u8g_uint_t, u8g_uint_t, u8g_uint_t, u8g_uint_t) { drawCalls++; }
+    void drawHLine(u8g_uint_t, u8g_uint_t, u8g_uint_t) { drawCalls++; }
+    void drawVLine(u8g_uint_t, u8g_uint_t, u8g_uint_t) { drawCalls++; }
+    void drawPixel(u8g_uint_t, u8g_uint_t) { drawCalls++; }
+    void drawXBMP(u8g_uint_t, u8g_uint_t, u8g_uint_t, u8g_uint_t, const u8g_pgm_uint8_t*) { drawCalls++; }
+    void drawBitmapP(u8g_uint_t, u8g_uint_t, u8g_uint_t, u8g_uint_t, const u8g_pgm_uint8_t*) { drawCalls++; }
+
+    u8g_uint_t getStrWidth(const char* s) { return s ? (u8g_uint_t)(strlen(s) * HOST_U8G_CHAR_WIDTH) : 0; }
+    u8g_uint_t getStrWidth(const __FlashStringHelper* s) { return getStrWidth((const char*) s); }
+    u8g_uint_t getWidth(void) { return 128; }
+    u8g_uint_t getHeight(void) { return 64; }
+    int8_t getFontAscent(void) { return 8; }
+    int8_t getFontDescent(void) { return -2; }
+    int8_t getFontLineSpacing(void) { return 10; }
+
+    virtual size_t write(uint8_t) { drawCalls++; return 1; }
+    using Print::write;
+
+    // управление со стороны хоста
+    uint32_t DrawCalls() const { return drawCalls; }
+    uint32_t Pages() const { return pages; }
+
+  private:
+    uint32_t drawCalls;
+    uint32_t pages;
+};
+//--------------------------------------------------------------------------------------------------------------------------------
+class U8GLIB_ST7920_128X64_1X : public U8GLIB
+{
+  public:
+    U8GLIB_ST7920_128X64_1X(uint8_t, uint8_t, uint8_t, uint8_t = U8G_PIN_NONE) {}
+    U8GLIB_ST7920_128X64_1X(uint8_t, uint8_t = U8G_PIN_NONE) {}
+};
+//--------------------------------------------------------------------------------------------------------------------------------
+#endif
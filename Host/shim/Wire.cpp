@@ -0,0 +1,131 @@
+#include "Arduino.h"
+#include "Wire.h"
+//--------------------------------------------------------------------------------------------------------------------------------
+TwoWire Wire;
+//--------------------------------------------------------------------------------------------------------------------------------
+TwoWire::TwoWire()
+{
+  memset(devices, 0, sizeof(devices));
+  memset(addresses, 0, sizeof(addresses));
+  txAddress = 0;
+  txLength = 0;
+  transmitting = false;
+  rxIndex = rxLength = 0;
+  transactions = 0;
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+void TwoWire::Attach(uint8_t address, HostWireDevice* device)
+{
+  for(uint8_t i = 0; i < HOST_WIRE_MAX_DEVICES; i++)
+  {
+    if(devices[i] && addresses[i] == address)
+    {
+      devices[i] = device;
+      return;
+    }
+  }
+
+  if(!device)
+    return;
+
+  for(uint8_t i = 0; i < HOST_WIRE_MAX_DEVICES; i++)
+  {
+    if(!devices[i])
+    {
+      addresses[i] = address;
+      devices[i] = device;
+      return;
+    }
+  }
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+HostWireDevice* TwoWire::getDevice(uint8_t address)
+{
+  for(uint8_t i = 0; i < HOST_WIRE_MAX_DEVICES; i++)
+  {
+    if(devices[i] && addresses[i] == address)
+      return devices[i];
+  }
+  return NULL;
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+void TwoWire::beginTransmission(uint8_t address)
+{
+  transmitting = true;
+  txAddress = address;
+  txLength = 0;
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+uint8_t TwoWire::endTransmission(uint8_t)
+{
+  transmitting = false;
+  transactions++;
+
+  HostWireDevice* dev = getDevice(txAddress);
+  if(!dev || !dev->OnAddress())
+  {
+    txLength = 0;
+    return 2; // NACK на адрес
+  }
+
+  dev->OnWrite(txBuffer, txLength);
+  txLength = 0;
+  return 0;
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+uint8_t TwoWire::requestFrom(uint8_t address, uint8_t quantity, uint8_t)
+{
+  transactions++;
+  rxIndex = rxLength = 0;
+
+  if(quantity > BUFFER_LENGTH)
+    quantity = BUFFER_LENGTH;
+
+  HostWireDevice* dev = getDevice(address);
+  if(!dev || !dev->OnAddress())
+    return 0;
+
+  rxLength = (uint8_t) dev->OnRead(rxBuffer, quantity);
+  return rxLength;
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+size_t TwoWire::write(uint8_t data)
+{
+  if(!transmitting || txLength >= BUFFER_LENGTH)
+  {
+    setWriteError();
+    return 0;
+  }
+  txBuffer[txLength++] = data;
+  return 1;
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+size_t TwoWire::write(const uint8_t* data, size_t quantity)
+{
+  for(size_t i = 0; i < quantity; i++)
+  {
+    if(!write(data[i]))
+      return i;
+  }
+  return quantity;
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+int TwoWire::available(void)
+{
+  return rxLength - rxIndex;
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+int TwoWire::read(void)
+{
+  if(rxIndex < rxLength)
+    return rxBuffer[rxIndex++];
+  return -1;
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+int TwoWire::peek(void)
+{
+  if(rxIndex < rxLength)
+    return rxBuffer[rxIndex];
+  return -1;
+}
+//--------------------------------------------------------------------------------------------------------------------------------
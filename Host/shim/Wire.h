@@ -0,0 +1,80 @@
+#ifndef TwoWire_h
+#define TwoWire_h
+//--------------------------------------------------------------------------------------------------------------------------------
+// шина I2C на хосте: устройства подключает тест (Attach), без устройства по адресу передача заканчивается NACK, как на железе
+//--------------------------------------------------------------------------------------------------------------------------------
+#include <inttypes.h>
+#include "Stream.h"
+//--------------------------------------------------------------------------------------------------------------------------------
+#define BUFFER_LENGTH 32
+#define HOST_WIRE_MAX_DEVICES 8
+//--------------------------------------------------------------------------------------------------------------------------------
+class HostWireDevice // модель устройства на шине I2C
+{
+  public:
+    virtual ~HostWireDevice() {}
+    virtual bool OnAddress() { return true; } // ACK на свой адрес; занятое устройство (например, EEPROM в цикле записи) отвечает NACK
+    virtual void OnWrite(const uint8_t* data, size_t len) = 0; // мастер передал байты (одна транзакция beginTransmission/endTransmission)
+    virtual size_t OnRead(uint8_t* data, size_t len) = 0; // мастер запросил len байт, вернуть - сколько отдано
+};
+//--------------------------------------------------------------------------------------------------------------------------------
+class TwoWire : public Stream
+{
+  public:
+    TwoWire();
+
+    void begin() {}
+    void begin(uint8_t) {}
+    void begin(int) {}
+    void end() {}
+    void setClock(uint32_t) {}
+
+    void beginTransmission(uint8_t address);
+    void beginTransmission(int address) { beginTransmission((uint8_t) address); }
+    uint8_t endTransmission(void) { return endTransmission(true); }
+    uint8_t endTransmission(uint8_t sendStop);
+
+    uint8_t requestFrom(uint8_t address, uint8_t quantity) { return requestFrom(address, quantity, (uint8_t) true); }
+    uint8_t requestFrom(uint8_t address, uint8_t quantity, uint8_t sendStop);
+    uint8_t requestFrom(int address, int quantity) { return requestFrom((uint8_t) address, (uint8_t) quantity, (uint8_t) true); }
+    uint8_t requestFrom(int address, int quantity, int sendStop) { return requestFrom((uint8_t) address, (uint8_t) quantity, (uint8_t) sendStop); }
+
+    virtual size_t write(uint8_t);
+    virtual size_t write(const uint8_t*, size_t);
+    virtual int available(void);
+    virtual int read(void);
+    virtual int peek(void);
+    virtual void flush(void) {}
+
+    inline size_t write(unsigned long n) { return write((uint8_t) n); }
+    inline size_t write(long n) { return write((uint8_t) n); }
+    inline size_t write(unsigned int n) { return write((uint8_t) n); }
+    inline size_t write(int n) { return write((uint8_t) n); }
+    using Print::write;
+
+    // управление со стороны хоста
+    void Attach(uint8_t address, HostWireDevice* device);
+    void Detach(uint8_t address) { Attach(address, NULL); }
+    uint32_t Transactions() const { return transactions; } // сколько раз мастер обращался к шине (передача или чтение)
+    void ResetStat() { transactions = 0; }
+
+  private:
+    HostWireDevice* getDevice(uint8_t address);
+
+    uint8_t addresses[HOST_WIRE_MAX_DEVICES];
+    HostWireDevice* devices[HOST_WIRE_MAX_DEVICES];
+
+    uint8_t txAddress;
+    uint8_t txBuffer[BUFFER_LENGTH];
+    uint8_t txLength;
+    bool transmitting;
+
+    uint8_t rxBuffer[BUFFER_LENGTH];
+    uint8_t rxIndex, rxLength;
+
+    uint32_t transactions;
+};
+//--------------------------------------------------------------------------------------------------------------------------------
+extern TwoWire Wire;
+//--------------------------------------------------------------------------------------------------------------------------------
+#endif
@@ -0,0 +1,78 @@
+#ifndef _AVR_IO_H_
+#define _AVR_IO_H_
+//--------------------------------------------------------------------------------------------------------------------------------
+// регистры ATmega2560, к которым прошивка обращается напрямую. На хосте это обычные переменные (см. HostHardware.cpp):
+// тесты могут выставлять их и вызывать обработчики прерываний, объявленные через ISR()
+//--------------------------------------------------------------------------------------------------------------------------------
+#include <stdint.h>
+//--------------------------------------------------------------------------------------------------------------------------------
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+extern volatile uint8_t SREG;
+
+extern volatile uint8_t UCSR0A, UCSR1A, UCSR2A, UCSR3A;
+extern volatile uint8_t UCSR0B, UCSR1B, UCSR2B, UCSR3B;
+
+extern volatile uint8_t ADCSRA, ADCSRB, ADMUX, ADCL, ADCH, DIDR0, DIDR2;
+extern volatile uint16_t ADC;
+
+extern volatile uint8_t PCICR, PCIFR, PCMSK0, PCMSK1, PCMSK2;
+extern volatile uint8_t PINK;
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
+//--------------------------------------------------------------------------------------------------------------------------------
+#define _BV(bit) (1 << (bit))
+#define bit_is_set(sfr, bit) ((sfr) & _BV(bit))
+#define bit_is_clear(sfr, bit) (!((sfr) & _BV(bit)))
+
+// UCSRnA
+#define TXC0 6
+#define TXC1 6
+#define TXC2 6
+#define TXC3 6
+
+// UCSRnB
+#define TXCIE0 6
+#define TXCIE1 6
+#define TXCIE2 6
+#define TXCIE3 6
+
+// ADCSRA
+#define ADEN 7
+#define ADSC 6
+#define ADATE 5
+#define ADIF 4
+#define ADIE 3
+#define ADPS2 2
+#define ADPS1 1
+#define ADPS0 0
+
+// ADCSRB
+#define MUX5 3
+#define ADTS2 2
+#define ADTS1 1
+#define ADTS0 0
+
+// ADMUX
+#define REFS1 7
+#define REFS0 6
+#define ADLAR 5
+
+// PCICR / PCIFR
+#define PCIE0 0
+#define PCIE1 1
+#define PCIE2 2
+#define PCIF0 0
+#define PCIF1 1
+#define PCIF2 2
+//--------------------------------------------------------------------------------------------------------------------------------
+// прерывания: на хосте ISR - обычная функция, её вызывает тест или HostHardware
+#define sei() ((void) 0)
+#define cli() ((void) 0)
+#define ISR(vector, ...) extern "C" void vector(void); extern "C" void vector(void)
+//--------------------------------------------------------------------------------------------------------------------------------
+#endif
@@ -0,0 +1,40 @@
+#ifndef __PGMSPACE_H_
+#define __PGMSPACE_H_
+//--------------------------------------------------------------------------------------------------------------------------------
+// на хосте флеш и ОЗУ - одно адресное пространство, PROGMEM-данные читаются напрямую
+//--------------------------------------------------------------------------------------------------------------------------------
+#include <stdint.h>
+#include <string.h>
+#include <stdio.h>
+//--------------------------------------------------------------------------------------------------------------------------------
+#define PROGMEM
+#define PGM_P const char*
+#define PGM_VOID_P const void*
+#define PSTR(s) (s)
+
+#define pgm_read_byte(addr) (*(const uint8_t*)(addr))
+#define pgm_read_word(addr) (*(const uint16_t*)(addr))
+#define pgm_read_dword(addr) (*(const uint32_t*)(addr))
+#define pgm_read_float(addr) (*(const float*)(addr))
+#define pgm_read_ptr(addr) (*(void* const*)(addr))
+#define pgm_read_byte_near(addr) pgm_read_byte(addr)
+#define pgm_read_word_near(addr) pgm_read_word(addr)
+#define pgm_read_byte_far(addr) pgm_read_byte(addr)
+
+#define memcpy_P memcpy
+#define memcmp_P memcmp
+#define strcpy_P strcpy
+#define strncpy_P strncpy
+#define strcat_P strcat
+#define strncat_P strncat
+#define strcmp_P strcmp
+#define strncmp_P strncmp
+#define strcasecmp_P strcasecmp
+#define strlen_P strlen
+#define strchr_P strchr
+#define strstr_P strstr
+#define sprintf_P sprintf
+#define snprintf_P snprintf
+#define printf_P printf
+//--------------------------------------------------------------------------------------------------------------------------------
+#endif
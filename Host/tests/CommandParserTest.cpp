@@ -0,0 +1,171 @@
+//--------------------------------------------------------------------------------------------------------------------------------
+// Тесты CommandParser/Command: разбор по месту не трогает кучу, разбор String - ровно одно выделение на команду,
+// оба пути дают одинаковый результат.
+//--------------------------------------------------------------------------------------------------------------------------------
+#include <Arduino.h>
+#include <HostHardware.h>
+#include "CommandParser.h"
+#include "HostTest.h"
+//--------------------------------------------------------------------------------------------------------------------------------
+static void testInPlaceArgs()
+{
+  CommandParser parser;
+  Command cmd;
+  char buff[] = "CTSET=STATE|TOPEN|24";
+
+  CHECK(parser.ParseCommand(buff, cmd));
+  CHECK_EQ(cmd.GetType(), ctSET);
+  CHECK_STR(cmd.GetTargetModuleID(), "STATE");
+  CHECK_EQ(cmd.GetArgsCount(), 2);
+  CHECK_STR(cmd.GetArg(0), "TOPEN");
+  CHECK_STR(cmd.GetArg(1), "24");
+  CHECK(cmd.GetArg(2) == NULL);
+
+  // аргументы - указатели внутрь переданного буфера
+  CHECK(cmd.GetTargetModuleID() == buff + 6);
+  CHECK(cmd.GetArg(0) >= buff && cmd.GetArg(1) < buff + sizeof(buff));
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+static void testInPlaceNoArgs()
+{
+  CommandParser parser;
+  Command cmd;
+  char buff[] = "CTGET=STAT";
+
+  CHECK(parser.ParseCommand(buff, cmd));
+  CHECK_EQ(cmd.GetType(), ctGET);
+  CHECK_STR(cmd.GetTargetModuleID(), "STAT");
+  CHECK_EQ(cmd.GetArgsCount(), 0);
+  CHECK(cmd.GetArg(0) == NULL);
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+static void testEmptyArgs()
+{
+  CommandParser parser;
+  Command cmd;
+  char buff[] = "CTSET=PIN||T";
+
+  CHECK(parser.ParseCommand(buff, cmd));
+  CHECK_EQ(cmd.GetArgsCount(), 2);
+  CHECK_STR(cmd.GetArg(0), "");
+  CHECK_STR(cmd.GetArg(1), "T");
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+static void testBadCommands()
+{
+  CommandParser parser;
+  Command cmd;
+  char shortCmd[] = "CTGET";
+  char badPrefix[] = "XXGET=STAT";
+  char badType[] = "CTPUT=STAT";
+
+  CHECK(!parser.ParseCommand(shortCmd, cmd));
+  CHECK(!parser.ParseCommand(badPrefix, cmd));
+  CHECK(!parser.ParseCommand(badType, cmd));
+  CHECK(!parser.ParseCommand((char*) NULL, cmd));
+  CHECK(!parser.ParseCommand(String(F("CTPUT=STAT|1")), cmd));
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+static void testArgsOverflow()
+{
+  // аргументов больше MAX_ARGS_IN_LIST - последний забирает остаток строки вместе с разделителями
+  char buff[256];
+  strcpy(buff, "CTSET=M");
+  for(int i = 0; i < MAX_ARGS_IN_LIST + 3; i++)
+  {
+    char num[8];
+    sprintf(num, "|%d", i);
+    strcat(buff, num);
+  }
+
+  CommandParser parser;
+  Command cmd;
+  CHECK(parser.ParseCommand(buff, cmd));
+  CHECK_EQ(cmd.GetArgsCount(), MAX_ARGS_IN_LIST);
+  CHECK_STR(cmd.GetArg(0), "0");
+
+  char tail[32];
+  sprintf(tail, "%d|%d|%d|%d", MAX_ARGS_IN_LIST - 1, MAX_ARGS_IN_LIST, MAX_ARGS_IN_LIST + 1, MAX_ARGS_IN_LIST + 2);
+  CHECK_STR(cmd.GetArg(MAX_ARGS_IN_LIST - 1), tail);
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+static void testInPlaceNoAllocations()
+{
+  CommandParser parser;
+  char buff[64];
+
+  Host::ResetHeapStat();
+  for(int i = 0; i < 100; i++)
+  {
+    strcpy(buff, (i & 1) ? "CTSET=STATE|TOPEN|24" : "CTGET=0|STATUS");
+    Command cmd;
+    CHECK(parser.ParseCommand(buff, cmd));
+  }
+  CHECK_EQ(Host::GetHeapStat()->Allocs, 0);
+  CHECK_EQ(Host::GetHeapStat()->Frees, 0);
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+static void testStringOneAllocation()
+{
+  CommandParser parser;
+  String withArgs = F("CTSET=STATE|TOPEN|24");
+  String noArgs = F("CTGET=STAT");
+
+  Host::ResetHeapStat();
+  long heapBefore = Host::GetHeapStat()->Current;
+  {
+    Command cmd;
+    CHECK(parser.ParseCommand(withArgs, cmd));
+    CHECK_EQ(Host::GetHeapStat()->Allocs, 1);
+
+    // повторный разбор в ту же команду освобождает прежнюю копию
+    CHECK(parser.ParseCommand(noArgs, cmd));
+    CHECK_EQ(Host::GetHeapStat()->Allocs, 2);
+    CHECK_EQ(Host::GetHeapStat()->Frees, 1);
+  }
+  CHECK_EQ(Host::GetHeapStat()->Frees, 2);
+  CHECK_EQ(Host::GetHeapStat()->Current, heapBefore);
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+static void testSamePathsResult()
+{
+  static const char* const commands[] =
+  {
+    "CTGET=0|PING", "CTSET=STATE|TOPEN|24", "CTGET=WATER|T_SETT", "CTSET=PIN|13|T", "CTGET=STAT", "CTSET=M|a||b|"
+  };
+
+  CommandParser parser;
+  for(size_t i = 0; i < sizeof(commands)/sizeof(commands[0]); i++)
+  {
+    char buff[64];
+    strcpy(buff, commands[i]);
+    String str = commands[i];
+
+    Command inPlace, copied;
+    CHECK(parser.ParseCommand(buff, inPlace));
+    CHECK(parser.ParseCommand(str, copied));
+
+    CHECK_EQ(inPlace.GetType(), copied.GetType());
+    CHECK_STR(inPlace.GetTargetModuleID(), copied.GetTargetModuleID());
+    CHECK_EQ(inPlace.GetArgsCount(), copied.GetArgsCount());
+    for(size_t j = 0; j < inPlace.GetArgsCount(); j++)
+      CHECK_STR(inPlace.GetArg(j), copied.GetArg(j));
+
+    // String-путь не портит исходную строку
+    CHECK_STR(str.c_str(), commands[i]);
+  }
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+int main()
+{
+  RUN_TEST(testInPlaceArgs);
+  RUN_TEST(testInPlaceNoArgs);
+  RUN_TEST(testEmptyArgs);
+  RUN_TEST(testBadCommands);
+  RUN_TEST(testArgsOverflow);
+  RUN_TEST(testInPlaceNoAllocations);
+  RUN_TEST(testStringOneAllocation);
+  RUN_TEST(testSamePathsResult);
+  return TestResult();
+}
+//--------------------------------------------------------------------------------------------------------------------------------
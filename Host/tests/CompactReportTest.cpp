@@ -0,0 +1,476 @@
+//--------------------------------------------------------------------------------------------------------------------------------
+// Тесты сжатого отчёта HTTP-модуля (HTTP_COMPACT_REPORT): модель сервера собирает слепок из полных отчётов (параметры s и w)
+// и из изменений (параметры b и ds) и сверяет его со слепком, собранным из полного отчёта в тот же момент. Полные отчёты
+// для сверки даёт второй экземпляр HttpModule, которому никто не подтверждает запросы, поэтому он всегда шлёт s и w.
+// Проверяется, что изменения восстанавливают слепок байт в байт, что полный отчёт уходит в начале, после смены набора
+// данных и каждые HTTP_COMPACT_KEYFRAME_INTERVAL отчётов, что неподтверждённый отчёт не становится базой изменений,
+// и что изменения короче полного отчёта.
+//
+// Собирается с вариантом прошивки firmware_http_compact (см. CMakeLists.txt)
+//--------------------------------------------------------------------------------------------------------------------------------
+#include <Arduino.h>
+#include <HostHardware.h>
+#include "ModuleController.h"
+#include "HttpModule.h"
+#include "HostTest.h"
+//--------------------------------------------------------------------------------------------------------------------------------
+#define PASSES 40 // сколько отчётов гоняем в тесте изменений
+#define STORED_SNAPSHOTS 4 // сколько последних слепков помнит модель сервера
+//--------------------------------------------------------------------------------------------------------------------------------
+struct Snapshot
+{
+  uint16_t Sequence;
+  uint8_t Length;
+  uint8_t Data[HTTP_COMPACT_SNAPSHOT_SIZE];
+};
+//--------------------------------------------------------------------------------------------------------------------------------
+// разобранный запрос: нужные параметры тела, пустая строка - параметра нет
+// (ds бывает пустым, если ничего не изменилось, поэтому изменения узнаём по параметру b)
+struct ReportParams
+{
+  String Q, B, S, W, DS;
+  unsigned int BodyLength;
+};
+//--------------------------------------------------------------------------------------------------------------------------------
+static uint8_t hexDigit(char c)
+{
+  if(c >= '0' && c <= '9')
+    return c - '0';
+  return (c & ~0x20) - 'A' + 10;
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+static uint8_t hexByte(const char* p)
+{
+  return (hexDigit(p[0]) << 4) | hexDigit(p[1]);
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+static ReportParams parseReport(const String& request)
+{
+  ReportParams result;
+  int bodyStart = request.indexOf("\r\n\r\n");
+  String body = request.substring(bodyStart < 0 ? 0 : bodyStart + 4);
+  result.BodyLength = body.length();
+
+  unsigned int from = 0;
+  while(from < body.length())
+  {
+    int amp = body.indexOf('&', from);
+    unsigned int to = amp < 0 ? body.length() : amp;
+    String pair = body.substring(from, to);
+    from = to + 1;
+
+    int eq = pair.indexOf('=');
+    if(eq < 0)
+      continue;
+
+    String key = pair.substring(0, eq);
+    String value = pair.substring(eq + 1);
+
+    if(key == "q") result.Q = value;
+    else if(key == "b") result.B = value;
+    else if(key == "s") result.S = value;
+    else if(key == "w") result.W = value;
+    else if(key == "ds") result.DS = value;
+  }
+  return result;
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+// модель сервера: раскладывает параметры s и w в двоичный слепок и накладывает на слепки изменения
+class CompactServer
+{
+  public:
+    CompactServer() : Fulls(0), Deltas(0), Unknown(0), stored(0), next(0) {}
+
+    // возвращает true, если слепок по отчёту восстановлен
+    bool Receive(const ReportParams& p, Snapshot& out)
+    {
+      out.Sequence = p.Q.length() ? (uint16_t) p.Q.toInt() : 0;
+
+      if(p.B.length())
+      {
+        const Snapshot* base = find((uint16_t) p.B.toInt());
+        if(!base)
+        {
+          // слепка с номером b не знаем - ждём полного отчёта
+          Unknown++;
+          return false;
+        }
+        out.Length = base->Length;
+        memcpy(out.Data, base->Data, base->Length);
+        if(!applyDelta(p.DS.c_str(), out))
+          return false;
+        Deltas++;
+      }
+      else
+      {
+        if(!DecodeFull(p, out))
+          return false;
+        Fulls++;
+      }
+
+      if(out.Sequence)
+        store(out);
+      return true;
+    }
+
+    static bool DecodeFull(const ReportParams& p, Snapshot& out)
+    {
+      out.Length = 0;
+      if(p.S.length() && !decodeSensors(p.S.c_str(), out))
+        return false;
+
+      const char* w = p.W.c_str();
+      for(; w[0] && w[1]; w += 2)
+        put(out, hexByte(w));
+      return true;
+    }
+
+    uint32_t Fulls, Deltas, Unknown;
+
+  private:
+    Snapshot snapshots[STORED_SNAPSHOTS];
+    uint8_t stored, next;
+
+    const Snapshot* find(uint16_t sequence)
+    {
+      for(uint8_t i = 0; i < stored; i++)
+        if(snapshots[i].Sequence == sequence)
+          return &snapshots[i];
+      return NULL;
+    }
+
+    void store(const Snapshot& s)
+    {
+      snapshots[next] = s;
+      next = (next + 1) % STORED_SNAPSHOTS;
+      if(stored < STORED_SNAPSHOTS)
+        stored++;
+    }
+
+    static void put(Snapshot& s, uint8_t b)
+    {
+      if(s.Length < sizeof(s.Data))
+        s.Data[s.Length++] = b;
+    }
+
+    static bool applyDelta(const char* ds, Snapshot& s)
+    {
+      while(*ds)
+      {
+        if(!ds[1] || !ds[2] || !ds[3])
+          return false;
+        uint8_t offset = hexByte(ds);
+        uint8_t len = hexByte(ds + 2);
+        ds += 4;
+        if(!len || offset + len > s.Length || strlen(ds) < (size_t) len * 2)
+          return false;
+        for(uint8_t i = 0; i < len; i++, ds += 2)
+          s.Data[offset + i] = hexByte(ds);
+      }
+      return true;
+    }
+
+    // секции параметра s: температура, влажность, освещённость, влажность почвы, pH
+    static bool decodeSensors(const char* s, Snapshot& out)
+    {
+      static const uint8_t valueChars[] = { 3, 6, 8, 3, 3 };
+      for(uint8_t section = 0; section < sizeof(valueChars); section++)
+      {
+        if(!s[0] || !s[1])
+          return false;
+        uint8_t cnt = hexByte(s);
+        s += 2;
+        put(out, cnt);
+
+        for(uint8_t i = 0; i < cnt; i++)
+        {
+          if(*s == '-')
+          {
+            s++;
+            if(valueChars[section] == 8)
+            {
+              for(uint8_t k = 0; k < 4; k++)
+                put(out, 0xFF);
+            }
+            else
+            {
+              for(uint8_t k = 0; k < valueChars[section] / 3; k++)
+              {
+                put(out, (uint8_t) NO_TEMPERATURE_DATA);
+                put(out, 0);
+              }
+            }
+            continue;
+          }
+
+          if(strlen(s) < valueChars[section])
+            return false;
+
+          if(valueChars[section] == 8)
+          {
+            for(uint8_t k = 0; k < 4; k++, s += 2)
+              put(out, hexByte(s));
+            continue;
+          }
+
+          // целая часть - два символа, дробная - один
+          for(uint8_t k = 0; k < valueChars[section] / 3; k++, s += 3)
+          {
+            put(out, hexByte(s));
+            put(out, hexDigit(s[2]));
+          }
+        } // for
+      } // for
+      return *s == 0;
+    }
+};
+//--------------------------------------------------------------------------------------------------------------------------------
+static HttpModule* http;
+static HttpModule reference;
+//--------------------------------------------------------------------------------------------------------------------------------
+static String ask(HttpModule* mod)
+{
+  String request;
+  mod->OnAskForData(&request);
+  return request;
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+static bool expectedSnapshot(Snapshot& out)
+{
+  // у второго экземпляра подтверждений не бывает - он шлёт только полные отчёты
+  return CompactServer::DecodeFull(parseReport(ask(&reference)), out);
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+static bool sameSnapshot(const Snapshot& a, const Snapshot& b)
+{
+  return a.Length == b.Length && !memcmp(a.Data, b.Data, a.Length);
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+static void setTemperature(const char* moduleID, ModuleStates type, uint8_t order, int8_t value, uint8_t fract)
+{
+  AbstractModule* mod = MainController->GetModuleByID(moduleID);
+  OneState* os = mod->State.GetStateByOrder(type, order);
+  Temperature t;
+  t.Value = value;
+  t.Fract = fract;
+  mod->State.UpdateState(type, os->GetIndex(), &t);
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+static void setLuminosity(uint8_t order, long lux)
+{
+  AbstractModule* mod = MainController->GetModuleByID("LIGHT");
+  OneState* os = mod->State.GetStateByOrder(StateLuminosity, order);
+  mod->State.UpdateState(StateLuminosity, os->GetIndex(), &lux);
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+static void restart()
+{
+  // модуль заново не знает, что сервер видел
+  http->Setup();
+  setTemperature("STATE", StateTemperature, 0, 20, 0);
+  setTemperature("HUMIDITY", StateHumidity, 0, 50, 0);
+  setTemperature("HUMIDITY", StateTemperature, 0, 21, 0);
+  setTemperature("HUMIDITY", StateHumidity, 1, 60, 0);
+  setTemperature("HUMIDITY", StateTemperature, 1, 22, 0);
+  setLuminosity(0, 1000);
+  setLuminosity(1, 2000);
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+static void testFirstReportIsFull()
+{
+  restart();
+
+  ReportParams p = parseReport(ask(http));
+  CHECK_EQ(p.Q.toInt(), 1);
+  CHECK(p.S.length() > 0);
+  CHECK(p.W.length() > 0);
+  CHECK_EQ(p.B.length(), 0);
+
+  // без подтверждения следующий отчёт - снова полный, с новым номером
+  http->OnHTTPResult(HTTP_REQUEST_COMPLETED + 1);
+  p = parseReport(ask(http));
+  CHECK_EQ(p.Q.toInt(), 2);
+  CHECK_EQ(p.B.length(), 0);
+
+  // раскладка слепка: после счётчика датчиков температуры - целая и дробная часть (0-15)
+  setTemperature("STATE", StateTemperature, 0, 23, 50);
+  Snapshot s;
+  CHECK(CompactServer::DecodeFull(parseReport(ask(http)), s));
+  CHECK_EQ(s.Data[0], MainController->GetModuleByID("STATE")->State.GetStateCount(StateTemperature));
+  CHECK_EQ(s.Data[1], 23);
+  CHECK_EQ(s.Data[2], 7);
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+static void testDeltaRoundTrip()
+{
+  restart();
+  CompactServer server;
+  uint32_t mismatches = 0, fullLength = 0, deltaLength = 0;
+  int lastFull = 0, maxGap = 0;
+
+  for(int pass = 0; pass < PASSES; pass++)
+  {
+    // меняется по одному-два показания за отчёт, как в поле между опросами
+    setTemperature("STATE", StateTemperature, 0, 18 + pass % 7, (pass * 13) % 100);
+    if(pass % 3 == 0)
+      setLuminosity(1, 2000 + pass * 300);
+    if(pass % 10 == 5)
+      setTemperature("HUMIDITY", StateHumidity, 1, NO_TEMPERATURE_DATA, 0); // датчик пропал
+    if(pass % 10 == 7)
+      setTemperature("HUMIDITY", StateHumidity, 1, 60 + pass % 4, 25);
+
+    ReportParams p = parseReport(ask(http));
+    CHECK_EQ(p.Q.toInt(), pass + 1);
+
+    Snapshot got, expected;
+    CHECK(server.Receive(p, got));
+    CHECK(expectedSnapshot(expected));
+    if(!sameSnapshot(got, expected))
+      mismatches++;
+
+    if(p.B.length())
+    {
+      // изменения считаются от последнего подтверждённого - здесь это предыдущий отчёт
+      CHECK_EQ(p.B.toInt(), pass);
+      deltaLength += p.BodyLength;
+    }
+    else
+    {
+      fullLength += p.BodyLength;
+      if(pass - lastFull > maxGap)
+        maxGap = pass - lastFull;
+      lastFull = pass;
+    }
+
+    http->OnHTTPResult(HTTP_REQUEST_COMPLETED);
+  }
+
+  CHECK_EQ(mismatches, 0);
+
+  // полные: первый и затем каждые HTTP_COMPACT_KEYFRAME_INTERVAL изменений
+  uint32_t fulls = 1 + (PASSES - 1) / (HTTP_COMPACT_KEYFRAME_INTERVAL + 1);
+  CHECK_EQ(server.Fulls, fulls);
+  CHECK_EQ(server.Deltas, PASSES - fulls);
+  CHECK_EQ(maxGap, HTTP_COMPACT_KEYFRAME_INTERVAL + 1);
+
+  // в среднем изменения хотя бы вдвое короче полного отчёта
+  CHECK(deltaLength / server.Deltas * 2 < fullLength / server.Fulls);
+
+  // ничего не изменилось - изменения пустые, слепок сервера остаётся прежним
+  ReportParams p = parseReport(ask(http));
+  CHECK(p.B.length() > 0);
+  CHECK_EQ(p.DS.length(), 0);
+  Snapshot got, expected;
+  CHECK(server.Receive(p, got));
+  CHECK(expectedSnapshot(expected));
+  CHECK(sameSnapshot(got, expected));
+  http->OnHTTPResult(HTTP_REQUEST_COMPLETED);
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+static void testLostReport()
+{
+  restart();
+  CompactServer server;
+  Snapshot got, expected;
+
+  CHECK(server.Receive(parseReport(ask(http)), got));
+  http->OnHTTPResult(HTTP_REQUEST_COMPLETED);
+
+  // отчёт 2 до сервера не дошёл: сервер его не видел, модуль не получил подтверждения
+  setTemperature("STATE", StateTemperature, 0, 30, 0);
+  ReportParams lost = parseReport(ask(http));
+  CHECK_EQ(lost.Q.toInt(), 2);
+  CHECK(lost.DS.length() > 0);
+  http->OnHTTPResult(HTTP_REQUEST_COMPLETED + 1);
+
+  // следующий отчёт - изменения снова относительно отчёта 1, и сервер их восстанавливает
+  setTemperature("STATE", StateTemperature, 0, 31, 0);
+  ReportParams p = parseReport(ask(http));
+  CHECK_EQ(p.Q.toInt(), 3);
+  CHECK_EQ(p.B.toInt(), 1);
+  CHECK(server.Receive(p, got));
+  CHECK(expectedSnapshot(expected));
+  CHECK(sameSnapshot(got, expected));
+  http->OnHTTPResult(HTTP_REQUEST_COMPLETED);
+
+  // сервер, потерявший слепки (перезапуск), изменения не восстановит, пока не придёт полный отчёт
+  CompactServer restarted;
+  setTemperature("STATE", StateTemperature, 0, 32, 0);
+  CHECK(!restarted.Receive(parseReport(ask(http)), got));
+  CHECK_EQ(restarted.Unknown, 1);
+  http->OnHTTPResult(HTTP_REQUEST_COMPLETED);
+
+  uint32_t reports = 0;
+  while(!restarted.Receive(parseReport(ask(http)), got) && reports++ <= HTTP_COMPACT_KEYFRAME_INTERVAL)
+    http->OnHTTPResult(HTTP_REQUEST_COMPLETED);
+  CHECK(reports <= HTTP_COMPACT_KEYFRAME_INTERVAL);
+  CHECK_EQ(restarted.Fulls, 1);
+  CHECK(expectedSnapshot(expected));
+  CHECK(sameSnapshot(got, expected));
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+static void testLayoutChange()
+{
+  restart();
+  CompactServer server;
+  Snapshot got, expected;
+  GlobalSettings* sett = MainController->GetSettings();
+
+  CHECK(server.Receive(parseReport(ask(http)), got));
+  http->OnHTTPResult(HTTP_REQUEST_COMPLETED);
+  setTemperature("STATE", StateTemperature, 0, 25, 0);
+  CHECK(parseReport(ask(http)).DS.length() > 0);
+  http->OnHTTPResult(HTTP_REQUEST_COMPLETED);
+
+  // состояние контроллера больше не шлём - набор данных сменился, уходит полный отчёт без w
+  sett->SetSendControllerStatusFlag(false);
+  ReportParams p = parseReport(ask(http));
+  CHECK_EQ(p.B.length(), 0);
+  CHECK(p.S.length() > 0);
+  CHECK_EQ(p.W.length(), 0);
+  CHECK(server.Receive(p, got));
+  http->OnHTTPResult(HTTP_REQUEST_COMPLETED);
+
+  setTemperature("STATE", StateTemperature, 0, 26, 0);
+  p = parseReport(ask(http));
+  CHECK(p.DS.length() > 0);
+  CHECK(server.Receive(p, got));
+  CHECK(expectedSnapshot(expected));
+  CHECK(sameSnapshot(got, expected));
+  http->OnHTTPResult(HTTP_REQUEST_COMPLETED);
+
+  // ничего не шлём - нет и номера отчёта
+  sett->SetSendSensorsDataFlag(false);
+  p = parseReport(ask(http));
+  CHECK_EQ(p.Q.length(), 0);
+  CHECK_EQ(p.S.length(), 0);
+  CHECK_EQ(p.B.length(), 0);
+  http->OnHTTPResult(HTTP_REQUEST_COMPLETED);
+
+  sett->SetSendSensorsDataFlag(true);
+  sett->SetSendControllerStatusFlag(true);
+  p = parseReport(ask(http));
+  CHECK_EQ(p.B.length(), 0);
+  CHECK(p.W.length() > 0);
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+int main()
+{
+  setup();
+  Serial.ClearSent();
+
+  http = (HttpModule*) MainController->GetModuleByID("HTTP");
+  CHECK(http != NULL);
+  if(!http)
+    return TestResult();
+
+  reference.Setup();
+
+  RUN_TEST(testFirstReportIsFull);
+  RUN_TEST(testDeltaRoundTrip);
+  RUN_TEST(testLostReport);
+  RUN_TEST(testLayoutChange);
+
+  return TestResult();
+}
+//--------------------------------------------------------------------------------------------------------------------------------
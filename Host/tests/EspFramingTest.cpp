@@ -0,0 +1,305 @@
+//--------------------------------------------------------------------------------------------------------------------------------
+// Тесты двоичных кадров между ESP и контроллером (CoreESPTransport, USE_WIFI_BINARY_FRAMING): на Serial2 - модель ESP8266
+// (HostEsp8266.h). Проверяется согласование режима по AT+CIPFRAME=1 и работа через +IPD, если прошивка ESP кадров не знает;
+// доставка данных, разбитых на несколько кадров, без искажений - в том числе байтов начала кадра, переводов строки и
+// "+IPD," внутри данных, которые в кадрах не экранируются; флаг "все данные приняты" только на последнем кадре порции;
+// пропуск целого кадра неизвестного клиента; отбраковка кадра с битой CRC и то, что ни оборванный кадр, ни случайный
+// байт начала кадра в потоке строк не съедают следующие за ними строки и кадры
+//--------------------------------------------------------------------------------------------------------------------------------
+#include <Arduino.h>
+#include <HostHardware.h>
+#include <HostEsp8266.h>
+#include "CoreTransport.h"
+#include "HostTest.h"
+//--------------------------------------------------------------------------------------------------------------------------------
+#define LOOP_STEP_MS 5 // модельное время одного прохода loop()
+#define MAX_WAIT_LOOPS 2000 // столько проходов loop() ждём, прежде чем считать, что события не будет
+#define DATA_CLIENT 1
+#define RECEIVED_SIZE 2048
+//--------------------------------------------------------------------------------------------------------------------------------
+static HostEsp8266 esp;
+//--------------------------------------------------------------------------------------------------------------------------------
+// клиент с заданным номером сокета, только чтобы сравнивать с ним клиентов из событий
+class ProbeClient : public CoreTransportClient
+{
+  public:
+    ProbeClient(uint8_t s) { bind(s); }
+};
+//--------------------------------------------------------------------------------------------------------------------------------
+// подписчик транспорта, который копит данные каждого клиента
+class DataCollector : public IClientEventsSubscriber
+{
+  public:
+    uint8_t Data[ESP_MAX_CLIENTS][RECEIVED_SIZE];
+    size_t Length[ESP_MAX_CLIENTS];
+    uint32_t Events[ESP_MAX_CLIENTS]; // сколько раз отдали данные
+    uint32_t Done[ESP_MAX_CLIENTS]; // сколько раз пришёл флаг "все данные приняты"
+    bool Connected[ESP_MAX_CLIENTS];
+    CoreTransportClient* Clients[ESP_MAX_CLIENTS];
+
+    DataCollector() { Reset(); memset(Connected, 0, sizeof(Connected)); }
+    void Reset()
+    {
+      memset(Length, 0, sizeof(Length));
+      memset(Events, 0, sizeof(Events));
+      memset(Done, 0, sizeof(Done));
+    }
+
+    // номер клиента снаружи не виден - находим его по пулу транспорта через сравнение клиентов
+    int8_t Find(CoreTransportClient& client)
+    {
+      for(uint8_t i = 0; i < ESP_MAX_CLIENTS; i++)
+        if(client == *Clients[i])
+          return i;
+      return -1;
+    }
+
+    virtual void OnClientConnect(CoreTransportClient& client, bool connected, int16_t)
+    {
+      int8_t i = Find(client);
+      if(i >= 0)
+        Connected[i] = connected;
+    }
+    virtual void OnClientDataWritten(CoreTransportClient&, int16_t) {}
+    virtual void OnClientDataAvailable(CoreTransportClient& client, uint8_t* data, size_t dataSize, bool isDone)
+    {
+      int8_t i = Find(client);
+      if(i < 0)
+        return;
+
+      if(Length[i] + dataSize <= RECEIVED_SIZE)
+        memcpy(Data[i] + Length[i], data, dataSize);
+      Length[i] += dataSize;
+      Events[i]++;
+      if(isDone)
+        Done[i]++;
+    }
+};
+//--------------------------------------------------------------------------------------------------------------------------------
+static DataCollector collector;
+//--------------------------------------------------------------------------------------------------------------------------------
+static void runLoop(int passes = 1)
+{
+  while(passes--)
+  {
+    Host::RunLoop();
+    Host::AdvanceMillis(LOOP_STEP_MS);
+    Serial.ClearSent();
+  }
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+static bool restart(bool framing)
+{
+  esp.SetFramingSupported(framing);
+  ESP.restart();
+  for(int i = 0; i < MAX_WAIT_LOOPS; i++)
+  {
+    if(ESP.ready() && esp.ServerStarted())
+      return true;
+    runLoop();
+  }
+  return false;
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+static bool waitReceived(uint8_t client, size_t len)
+{
+  for(int i = 0; i < MAX_WAIT_LOOPS && collector.Length[client] < len; i++)
+    runLoop();
+  runLoop(10); // лишнего тоже не должно прийти
+  return collector.Length[client] == len;
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+static void fillPayload(uint8_t* data, size_t len, uint8_t seed)
+{
+  // всё, что в потоке строк имело бы особый смысл: байт начала кадра, перевод строки, заголовок +IPD
+  static const char IPD[] = "+IPD,0,4:";
+  for(size_t i = 0; i < len; i++)
+    data[i] = (uint8_t) (seed + i * 13);
+  for(size_t i = 0; i + 16 < len; i += 61)
+  {
+    data[i] = ESP_FRAME_START;
+    data[i + 1] = '\n';
+    memcpy(data + i + 2, IPD, sizeof(IPD) - 1);
+  }
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+static size_t buildFrame(uint8_t* frame, uint8_t type, uint8_t client, const uint8_t* data, uint16_t len)
+{
+  // кадр собираем сами, по описанию в CoreTransport.h - не через модель
+  frame[0] = ESP_FRAME_START;
+  frame[1] = type;
+  frame[2] = client;
+  frame[3] = 0;
+  frame[4] = len & 0xFF;
+  frame[5] = len >> 8;
+  memcpy(frame + ESP_FRAME_HEADER_SIZE, data, len);
+  frame[ESP_FRAME_HEADER_SIZE + len] = HostEsp8266::FrameCRC(frame + 1, ESP_FRAME_HEADER_SIZE - 1 + len);
+  return ESP_FRAME_HEADER_SIZE + len + 1;
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+static void testFallbackToIpd()
+{
+  // прошивка ESP кадров не знает: на AT+CIPFRAME=1 ответила ERROR, данные идут через +IPD
+  CHECK(restart(false));
+  CHECK(!esp.FramingEnabled());
+
+  uint8_t data[300];
+  fillPayload(data, sizeof(data), 1);
+  collector.Reset();
+  esp.Connect(DATA_CLIENT);
+  runLoop();
+  esp.SendData(DATA_CLIENT, data, sizeof(data));
+  CHECK(waitReceived(DATA_CLIENT, sizeof(data)));
+  CHECK(!memcmp(collector.Data[DATA_CLIENT], data, sizeof(data)));
+  CHECK_EQ(collector.Done[DATA_CLIENT], 1);
+  esp.Close(DATA_CLIENT);
+  runLoop();
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+static void testFramesDelivered()
+{
+  CHECK(restart(true));
+  CHECK(esp.FramingEnabled());
+
+  // порция больше кадра - уходит тремя кадрами, флаг "все данные приняты" приходит один раз, на последнем
+  uint8_t data[ESP_FRAME_MAX_PAYLOAD * 2 + 100];
+  fillPayload(data, sizeof(data), 7);
+  collector.Reset();
+  esp.Connect(DATA_CLIENT);
+  runLoop();
+  uint8_t firstFrame = esp.FrameNumber();
+  esp.SendData(DATA_CLIENT, data, sizeof(data));
+  CHECK_EQ((uint8_t) (esp.FrameNumber() - firstFrame), 3);
+  CHECK(waitReceived(DATA_CLIENT, sizeof(data)));
+  CHECK(!memcmp(collector.Data[DATA_CLIENT], data, sizeof(data)));
+  CHECK_EQ(collector.Done[DATA_CLIENT], 1);
+
+  // несколько порций подряд, без проходов loop() между ними
+  collector.Reset();
+  for(uint8_t i = 0; i < 3; i++)
+    esp.SendData(DATA_CLIENT, data + i * 50, 50);
+  CHECK(waitReceived(DATA_CLIENT, 150));
+  CHECK(!memcmp(collector.Data[DATA_CLIENT], data, 150));
+  CHECK_EQ(collector.Done[DATA_CLIENT], 3);
+
+  // порция из одного байта - байта начала кадра
+  collector.Reset();
+  uint8_t start = ESP_FRAME_START;
+  esp.SendData(DATA_CLIENT, &start, 1);
+  CHECK(waitReceived(DATA_CLIENT, 1));
+  CHECK_EQ(collector.Data[DATA_CLIENT][0], ESP_FRAME_START);
+  CHECK_EQ(collector.Done[DATA_CLIENT], 1);
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+static void testUnknownFrameSkipped()
+{
+  uint8_t data[40];
+  uint8_t frame[ESP_FRAME_HEADER_SIZE + sizeof(data) + 1];
+  fillPayload(data, sizeof(data), 3);
+  collector.Reset();
+
+  // целый кадр неизвестного типа и кадр для клиента вне пула пропускаются целиком, следующий кадр разбирается
+  esp.SendRaw(frame, buildFrame(frame, 0x7E | ESP_FRAME_LAST, DATA_CLIENT, data, sizeof(data)));
+  esp.SendRaw(frame, buildFrame(frame, ESP_FRAME_DATA | ESP_FRAME_LAST, ESP_MAX_CLIENTS + 3, data, sizeof(data)));
+  esp.SendRaw(frame, buildFrame(frame, ESP_FRAME_DATA | ESP_FRAME_LAST, DATA_CLIENT, data, sizeof(data)));
+  CHECK(waitReceived(DATA_CLIENT, sizeof(data)));
+  CHECK(!memcmp(collector.Data[DATA_CLIENT], data, sizeof(data)));
+  CHECK_EQ(collector.Events[DATA_CLIENT], 1);
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+static void testBadCrcResync()
+{
+  uint8_t data[40];
+  uint8_t frame[ESP_FRAME_HEADER_SIZE + sizeof(data) + 1];
+  for(size_t i = 0; i < sizeof(data); i++)
+    data[i] = (uint8_t) ('a' + i % 26); // без байта начала кадра и переводов строки
+  collector.Reset();
+
+  // кадр с битой CRC до клиента не доходит; его остаток разбирается как строка, до перевода строки в следующем
+  // ответе ESP, а следующий кадр - как обычно
+  size_t len = buildFrame(frame, ESP_FRAME_DATA | ESP_FRAME_LAST, DATA_CLIENT, data, sizeof(data));
+  frame[len - 1] ^= 0x21;
+  esp.SendRaw(frame, len);
+  esp.SendRaw((const uint8_t*) "\r\n", 2);
+  data[0] = 'Z';
+  esp.SendData(DATA_CLIENT, data, sizeof(data));
+  CHECK(waitReceived(DATA_CLIENT, sizeof(data)));
+  CHECK(!memcmp(collector.Data[DATA_CLIENT], data, sizeof(data)));
+  CHECK_EQ(collector.Events[DATA_CLIENT], 1);
+
+  // испорченные данные внутри кадра - то же самое
+  collector.Reset();
+  len = buildFrame(frame, ESP_FRAME_DATA | ESP_FRAME_LAST, DATA_CLIENT, data, sizeof(data));
+  frame[ESP_FRAME_HEADER_SIZE + 5] ^= 0x04;
+  esp.SendRaw(frame, len);
+  esp.SendRaw((const uint8_t*) "\r\n", 2);
+  esp.SendData(DATA_CLIENT, data, sizeof(data));
+  CHECK(waitReceived(DATA_CLIENT, sizeof(data)));
+  CHECK(!memcmp(collector.Data[DATA_CLIENT], data, sizeof(data)));
+
+  // кадр оборвался (ESP перезагрузилась посреди кадра): транспорт ждёт его остаток и берёт в кадр чужие байты,
+  // CRC не сходится - следующие за обрывком кадры при этом не теряются
+  collector.Reset();
+  len = buildFrame(frame, ESP_FRAME_DATA | ESP_FRAME_LAST, DATA_CLIENT, data, sizeof(data));
+  esp.SendRaw(frame, ESP_FRAME_HEADER_SIZE + 10);
+  esp.SendRaw((const uint8_t*) "\r\n", 2);
+  esp.SendData(DATA_CLIENT, data, sizeof(data));
+  esp.SendData(DATA_CLIENT, data, sizeof(data));
+  CHECK(waitReceived(DATA_CLIENT, sizeof(data) * 2));
+  CHECK(!memcmp(collector.Data[DATA_CLIENT], data, sizeof(data)));
+  CHECK(!memcmp(collector.Data[DATA_CLIENT] + sizeof(data), data, sizeof(data)));
+  CHECK_EQ(collector.Done[DATA_CLIENT], 2);
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+static void testStrayStartByte()
+{
+  uint8_t data[60];
+  fillPayload(data, sizeof(data), 11);
+  uint8_t start = ESP_FRAME_START;
+
+  // случайный байт начала кадра перед строкой: строка разбирается, клиент подключается и получает свои данные
+  esp.Close(DATA_CLIENT);
+  runLoop(5);
+  CHECK(!collector.Connected[DATA_CLIENT]);
+  esp.SendRaw(&start, 1);
+  esp.Connect(DATA_CLIENT);
+  runLoop(5);
+  CHECK(collector.Connected[DATA_CLIENT]);
+
+  collector.Reset();
+  esp.SendData(DATA_CLIENT, data, sizeof(data));
+  CHECK(waitReceived(DATA_CLIENT, sizeof(data)));
+  CHECK(!memcmp(collector.Data[DATA_CLIENT], data, sizeof(data)));
+
+  // он же прямо перед кадром - кадр не теряется
+  collector.Reset();
+  esp.SendRaw(&start, 1);
+  esp.SendData(DATA_CLIENT, data, sizeof(data));
+  CHECK(waitReceived(DATA_CLIENT, sizeof(data)));
+  CHECK(!memcmp(collector.Data[DATA_CLIENT], data, sizeof(data)));
+
+  esp.Close(DATA_CLIENT);
+  runLoop(5);
+  CHECK(!collector.Connected[DATA_CLIENT]);
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+int main()
+{
+  Host::SetClockMode(hostClockFrozen);
+  esp.Attach(Serial2);
+  setup();
+  Serial.ClearSent();
+
+  for(uint8_t i = 0; i < ESP_MAX_CLIENTS; i++)
+    collector.Clients[i] = new ProbeClient(i);
+  ESP.subscribe(&collector);
+
+  RUN_TEST(testFallbackToIpd);
+  RUN_TEST(testFramesDelivered);
+  RUN_TEST(testUnknownFrameSkipped);
+  RUN_TEST(testBadCrcResync);
+  RUN_TEST(testStrayStartByte);
+
+  return TestResult();
+}
+//--------------------------------------------------------------------------------------------------------------------------------
@@ -0,0 +1,31 @@
+#ifndef _HOST_TEST_H
+#define _HOST_TEST_H
+//--------------------------------------------------------------------------------------------------------------------------------
+// Минимальные проверки для тестов прошивки на хосте: без фреймворков, тест - обычная программа,
+// код возврата которой смотрит ctest. Проверка не прерывает тест, а только считает ошибки.
+//--------------------------------------------------------------------------------------------------------------------------------
+#include <stdio.h>
+#include <string.h>
+//--------------------------------------------------------------------------------------------------------------------------------
+static unsigned long hostTestChecks = 0;
+static unsigned long hostTestFailures = 0;
+//--------------------------------------------------------------------------------------------------------------------------------
+#define CHECK(cond) do { hostTestChecks++; if(!(cond)) { hostTestFailures++; \
+  printf("%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); } } while(0)
+
+#define CHECK_EQ(a, b) do { hostTestChecks++; long _a = (long)(a); long _b = (long)(b); if(_a != _b) { hostTestFailures++; \
+  printf("%s:%d: CHECK_EQ(%s, %s) failed: %ld != %ld\n", __FILE__, __LINE__, #a, #b, _a, _b); } } while(0)
+
+#define CHECK_STR(a, b) do { hostTestChecks++; const char* _a = (a); const char* _b = (b); \
+  if(!_a || !_b || strcmp(_a, _b)) { hostTestFailures++; \
+  printf("%s:%d: CHECK_STR(%s, %s) failed: \"%s\" != \"%s\"\n", __FILE__, __LINE__, #a, #b, _a ? _a : "(null)", _b ? _b : "(null)"); } } while(0)
+//--------------------------------------------------------------------------------------------------------------------------------
+#define RUN_TEST(fn) do { printf("%s\n", #fn); fn(); } while(0)
+//--------------------------------------------------------------------------------------------------------------------------------
+static inline int TestResult()
+{
+  printf("%lu checks, %lu failed\n", hostTestChecks, hostTestFailures);
+  return hostTestFailures ? 1 : 0;
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+#endif
@@ -0,0 +1,230 @@
+//--------------------------------------------------------------------------------------------------------------------------------
+// Тесты очереди событий из прерываний в loop (InterruptEvents): порядок и ёмкость очереди SPSCQueue, ограничение
+// разбора за один вызов dispatch, отсутствие потерь импульсов расходомеров, когда очередь заполнена.
+// Нагрузочные тесты гоняют писателя в отдельном потоке - как прерывание, которое приходит в любой момент разбора:
+// сотни тысяч событий подряд, ни одно не должно потеряться, повториться или прийти не по порядку.
+//
+// Очередь рассчитана на порядок записей в память, который дают AVR и x86 (барьера компилятора достаточно),
+// поэтому нагрузочные тесты собираются только на x86
+//--------------------------------------------------------------------------------------------------------------------------------
+#if defined(__i386__) || defined(__x86_64__)
+#include <thread> // до Arduino.h - там макросы min и max
+#define STRESS_TESTS
+#endif
+#include <Arduino.h>
+#include <HostHardware.h>
+#include "InterruptEvents.h"
+#include "HostTest.h"
+//--------------------------------------------------------------------------------------------------------------------------------
+#define STRESS_EVENTS 500000UL // сколько событий шлёт поток-писатель в нагрузочных тестах
+#define BURST_PULSES 10000 // импульсов подряд, пока loop занят
+//--------------------------------------------------------------------------------------------------------------------------------
+// из WaterflowModule.cpp
+extern unsigned int flowPulses[];
+extern unsigned int pin2PendingPulses;
+extern unsigned int pin3PendingPulses;
+void waterflowPulsesHandler(const InterruptEvent& e);
+//--------------------------------------------------------------------------------------------------------------------------------
+typedef SPSCQueue<InterruptEvent,INTERRUPT_EVENTS_QUEUE_SIZE> EventsQueue;
+//--------------------------------------------------------------------------------------------------------------------------------
+static void testQueueOrder()
+{
+  EventsQueue q;
+  InterruptEvent e = {0, 0, 0};
+
+  CHECK(!q.pop(e));
+
+  // одна ячейка всегда пустая - так полная очередь отличается от пустой
+  uint16_t pushed = 0;
+  while(q.push(e))
+    e.Value = ++pushed;
+  CHECK_EQ(pushed, INTERRUPT_EVENTS_QUEUE_SIZE - 1);
+
+  // индексы много раз проходят через конец буфера, порядок сохраняется
+  uint16_t expected = 0;
+  bool ordered = true;
+  for(uint16_t i = 0; i < 1000; i++)
+  {
+    CHECK(q.pop(e));
+    ordered = ordered && e.Value == expected++;
+    e.Value = pushed++;
+    CHECK(q.push(e));
+  }
+  CHECK(ordered);
+
+  uint16_t left = 0;
+  while(q.pop(e))
+    left++;
+  CHECK_EQ(left, INTERRUPT_EVENTS_QUEUE_SIZE - 1);
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+static uint32_t floodHandled = 0;
+//--------------------------------------------------------------------------------------------------------------------------------
+static void floodHandler(const InterruptEvent& e)
+{
+  // каждое событие тут же порождает новое - как прерывание, которое не успевает закончиться
+  floodHandled++;
+  InterruptEvents.post(ieWaterflowPulses, e.Source, e.Value);
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+static void testDispatchBound()
+{
+  InterruptEvents.setHandler(ieWaterflowPulses, floodHandler);
+
+  for(uint8_t i = 0; i < INTERRUPT_EVENTS_QUEUE_SIZE; i++)
+    InterruptEvents.post(ieWaterflowPulses, 0, 1);
+
+  // поток событий не бесконечен: dispatch возвращается, разобрав не больше, чем помещается во все очереди
+  floodHandled = 0;
+  InterruptEvents.dispatch();
+  CHECK_EQ(floodHandled, INTERRUPT_EVENTS_QUEUE_SIZE * iepPrioritiesCount);
+
+  // без обработчика события просто выбрасываются
+  InterruptEvents.setHandler(ieWaterflowPulses, NULL);
+  InterruptEvents.dispatch();
+  InterruptEvents.dispatch();
+  floodHandled = 0;
+  InterruptEvents.setHandler(ieWaterflowPulses, floodHandler);
+  InterruptEvents.dispatch();
+  CHECK_EQ(floodHandled, 0);
+
+  InterruptEvents.setHandler(ieWaterflowPulses, waterflowPulsesHandler);
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+static void resetWaterflow()
+{
+  InterruptEvents.dispatch();
+  flowPulses[0] = flowPulses[1] = 0;
+  pin2PendingPulses = pin3PendingPulses = 0;
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+static void testBurstNoLoss()
+{
+  resetWaterflow();
+
+  // loop занят: импульсы идут пачкой, очередь заполняется после первых событий
+  for(uint32_t i = 0; i < BURST_PULSES; i++)
+  {
+    Host::FireInterrupt(0);
+    if(i % 3 == 0)
+      Host::FireInterrupt(1);
+  }
+  uint32_t second = (BURST_PULSES + 2) / 3;
+
+  InterruptEvents.dispatch();
+
+  // что не влезло в очередь - ждёт в прерывании, ничего не потеряно
+  CHECK_EQ(flowPulses[0] + pin2PendingPulses, BURST_PULSES);
+  CHECK_EQ(flowPulses[1] + pin3PendingPulses, second);
+  CHECK(pin2PendingPulses > 0);
+
+  // следующий импульс уносит накопленное одним событием
+  Host::FireInterrupt(0);
+  Host::FireInterrupt(1);
+  CHECK_EQ(pin2PendingPulses, 0);
+  CHECK_EQ(pin3PendingPulses, 0);
+  InterruptEvents.dispatch();
+  CHECK_EQ(flowPulses[0], BURST_PULSES + 1);
+  CHECK_EQ(flowPulses[1], second + 1);
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+#ifdef STRESS_TESTS
+//--------------------------------------------------------------------------------------------------------------------------------
+static void testQueueStress()
+{
+  static EventsQueue q;
+  static volatile bool producerDone;
+  producerDone = false;
+
+  // писатель кладёт номера подряд, при заполненной очереди - повторяет попытку
+  std::thread producer([]()
+  {
+    InterruptEvent e = {0, 0, 0};
+    for(uint32_t i = 0; i < STRESS_EVENTS; i++)
+    {
+      e.Source = (uint8_t) (i >> 16);
+      e.Value = (uint16_t) i;
+      while(!q.push(e))
+        std::this_thread::yield(); // на одноядерной машине иначе читатель ждёт конца кванта
+    }
+    producerDone = true;
+  });
+
+  uint32_t expected = 0, errors = 0, emptyPolls = 0;
+  InterruptEvent e;
+  while(expected < STRESS_EVENTS)
+  {
+    bool done = producerDone; // читаем до pop: если писатель уже закончил, пустая очередь - это конец
+    if(!q.pop(e))
+    {
+      if(done)
+        break;
+      emptyPolls++;
+      std::this_thread::yield();
+      continue;
+    }
+    if(e.Value != (uint16_t) expected || e.Source != (uint8_t) (expected >> 16))
+      errors++;
+    expected++;
+  }
+  producer.join();
+
+  CHECK_EQ(expected, STRESS_EVENTS);
+  CHECK_EQ(errors, 0);
+  CHECK(!q.pop(e));
+  printf("  %lu events, %lu empty polls\n", (unsigned long) expected, (unsigned long) emptyPolls);
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+static void testWaterflowStress()
+{
+  resetWaterflow();
+  static volatile bool producerDone;
+  producerDone = false;
+
+  // "прерывания" расходомеров приходят вперемешку с разбором событий в loop
+  std::thread producer([]()
+  {
+    for(uint32_t i = 0; i < STRESS_EVENTS; i++)
+    {
+      // накопитель прерывания - 16 бит на AVR, не даём loop отстать больше, чем на 20000 импульсов (на деле это секунды простоя)
+      while(i - (flowPulses[0] + flowPulses[1]) > 20000)
+        std::this_thread::yield();
+      Host::FireInterrupt(i & 1);
+    }
+    producerDone = true;
+  });
+
+  uint32_t dispatches = 0;
+  while(!producerDone)
+  {
+    InterruptEvents.dispatch();
+    dispatches++;
+    std::this_thread::yield();
+  }
+  producer.join();
+  InterruptEvents.dispatch();
+
+  CHECK_EQ(flowPulses[0] + pin2PendingPulses, STRESS_EVENTS / 2);
+  CHECK_EQ(flowPulses[1] + pin3PendingPulses, STRESS_EVENTS / 2);
+  printf("  %lu pulses, %lu dispatch calls, %lu + %lu pending\n", (unsigned long) STRESS_EVENTS, (unsigned long) dispatches,
+    (unsigned long) pin2PendingPulses, (unsigned long) pin3PendingPulses);
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+#endif // STRESS_TESTS
+//--------------------------------------------------------------------------------------------------------------------------------
+int main()
+{
+  setup();
+  Serial.ClearSent();
+
+  RUN_TEST(testQueueOrder);
+  RUN_TEST(testDispatchBound);
+  RUN_TEST(testBurstNoLoss);
+  #ifdef STRESS_TESTS
+  RUN_TEST(testQueueStress);
+  RUN_TEST(testWaterflowStress);
+  #endif
+
+  return TestResult();
+}
+//--------------------------------------------------------------------------------------------------------------------------------
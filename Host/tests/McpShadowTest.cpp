@@ -0,0 +1,220 @@
+//--------------------------------------------------------------------------------------------------------------------------------
+// Тесты теневых регистров расширителей портов (WorkStatus::MCP_*_PinMode/PinWrite и McpFlush) на моделях MCP23017 и MCP23S17:
+// запись в каналы не трогает шину до McpFlush, неизменившиеся регистры не переписываются, оба порта уходят одной
+// транзакцией, защёлки пишутся раньше направления. Для сравнения считается, во что обходится то же самое через
+// библиотеки напрямую - так, как прошивка писала в каналы раньше.
+//
+// Собирается с вариантом прошивки firmware_mcp: по два MCP23017 и MCP23S17 (см. CMakeLists.txt)
+//--------------------------------------------------------------------------------------------------------------------------------
+#include <Arduino.h>
+#include <Wire.h>
+#include <SPI.h>
+#include <HostHardware.h>
+#include <HostMcp23x17.h>
+#include "AbstractModule.h"
+#include "HostTest.h"
+//--------------------------------------------------------------------------------------------------------------------------------
+#define RELAYS_COUNT 8 // реле на порту A, как у модуля досветки или полива
+#define PASSES 100 // проходов loop(), в каждом модуль заново пишет состояние реле
+//--------------------------------------------------------------------------------------------------------------------------------
+static const byte i2cAddresses[] = { MCP23017_ADDRESSES };
+static const byte spiAddresses[] = { MCP23S17_ADDRESSES };
+//--------------------------------------------------------------------------------------------------------------------------------
+static HostMCP23017 i2cChip0, i2cChip1;
+static HostMCP23S17 spiChip0(spiAddresses[0]), spiChip1(spiAddresses[1]);
+//--------------------------------------------------------------------------------------------------------------------------------
+static void resetStat()
+{
+  i2cChip0.ResetStat();
+  i2cChip1.ResetStat();
+  spiChip0.ResetStat();
+  spiChip1.ResetStat();
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+static uint32_t busTransactions()
+{
+  return i2cChip0.Transactions() + i2cChip1.Transactions() + spiChip0.Transactions() + spiChip1.Transactions();
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+static void testInit()
+{
+  // после инициализации микросхемы и теневые регистры совпадают: все пины - входы, защёлки в нуле
+  CHECK_EQ(i2cChip0.Directions(), 0xFFFF);
+  CHECK_EQ(i2cChip0.Outputs(), 0);
+  CHECK_EQ(i2cChip1.Directions(), 0xFFFF);
+  CHECK_EQ(spiChip0.Directions(), 0xFFFF);
+  CHECK_EQ(spiChip1.Directions(), 0xFFFF);
+  CHECK(spiChip1.Register(HOST_MCP_IOCONA) & HOST_MCP_IOCON_HAEN);
+
+  resetStat();
+  WORK_STATUS.McpFlush();
+  CHECK_EQ(busTransactions(), 0);
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+static void testWritesWaitForFlush()
+{
+  resetStat();
+
+  for(byte i = 0; i < RELAYS_COUNT; i++)
+  {
+    WORK_STATUS.MCP_I2C_PinMode(i2cAddresses[0], i, OUTPUT);
+    WORK_STATUS.MCP_I2C_PinWrite(i2cAddresses[0], i, (i & 1) ? HIGH : LOW);
+    WORK_STATUS.MCP_SPI_PinMode(spiAddresses[1], i, OUTPUT);
+    WORK_STATUS.MCP_SPI_PinWrite(spiAddresses[1], i, (i & 1) ? LOW : HIGH);
+  }
+  CHECK_EQ(busTransactions(), 0);
+  CHECK_EQ(i2cChip0.Directions(), 0xFFFF);
+
+  WORK_STATUS.McpFlush();
+
+  // по транзакции на защёлки и на направление, только порт A, только у тех микросхем, что менялись
+  CHECK_EQ(i2cChip0.Transactions(), 2);
+  CHECK_EQ(i2cChip0.BytesWritten(), 2);
+  CHECK_EQ(i2cChip1.Transactions(), 0);
+  CHECK_EQ(spiChip1.Transactions(), 2);
+  CHECK_EQ(spiChip1.BytesWritten(), 2);
+  CHECK_EQ(spiChip0.Transactions(), 0);
+
+  CHECK_EQ(i2cChip0.Directions(), 0xFF00);
+  CHECK_EQ(i2cChip0.Outputs(), 0xAA);
+  CHECK_EQ(spiChip1.Directions(), 0xFF00);
+  CHECK_EQ(spiChip1.Outputs(), 0x55);
+
+  // выход включается, когда на защёлке уже нужный уровень
+  CHECK(i2cChip0.WrittenAt(HOST_MCP_OLATA) < i2cChip0.WrittenAt(HOST_MCP_IODIRA));
+  CHECK(spiChip1.WrittenAt(HOST_MCP_OLATA) < spiChip1.WrittenAt(HOST_MCP_IODIRA));
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+static void testUnchangedSkipped()
+{
+  resetStat();
+
+  // модуль каждый проход пишет то же самое состояние реле
+  for(int pass = 0; pass < PASSES; pass++)
+  {
+    for(byte i = 0; i < RELAYS_COUNT; i++)
+    {
+      WORK_STATUS.MCP_I2C_PinWrite(i2cAddresses[0], i, (i & 1) ? HIGH : LOW);
+      WORK_STATUS.MCP_SPI_PinWrite(spiAddresses[1], i, (i & 1) ? LOW : HIGH);
+    }
+    WORK_STATUS.McpFlush();
+  }
+  CHECK_EQ(busTransactions(), 0);
+
+  // переключили и вернули обратно до McpFlush - тоже ничего не пишется
+  WORK_STATUS.MCP_I2C_PinWrite(i2cAddresses[0], 0, HIGH);
+  WORK_STATUS.MCP_I2C_PinWrite(i2cAddresses[0], 0, LOW);
+  WORK_STATUS.McpFlush();
+  CHECK_EQ(busTransactions(), 0);
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+static void testBothPortsOneTransaction()
+{
+  resetStat();
+
+  WORK_STATUS.MCP_I2C_PinWrite(i2cAddresses[1], 2, HIGH);
+  WORK_STATUS.MCP_I2C_PinWrite(i2cAddresses[1], 12, HIGH);
+  WORK_STATUS.MCP_SPI_PinWrite(spiAddresses[0], 3, HIGH);
+  WORK_STATUS.MCP_SPI_PinWrite(spiAddresses[0], 11, HIGH);
+  WORK_STATUS.McpFlush();
+
+  // OLATA и OLATB - соседние регистры, пишутся последовательной адресацией
+  CHECK_EQ(i2cChip1.Transactions(), 1);
+  CHECK_EQ(i2cChip1.BytesWritten(), 2);
+  CHECK_EQ(i2cChip1.Outputs(), (1 << 2) | (1 << 12));
+  CHECK_EQ(spiChip0.Transactions(), 1);
+  CHECK_EQ(spiChip0.BytesWritten(), 2);
+  CHECK_EQ(spiChip0.Outputs(), (1 << 3) | (1 << 11));
+
+  // только порт B - пишется только OLATB
+  resetStat();
+  WORK_STATUS.MCP_I2C_PinWrite(i2cAddresses[1], 12, LOW);
+  WORK_STATUS.McpFlush();
+  CHECK_EQ(i2cChip1.Transactions(), 1);
+  CHECK_EQ(i2cChip1.BytesWritten(), 1);
+  CHECK(i2cChip1.WrittenAt(HOST_MCP_OLATB) != 0);
+  CHECK_EQ(i2cChip1.WrittenAt(HOST_MCP_OLATA), 0);
+  CHECK_EQ(i2cChip1.Outputs(), 1 << 2);
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+static void testSpiPullupGoesStraight()
+{
+  resetStat();
+
+  // вход с подтяжкой пишется сразу: библиотека трогает и GPPU, и направление
+  WORK_STATUS.MCP_SPI_PinMode(spiAddresses[0], 9, OUTPUT);
+  WORK_STATUS.McpFlush();
+  CHECK_EQ(spiChip0.Directions() & (1 << 9), 0);
+
+  resetStat();
+  WORK_STATUS.MCP_SPI_PinMode(spiAddresses[0], 9, INPUT_PULLUP);
+  CHECK(spiChip0.Transactions() > 0);
+  CHECK(spiChip0.Directions() & (1 << 9));
+  CHECK(spiChip0.Register(HOST_MCP_GPPUA + 1) & (1 << 1));
+
+  // направление уже в микросхеме - McpFlush его не переписывает
+  uint32_t transactions = spiChip0.Transactions();
+  WORK_STATUS.McpFlush();
+  CHECK_EQ(spiChip0.Transactions(), transactions);
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+static void testUnknownAddressIgnored()
+{
+  resetStat();
+
+  WORK_STATUS.MCP_I2C_PinWrite(7, 0, HIGH);
+  WORK_STATUS.MCP_SPI_PinMode(7, 0, OUTPUT);
+  WORK_STATUS.MCP_I2C_PinWrite(i2cAddresses[0], 16, HIGH); // каналов всего 16
+  WORK_STATUS.McpFlush();
+  CHECK_EQ(busTransactions(), 0);
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+static void testCompareWithDirectWrites()
+{
+  // то же, что в testUnchangedSkipped, но через библиотеки напрямую: запись канала MCP23017 - чтение OLAT и его запись,
+  // MCP23S17 - запись OLAT из копии регистров в памяти
+  Adafruit_MCP23017* i2cBank = WORK_STATUS.GetMCP_I2C_ByAddress(i2cAddresses[0]);
+  MCP23S17* spiBank = WORK_STATUS.GetMCP_SPI_ByAddress(spiAddresses[1]);
+
+  resetStat();
+  uint32_t wireBefore = Wire.Transactions();
+  uint32_t spiBefore = SPI.Transfers();
+  for(int pass = 0; pass < PASSES; pass++)
+  {
+    for(byte i = 0; i < RELAYS_COUNT; i++)
+    {
+      i2cBank->digitalWrite(i, (i & 1) ? HIGH : LOW);
+      spiBank->digitalWrite(i, (i & 1) ? LOW : HIGH);
+    }
+  }
+  uint32_t directWire = Wire.Transactions() - wireBefore;
+  uint32_t directSpi = SPI.Transfers() - spiBefore;
+  CHECK_EQ(i2cChip0.Outputs(), 0xAA);
+  CHECK_EQ(spiChip1.Outputs(), 0x55);
+
+  printf("  %d passes x %d relays: direct - %lu I2C transactions, %lu SPI bytes; shadow registers - 0 and 0\n",
+    PASSES, RELAYS_COUNT, (unsigned long) directWire, (unsigned long) directSpi);
+  CHECK(directWire >= PASSES * RELAYS_COUNT * 2);
+  CHECK(directSpi >= PASSES * RELAYS_COUNT * 3);
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+int main()
+{
+  Host::SetClockMode(hostClockFrozen);
+  Wire.Attach(MCP23017_ADDRESS | i2cAddresses[0], &i2cChip0);
+  Wire.Attach(MCP23017_ADDRESS | i2cAddresses[1], &i2cChip1);
+  HostMCP23S17::AttachSPI(MCP23S17_CS_PIN);
+
+  WORK_STATUS.InitMcpSPIExtenders();
+  WORK_STATUS.InitMcpI2CExtenders();
+
+  RUN_TEST(testInit);
+  RUN_TEST(testWritesWaitForFlush);
+  RUN_TEST(testUnchangedSkipped);
+  RUN_TEST(testBothPortsOneTransaction);
+  RUN_TEST(testSpiPullupGoesStraight);
+  RUN_TEST(testUnknownAddressIgnored);
+  RUN_TEST(testCompareWithDirectWrites);
+  return TestResult();
+}
+//--------------------------------------------------------------------------------------------------------------------------------
@@ -0,0 +1,187 @@
+//--------------------------------------------------------------------------------------------------------------------------------
+// Тесты кеша внешней EEPROM из Memory.cpp на модели AT24C32: запись одинакового значения не тратит цикл записи,
+// пакетная запись MemBeginWrite/MemCommit уходит в память страницами, вложенные пакеты сбрасываются только на
+// внешнем MemCommit, чтение из закешированной строки не трогает шину, а ожидание записи идёт опросом ACK, а не задержкой.
+//
+// Конфигурация прошивки использует встроенную EEPROM, поэтому Memory.cpp собирается здесь ещё раз - с AT24C32
+//--------------------------------------------------------------------------------------------------------------------------------
+#include <Arduino.h>
+#include <Wire.h>
+#include <HostHardware.h>
+#include <HostDevices.h>
+#include "Globals.h"
+#undef EEPROM_USED_MEMORY
+#define EEPROM_USED_MEMORY EEPROM_AT24C32
+#include "Memory.cpp"
+#include "HostTest.h"
+//--------------------------------------------------------------------------------------------------------------------------------
+static HostAT24CX eeprom;
+//--------------------------------------------------------------------------------------------------------------------------------
+static void reset()
+{
+  // сбрасываем закешированную строку, чтобы тест начинал с чтения из памяти
+  MemBeginWrite();
+  MemCommit();
+  memCacheLine = NO_CACHE_LINE;
+
+  eeprom.ResetStat();
+  MemResetStat();
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+static void testSingleWrite()
+{
+  reset();
+
+  MemWrite(10, 0x42);
+  CHECK_EQ(eeprom.WriteCycles(), 1);
+  CHECK_EQ(eeprom.BytesWritten(), 1);
+  CHECK_EQ(eeprom.Data()[10], 0x42);
+  CHECK_EQ(MemRead(10), 0x42);
+
+  // то же значение - ячейку не трогаем
+  MemWrite(10, 0x42);
+  CHECK_EQ(eeprom.WriteCycles(), 1);
+  CHECK_EQ(MemGetStat()->BytesSkipped, 1);
+  CHECK_EQ(MemGetStat()->Flushes, 1);
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+static void testBatchedWrite()
+{
+  reset();
+
+  // 100 байт с адреса 200: строки кеша 192..223, 224..255, 256..287, 288..319. Полная строка уходит двумя записями
+  // (буфер Wire - 32 байта, из них 2 на адрес), итого 1 + 2 + 2 + 1 = 6 циклов записи вместо ста
+  MemBeginWrite();
+  for(unsigned int i = 0; i < 100; i++)
+    MemWrite(200 + i, (uint8_t) (i + 1));
+  MemCommit();
+
+  CHECK_EQ(eeprom.WriteCycles(), 6);
+  CHECK_EQ(eeprom.BytesWritten(), 100);
+  CHECK_EQ(eeprom.PageWraps(), 0);
+  CHECK_EQ(eeprom.MaxCellWrites(), 1);
+
+  for(unsigned int i = 0; i < 100; i++)
+    CHECK_EQ(eeprom.Data()[200 + i], i + 1);
+
+  // соседние байты вокруг диапазона не затронуты
+  CHECK_EQ(eeprom.Data()[199], 0xFF);
+  CHECK_EQ(eeprom.Data()[300], 0xFF);
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+static void testNestedCommit()
+{
+  reset();
+
+  MemBeginWrite();
+    MemWrite(500, 1);
+    MemBeginWrite();
+      MemWrite(501, 2);
+      MemWrite(502, 3);
+    MemCommit();
+
+    // внутренний MemCommit ничего не пишет
+    CHECK_EQ(eeprom.WriteCycles(), 0);
+    CHECK_EQ(eeprom.Data()[500], 0xFF);
+
+    // чтение видит ещё не записанные изменения
+    CHECK_EQ(MemRead(501), 2);
+    MemWrite(503, 4);
+  MemCommit();
+
+  CHECK_EQ(eeprom.WriteCycles(), 1);
+  CHECK_EQ(eeprom.BytesWritten(), 4);
+  CHECK_EQ(eeprom.Data()[500], 1);
+  CHECK_EQ(eeprom.Data()[503], 4);
+
+  // лишний MemCommit безопасен
+  MemCommit();
+  CHECK_EQ(eeprom.WriteCycles(), 1);
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+static void testLineSwitchFlushes()
+{
+  reset();
+
+  MemBeginWrite();
+  MemWrite(1000, 0x11);
+  CHECK_EQ(eeprom.WriteCycles(), 0);
+
+  // переход на другую строку сохраняет изменения текущей
+  MemWrite(2000, 0x22);
+  CHECK_EQ(eeprom.WriteCycles(), 1);
+  CHECK_EQ(eeprom.Data()[1000], 0x11);
+  CHECK_EQ(eeprom.Data()[2000], 0xFF);
+  MemCommit();
+
+  CHECK_EQ(eeprom.WriteCycles(), 2);
+  CHECK_EQ(eeprom.Data()[2000], 0x22);
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+static void testCachedReads()
+{
+  reset();
+
+  for(unsigned int i = 0; i < 32; i++)
+    eeprom.Data()[64 + i] = (uint8_t) (0x80 + i);
+
+  MemRead(64);
+  uint32_t transactions = Wire.Transactions();
+
+  // вся строка уже в кеше - шина не нужна
+  for(unsigned int i = 0; i < 32; i++)
+    CHECK_EQ(MemRead(64 + i), 0x80 + i);
+  CHECK_EQ(Wire.Transactions(), transactions);
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+static void testUnchangedBatch()
+{
+  reset();
+
+  for(unsigned int i = 0; i < 32; i++)
+    eeprom.Data()[3000 + i] = (uint8_t) i;
+
+  MemBeginWrite();
+  for(unsigned int i = 0; i < 32; i++)
+    MemWrite(3000 + i, (uint8_t) i);
+  MemCommit();
+
+  CHECK_EQ(eeprom.WriteCycles(), 0);
+  CHECK_EQ(MemGetStat()->BytesSkipped, 32);
+  CHECK_EQ(MemGetStat()->Flushes, 0);
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+static void testWaitIsAckPolling()
+{
+  reset();
+
+  MemBeginWrite();
+  for(unsigned int i = 0; i < 64; i++)
+    MemWrite(1536 + i, (uint8_t) ~i);
+  MemCommit();
+
+  // ожидание длится ровно цикл записи микросхемы: мастер опрашивает её, пока она не ответит ACK
+  CHECK_EQ(eeprom.WriteCycles(), 4);
+  CHECK(eeprom.Nacks() > 0);
+
+  uint32_t waited = MemGetStat()->WaitMicros;
+  CHECK(waited >= eeprom.BusyMicros());
+  CHECK(waited < eeprom.BusyMicros() + eeprom.BusyMicros() / 2);
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+int main()
+{
+  Host::SetClockMode(hostClockFrozen);
+  Wire.Attach(AT24CX_ID | EEPROM_MEMORY_INDEX, &eeprom);
+  MemInit();
+
+  RUN_TEST(testSingleWrite);
+  RUN_TEST(testBatchedWrite);
+  RUN_TEST(testNestedCommit);
+  RUN_TEST(testLineSwitchFlushes);
+  RUN_TEST(testCachedReads);
+  RUN_TEST(testUnchangedBatch);
+  RUN_TEST(testWaitIsAckPolling);
+  return TestResult();
+}
+//--------------------------------------------------------------------------------------------------------------------------------
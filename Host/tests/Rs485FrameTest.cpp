@@ -0,0 +1,487 @@
+//--------------------------------------------------------------------------------------------------------------------------------
+// Тесты кадров второй версии шины RS-485 (UniRS485Gate): на Serial3 висит модель шины с модулями датчиков - один понимает
+// кадры второй версии и отдаёт показания трёх датчиков одним кадром, второй - только пакеты первой версии.
+// Проверяется CRC по таблице полубайтов против побитового расчёта, разбор многозаписных кадров, переход на старый формат
+// для молчащего модуля и повторное выяснение формата после пропажи модуля, отбраковка кадров с битой CRC и длиной,
+// и то, что полный круг опроса трёхдатчикового модуля - один обмен.
+//
+// Модель шины собирает кадры и считает CRC сама, не пользуясь структурами и функциями прошивки. Кадр шлюза уходит из UART
+// между проходами loop(): тогда модель вызывает прерывание окончания передачи, если шлюз его разрешил, и модуль сразу
+// отвечает. Если в этот момент DE шлюза ещё поднят, его передатчик держит шину и ответ пропадает, как на железе
+//--------------------------------------------------------------------------------------------------------------------------------
+#include <Arduino.h>
+#include <HostHardware.h>
+#include "UniversalSensors.h"
+#include "Crc8.h"
+#include "HostTest.h"
+//--------------------------------------------------------------------------------------------------------------------------------
+#define LOOP_STEP_MS 10 // модельное время одного прохода loop()
+#define POLL_CYCLE_MS (RS485_ONE_SENSOR_UPDATE_INTERVAL * 2 + 100) // круг опроса: один обмен с каждым из двух модулей
+#define V1_PACKET_SIZE sizeof(RS485Packet) // пакет первой версии - состояние контроллера плюс 7 байт обвязки
+#define V2_OVERHEAD 6
+//--------------------------------------------------------------------------------------------------------------------------------
+static uint8_t referenceCrc8(const uint8_t* data, size_t len)
+{
+  // побитовый расчёт, как в OneWire::crc8
+  uint8_t crc = 0;
+  while(len--)
+  {
+    uint8_t inbyte = *data++;
+    for(uint8_t i = 8; i; i--)
+    {
+      uint8_t mix = (crc ^ inbyte) & 0x01;
+      crc >>= 1;
+      if(mix)
+        crc ^= 0x8C;
+      inbyte >>= 1;
+    }
+  }
+  return crc;
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+extern "C" void USART3_TX_vect(void); // из UniversalSensors.cpp, RS_485_TX_vect
+//--------------------------------------------------------------------------------------------------------------------------------
+// ответ модуля на последний кадр шлюза, уходит в шину вместе с окончанием передачи кадра (см. busTick)
+static uint8_t slaveAnswer[64];
+static uint8_t slaveAnswerLength = 0;
+static bool gateFrameSent = false;
+static uint32_t lostAnswers = 0;
+//--------------------------------------------------------------------------------------------------------------------------------
+typedef enum
+{
+  corruptNone,
+  corruptCrc, // портим последний байт
+  corruptLength // длина больше, чем влезает в пакет первой версии
+
+} CorruptMode;
+//--------------------------------------------------------------------------------------------------------------------------------
+struct BusSensor
+{
+  uint8_t Type;
+  uint8_t Index;
+  uint8_t Reading[4];
+};
+//--------------------------------------------------------------------------------------------------------------------------------
+// модуль с датчиками на шине
+class BusModule
+{
+  public:
+    BusModule(bool v2) : V2(v2), Online(true), Corrupt(corruptNone), count(0) { ResetStat(); }
+
+    bool V2;
+    bool Online;
+    CorruptMode Corrupt; // сработает на одном ответе
+
+    uint32_t V1Requests, V2Requests, Answers;
+
+    void ResetStat() { V1Requests = V2Requests = Answers = 0; }
+
+    BusSensor* Add(uint8_t type, uint8_t index)
+    {
+      BusSensor* s = &sensors[count++];
+      memset(s, 0, sizeof(BusSensor));
+      s->Type = type;
+      s->Index = index;
+      return s;
+    }
+
+    BusSensor* Find(uint8_t type, uint8_t index)
+    {
+      for(uint8_t i = 0; i < count; i++)
+        if(sensors[i].Type == type && sensors[i].Index == index)
+          return &sensors[i];
+      return NULL;
+    }
+
+    void OnRequest(bool v2, const uint8_t* request)
+    {
+      if(v2) V2Requests++; else V1Requests++;
+
+      // модуль первой версии не знает заголовка кадра и молчит
+      if(!Online || (v2 && !V2))
+        return;
+
+      BusSensor* s = Find(request[v2 ? 5 : 4], request[v2 ? 6 : 5]);
+      uint8_t answer[V1_PACKET_SIZE];
+      uint8_t len;
+
+      if(v2)
+      {
+        answer[0] = 0xAC;
+        answer[1] = 0xCA;
+        answer[3] = RS485FromSlave;
+        answer[4] = RS485SensorDataPacket;
+        len = 5;
+        // запрошенный датчик - первым, за ним остальные
+        len = putRecord(answer, len, s);
+        for(uint8_t i = 0; i < count; i++)
+          if(&sensors[i] != s)
+            len = putRecord(answer, len, &sensors[i]);
+        answer[2] = len - 5;
+        if(Corrupt == corruptLength)
+          answer[2] = 0xF0;
+      }
+      else
+      {
+        memcpy(answer, request, V1_PACKET_SIZE - 1);
+        answer[2] = RS485FromSlave;
+        memcpy(answer + 6, s->Reading, 4);
+        len = V1_PACKET_SIZE - 1;
+      }
+
+      answer[len] = referenceCrc8(answer, len);
+      len++;
+      if(Corrupt == corruptCrc)
+        answer[len-1] ^= 0x5A;
+      Corrupt = corruptNone;
+
+      Answers++;
+      memcpy(slaveAnswer, answer, len);
+      slaveAnswerLength = len;
+    }
+
+  private:
+    BusSensor sensors[4];
+    uint8_t count;
+
+    static uint8_t putRecord(uint8_t* dest, uint8_t len, const BusSensor* s)
+    {
+      dest[len++] = s->Type;
+      dest[len++] = s->Index;
+      memcpy(dest + len, s->Reading, 4);
+      return len + 4;
+    }
+};
+//--------------------------------------------------------------------------------------------------------------------------------
+static BusModule multiModule(true); // три датчика, понимает кадры второй версии
+static BusModule oldModule(false); // один датчик, только пакеты первой версии
+static BusSensor* temp0;
+static BusSensor* temp1;
+static BusSensor* humidity0;
+static BusSensor* light0;
+//--------------------------------------------------------------------------------------------------------------------------------
+// что шлюз пишет в шину
+static uint8_t busFrame[64];
+static uint8_t busFrameLength = 0;
+static uint32_t gateBadCrc = 0;
+static uint32_t sensorRequestBytes = 0;
+static uint8_t lastV2RequestLength = 0;
+//--------------------------------------------------------------------------------------------------------------------------------
+static void onGateFrame(bool v2)
+{
+  if(referenceCrc8(busFrame, busFrameLength - 1) != busFrame[busFrameLength - 1])
+  {
+    gateBadCrc++;
+    return;
+  }
+
+  uint8_t direction = busFrame[v2 ? 3 : 2];
+  uint8_t type = busFrame[v2 ? 4 : 3];
+  if(direction != RS485FromMaster || type != RS485SensorDataPacket)
+    return; // модули управления и исполнительные модули в этой модели не висят
+
+  sensorRequestBytes += busFrameLength;
+  if(v2)
+    lastV2RequestLength = busFrameLength;
+
+  gateFrameSent = true;
+
+  uint8_t sType = busFrame[v2 ? 5 : 4];
+  uint8_t sIndex = busFrame[v2 ? 6 : 5];
+  if(multiModule.Find(sType, sIndex))
+    multiModule.OnRequest(v2, busFrame);
+  else
+  if(oldModule.Find(sType, sIndex))
+    oldModule.OnRequest(v2, busFrame);
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+static void onGateByte(HardwareSerial&, uint8_t b)
+{
+  UCSR3A &= ~_BV(TXC3); // байт ушёл в UART, но не в шину: флаг окончания передачи выставит busTick
+
+  busFrame[busFrameLength++] = b;
+
+  // ищем начало пакета или кадра
+  if(busFrameLength == 1 && b != 0xAB && b != 0xAC)
+    busFrameLength = 0;
+  else
+  if(busFrameLength == 2 && !((busFrame[0] == 0xAB && b == 0xBA) || (busFrame[0] == 0xAC && b == 0xCA)))
+    busFrameLength = 0;
+
+  if(busFrameLength < 3)
+    return;
+
+  bool v2 = busFrame[0] == 0xAC;
+  uint8_t expected = v2 ? busFrame[2] + V2_OVERHEAD : V1_PACKET_SIZE;
+  if(busFrameLength < expected && busFrameLength < sizeof(busFrame))
+    return;
+
+  onGateFrame(v2);
+  busFrameLength = 0;
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+static void busTick()
+{
+  if(!gateFrameSent)
+    return;
+  gateFrameSent = false;
+
+  // последний байт кадра ушёл из сдвигового регистра
+  UCSR3A |= _BV(TXC3);
+  if(UCSR3B & _BV(TXCIE3))
+    USART3_TX_vect();
+
+  if(!slaveAnswerLength)
+    return;
+
+  if(Host::GetDigital(RS_485_DE_PIN) == HIGH)
+    lostAnswers++;
+  else
+    Serial3.Inject(slaveAnswer, slaveAnswerLength);
+
+  slaveAnswerLength = 0;
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+static void runLoop()
+{
+  Host::RunLoop();
+  busTick();
+  Host::AdvanceMillis(LOOP_STEP_MS);
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+// статистика шлюза по датчикам в очереди опроса, из RS485.PrintStats: запросы, таймауты, битые пакеты
+class StatsPrint : public Print
+{
+  public:
+    String Text;
+    virtual size_t write(uint8_t c) { Text += (char) c; return 1; }
+};
+//--------------------------------------------------------------------------------------------------------------------------------
+static long gateStat(uint8_t field)
+{
+  // по всем датчикам очереди: какой датчик модуля опрашивается в момент порчи ответа, зависит от круга опроса
+  StatsPrint p;
+  RS485.PrintStats(&p);
+
+  long total = 0;
+  for(uint8_t queuePos = 0; queuePos < 4; queuePos++)
+  {
+    String key = String("|S") + queuePos + "|";
+    int at = p.Text.indexOf(key);
+    if(at < 0)
+      continue;
+
+    at += key.length();
+    for(uint8_t i = 0; i < field; i++)
+      at = p.Text.indexOf('|', at) + 1;
+    total += p.Text.substring(at).toInt();
+  }
+  return total;
+}
+#define STAT_TIMEOUTS 1
+#define STAT_CRC_ERRORS 2
+//--------------------------------------------------------------------------------------------------------------------------------
+static void runFor(unsigned long ms)
+{
+  for(unsigned long t = 0; t < ms; t += LOOP_STEP_MS)
+    runLoop();
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+static void runUntilRequested(BusModule& module)
+{
+  // до очередного запроса к модулю, плюс время на разбор ответа
+  uint32_t requests = module.V1Requests + module.V2Requests;
+  for(uint16_t i = 0; i < 1000 && module.V1Requests + module.V2Requests == requests; i++)
+    runLoop();
+  runFor(LOOP_STEP_MS * 5);
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+static void setTemperature(BusSensor* s, int8_t value, uint8_t fract)
+{
+  s->Reading[0] = (uint8_t) value;
+  s->Reading[1] = fract;
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+static const Temperature* gateTemperature(UniSensorType type, uint8_t index, bool second = false)
+{
+  UniSensorState states;
+  if(!UniDispatcher.GetRegisteredStates(type, index, states))
+    return NULL;
+  OneState* os = second ? states.State2 : states.State1;
+  return os ? (const Temperature*) os->GetCurrentData() : NULL;
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+static bool gateHasTemperature(uint8_t index, int8_t value, uint8_t fract)
+{
+  const Temperature* t = gateTemperature(uniTemp, index);
+  return t && t->Value == value && t->Fract == fract;
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+static long gateLuminosity(uint8_t index)
+{
+  UniSensorState states;
+  if(!UniDispatcher.GetRegisteredStates(uniLuminosity, index, states) || !states.State1)
+    return -2;
+  return *((const int32_t*) states.State1->GetCurrentData());
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+static void testCrcTable()
+{
+  // таблица по полбайта даёт ту же сумму, что и побитовый расчёт - старые модули понимают новую прошивку
+  bool same = true;
+  uint8_t buff[64];
+  for(uint16_t b = 0; b < 256; b++)
+  {
+    buff[0] = (uint8_t) b;
+    same = same && Crc8(buff, 1) == referenceCrc8(buff, 1);
+  }
+
+  for(uint16_t round = 0; round < 500; round++)
+  {
+    uint8_t len = 1 + round % sizeof(buff);
+    for(uint8_t i = 0; i < len; i++)
+      buff[i] = (uint8_t) (round * 31 + i * 7 + (i >> 2));
+    same = same && Crc8(buff, len) == referenceCrc8(buff, len);
+
+    // по частям - то же самое, что целиком
+    uint8_t half = len / 2;
+    same = same && Crc8(buff + half, len - half, Crc8(buff, half)) == Crc8(buff, len);
+  }
+  CHECK(same);
+
+  // блок вместе со своей CRC даёт ноль - так модули проверяют пакет целиком
+  buff[10] = Crc8(buff, 10);
+  CHECK_EQ(Crc8(buff, 11), 0);
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+static void testMultiRecordFrame()
+{
+  setTemperature(temp0, 21, 50);
+  setTemperature(temp1, -5, 25);
+  setTemperature(humidity0, 60, 10);
+  humidity0->Reading[2] = 23;
+  humidity0->Reading[3] = 75;
+  int32_t lux = 12345;
+  memcpy(light0->Reading, &lux, 4);
+
+  // первый круг: модуль с тремя датчиками ответил кадром сразу за все, старый модуль на кадр промолчал
+  runFor(POLL_CYCLE_MS);
+  CHECK(gateHasTemperature(0, 21, 50));
+  CHECK(gateHasTemperature(1, -5, 25));
+  const Temperature* h = gateTemperature(uniHumidity, 0);
+  const Temperature* ht = gateTemperature(uniHumidity, 0, true);
+  CHECK(h && h->Value == 60 && h->Fract == 10);
+  CHECK(ht && ht->Value == 23 && ht->Fract == 75);
+  CHECK_EQ(multiModule.V2Requests, 1);
+  CHECK_EQ(multiModule.V1Requests, 0);
+  CHECK_EQ(oldModule.V2Requests, 1);
+  CHECK_EQ(oldModule.Answers, 0);
+  CHECK_EQ(lastV2RequestLength, 2 + V2_OVERHEAD);
+
+  // дальше старый модуль опрашивается пакетами первой версии
+  runFor(POLL_CYCLE_MS);
+  CHECK_EQ(gateLuminosity(0), 12345);
+  CHECK(oldModule.V1Requests >= 1);
+  CHECK_EQ(oldModule.V2Requests, 1);
+
+  // установившийся режим: модули опрашиваются по очереди, по одному обмену на модуль, хотя у первого три датчика
+  multiModule.ResetStat();
+  oldModule.ResetStat();
+  sensorRequestBytes = 0;
+  setTemperature(temp1, -6, 0);
+  runFor(POLL_CYCLE_MS * 3);
+  CHECK(multiModule.V2Requests >= 3);
+  CHECK(multiModule.V2Requests <= oldModule.V1Requests + 1 && oldModule.V1Requests <= multiModule.V2Requests + 1);
+  CHECK_EQ(multiModule.V1Requests, 0);
+  CHECK_EQ(oldModule.V2Requests, 0);
+  CHECK_EQ(sensorRequestBytes, multiModule.V2Requests * (2 + V2_OVERHEAD) + oldModule.V1Requests * V1_PACKET_SIZE);
+  CHECK(gateHasTemperature(1, -6, 0));
+  CHECK_EQ(gateBadCrc, 0);
+  CHECK_EQ(lostAnswers, 0);
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+static void testBadFrames()
+{
+  runFor(POLL_CYCLE_MS);
+  long crcErrors = gateStat(STAT_CRC_ERRORS);
+  long timeouts = gateStat(STAT_TIMEOUTS);
+
+  // битая CRC: показания не применяются, ошибка попадает в статистику
+  setTemperature(temp0, 30, 0);
+  multiModule.Corrupt = corruptCrc;
+  runUntilRequested(multiModule);
+  CHECK(!gateHasTemperature(0, 30, 0));
+  CHECK_EQ(gateStat(STAT_CRC_ERRORS), crcErrors + 1);
+  CHECK_EQ(gateStat(STAT_TIMEOUTS), timeouts);
+
+  runFor(POLL_CYCLE_MS);
+  CHECK(gateHasTemperature(0, 30, 0));
+
+  // длина больше буфера: шлюз не выходит за пакет, ждёт недостающих байт и отбраковывает кадр по таймауту,
+  // следующий обмен - как обычно
+  setTemperature(temp0, 31, 0);
+  multiModule.Corrupt = corruptLength;
+  runUntilRequested(multiModule);
+  CHECK(!gateHasTemperature(0, 31, 0));
+  CHECK_EQ(gateStat(STAT_CRC_ERRORS), crcErrors + 1);
+  CHECK_EQ(gateStat(STAT_TIMEOUTS), timeouts + 1);
+
+  runFor(POLL_CYCLE_MS);
+  CHECK(gateHasTemperature(0, 31, 0));
+  CHECK_EQ(gateBadCrc, 0);
+  CHECK_EQ(lostAnswers, 0);
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+static void testRenegotiation()
+{
+  // модуль пропал: после RS485_RESET_SENSOR_AFTER_N_BAD_READINGS таймаутов его показания сбрасываются
+  multiModule.Online = false;
+  runFor(POLL_CYCLE_MS * 3 * (RS485_RESET_SENSOR_AFTER_N_BAD_READINGS + 2));
+  const Temperature* t = gateTemperature(uniTemp, 0);
+  CHECK(t && t->Value == NO_TEMPERATURE_DATA);
+
+  // пока молчал - опрашивался по-старому; вернулся - шлюз снова пробует кадр второй версии и получает все датчики разом
+  CHECK(multiModule.V1Requests > 0);
+  multiModule.ResetStat();
+  multiModule.Online = true;
+  setTemperature(temp0, 19, 0);
+  setTemperature(temp1, 18, 0);
+  runFor(POLL_CYCLE_MS * 6);
+  CHECK(multiModule.V2Requests >= 1);
+  CHECK(gateHasTemperature(0, 19, 0));
+  CHECK(gateHasTemperature(1, 18, 0));
+
+  // установилось: снова только кадры второй версии
+  multiModule.ResetStat();
+  runFor(POLL_CYCLE_MS * 2);
+  CHECK_EQ(multiModule.V1Requests, 0);
+  CHECK(multiModule.V2Requests >= 2);
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+int main()
+{
+  Host::SetClockMode(hostClockFrozen);
+  setup();
+  Serial.ClearSent();
+
+  // универсальные датчики регистрируем до первого опроса шины - по ним строится очередь шлюза
+  UniDispatcher.AddUniSensor(uniTemp, 0);
+  UniDispatcher.AddUniSensor(uniTemp, 1);
+  UniDispatcher.AddUniSensor(uniHumidity, 0);
+  UniDispatcher.AddUniSensor(uniLuminosity, 0);
+
+  temp0 = multiModule.Add(uniTemp, 0);
+  temp1 = multiModule.Add(uniTemp, 1);
+  humidity0 = multiModule.Add(uniHumidity, 0);
+  light0 = oldModule.Add(uniLuminosity, 0);
+
+  Serial3.OnWrite(onGateByte);
+
+  RUN_TEST(testCrcTable);
+  RUN_TEST(testMultiRecordFrame);
+  RUN_TEST(testBadFrames);
+  RUN_TEST(testRenegotiation);
+
+  return TestResult();
+}
+//--------------------------------------------------------------------------------------------------------------------------------
@@ -0,0 +1,221 @@
+//--------------------------------------------------------------------------------------------------------------------------------
+// Тесты расписания обновления модулей (ModuleController::ScheduleModule и UpdateModules) на отдельном контроллере
+// с модулями-пустышками: периодический модуль вызывается только по истечении своего интервала и получает настоящий dt,
+// за проход вызывается не больше одного периодического модуля обычного приоритета - с бОльшим приоритетом, при равенстве
+// самый опоздавший, модули с высоким приоритетом вызываются вне очереди. Профилировщик считает превышения BudgetMicros
+// и опоздания, транспорты обслуживаются не чаще раза в TRANSPORTS_UPDATE_INTERVAL, но и на долгом проходе тоже.
+//
+// Время модельное: проход почти не занимает времени (часы шима сдвигаются на микросекунду за чтение), если модуль сам
+// не "поработает" (WorkMicros)
+//--------------------------------------------------------------------------------------------------------------------------------
+#include <Arduino.h>
+#include <HostHardware.h>
+#include "ModuleController.h"
+#include "HostTest.h"
+//--------------------------------------------------------------------------------------------------------------------------------
+#define PASS_STEP_MS 10 // модельное время между проходами
+//--------------------------------------------------------------------------------------------------------------------------------
+static char trace[256]; // какие модули вызывались за проход, по порядку
+static uint16_t transportsCalls = 0;
+//--------------------------------------------------------------------------------------------------------------------------------
+class TestModule : public AbstractModule
+{
+  public:
+    TestModule(ModuleController* c, const char* id, uint16_t interval = 0, uint8_t priority = 0, uint32_t budget = 0)
+      : AbstractModule(id), WorkMicros(0), Calls(0), LastDt(0), controller(c), interval(interval), priority(priority), budget(budget)
+    {
+      controller->RegisterModule(this);
+    }
+
+    unsigned long WorkMicros; // сколько модельного времени занимает Update
+    uint32_t Calls;
+    uint16_t LastDt;
+
+    virtual bool ExecCommand(const Command&, bool) { return false; }
+
+    virtual void Setup()
+    {
+      if(interval)
+        controller->ScheduleModule(this, interval, priority, budget);
+    }
+
+    virtual void Update(uint16_t dt)
+    {
+      Calls++;
+      LastDt = dt;
+      strcat(trace, GetID());
+      strcat(trace, " ");
+      Host::AdvanceMicros(WorkMicros);
+    }
+
+  private:
+    ModuleController* controller;
+    uint16_t interval;
+    uint8_t priority;
+    uint32_t budget;
+};
+//--------------------------------------------------------------------------------------------------------------------------------
+static void onTransports(AbstractModule*)
+{
+  transportsCalls++;
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+static const char* pass(ModuleController& ctl, unsigned long stepMs = PASS_STEP_MS)
+{
+  // проход в текущий момент, потом время идёт дальше
+  trace[0] = 0;
+  ctl.UpdateModules(onTransports);
+  Host::AdvanceMillis(stepMs);
+  return trace;
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+static unsigned long testStartedAt = 0;
+//--------------------------------------------------------------------------------------------------------------------------------
+static void startClock()
+{
+  testStartedAt = millis() + 1;
+  Host::AdvanceMicros(testStartedAt * 1000UL - micros());
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+static void at(unsigned long ms)
+{
+  // ровно ms от начала теста, сколько бы ни "проработали" модули
+  Host::AdvanceMicros((testStartedAt + ms) * 1000UL - micros());
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+static void testDueOrder()
+{
+  ModuleController ctl;
+  TestModule every(&ctl, "EVERY");
+  TestModule p100(&ctl, "P100", 100, schedulePriorityNormal);
+  TestModule p200(&ctl, "P200", 200, schedulePriorityNormal);
+
+  // до истечения интервала вызываются только модули без расписания
+  bool onlyEvery = true;
+  for(uint8_t i = 0; i < 10; i++)
+    onlyEvery = onlyEvery && !strcmp(pass(ctl), "EVERY ");
+  CHECK(onlyEvery);
+  CHECK_EQ(every.Calls, 10);
+  CHECK_EQ(every.LastDt, PASS_STEP_MS);
+
+  // периодический модуль - раньше остальных, dt - с его прошлого вызова
+  CHECK_STR(pass(ctl), "P100 EVERY ");
+  CHECK_EQ(p100.LastDt, 100);
+
+  for(uint8_t i = 0; i < 9; i++)
+    pass(ctl);
+
+  // обоим пора: за проход - только один, второй - на следующем, со своим настоящим dt
+  CHECK_STR(pass(ctl), "P100 EVERY ");
+  CHECK_STR(pass(ctl), "P200 EVERY ");
+  CHECK_EQ(p200.LastDt, 200 + PASS_STEP_MS);
+  CHECK_EQ(p100.Calls, 2);
+  CHECK_EQ(p200.Calls, 1);
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+static void testPriority()
+{
+  ModuleController ctl;
+  TestModule low(&ctl, "LOW", 100, schedulePriorityLow);
+  TestModule normal(&ctl, "NORMAL", 150, schedulePriorityNormal);
+  TestModule high1(&ctl, "HIGH1", 50, schedulePriorityHigh);
+  TestModule high2(&ctl, "HIGH2", 50, schedulePriorityHigh);
+
+  // всем пора: модули с высоким приоритетом - вне очереди, из остальных - обычный, хотя низкий опоздал сильнее
+  Host::AdvanceMillis(150);
+  CHECK_STR(pass(ctl), "HIGH1 HIGH2 NORMAL ");
+  CHECK_STR(pass(ctl), "LOW ");
+  CHECK_EQ(high1.LastDt, 150);
+
+  // при равном приоритете - самый опоздавший, а не первый зарегистрированный
+  ModuleController ctl2;
+  TestModule first(&ctl2, "FIRST", 100, schedulePriorityNormal);
+  TestModule second(&ctl2, "SECOND", 100, schedulePriorityNormal);
+
+  Host::AdvanceMillis(30);
+  ctl2.ScheduleModule(&first, 100, schedulePriorityNormal); // первому - заново с этого момента, опоздает меньше
+  Host::AdvanceMillis(120);
+  CHECK_STR(pass(ctl2), "SECOND ");
+  CHECK_STR(pass(ctl2), "FIRST ");
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+static void testOverruns()
+{
+  startClock();
+  ModuleController ctl;
+  TestModule every(&ctl, "EVERY");
+  TestModule budget(&ctl, "BUDGET", 100, schedulePriorityNormal, 500);
+  TestModule unbudgeted(&ctl, "UNBUDGETED", 100, schedulePriorityHigh);
+  const ModuleProfileData* pd = ctl.GetModuleProfile(1);
+  const ModuleProfileData* unbudgetedPd = ctl.GetModuleProfile(2);
+
+  // Update дольше бюджета - превышение считается
+  budget.WorkMicros = 800;
+  unbudgeted.WorkMicros = 800;
+  at(100);
+  pass(ctl, 0);
+  CHECK_EQ(pd->Calls, 1);
+  CHECK_EQ(pd->Overruns, 1);
+  CHECK(pd->MaxMicros >= 800 && pd->MaxMicros < 810);
+  CHECK_EQ(pd->MaxLateness, 0);
+
+  // уложился - не считается
+  budget.WorkMicros = 300;
+  at(200);
+  pass(ctl, 0);
+  CHECK_EQ(pd->Calls, 2);
+  CHECK_EQ(pd->Overruns, 1);
+  CHECK(pd->TotalMicros >= 1100 && pd->TotalMicros < 1110);
+
+  // опоздание - относительно срока
+  at(330);
+  pass(ctl, 0);
+  CHECK_EQ(pd->Calls, 3);
+  CHECK_EQ(pd->MaxLateness, 30);
+
+  // без бюджета превышения не считаются, сколько бы Update ни работал
+  CHECK_EQ(unbudgetedPd->Calls, 3);
+  CHECK_EQ(unbudgetedPd->Overruns, 0);
+
+  ctl.ResetProfile();
+  CHECK_EQ(pd->Calls, 0);
+  CHECK_EQ(pd->Overruns, 0);
+  CHECK_EQ(pd->BudgetMicros, 500);
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+static void testTransportsSlot()
+{
+  ModuleController ctl;
+  TestModule m1(&ctl, "M1");
+  TestModule m2(&ctl, "M2");
+  TestModule m3(&ctl, "M3");
+  TestModule m4(&ctl, "M4");
+
+  // быстрые проходы: транспорты - раз в TRANSPORTS_UPDATE_INTERVAL, а не после каждого модуля
+  Host::AdvanceMillis(TRANSPORTS_UPDATE_INTERVAL);
+  transportsCalls = 0;
+  for(uint8_t i = 0; i < TRANSPORTS_UPDATE_INTERVAL * 4; i++)
+    pass(ctl, 1);
+  CHECK_EQ(transportsCalls, 4);
+
+  // долгий проход: транспорты обслуживаются и посреди него
+  m1.WorkMicros = m2.WorkMicros = m3.WorkMicros = m4.WorkMicros = (TRANSPORTS_UPDATE_INTERVAL * 1000UL * 3) / 5;
+  Host::AdvanceMillis(TRANSPORTS_UPDATE_INTERVAL);
+  transportsCalls = 0;
+  pass(ctl, 0);
+  CHECK_EQ(transportsCalls, 2);
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+int main()
+{
+  Host::SetClockMode(hostClockFrozen);
+  Host::AdvanceMillis(1000);
+
+  RUN_TEST(testDueOrder);
+  RUN_TEST(testPriority);
+  RUN_TEST(testOverruns);
+  RUN_TEST(testTransportsSlot);
+
+  return TestResult();
+}
+//--------------------------------------------------------------------------------------------------------------------------------
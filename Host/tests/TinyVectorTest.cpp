@@ -0,0 +1,327 @@
+//--------------------------------------------------------------------------------------------------------------------------------
+// Тесты Vector, FixedVector и PoolVector из TinyVector.h: удаление сдвигает элементы, а не байты; empty() сохраняет память,
+// clear() и shrink() освобождают её; reserve() - одно выделение; FixedVector не трогает кучу; PoolVector живёт в пуле,
+// растёт в нём на месте и уходит в кучу, только когда в пуле нет места.
+//--------------------------------------------------------------------------------------------------------------------------------
+#include <Arduino.h>
+#include <HostHardware.h>
+#include "TinyVector.h"
+#include "HostTest.h"
+//--------------------------------------------------------------------------------------------------------------------------------
+typedef struct
+{
+  uint16_t id;
+  uint32_t value;
+  
+} TestItem; // элемент шире байта - на нём ломалось побайтовое удаление
+//--------------------------------------------------------------------------------------------------------------------------------
+static bool operator==(const TestItem& a, const TestItem& b)
+{
+  return a.id == b.id && a.value == b.value;
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+#define TEST_POOL_BLOCK_SIZE 16
+#define TEST_POOL_BLOCKS 8
+static uint8_t testPoolStorage[TEST_POOL_BLOCK_SIZE * TEST_POOL_BLOCKS];
+static uint8_t testPoolMap[(TEST_POOL_BLOCKS + 7) / 8];
+VectorPool TestPool(testPoolStorage, testPoolMap, TEST_POOL_BLOCK_SIZE, TEST_POOL_BLOCKS);
+typedef PoolVector<TestItem, &TestPool> PooledItems; // по два элемента на блок
+//--------------------------------------------------------------------------------------------------------------------------------
+static TestItem item(uint16_t id)
+{
+  TestItem t = { id, (uint32_t) id * 1000 };
+  return t;
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+template<typename V>
+static void fill(V& v, uint16_t count)
+{
+  for(uint16_t i = 0; i < count; i++)
+    v.push_back(item(i));
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+template<typename V>
+static void checkIds(V& v, const uint16_t* ids, size_t count)
+{
+  CHECK_EQ(v.size(), count);
+  for(size_t i = 0; i < count && i < v.size(); i++)
+  {
+    CHECK_EQ(v[i].id, ids[i]);
+    CHECK_EQ(v[i].value, ids[i] * 1000UL);
+  }
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+template<typename V>
+static void checkRemove(V& v)
+{
+  fill(v, 6);
+
+  v.remove(1, 2); // из середины
+  const uint16_t afterMiddle[] = { 0, 3, 4, 5 };
+  checkIds(v, afterMiddle, 4);
+
+  v.remove(0, 1); // первый
+  const uint16_t afterFirst[] = { 3, 4, 5 };
+  checkIds(v, afterFirst, 3);
+
+  v.remove(1, 100); // кол-во больше оставшегося - удаляется хвост
+  const uint16_t afterTail[] = { 3 };
+  checkIds(v, afterTail, 1);
+
+  v.remove(5, 1); // за пределами - ничего не происходит
+  checkIds(v, afterTail, 1);
+
+  v.remove(0, 1);
+  CHECK_EQ(v.size(), 0);
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+static void testVectorRemove()
+{
+  Vector<TestItem> v;
+  checkRemove(v);
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+static void testFixedVectorRemove()
+{
+  FixedVector<TestItem, 8> v;
+  checkRemove(v);
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+static void testVectorIndexOfAndPop()
+{
+  Vector<TestItem> v;
+  CHECK_EQ(v.indexOf(item(1)), -1);
+
+  fill(v, 4);
+  CHECK_EQ(v.indexOf(item(2)), 2);
+  CHECK_EQ(v.indexOf(item(7)), -1);
+
+  v.pop();
+  CHECK_EQ(v.size(), 3);
+  CHECK_EQ(v.indexOf(item(3)), -1);
+
+  v.pop(); v.pop(); v.pop(); v.pop(); // лишний pop пустого вектора безопасен
+  CHECK_EQ(v.size(), 0);
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+static void testVectorGrowth()
+{
+  Vector<TestItem> v;
+
+  Host::ResetHeapStat();
+  fill(v, 9); // 1, 2, 4, 8, 16 - пять выделений
+  CHECK_EQ(v.capacity(), 16);
+  CHECK_EQ(Host::GetHeapStat()->Allocs, 5);
+  CHECK_EQ(Host::GetHeapStat()->Frees, 4);
+
+  for(uint16_t i = 0; i < 9; i++)
+    CHECK_EQ(v[i].id, i);
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+static void testVectorReserve()
+{
+  Vector<TestItem> v;
+
+  Host::ResetHeapStat();
+  v.reserve(20);
+  fill(v, 20);
+  CHECK_EQ(v.capacity(), 20);
+  CHECK_EQ(Host::GetHeapStat()->Allocs, 1);
+
+  v.reserve(10); // меньше текущей ёмкости - ничего не меняется
+  CHECK_EQ(v.capacity(), 20);
+  CHECK_EQ(Host::GetHeapStat()->Allocs, 1);
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+static void testVectorEmptyKeepsMemory()
+{
+  Vector<TestItem> v;
+  fill(v, 8);
+
+  Host::ResetHeapStat();
+  v.empty();
+  CHECK_EQ(v.size(), 0);
+  CHECK_EQ(v.capacity(), 8);
+
+  fill(v, 8);
+  CHECK_EQ(Host::GetHeapStat()->Allocs, 0);
+  CHECK_EQ(Host::GetHeapStat()->Frees, 0);
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+static void testVectorClearFreesMemory()
+{
+  Vector<TestItem> v;
+  fill(v, 8);
+
+  Host::ResetHeapStat();
+  size_t heapBefore = Host::GetHeapStat()->Current;
+  v.clear();
+  CHECK_EQ(v.size(), 0);
+  CHECK_EQ(v.capacity(), 0);
+  CHECK(v.pData() == NULL);
+  CHECK_EQ(Host::GetHeapStat()->Frees, 1);
+  CHECK(heapBefore - Host::GetHeapStat()->Current >= 8 * sizeof(TestItem));
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+static void testVectorShrink()
+{
+  Vector<uint8_t> v;
+  for(int i = 0; i < 100; i++)
+    v.push_back(i);
+
+  v.shrink(64); // не пустой - память остаётся
+  CHECK_EQ(v.capacity(), 128);
+
+  v.empty();
+  v.shrink(128); // ёмкость не больше порога - память остаётся
+  CHECK_EQ(v.capacity(), 128);
+
+  v.shrink(64);
+  CHECK_EQ(v.capacity(), 0);
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+static void testVectorCopy()
+{
+  Vector<TestItem> a;
+  fill(a, 5);
+
+  Vector<TestItem> b(a);
+  CHECK(b.pData() != a.pData());
+  b[0].value = 42;
+  CHECK_EQ(a[0].value, 0);
+
+  Vector<TestItem> c;
+  fill(c, 2);
+  c = a;
+  CHECK(c.pData() != a.pData());
+  CHECK_EQ(c.size(), 5);
+  CHECK_EQ(c[4].id, 4);
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+static void testFixedVectorCapacity()
+{
+  Host::ResetHeapStat();
+  {
+    FixedVector<TestItem, 4> v;
+    for(uint16_t i = 0; i < 4; i++)
+      CHECK(v.push_back(item(i)));
+
+    CHECK(v.full());
+    CHECK(!v.push_back(item(99))); // места нет - элемент не добавляется
+    CHECK_EQ(v.size(), 4);
+    CHECK_EQ(v.indexOf(item(99)), -1);
+    CHECK_EQ(v[3].id, 3);
+
+    v.pop();
+    CHECK(!v.full());
+    CHECK(v.push_back(item(7)));
+    CHECK_EQ(v[3].id, 7);
+
+    v.clear();
+    CHECK_EQ(v.size(), 0);
+    CHECK_EQ(v.capacity(), 4);
+  }
+  CHECK_EQ(Host::GetHeapStat()->Allocs, 0);
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+static void testPoolVectorRemove()
+{
+  PooledItems v;
+  checkRemove(v);
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+static void testPoolVectorNoHeap()
+{
+  Host::ResetHeapStat();
+  {
+    PooledItems v;
+    fill(v, TEST_POOL_BLOCKS * 2); // весь пул
+    CHECK(v.pooled());
+    CHECK_EQ(v.capacity(), TEST_POOL_BLOCKS * 2);
+    CHECK_EQ(TestPool.freeBlocks(), 0);
+    CHECK_EQ(v[TEST_POOL_BLOCKS * 2 - 1].id, TEST_POOL_BLOCKS * 2 - 1);
+
+    v.empty(); // память остаётся за вектором
+    CHECK_EQ(TestPool.freeBlocks(), 0);
+
+    v.shrink(4); // пустой и больше порога - блоки возвращаются в пул
+    CHECK_EQ(v.capacity(), 0);
+    CHECK_EQ(TestPool.freeBlocks(), TEST_POOL_BLOCKS);
+  }
+  CHECK_EQ(Host::GetHeapStat()->Allocs, 0);
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+static void testPoolVectorGrowsInPlace()
+{
+  PooledItems v;
+  v.push_back(item(0));
+  CHECK_EQ(v.capacity(), 2); // остаток блока - тоже вектору
+  TestItem* first = v.pData();
+
+  fill(v, 3); // блок за ним свободен - данные не переезжают
+  CHECK(v.pData() == first);
+  CHECK_EQ(v.capacity(), 4);
+  CHECK_EQ(v[0].id, 0);
+  CHECK_EQ(v[3].id, 2);
+
+  // за вектором занято - растёт через новую цепочку блоков
+  PooledItems other;
+  other.push_back(item(100));
+  fill(v, 1);
+  CHECK(v.pooled());
+  CHECK(v.pData() != first);
+  CHECK_EQ(v.capacity(), 8);
+  CHECK_EQ(v[3].id, 2);
+  CHECK_EQ(v[4].id, 0);
+  CHECK_EQ(other[0].id, 100);
+  CHECK_EQ(TestPool.freeBlocks(), TEST_POOL_BLOCKS - 5);
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+static void testPoolVectorHeapFallback()
+{
+  PooledItems a;
+  a.reserve(10); // пять блоков из восьми
+  fill(a, 10);
+
+  Host::ResetHeapStat();
+  {
+    PooledItems b;
+    b.reserve(6); // три оставшихся блока
+    fill(b, 6);
+    CHECK(b.pooled());
+    CHECK_EQ(Host::GetHeapStat()->Allocs, 0);
+
+    fill(b, 1);
+    CHECK(!b.pooled());
+    CHECK_EQ(Host::GetHeapStat()->Allocs, 1);
+    CHECK_EQ(TestPool.freeBlocks(), 3); // его блоки вернулись в пул
+    CHECK_EQ(b.size(), 7);
+    CHECK_EQ(b[5].id, 5);
+    CHECK_EQ(b[6].id, 0);
+  }
+  CHECK_EQ(Host::GetHeapStat()->Frees, 1);
+  CHECK_EQ(TestPool.freeBlocks(), 3);
+
+  a.clear();
+  CHECK_EQ(TestPool.freeBlocks(), TEST_POOL_BLOCKS);
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+int main()
+{
+  RUN_TEST(testVectorRemove);
+  RUN_TEST(testFixedVectorRemove);
+  RUN_TEST(testVectorIndexOfAndPop);
+  RUN_TEST(testVectorGrowth);
+  RUN_TEST(testVectorReserve);
+  RUN_TEST(testVectorEmptyKeepsMemory);
+  RUN_TEST(testVectorClearFreesMemory);
+  RUN_TEST(testVectorShrink);
+  RUN_TEST(testVectorCopy);
+  RUN_TEST(testFixedVectorCapacity);
+  RUN_TEST(testPoolVectorRemove);
+  RUN_TEST(testPoolVectorNoHeap);
+  RUN_TEST(testPoolVectorGrowsInPlace);
+  RUN_TEST(testPoolVectorHeapFallback);
+  return TestResult();
+}
+//--------------------------------------------------------------------------------------------------------------------------------
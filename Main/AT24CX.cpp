@@ -126,7 +126,7 @@ void AT24CX::write(unsigned int address, byte data) {
     	Wire.write(address & 0xFF);
       	Wire.write(data);
     	Wire.endTransmission();
-    	delay(10);
+    	waitReady();
     }
 }
 
@@ -239,10 +239,23 @@ void AT24CX::write(unsigned int address, byte *data, int offset, int n) {
     	byte *adr = data+offset;
     	Wire.write(adr, n);
     	Wire.endTransmission();
-    	delay(20);
+    	waitReady();
     }
 }
 
+/**
+ * Wait for the end of internal write cycle: the chip does not acknowledge
+ * its address until the cycle is done (ACK polling)
+ */
+void AT24CX::waitReady() {
+	unsigned long startedAt = millis();
+	do {
+		Wire.beginTransmission(_id);
+		if (Wire.endTransmission()==0)
+			return;
+	} while (millis() - startedAt < AT24CX_WRITE_CYCLE_TIMEOUT);
+}
+
 /**
  * Read byte
  */
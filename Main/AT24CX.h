@@ -38,6 +38,9 @@ typedef uint8_t byte;
 // 0x50
 #define AT24CX_ID B1010000
 
+// max time of internal write cycle, ms
+#define AT24CX_WRITE_CYCLE_TIMEOUT 20
+
 // general class definition
 class AT24CX {
 public:
@@ -62,6 +65,7 @@ protected:
 private:
 	void read(unsigned int address, byte *data, int offset, int n);
 	void write(unsigned int address, byte *data, int offset, int n);
+	void waitReady();
 	int _id;
 	byte _b[8];
 	byte _pageSize;
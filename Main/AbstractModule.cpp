@@ -108,6 +108,33 @@ WorkStatus::WorkStatus()
   memset(&UsedPins,0,sizeof(UsedPins));
 }
 //--------------------------------------------------------------------------------------------------------------------------------
+#if (defined(USE_MCP23S17_EXTENDER) && COUNT_OF_MCP23S17_EXTENDERS > 0) || (defined(USE_MCP23017_EXTENDER) && COUNT_OF_MCP23017_EXTENDERS > 0)
+static uint8_t mcpDirtyPorts(uint16_t wanted, uint16_t written)
+{
+  // какие порты надо переписать: бит 0 - порт A, бит 1 - порт B
+  uint16_t diff = wanted ^ written;
+  return ((diff & 0xFF) ? 1 : 0) | ((diff >> 8) ? 2 : 0);
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+static void mcpShadowInit(McpShadowRegisters* sh)
+{
+  // после инициализации все пины - входы, выходные защёлки - в нуле
+  sh->Mode = sh->WrittenMode = 0xFFFF;
+  sh->Latch = sh->WrittenLatch = 0;
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+static void mcpShadowWrite(McpShadowRegisters* sh, byte mpcChannel, byte level)
+{
+  if(mpcChannel > 15)
+    return;
+
+  if(level)
+    sh->Latch |= (1 << mpcChannel);
+  else
+    sh->Latch &= ~(1 << mpcChannel);
+}
+#endif
+//--------------------------------------------------------------------------------------------------------------------------------
 #if defined(USE_MCP23017_EXTENDER) && COUNT_OF_MCP23017_EXTENDERS > 0
 void WorkStatus::InitMcpI2CExtenders()
 {  
@@ -118,40 +145,51 @@ void WorkStatus::InitMcpI2CExtenders()
     Adafruit_MCP23017* bank = new Adafruit_MCP23017;
     
     bank->begin(mcp_addresses[i]);
+    bank->writePortAB(0,3); // защёлки могли остаться от предыдущего запуска - приводим их к теневым регистрам
     
     mcpI2CExtenders[i] = bank;
+    mcpShadowInit(&(mcpI2CShadows[i]));
   }  
 }
 //--------------------------------------------------------------------------------------------------------------------------------
-Adafruit_MCP23017* WorkStatus::GetMCP_I2C_ByAddress(byte addr)
+int8_t WorkStatus::GetMCP_I2C_Index(byte addr)
 {
   for(byte i=0;i<COUNT_OF_MCP23017_EXTENDERS;i++)
   {
-    Adafruit_MCP23017* bank = mcpI2CExtenders[i];
-    if(bank->getAddress() == addr)
-      return bank;
+    if(mcpI2CExtenders[i]->getAddress() == addr)
+      return i;
   }
 
-  return NULL;  
+  return -1;
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+Adafruit_MCP23017* WorkStatus::GetMCP_I2C_ByAddress(byte addr)
+{
+  int8_t idx = GetMCP_I2C_Index(addr);
+  return idx == -1 ? NULL : mcpI2CExtenders[idx];
 }
 //--------------------------------------------------------------------------------------------------------------------------------
 void WorkStatus::MCP_I2C_PinMode(byte mcpAddress, byte mpcChannel, byte mode)
 {
-  Adafruit_MCP23017* bank = GetMCP_I2C_ByAddress(mcpAddress);
-  if(!bank)
+  int8_t idx = GetMCP_I2C_Index(mcpAddress);
+  if(idx == -1 || mpcChannel > 15)
     return;
 
-  bank->pinMode(mpcChannel,mode);
+  McpShadowRegisters* sh = &(mcpI2CShadows[idx]);
+  if(mode == INPUT)
+    sh->Mode |= (1 << mpcChannel);
+  else
+    sh->Mode &= ~(1 << mpcChannel);
   
 }
 //--------------------------------------------------------------------------------------------------------------------------------
 void WorkStatus::MCP_I2C_PinWrite(byte mcpAddress, byte mpcChannel, byte level)
 {
-  Adafruit_MCP23017* bank = GetMCP_I2C_ByAddress(mcpAddress);
-  if(!bank)
+  int8_t idx = GetMCP_I2C_Index(mcpAddress);
+  if(idx == -1)
     return; 
 
-  bank->digitalWrite(mpcChannel,level);
+  mcpShadowWrite(&(mcpI2CShadows[idx]),mpcChannel,level);
 }
 
 #endif
@@ -164,43 +202,105 @@ void WorkStatus::InitMcpSPIExtenders()
   for(byte i=0;i<COUNT_OF_MCP23S17_EXTENDERS;i++)
   {
     MCP23S17* bank = new MCP23S17(&SPI,MCP23S17_CS_PIN,mcp_addresses[i]);
-    bank->begin();
+    bank->begin(); // пишет в микросхему все регистры: пины - входы, защёлки - в нуле
     mcpSPIExtenders[i] = bank;
+    mcpShadowInit(&(mcpSPIShadows[i]));
   }
 }
 //--------------------------------------------------------------------------------------------------------------------------------
 void WorkStatus::MCP_SPI_PinMode(byte mcpAddress, byte mpcChannel, byte mode)
 {
-  MCP23S17* bank = GetMCP_SPI_ByAddress(mcpAddress);
-  if(!bank)
+  int8_t idx = GetMCP_SPI_Index(mcpAddress);
+  if(idx == -1 || mpcChannel > 15)
+    return;
+
+  McpShadowRegisters* sh = &(mcpSPIShadows[idx]);
+
+  if(mode == OUTPUT)
+  {
+    sh->Mode &= ~(1 << mpcChannel);
     return;
+  }
 
-  bank->pinMode(mpcChannel,mode);
+  // вход: подтяжку библиотека пишет сразу, вместе с направлением
+  mcpSPIExtenders[idx]->pinMode(mpcChannel,mode);
+  sh->Mode |= (1 << mpcChannel);
+  sh->WrittenMode |= (1 << mpcChannel);
   
 }
 //--------------------------------------------------------------------------------------------------------------------------------
 void WorkStatus::MCP_SPI_PinWrite(byte mcpAddress, byte mpcChannel, byte level)
 {
-  MCP23S17* bank = GetMCP_SPI_ByAddress(mcpAddress);
-  if(!bank)
+  int8_t idx = GetMCP_SPI_Index(mcpAddress);
+  if(idx == -1)
     return;  
 
-  bank->digitalWrite(mpcChannel,level);
+  mcpShadowWrite(&(mcpSPIShadows[idx]),mpcChannel,level);
 }
 //--------------------------------------------------------------------------------------------------------------------------------
-MCP23S17* WorkStatus::GetMCP_SPI_ByAddress(byte addr)
+int8_t WorkStatus::GetMCP_SPI_Index(byte addr)
 {
   for(byte i=0;i<COUNT_OF_MCP23S17_EXTENDERS;i++)
   {
-    MCP23S17* bank = mcpSPIExtenders[i];
-    if(bank->getAddress() == addr)
-      return bank;
+    if(mcpSPIExtenders[i]->getAddress() == addr)
+      return i;
   }
 
-  return NULL;
+  return -1;
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+MCP23S17* WorkStatus::GetMCP_SPI_ByAddress(byte addr)
+{
+  int8_t idx = GetMCP_SPI_Index(addr);
+  return idx == -1 ? NULL : mcpSPIExtenders[idx];
 }
 #endif
 //--------------------------------------------------------------------------------------------------------------------------------
+void WorkStatus::McpFlush()
+{
+  // сначала пишем защёлки, потом направление - тогда пин, переключаемый на выход, сразу выдаёт нужный уровень
+  
+#if defined(USE_MCP23S17_EXTENDER) && COUNT_OF_MCP23S17_EXTENDERS > 0
+  for(byte i=0;i<COUNT_OF_MCP23S17_EXTENDERS;i++)
+  {
+    McpShadowRegisters* sh = &(mcpSPIShadows[i]);
+    uint8_t ports = mcpDirtyPorts(sh->Latch,sh->WrittenLatch);
+    if(ports)
+    {
+      mcpSPIExtenders[i]->writePortAB(sh->Latch,ports);
+      sh->WrittenLatch = sh->Latch;
+    }
+
+    ports = mcpDirtyPorts(sh->Mode,sh->WrittenMode);
+    if(ports)
+    {
+      mcpSPIExtenders[i]->writeModeAB(sh->Mode,ports);
+      sh->WrittenMode = sh->Mode;
+    }
+  } // for
+#endif
+
+#if defined(USE_MCP23017_EXTENDER) && COUNT_OF_MCP23017_EXTENDERS > 0
+  for(byte i=0;i<COUNT_OF_MCP23017_EXTENDERS;i++)
+  {
+    McpShadowRegisters* sh = &(mcpI2CShadows[i]);
+    uint8_t ports = mcpDirtyPorts(sh->Latch,sh->WrittenLatch);
+    if(ports)
+    {
+      mcpI2CExtenders[i]->writePortAB(sh->Latch,ports);
+      sh->WrittenLatch = sh->Latch;
+    }
+
+    ports = mcpDirtyPorts(sh->Mode,sh->WrittenMode);
+    if(ports)
+    {
+      mcpI2CExtenders[i]->writeModeAB(sh->Mode,ports);
+      sh->WrittenMode = sh->Mode;
+    }
+  } // for
+#endif
+}
+//--------------------------------------------------------------------------------------------------------------------------------
 void WorkStatus::PinMode(byte pinNumber,byte mode, bool setMode)
 {
 
@@ -420,7 +520,7 @@ const char* WorkStatus::ToHex(int i)
   return WORK_STATUS_HEX_HOLDER;
 }
 //--------------------------------------------------------------------------------------------------------------------------------
-void WorkStatus::WriteStatus(Stream* pStream, bool bAsTextHex)
+void WorkStatus::WriteStatus(Print* pStream, bool bAsTextHex)
 {
   if(!pStream)
     return;
@@ -448,8 +548,8 @@ void OneState::Update(void* newData) // обновляем внутреннее
       case StateSoilMoisture: // и для влажности почвы используем структуру температуры
       case StatePH: // и для pH  используем структуру температуры
       {
-        Temperature* t1 = (Temperature*) Data;
-        Temperature* t2 = (Temperature*) PreviousData;
+        Temperature* t1 = (Temperature*) &Data;
+        Temperature* t2 = (Temperature*) &PreviousData;
 
         *t2 = *t1; // сохраняем предыдущую температуру
 
@@ -470,12 +570,12 @@ void OneState::Update(void* newData) // обновляем внутреннее
 
       case StateLuminosity:
       {
-        long*  ui1 = (long*) Data;
-        long*  ui2 = (long*) PreviousData;
+        int32_t*  ui1 = (int32_t*) &Data;
+        int32_t*  ui2 = (int32_t*) &PreviousData;
 
         *ui2 = *ui1; // сохраняем предыдущее состояние освещенности
 
-        long* newState = (long*) newData;
+        int32_t* newState = (int32_t*) newData;
         *ui1 = *newState; // пишем новое состояние освещенности
       } 
       break;
@@ -483,12 +583,12 @@ void OneState::Update(void* newData) // обновляем внутреннее
       case StateWaterFlowInstant: // работаем с датчиками расхода воды
       case StateWaterFlowIncremental:
       {
-        unsigned long*  ui1 = (unsigned long*) Data;
-        unsigned long*  ui2 = (unsigned long*) PreviousData;
+        uint32_t*  ui1 = (uint32_t*) &Data;
+        uint32_t*  ui2 = (uint32_t*) &PreviousData;
 
         *ui2 = *ui1; // сохраняем предыдущее состояние расхода воды
 
-        unsigned long* newState = (unsigned long*) newData;
+        uint32_t* newState = (uint32_t*) newData;
         *ui1 = *newState; // пишем новое состояние расхода воды
         
       }
@@ -498,6 +598,9 @@ void OneState::Update(void* newData) // обновляем внутреннее
       break;
       
     } // switch
+
+    if(IsChanged())
+      Version++;
  
 }
 //--------------------------------------------------------------------------------------------------------------------------------
@@ -505,6 +608,9 @@ void OneState::Init(ModuleStates state, uint8_t idx)
 {
     Type = state;
     Index = idx;
+    Version = 0;
+    Data = 0;
+    PreviousData = 0;
 
     switch(state)
     {
@@ -513,46 +619,23 @@ void OneState::Init(ModuleStates state, uint8_t idx)
       case StateSoilMoisture: // и для влажности почвы используем структуру температуры
       case StatePH: // и для pH  используем структуру температуры
       {
-      
-        Temperature* t1 = new Temperature;
-        Temperature* t2 = new Temperature;
-        
-        Data = t1;
-        PreviousData = t2;
+        Temperature t; // копируем через memcpy: Data - uint32_t, обращение к нему как к Temperature нарушает strict aliasing
+        memcpy(&Data,&t,sizeof(t));
+        memcpy(&PreviousData,&t,sizeof(t));
       }
-        
       break;
 
       case StateLuminosity:
       {
-        long*  ui1 = new long;
-        long*  ui2 = new long;
-
-        *ui1 = NO_LUMINOSITY_DATA; // нет данных об освещенности
-        *ui2 = NO_LUMINOSITY_DATA;
-        
-        Data = ui1;
-        PreviousData = ui2;
+        *((int32_t*) &Data) = NO_LUMINOSITY_DATA; // нет данных об освещенности
+        *((int32_t*) &PreviousData) = NO_LUMINOSITY_DATA;
       }
       break;
 
       case StateWaterFlowInstant:
       case StateWaterFlowIncremental:
-      {
-        unsigned long*  ui1 = new unsigned long;
-        unsigned long*  ui2 = new unsigned long;
-
-        *ui1 = 0; // нет данных о расходе воды
-        *ui2 = 0;
-        
-        Data = ui1;
-        PreviousData = ui2;
-        
-      }
-      break;
-
       case StateUnknown:
-      break;
+      break; // нет данных о расходе воды - нули
     } // switch
   
 }
@@ -567,20 +650,20 @@ OneState::operator String() // выводим текущие значения к
       case StatePH: // и для pH  используем структуру температуры
       {
       
-        Temperature* t1 = (Temperature*) Data;
+        Temperature* t1 = (Temperature*) &Data;
         return *t1;
       }
         
       case StateLuminosity:
       {
-        long*  ul1 = (long*) Data;
+        int32_t*  ul1 = (int32_t*) &Data;
         return String(*ul1);
       }
 
       case StateWaterFlowInstant:
       case StateWaterFlowIncremental:
       {
-        unsigned long*  ul1 = (unsigned long*) Data;
+        uint32_t*  ul1 = (uint32_t*) &Data;
         return String(*ul1);        
       }
 
@@ -609,11 +692,11 @@ OneState& OneState::operator=(const OneState& rhs)
         case StateSoilMoisture: // и для влажности почвы используем структуру температуры
         case StatePH: // и для pH  используем структуру температуры
         {
-          Temperature* rhs_t1 = (Temperature*) rhs.Data;
-          Temperature* rhs_t2 = (Temperature*) rhs.PreviousData;
+          Temperature* rhs_t1 = (Temperature*) &rhs.Data;
+          Temperature* rhs_t2 = (Temperature*) &rhs.PreviousData;
 
-          Temperature* this_t1 = (Temperature*) Data;
-          Temperature* this_t2 = (Temperature*) PreviousData;
+          Temperature* this_t1 = (Temperature*) &Data;
+          Temperature* this_t2 = (Temperature*) &PreviousData;
 
           *this_t1 = *rhs_t1;
           *this_t2 = *rhs_t2;
@@ -623,11 +706,11 @@ OneState& OneState::operator=(const OneState& rhs)
 
         case StateLuminosity:
         {
-          long*  rhs_ui1 = (long*) rhs.Data;
-          long*  rhs_ui2 = (long*) rhs.PreviousData;
+          int32_t*  rhs_ui1 = (int32_t*) &rhs.Data;
+          int32_t*  rhs_ui2 = (int32_t*) &rhs.PreviousData;
   
-          long*  this_ui1 = (long*) Data;
-          long*  this_ui2 = (long*) PreviousData;
+          int32_t*  this_ui1 = (int32_t*) &Data;
+          int32_t*  this_ui2 = (int32_t*) &PreviousData;
 
           *this_ui1 = *rhs_ui1;
           *this_ui2 = *rhs_ui2;
@@ -637,11 +720,11 @@ OneState& OneState::operator=(const OneState& rhs)
         case StateWaterFlowInstant:
         case StateWaterFlowIncremental:
         {
-          unsigned long*  rhs_ui1 = (unsigned long*) rhs.Data;
-          unsigned long*  rhs_ui2 = (unsigned long*) rhs.PreviousData;
+          uint32_t*  rhs_ui1 = (uint32_t*) &rhs.Data;
+          uint32_t*  rhs_ui2 = (uint32_t*) &rhs.PreviousData;
   
-          unsigned long*  this_ui1 = (unsigned long*) Data;
-          unsigned long*  this_ui2 = (unsigned long*) PreviousData;
+          uint32_t*  this_ui1 = (uint32_t*) &Data;
+          uint32_t*  this_ui2 = (uint32_t*) &PreviousData;
 
           *this_ui1 = *rhs_ui1;
           *this_ui2 = *rhs_ui2;
@@ -653,6 +736,7 @@ OneState& OneState::operator=(const OneState& rhs)
       
       } // switch
   
+      Version++; // данные скопированы целиком, считаем их изменившимися
 
   return *this;
 }
@@ -666,8 +750,8 @@ bool OneState::IsChanged()
         case StateSoilMoisture: // и для влажности почвы используем структуру температуры
         case StatePH: // и для pH  используем структуру температуры
         {
-          Temperature* t1 = (Temperature*) Data;
-          Temperature* t2 = (Temperature*) PreviousData;
+          Temperature* t1 = (Temperature*) &Data;
+          Temperature* t2 = (Temperature*) &PreviousData;
 
           if(*t1 != *t2)
             return true; // температура изменилась
@@ -677,8 +761,8 @@ bool OneState::IsChanged()
 
         case StateLuminosity:
         {
-          long*  ui1 = (long*) Data;
-          long*  ui2 = (long*) PreviousData;
+          int32_t*  ui1 = (int32_t*) &Data;
+          int32_t*  ui2 = (int32_t*) &PreviousData;
   
          if(*ui1 != *ui2)
           return true; // состояние освещенности изменилось
@@ -688,8 +772,8 @@ bool OneState::IsChanged()
         case StateWaterFlowInstant:
         case StateWaterFlowIncremental:
         {
-          unsigned long*  ui1 = (unsigned long*) Data;
-          unsigned long*  ui2 = (unsigned long*) PreviousData;
+          uint32_t*  ui1 = (uint32_t*) &Data;
+          uint32_t*  ui2 = (uint32_t*) &PreviousData;
   
          if(*ui1 != *ui2)
           return true; // состояние освещенности изменилось
@@ -757,13 +841,13 @@ bool OneState::HasData()
     case StatePH:
     case StateSoilMoisture:
     {
-      Temperature* t = (Temperature*) Data;
+      Temperature* t = (Temperature*) &Data;
       return t->HasData();
     }
 
     case StateLuminosity:
     {
-      long*  ui1 = (long*) Data;
+      int32_t*  ui1 = (int32_t*) &Data;
       return *ui1 != NO_LUMINOSITY_DATA;
     }
 
@@ -788,7 +872,7 @@ uint8_t OneState::GetRawData(byte* outBuffer)
     case StateHumidity:
     case StateSoilMoisture:
     {
-        Temperature* t = (Temperature*) Data;
+        Temperature* t = (Temperature*) &Data;
         *outBuffer++ = t->Fract;
         *outBuffer = t->Value;
       return 2;
@@ -796,7 +880,7 @@ uint8_t OneState::GetRawData(byte* outBuffer)
 
     case StatePH: // для датчика pH мы теперь возвращаем ещё и подсчитанный вольтаж во вторых двух байтах
     {
-        Temperature* t = (Temperature*) Data;
+        Temperature* t = (Temperature*) &Data;
 
         uint16_t phMV = 0;
         unsigned long curPH = 0;
@@ -832,7 +916,7 @@ uint8_t OneState::GetRawData(byte* outBuffer)
     // для освещённости пишем два байта в сырые данные
     case StateLuminosity:
     {
-      long* lum = (long*) Data;
+      int32_t* lum = (int32_t*) &Data;
       memcpy(outBuffer,lum,2);
       return 2;
     }
@@ -840,9 +924,9 @@ uint8_t OneState::GetRawData(byte* outBuffer)
     case StateWaterFlowInstant:
     case StateWaterFlowIncremental:
     {
-      unsigned long* flow = (unsigned long*) Data;
-      memcpy(outBuffer,flow,sizeof(unsigned long));
-      return sizeof(unsigned long);
+      uint32_t* flow = (uint32_t*) &Data;
+      memcpy(outBuffer,flow,sizeof(uint32_t));
+      return sizeof(uint32_t);
     }
     
     
@@ -908,52 +992,11 @@ ModuleStates OneState::GetType(const char* stringType)
   return StateUnknown;
 }
 //--------------------------------------------------------------------------------------------------------------------------------
-OneState::~OneState()
+static Temperature dataToTemperature(const uint32_t& data)
 {
-  // подчищаем за собой
-  
-       switch(Type)
-      {
-        case StateTemperature:
-        case StateHumidity: // и для влажности используем структуру температуры
-        case StateSoilMoisture: // и для влажности почвы используем структуру температуры
-        case StatePH: // и для pH  используем структуру температуры
-        {
-          Temperature* t1 = (Temperature*) Data;
-          Temperature* t2 = (Temperature*) PreviousData;
-
-          delete t1;
-          delete t2;
-        }
-        break;
-
-        case StateLuminosity:
-        {
-          long*  ui1 = (long*) Data;
-          long*  ui2 = (long*) PreviousData;
-  
-          delete ui1;
-          delete ui2;
-        }  
-        break;
-
-        case StateWaterFlowInstant:
-        case StateWaterFlowIncremental:
-        {
-          unsigned long*  ui1 = (unsigned long*) Data;
-          unsigned long*  ui2 = (unsigned long*) PreviousData;
-  
-          delete ui1;
-          delete ui2;
-        }  
-        break;
-
-        case StateUnknown:
-        break;
-      
-      } // switch
- 
-  
+  // данные лежат в uint32_t, байтами к ним обращаться можно - без нарушения strict aliasing
+  const uint8_t* b = (const uint8_t*) &data;
+  return Temperature((int8_t) b[0],b[1]);
 }
 //--------------------------------------------------------------------------------------------------------------------------------
 OneState::operator HumidityPair()
@@ -963,7 +1006,7 @@ OneState::operator HumidityPair()
     return HumidityPair(Humidity(),Humidity()); // undefined behaviour
   }
 
-    return HumidityPair(*((Humidity*)PreviousData),*((Humidity*)Data));  
+    return HumidityPair(dataToTemperature(PreviousData),dataToTemperature(Data));  
 }
 //--------------------------------------------------------------------------------------------------------------------------------
 OneState::operator TemperaturePair()
@@ -973,7 +1016,7 @@ OneState::operator TemperaturePair()
     return TemperaturePair(Temperature(),Temperature()); // undefined behaviour
   }
 
-    return TemperaturePair(*((Temperature*)PreviousData),*((Temperature*)Data));
+    return TemperaturePair(dataToTemperature(PreviousData),dataToTemperature(Data));
 }
 //--------------------------------------------------------------------------------------------------------------------------------
 OneState::operator LuminosityPair()
@@ -982,7 +1025,7 @@ OneState::operator LuminosityPair()
   {
     return LuminosityPair(0,0); // undefined behaviour
   }
-  return LuminosityPair(*((long*)PreviousData),*((long*)Data));   
+  return LuminosityPair(*((int32_t*) &PreviousData),*((int32_t*) &Data));   
 }
 //--------------------------------------------------------------------------------------------------------------------------------
 OneState::operator WaterFlowPair()
@@ -991,12 +1034,12 @@ OneState::operator WaterFlowPair()
   {
     return WaterFlowPair(0,0); // undefined behaviour
   }
-  return WaterFlowPair(*((unsigned long*)PreviousData),*((unsigned long*)Data));   
+  return WaterFlowPair(*((uint32_t*) &PreviousData),*((uint32_t*) &Data));   
 }
 //--------------------------------------------------------------------------------------------------------------------------------
 OneState operator-(const OneState& left, const OneState& right)
 {
-  OneState result(left.Type,left.Index); // инициализируем
+  OneState result((ModuleStates) left.Type,left.Index); // инициализируем
 
   if(left.Type != right.Type)
   {
@@ -1010,18 +1053,18 @@ OneState operator-(const OneState& left, const OneState& right)
         case StateSoilMoisture: // и для влажности почвы используем структуру температуры
         case StatePH: // и для pH  используем структуру температуры
         {
-          Temperature* t1 = (Temperature*) left.Data;
-          Temperature* t2 = (Temperature*) right.Data;
+          Temperature* t1 = (Temperature*) &left.Data;
+          Temperature* t2 = (Temperature*) &right.Data;
 
 
-          Temperature* thisT = (Temperature*) result.Data;
+          Temperature* thisT = (Temperature*) &result.Data;
           if(t1->Value != NO_TEMPERATURE_DATA && t2->Value != NO_TEMPERATURE_DATA) // только если есть показания с датчиков
               *thisT = (*t1 - *t2); // получаем дельту текущих изменений
           
-          t1 = (Temperature*) left.PreviousData;
-          t2 = (Temperature*) right.PreviousData;
+          t1 = (Temperature*) &left.PreviousData;
+          t2 = (Temperature*) &right.PreviousData;
 
-          thisT = (Temperature*) result.PreviousData;
+          thisT = (Temperature*) &result.PreviousData;
           if(t1->Value != NO_TEMPERATURE_DATA && t2->Value != NO_TEMPERATURE_DATA) // только если есть показания с датчиков
               *thisT = (*t1 - *t2); // получаем дельту предыдущих изменений
         
@@ -1030,19 +1073,19 @@ OneState operator-(const OneState& left, const OneState& right)
 
         case StateLuminosity:
         {
-          long*  ui1 = (long*) left.Data;
-          long*  ui2 = (long*) right.Data;
+          int32_t*  ui1 = (int32_t*) &left.Data;
+          int32_t*  ui2 = (int32_t*) &right.Data;
 
-          long* thisLong = (long*) result.Data;
+          int32_t* thisLong = (int32_t*) &result.Data;
 
           // получаем дельту текущих изменений
           if(*ui1 != NO_LUMINOSITY_DATA && *ui2 != NO_LUMINOSITY_DATA) // только если есть показания с датчиков
             *thisLong = abs((*ui1 - *ui2));
 
-          ui1 = (long*) left.PreviousData;
-          ui2 = (long*) right.PreviousData;
+          ui1 = (int32_t*) &left.PreviousData;
+          ui2 = (int32_t*) &right.PreviousData;
 
-          thisLong = (long*) result.PreviousData;
+          thisLong = (int32_t*) &result.PreviousData;
 
           // получаем дельту предыдущих изменений
           if(*ui1 != NO_LUMINOSITY_DATA && *ui2 != NO_LUMINOSITY_DATA) // только если есть показания с датчиков
@@ -1053,18 +1096,18 @@ OneState operator-(const OneState& left, const OneState& right)
         case StateWaterFlowInstant:
         case StateWaterFlowIncremental:
         {
-          unsigned long*  ui1 = (unsigned long*) left.Data;
-          unsigned long*  ui2 = (unsigned long*) right.Data;
+          uint32_t*  ui1 = (uint32_t*) &left.Data;
+          uint32_t*  ui2 = (uint32_t*) &right.Data;
 
-          unsigned long* thisUi = (unsigned long*) result.Data;
+          uint32_t* thisUi = (uint32_t*) &result.Data;
 
           // получаем дельту текущих изменений
           *thisUi = abs((*ui1 - *ui2));
 
-          ui1 = (unsigned long*) left.PreviousData;
-          ui2 = (unsigned long*) right.PreviousData;
+          ui1 = (uint32_t*) &left.PreviousData;
+          ui2 = (uint32_t*) &right.PreviousData;
 
-          thisUi = (unsigned long*) result.PreviousData;
+          thisUi = (uint32_t*) &result.PreviousData;
 
           // получаем дельту предыдущих изменений
           *thisUi = abs((*ui1 - *ui2));
@@ -1124,9 +1167,64 @@ Temperature operator-(const Temperature& left, const Temperature& right)
     return Temperature(res/100, res%100); // дельта у нас всегда положительная.
 }
 //--------------------------------------------------------------------------------------------------------------------------------
-ModuleState::ModuleState() : supportedStates(0)
+uint16_t ModuleState::layoutVersion = 0;
+ModuleState* ModuleState::firstState = NULL;
+uint8_t ModuleState::usedSlots = 0;
+//--------------------------------------------------------------------------------------------------------------------------------
+// общая таблица состояний всех модулей; состояния в ней - простые структуры, инициализируются через OneState::Init
+static uint32_t statesTable[(MAX_MODULE_STATES*sizeof(OneState) + sizeof(uint32_t) - 1)/sizeof(uint32_t)];
+#define STATES_TABLE ((OneState*) statesTable)
+//--------------------------------------------------------------------------------------------------------------------------------
+ModuleState::ModuleState() : states(NULL), statesCount(0), supportedStates(0)
 {
-  
+  // модули - глобальные объекты, поэтому список строится ещё до setup
+  nextState = firstState;
+  firstState = this;
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+ModuleState::~ModuleState()
+{
+  // освобождаем свой участок таблицы и выходим из списка
+  if(statesCount)
+  {
+    OneState* tail = states + statesCount;
+    moveSlots(states,tail,usedSlots - (tail - STATES_TABLE));
+    shiftOthers(this,tail,-statesCount);
+    usedSlots -= statesCount;
+    layoutVersion++;
+  }
+
+  ModuleState** pp = &firstState;
+  while(*pp && *pp != this)
+    pp = &((*pp)->nextState);
+
+  if(*pp)
+    *pp = nextState;
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+void ModuleState::moveSlots(OneState* dest, const OneState* src, uint8_t count)
+{
+  // слоты перекрываются - копируем с того конца, который не затрёт ещё не скопированное
+  if(dest < src)
+  {
+    for(uint8_t i=0;i<count;i++)
+      dest[i].CopySlot(src[i]);
+  }
+  else
+  {
+    while(count--)
+      dest[count].CopySlot(src[count]);
+  }
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+void ModuleState::shiftOthers(ModuleState* owner, OneState* from, int16_t delta)
+{
+  // участки модулей, лежащие за изменённым местом таблицы, переехали вместе с хвостом таблицы
+  for(ModuleState* ms = firstState; ms; ms = ms->nextState)
+  {
+    if(ms != owner && ms->statesCount && ms->states >= from)
+      ms->states += delta;
+  }
 }
 //--------------------------------------------------------------------------------------------------------------------------------
 bool ModuleState::HasState(ModuleStates state)
@@ -1134,55 +1232,102 @@ bool ModuleState::HasState(ModuleStates state)
   return ( (supportedStates & state) == state);
 }
 //--------------------------------------------------------------------------------------------------------------------------------
-void ModuleState::RemoveState(ModuleStates state, uint8_t idx)
+bool ModuleState::getGroup(ModuleStates state, uint8_t& first, uint8_t& count)
 {
-  size_t cnt = states.size();
-  for(size_t i=0;i<cnt;i++)
+  if(!(supportedStates & state))
+    return false;
+    
+  // ищем первое состояние нужного типа
+  uint8_t lo = 0, hi = statesCount;
+  while(lo < hi)
   {
-    OneState* os = states[i];
-    if(os->GetType() == state && os->GetIndex() == idx)
-    {
-      // нашли нужное состояние, удаляем его
-      delete os;
-      // теперь сдвигаем на пустое место
-      size_t wIdx = i;
-      while(wIdx < cnt-1)
-      {
-       states[wIdx] = states[wIdx+1]; 
-       wIdx++;
-      } // while
-      // удаляем последний элемент (по сути, внутри вектора просто сдвинется указатель записи, и всё).
-      states.pop();
-
-      break; // выходим из цикла
-    } // if
-  } // for
+    uint8_t mid = (lo + hi)/2;
+    if(states[mid].Type < state)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+  first = lo;
+
+  // и первое состояние следующего типа
+  hi = statesCount;
+  while(lo < hi)
+  {
+    uint8_t mid = (lo + hi)/2;
+    if(states[mid].Type <= state)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+  count = lo - first;
+
+  return count > 0;
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+void ModuleState::RemoveState(ModuleStates state, uint8_t idx)
+{
+  OneState* os = GetState(state,idx);
+  if(!os)
+    return;
+
+  // нашли нужное состояние, сдвигаем на его место весь хвост таблицы, вместе с участками других модулей
+  moveSlots(os,os + 1,usedSlots - (os + 1 - STATES_TABLE));
+  shiftOthers(this,os + 1,-1);
+  usedSlots--;
+  statesCount--;
+  layoutVersion++;
+
+  if(!statesCount)
+    states = NULL;
 
   // теперь проверяем - если больше нет такого состояния - обнуляем его флаг.
-  if(!HasState(state)) // нет такого состояния
-    supportedStates &= ~state; // инвертируем все биты в state, кроме выставленного, и применяем эту маску к supportedStates. 
-    // В результате в supportedStates очистятся только те биты, которые были выставлены в state.
+  if(!GetStateCount(state))
+    supportedStates &= ~state; 
 }
 //--------------------------------------------------------------------------------------------------------------------------------
 OneState* ModuleState::AddState(ModuleStates state, uint8_t idx)
 {
+    if(usedSlots >= MAX_MODULE_STATES) // таблица состояний заполнена, см. MAX_MODULE_STATES
+    {
+      // датчик пропадёт из отчётов, тревог и дельт - сообщаем об этом один раз, при первом не влезшем состоянии
+      static bool overflowReported = false;
+      if(!overflowReported)
+      {
+        overflowReported = true;
+        Serial.println(F("STATES TABLE IS FULL, INCREASE MAX_MODULE_STATES!"));
+      }
+      return NULL;
+    }
+
+    if(!statesCount) // первое состояние модуля - его участок начинается в конце таблицы
+      states = STATES_TABLE + usedSlots;
+      
+    // новое состояние встаёт в конец группы своего типа
+    uint8_t pos = 0;
+    while(pos < statesCount && states[pos].Type <= state)
+      pos++;
+
+    // освобождаем под него слот, сдвигая хвост таблицы вместе с участками других модулей
+    OneState* slot = states + pos;
+    moveSlots(slot + 1,slot,usedSlots - (slot - STATES_TABLE));
+    shiftOthers(this,slot,1);
+    usedSlots++;
+    statesCount++;
+
+    slot->Init(state,idx);
+    
     supportedStates |= state;
-    OneState* s = new OneState(state,idx);
-    states.push_back(s); // сохраняем состояние
+    layoutVersion++;
     
-    return s;
+    return &states[pos];
 }
 //--------------------------------------------------------------------------------------------------------------------------------
 bool ModuleState::HasChanges()
 {
-  size_t sz = states.size();
-  for(size_t i=0;i<sz;i++)
+  for(uint8_t i=0;i<statesCount;i++)
   {
-      OneState* s = states[i];
-
-      if(s->IsChanged())
+      if(states[i].IsChanged())
         return true;
-
   } // for
 
   return false;
@@ -1191,60 +1336,47 @@ bool ModuleState::HasChanges()
 //--------------------------------------------------------------------------------------------------------------------------------
 void ModuleState::UpdateState(ModuleStates state, uint8_t idx, void* newData)
 {
-  size_t sz = states.size();
-  for(size_t i=0;i<sz;i++)
-  {
-      OneState* s = states[i];
-      if(s->GetType() == state && s->GetIndex() == idx)
-      {
-        s->Update(newData);
-        return;
-      } // if
-  } // for
+  OneState* s = GetState(state,idx);
+  if(s)
+    s->Update(newData);
 }
 //--------------------------------------------------------------------------------------------------------------------------------
 uint8_t ModuleState::GetStateCount(ModuleStates state)
 {
-  uint8_t result = 0;
-  size_t sz = states.size();
+  uint8_t first, count;
+  if(!getGroup(state,first,count))
+    return 0;
   
-  for(size_t i=0;i<sz;i++)
-  {
-      OneState* s = states[i];
-      if(s->GetType() == state)
-        result++;
-  }
-  
-  return result;
+  return count;
 }
 //--------------------------------------------------------------------------------------------------------------------------------
 OneState* ModuleState::GetStateByOrder(ModuleStates state, uint8_t orderNum)
 {
-  size_t sz = states.size();
-  uint8_t cntr = 0;
-  for(size_t i=0;i<sz;i++)
-  {
-      OneState* s = states[i];
-      if(s->GetType() == state)
-      {
-        if(cntr == orderNum)
-          return s;
-
-          cntr++;
-      }
-  }
+  uint8_t first, count;
+  if(!getGroup(state,first,count) || orderNum >= count)
+    return NULL;
 
-    return NULL;  
+  return &states[first + orderNum];
 }
 //--------------------------------------------------------------------------------------------------------------------------------
 OneState* ModuleState::GetState(ModuleStates state, uint8_t idx)
 {
-  size_t sz = states.size();
-  for(size_t i=0;i<sz;i++)
+  uint8_t first, count;
+  if(!getGroup(state,first,count))
+    return NULL;
+
+  OneState* group = &states[first];
+
+  // сначала пробуем прямое смещение от индекса первого датчика группы
+  uint8_t slot = idx - group[0].Index;
+  if(slot < count && group[slot].Index == idx)
+    return &group[slot];
+
+  // индексы идут с пропусками, ищем перебором
+  for(uint8_t i=0;i<count;i++)
   {
-      OneState* s = states[i];
-      if(s->GetType() == state && s->GetIndex() == idx)
-        return s;
+      if(group[i].Index == idx)
+        return &group[i];
   }
 
     return NULL;
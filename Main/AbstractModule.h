@@ -196,11 +196,16 @@ struct WaterFlowPair
 //--------------------------------------------------------------------------------------------------------------------------------
 class OneState
 {
-    ModuleStates Type; // тип состояния (температура, освещенность, каналы реле)
+    friend class ModuleState;
     
+    uint8_t Type; // тип состояния (температура, освещенность, каналы реле), из перечисления ModuleStates
     uint8_t Index; // индекс (например, датчика температуры)
-    void* Data; // данные с датчика
-    void* PreviousData; // предыдущие данные с датчика
+    uint8_t Version; // счётчик изменений показаний, увеличивается при каждом реальном изменении данных
+
+    // данные хранятся прямо в состоянии, без отдельных блоков в куче: 4 байта вмещают любой из типов показаний
+    // (Temperature, long, unsigned long)
+    uint32_t Data; // данные с датчика
+    uint32_t PreviousData; // предыдущие данные с датчика
 
     public:
 
@@ -211,7 +216,9 @@ class OneState
     String GetUnit(); // возвращает единицы измерения состояния в виде строки
 
     uint8_t GetIndex() {return Index;}
-    ModuleStates GetType() {return Type;}
+    ModuleStates GetType() {return (ModuleStates) Type;}
+    uint8_t GetVersion() {return Version;} // по смене версии можно понять, что показания изменились, не сравнивая их
+    const void* GetCurrentData() {return &Data;} // текущие показания без копирования в пару (Temperature/Humidity или long - по типу состояния)
     
     void Update(void* newData); // обновляет состояние
     bool IsChanged(); // тестирует, есть ли изменения
@@ -232,30 +239,56 @@ class OneState
     {
       Init(s,idx);
     }
-    ~OneState();
 
     private:
 
     OneState();
     OneState(const OneState& rhs);
     void Init(ModuleStates type, uint8_t idx); // инициализирует состояние
+    void CopySlot(const OneState& rhs) // копирует слот таблицы целиком, с типом и индексом - при сдвиге участков таблицы
+    {
+      Type = rhs.Type;
+      Index = rhs.Index;
+      Version = rhs.Version;
+      Data = rhs.Data;
+      PreviousData = rhs.PreviousData;
+    }
     
 };
 //--------------------------------------------------------------------------------------------------------------------------------
-typedef Vector<OneState*> StateVec;
+// состояния всех модулей лежат в одной статической таблице на MAX_MODULE_STATES слотов, у каждого модуля - свой непрерывный
+// участок. Внутри участка состояния сгруппированы по возрастанию типа, внутри группы - в порядке добавления.
+// Группа типа ищется двоичным поиском, датчик в группе - по смещению его индекса от индекса первого датчика
+// (датчики обычно регистрируются подряд), и только если индексы идут с пропусками - перебором группы.
 //--------------------------------------------------------------------------------------------------------------------------------
 class ModuleState
 {
+ OneState* states; // состояния модуля - участок общей таблицы
+ uint8_t statesCount; // кол-во состояний
  uint8_t supportedStates; // какие состояния поддерживаем?
- StateVec states; // какие состояния поддерживаем?
+
+ ModuleState* nextState; // следующий в списке всех состояний модулей, нужен для сдвига их участков таблицы
+ static ModuleState* firstState;
+ static uint8_t usedSlots; // сколько слотов общей таблицы занято
+
+ static uint16_t layoutVersion; // увеличивается при добавлении/удалении состояний в любом модуле
+ static void shiftOthers(ModuleState* owner, OneState* from, int16_t delta); // сдвигает участки модулей, лежащие начиная с from
+ static void moveSlots(OneState* dest, const OneState* src, uint8_t count); // переносит слоты таблицы, области могут перекрываться
+
+ bool getGroup(ModuleStates state, uint8_t& first, uint8_t& count); // ищет группу состояний одного типа
 
 public:
   ModuleState();
+  ~ModuleState();
+
+  // состояния перемещаются в памяти при добавлении/удалении, поэтому закэшированные указатели на OneState действительны,
+  // пока не сменилась эта версия
+  static uint16_t GetLayoutVersion() {return layoutVersion;}
 
   bool HasState(ModuleStates state); // проверяет, поддерживаются ли такие состояния?
   bool HasChanges(); // проверяет, есть ли изменения во внутреннем состоянии модуля?
   
-  OneState* AddState(ModuleStates state, uint8_t sensorIndex); // добавляем датчик и привязываем его к индексу
+  OneState* AddState(ModuleStates state, uint8_t sensorIndex); // добавляем датчик и привязываем его к индексу, NULL - таблица состояний заполнена
   void UpdateState(ModuleStates state, uint8_t sensorIndex, void* newData); // обновляем состояние модуля (например, показания с температурных датчиков);
   
   uint8_t GetStateCount(ModuleStates state); // возвращает кол-во датчиков определённого вида (не даёт информации об индексах датчиков!)
@@ -293,6 +326,12 @@ public:
   
 };
 //--------------------------------------------------------------------------------------------------------------------------------
+// дескриптор модуля - его порядковый номер регистрации в контроллере. Модули не удаляются, поэтому дескриптор можно
+// один раз получить по имени (ModuleController::GetModuleHandle) и хранить вместо имени или повторного поиска.
+//--------------------------------------------------------------------------------------------------------------------------------
+typedef uint8_t ModuleHandle;
+#define NO_MODULE_HANDLE 0xFF // модуль не найден
+//--------------------------------------------------------------------------------------------------------------------------------
 // абстрактный класс резервирования датчиков
 //--------------------------------------------------------------------------------------------------------------------------------
 class ReservationResolver
@@ -324,6 +363,15 @@ typedef struct
    
 } UsedPinsInfo; // состояние занятости пинов
 //--------------------------------------------------------------------------------------------------------------------------------
+typedef struct
+{
+  uint16_t Mode; // желаемое направление пинов (1 - вход, 0 - выход), порт B - в старшем байте
+  uint16_t Latch; // желаемые уровни на выходах
+  uint16_t WrittenMode; // направление пинов, записанное в микросхему
+  uint16_t WrittenLatch; // уровни на выходах, записанные в микросхему
+  
+} McpShadowRegisters; // теневые регистры расширителя MCP23S17/MCP23017
+//--------------------------------------------------------------------------------------------------------------------------------
 class WorkStatus
 {
   uint8_t statuses[STATUSES_BYTES];
@@ -341,18 +389,25 @@ public:
   
 #if defined(USE_MCP23S17_EXTENDER) && COUNT_OF_MCP23S17_EXTENDERS > 0
   MCP23S17* mcpSPIExtenders[COUNT_OF_MCP23S17_EXTENDERS];
+  McpShadowRegisters mcpSPIShadows[COUNT_OF_MCP23S17_EXTENDERS];
   void InitMcpSPIExtenders();
   MCP23S17* GetMCP_SPI_ByAddress(byte addr);
+  int8_t GetMCP_SPI_Index(byte addr);
 #endif  
 
 #if defined(USE_MCP23017_EXTENDER) && COUNT_OF_MCP23017_EXTENDERS > 0
   Adafruit_MCP23017* mcpI2CExtenders[COUNT_OF_MCP23017_EXTENDERS];
+  McpShadowRegisters mcpI2CShadows[COUNT_OF_MCP23017_EXTENDERS];
   void InitMcpI2CExtenders();
   Adafruit_MCP23017* GetMCP_I2C_ByAddress(byte addr);
+  int8_t GetMCP_I2C_Index(byte addr);
 #endif  
 
+  // пишет в расширители изменения, накопленные в теневых регистрах (вызывается раз за проход loop)
+  void McpFlush();
+
     void SetStatus(uint8_t bitNum, bool bOn);
-    void WriteStatus(Stream* pStream, bool bAsTextHex);
+    void WriteStatus(Print* pStream, bool bAsTextHex);
     bool GetStatus(uint8_t bitNum);
     bool IsModeChanged();
     void SetModeUnchanged();
@@ -369,6 +424,8 @@ public:
   void PinMode(byte pinNumber,byte mode, bool setMode=true); 
   void PinWrite(byte pin, byte level); // пишет в пин состояние, заодно копируя его в слепок состояния контроллера
 
+  // запись в каналы MCP23S17/MCP23017 идёт в теневые регистры, в микросхемы изменения уходят по McpFlush,
+  // одной транзакцией на регистр (оба порта сразу), и только если значение действительно изменилось
   #if defined(USE_MCP23S17_EXTENDER) && COUNT_OF_MCP23S17_EXTENDERS > 0
     // запись в каналы MCP23S17
     void MCP_SPI_PinMode(byte mcpAddress, byte mpcChannel, byte mode);
@@ -19,6 +19,11 @@ AlertRule::AlertRule()
 {
   rawCommand = NULL;
   linkedModule = NULL;
+  targetModuleHandle = NO_MODULE_HANDLE;
+  runtime.RaisedOnLastIteration = 0;
+  runtime.OnStack = 0;
+  ResetCache();
+  memset(&predicate,0,sizeof(predicate));
   
   Settings.StartTime = 0;
   Settings.WorkTime = 0;
@@ -124,6 +129,14 @@ const char* AlertRule::GetTargetCommandModuleName()
   return GetKnownModuleName(Settings.TargetModuleNameIndex);
 }
 //-------------------------------------------------------------------------------------------------------------------------------------------------------------------------
+AbstractModule* AlertRule::GetTargetCommandModule()
+{
+  if(targetModuleHandle == NO_MODULE_HANDLE) // ещё не искали модуль, либо он не был зарегистрирован на момент поиска
+    targetModuleHandle = MainController->GetModuleHandle(GetTargetCommandModuleName());
+
+  return MainController->GetModuleByHandle(targetModuleHandle);
+}
+//-------------------------------------------------------------------------------------------------------------------------------------------------------------------------
 bool AlertRule::HasTargetCommand()
 {
   if(Settings.TargetCommandType == commandUnparsed)
@@ -217,12 +230,12 @@ void AlertRule::Update(uint16_t dt
   
   // считаем, что мы можем работать, если попадаем в текущий день недели
   #ifdef USE_DS3231_REALTIME_CLOCK 
-    Settings.CanWork = bitRead(Settings.DayMask,currentDOW-1);
+    Settings.CanWork = bitRead(predicate.DayMask,currentDOW-1);
   #else
     Settings.CanWork = 1;
   #endif  
 
-  if(Settings.StartTime == 0  && Settings.WorkTime == 0) // работаем всегда
+  if(predicate.AnyTime) // работаем всегда
   {
      return;
   }
@@ -230,9 +243,9 @@ void AlertRule::Update(uint16_t dt
 
   #ifdef USE_DS3231_REALTIME_CLOCK
 
-  // создаём диапазон для проверки
-  uint16_t startDia = Settings.StartTime;
-  uint16_t stopDia = startDia + Settings.WorkTime;
+  // диапазон для проверки разобран из настроек в Compile
+  uint16_t startDia = predicate.WindowStart;
+  uint16_t stopDia = predicate.WindowEnd;
 
   // если мы находимся между этим диапазоном, то мы можем работать в это время,
   // иначе - не можем, и просто выставляем флаг работы в false.
@@ -252,7 +265,7 @@ void AlertRule::Update(uint16_t dt
     // правая граница диапазона перешагнула на следующие сутки,
     // отражаем диапазон текущего часа на следующие сутки
     // только в том случае, если текущее кол-во минут от начала суток меньше, чем время начала работы
-    if(checkMinutes < Settings.StartTime)
+    if(checkMinutes < startDia)
     {
       checkMinutes += mins_in_day;
       haveOverflow = true;
@@ -266,7 +279,7 @@ void AlertRule::Update(uint16_t dt
       // в диапазон попали, надо проверить попадание в дни недели.
       // считаем, что мы попали в день недели, если он выставлен
       // в флагах или у нас был перенос работы на следующие сутки.
-      canWeWork = haveOverflow || bitRead(Settings.DayMask,currentDOW-1);
+      canWeWork = haveOverflow || bitRead(predicate.DayMask,currentDOW-1);
     }
 
     Settings.CanWork = canWeWork ? 1 : 0;
@@ -276,292 +289,202 @@ void AlertRule::Update(uint16_t dt
   
 }
 //-------------------------------------------------------------------------------------------------------------------------------------------------------------------------
-bool AlertRule::HasAlert()
+void AlertRule::ResetCache()
 {
-  if(!linkedModule || !Settings.Enabled || !Settings.CanWork)
-    return false;
-
-
-  switch(Settings.Target)
+  runtime.HasResult = 0;
+  runtime.Result = 0;
+  runtime.Volatile = 0;
+  runtime.StateResolved = 0;
+  runtime.Raised = 0;
+  watchedState = NULL;
+  watchedLayoutVersion = 0;
+  watchedStateVersion = 0;
+}
+//-------------------------------------------------------------------------------------------------------------------------------------------------------------------------
+OneState* AlertRule::GetWatchedState(ModuleStates type)
+{
+  // ищем состояние у модуля только один раз, пока набор состояний не поменялся
+  if(!runtime.StateResolved || watchedLayoutVersion != ModuleState::GetLayoutVersion())
   {
-    case rtTemp: // проверяем температуру
-    {
-     if(!linkedModule->State.HasState(StateTemperature))  // не поддерживаем температуру
-        return false;
+    watchedState = NULL;
+    if(linkedModule->State.HasState(type))
+      watchedState = linkedModule->State.GetState(type,Settings.SensorIndex);
 
-     OneState* os = linkedModule->State.GetState(StateTemperature,Settings.SensorIndex);
-       
-     if(!os) // не срослось
-      return false;
-
-       TemperaturePair tp = *os;
-
-       #ifdef ALERT_INCLUDE_COMMA_VALUES
-       int curTemp = tp.Current.Value*100 + tp.Current.Fract;
-       int tAlert = (int8_t) Settings.DataAlert*100; // следим за переданной температурой
-       #else 
-       int8_t curTemp = tp.Current.Value;
-       int8_t tAlert = (int8_t) Settings.DataAlert; // следим за переданной температурой
-       #endif
+    watchedLayoutVersion = ModuleState::GetLayoutVersion();
+    runtime.StateResolved = 1;
+  }
 
-       if(curTemp == NO_TEMPERATURE_DATA) // нет датчика на линии
-       {
-        // пытаемся найти резервирование
-        OneState* reservedState = MainController->GetReservedState(linkedModule,StateTemperature,Settings.SensorIndex);
-        if(!reservedState)
-          return (curTemp == tAlert); // на случай, если правило следит за отсутствием показаний с датчика
-        else // есть зарезервированный датчик с показаниями
-        {
-          TemperaturePair tp = *reservedState; 
-         
-          #ifdef ALERT_INCLUDE_COMMA_VALUES
-          curTemp = tp.Current.Value*100 + tp.Current.Fract;
-          #else
-          curTemp = tp.Current.Value;
-          #endif
-        } // else
-       }
- 
-       switch(Settings.DataSource)
-       {
-          case tsOpenTemperature: // попросили подставить температуру открытия из настроек
-            tAlert = MainController->GetSettings()->GetOpenTemp();
-          break;
+  return watchedState;
+}
+//-------------------------------------------------------------------------------------------------------------------------------------------------------------------------
+bool AlertRule::HasAlert()
+{
+  if(!linkedModule || !Settings.Enabled || !Settings.CanWork)
+    return false;
 
-          case tsCloseTemperature: // попросили подставить температуру закрытия из настроек
-            tAlert = MainController->GetSettings()->GetCloseTemp();
-          break;
+  // если показания, за которыми следим, не изменились с прошлой проверки - отдаём закэшированный результат
+  if(runtime.HasResult && !runtime.Volatile && watchedLayoutVersion == ModuleState::GetLayoutVersion()
+    && (!watchedState || watchedState->GetVersion() == watchedStateVersion))
+    return runtime.Result;
 
-          case tsPassed:
-          break;
-       }
+  runtime.Volatile = 0;
+  bool result = CheckAlert();
 
-       switch(Settings.Operand)
-       {
-          case roLessThan: return curTemp < tAlert;
-          case roLessOrEqual: return curTemp <= tAlert;
-          case roGreaterThan: return curTemp > tAlert;
-          case roGreaterOrEqual: return curTemp >= tAlert;
-          default: return false;
-       } // switch
-    }  
-    break; // rtTemp
-
-    case rtLuminosity: // следим за освещенностью
-    {
-      if(Settings.DataAlert == -2) 
-      {
-        // специальное значение, означающее "работать без датчика освещённости"
-        return true; // в этом случае считаем, что работать мы можем при любом раскладе
-      } // if
-      
-     if(!linkedModule->State.HasState(StateLuminosity))  // не поддерживаем освещенность
-        return false;
+  watchedLayoutVersion = ModuleState::GetLayoutVersion();
+  watchedStateVersion = watchedState ? watchedState->GetVersion() : 0;
+  runtime.Result = result ? 1 : 0;
+  runtime.HasResult = 1;
 
-       OneState* os = linkedModule->State.GetState(StateLuminosity,Settings.SensorIndex);
-       
-       if(!os) // не срослось
-        return false;
+  return result;
+}
+//-------------------------------------------------------------------------------------------------------------------------------------------------------------------------
+void AlertRule::Compile()
+{
+  // разбираем настройки один раз, чтобы при проверке не ходить по switch на каждый тип датчика
+  memset(&predicate,0,sizeof(predicate));
+  predicate.ThresholdSource = tsPassed;
+  predicate.KnownOperand = 1;
+
+  // когда правило работает
+  predicate.DayMask = Settings.DayMask;
+  predicate.AnyTime = (Settings.StartTime == 0 && Settings.WorkTime == 0) ? 1 : 0;
+  predicate.WindowStart = Settings.StartTime;
+  predicate.WindowEnd = Settings.StartTime + Settings.WorkTime;
+
+  switch(Settings.Operand)
+  {
+    case roLessThan: break;
+    case roLessOrEqual: predicate.OrEqual = 1; break;
+    case roGreaterThan: predicate.Greater = 1; break;
+    case roGreaterOrEqual: predicate.Greater = 1; predicate.OrEqual = 1; break;
+    default: predicate.KnownOperand = 0; break;
+  }
 
-       LuminosityPair lp = *os; 
-       long lum = lp.Current;
+  // порог в единицах показаний: целые значения, или сотые доли - если сравниваем с дробной частью
+  #ifdef ALERT_INCLUDE_COMMA_VALUES
+    int32_t fixedThreshold = ((int8_t) Settings.DataAlert)*100;
+  #else
+    int32_t fixedThreshold = (int8_t) Settings.DataAlert;
+  #endif
+  
+  switch(Settings.Target)
+  {
+    case rtTemp:
+      predicate.StateType = StateTemperature;
+      predicate.ThresholdSource = Settings.DataSource;
+    break;
 
-       if(lum == NO_LUMINOSITY_DATA) // нет датчика на линии
-       {
-        // пытаемся найти резервирование
-        OneState* reservedState = MainController->GetReservedState(linkedModule,StateLuminosity,Settings.SensorIndex);
-        if(!reservedState)
-          return (lum == Settings.DataAlert); // на случай, если правило следит за отсутствием показаний с датчика
-        else // есть зарезервированный датчик с показаниями
-          {
-            LuminosityPair lp = *reservedState; 
-            lum = lp.Current;
-          } // else
-        }
+    case rtHumidity:
+      predicate.StateType = StateHumidity;
+    break;
 
-       switch(Settings.Operand)
-       {
-          case roLessThan: return lum < Settings.DataAlert;
-          case roLessOrEqual: return lum <= Settings.DataAlert;
-          case roGreaterThan: return lum > Settings.DataAlert;
-          case roGreaterOrEqual: return lum >= Settings.DataAlert;
-          default: return false;
-       } // switch
-      
-    }
+    case rtSoilMoisture:
+      predicate.StateType = StateSoilMoisture;
     break;
 
-    case rtHumidity: // следим за влажностью
-    {
-     if(!linkedModule->State.HasState(StateHumidity))  // не поддерживаем влажность
-        return false;
+    case rtPH:
+      predicate.StateType = StatePH;
+    break;
 
-       OneState* os = linkedModule->State.GetState(StateHumidity,Settings.SensorIndex);
-       if(!os) // не срослось
-        return false;
+    case rtLuminosity:
+      if(Settings.DataAlert == -2) // специальное значение, означающее "работать без датчика освещённости"
+        return;
+        
+      predicate.StateType = StateLuminosity;
+      predicate.Kind = rpkLong;
+      predicate.Threshold = Settings.DataAlert;
+      predicate.NoDataResult = (Settings.DataAlert == NO_LUMINOSITY_DATA) ? 1 : 0;
+    return;
 
-       HumidityPair hp = *os;
-       #ifdef ALERT_INCLUDE_COMMA_VALUES
-       int curHumidity = hp.Current.Value*100 + hp.Current.Fract;
-       int humidityAlert = Settings.DataAlert*100;
-       #else
-       int8_t curHumidity = hp.Current.Value;
-       int8_t humidityAlert = Settings.DataAlert;
-       #endif
+    case rtPinState:
+      // уровень на пине может быть только 0 или 1, поэтому операнды > и <= не имеют смысла,
+      // вместо них принудительно используем >= и <.
+      predicate.Kind = rpkPin;
+      predicate.Threshold = Settings.DataAlert;
+      predicate.OrEqual = predicate.Greater;
+    return;
 
-       if(curHumidity == NO_TEMPERATURE_DATA) // нет датчика на линии
-       {
-           // пытаемся найти резервирование
-          OneState* reservedState = MainController->GetReservedState(linkedModule,StateHumidity,Settings.SensorIndex);
-          if(!reservedState)
-            return (curHumidity == Settings.DataAlert); // на случай, если правило следит за отсутствием показаний с датчика
-          else // есть зарезервированный датчик с показаниями
-          {
-            HumidityPair tp = *reservedState;
-            
-            #ifdef ALERT_INCLUDE_COMMA_VALUES
-            curHumidity = tp.Current.Value*100 + tp.Current.Fract;
-            #else 
-            curHumidity = tp.Current.Value;
-            #endif
-          } // else
-             
-       }
-
-       switch(Settings.Operand)
-       {
-          case roLessThan: return curHumidity < humidityAlert;
-          case roLessOrEqual: return curHumidity <= humidityAlert;
-          case roGreaterThan: return curHumidity > humidityAlert;
-          case roGreaterOrEqual: return curHumidity >= humidityAlert;
-          default: return false;
-       } // switch
-      
-    }
-    break;
+    default: // ни за чем не следим, считаем, что сработали по времени
+    return;
+  } // switch
 
-   case rtSoilMoisture: // следим за влажностью почвы
-    {
-     if(!linkedModule->State.HasState(StateSoilMoisture))  // не поддерживаем влажность
-        return false;
+  predicate.Kind = rpkFixed;
+  predicate.Threshold = fixedThreshold;
+  predicate.NoDataResult = ((int8_t) Settings.DataAlert == NO_TEMPERATURE_DATA) ? 1 : 0;
+}
+//-------------------------------------------------------------------------------------------------------------------------------------------------------------------------
+static bool ReadRuleValue(uint8_t kind, OneState* os, int32_t& value) // читает показания состояния, false - показаний с датчика нет
+{
+  if(kind == rpkLong)
+  {
+    value = *((const int32_t*) os->GetCurrentData());
+    return value != NO_LUMINOSITY_DATA;
+  }
 
-       OneState* os = linkedModule->State.GetState(StateSoilMoisture,Settings.SensorIndex);
-       if(!os) // не срослось
-        return false;
-       
-       HumidityPair hp = *os;
-
-       #ifdef ALERT_INCLUDE_COMMA_VALUES
-       int curHumidity = hp.Current.Value*100 + hp.Current.Fract;
-       int humidityAlert = Settings.DataAlert*100;
-       #else
-       int8_t curHumidity = hp.Current.Value;
-       int8_t humidityAlert = Settings.DataAlert;
-       #endif
-
-       if(curHumidity == NO_TEMPERATURE_DATA) // нет датчика на линии
-       {
-          // пытаемся найти резервирование
-          OneState* reservedState = MainController->GetReservedState(linkedModule,StateSoilMoisture,Settings.SensorIndex);
-          if(!reservedState)
-            return (curHumidity == Settings.DataAlert); // на случай, если правило следит за отсутствием показаний с датчика
-          else // есть зарезервированный датчик с показаниями
-          {
-            HumidityPair tp = *reservedState;
-            #ifdef ALERT_INCLUDE_COMMA_VALUES
-            curHumidity = tp.Current.Value*100 + tp.Current.Fract;
-            #else 
-            curHumidity = tp.Current.Value;
-            #endif
-          } // else
-        }
+  const Temperature* t = (const Temperature*) os->GetCurrentData();
+  #ifdef ALERT_INCLUDE_COMMA_VALUES
+    value = t->Value*100 + t->Fract;
+  #else
+    value = t->Value;
+  #endif
+  
+  return t->Value != NO_TEMPERATURE_DATA;
+}
+//-------------------------------------------------------------------------------------------------------------------------------------------------------------------------
+bool AlertRule::CheckAlert()
+{
+  int32_t value;
+  int32_t threshold = predicate.Threshold;
+  
+  switch(predicate.Kind)
+  {
+    case rpkAlways:
+      return true;
 
-       switch(Settings.Operand)
-       {
-          case roLessThan: return curHumidity < humidityAlert;
-          case roLessOrEqual: return curHumidity <= humidityAlert;
-          case roGreaterThan: return curHumidity > humidityAlert;
-          case roGreaterOrEqual: return curHumidity >= humidityAlert;
-          default: return false;
-       } // switch
-      
-    }
-    break;  
+    case rpkPin:
+      runtime.Volatile = 1; // состояние пина читаем каждый раз
+      WORK_STATUS.PinMode(Settings.SensorIndex,INPUT);
+      value = digitalRead(Settings.SensorIndex); // читаем из пина его значение
+    break;
 
-    case rtPH: // следим за pH
+    default:
     {
-     if(!linkedModule->State.HasState(StatePH))  // не поддерживаем pH
-        return false;
-
-       OneState* os = linkedModule->State.GetState(StatePH,Settings.SensorIndex);
-       if(!os) // не срослось
+      OneState* os = GetWatchedState((ModuleStates) predicate.StateType); // указатель на состояние кэшируется
+      if(!os) // не срослось
         return false;
 
-       HumidityPair hp = *os;
-       #ifdef ALERT_INCLUDE_COMMA_VALUES
-       int curHumidity = hp.Current.Value*100 + hp.Current.Fract;
-       int phAlert = Settings.DataAlert*100;
-       #else
-       int8_t curHumidity = hp.Current.Value;
-       int8_t phAlert = Settings.DataAlert;
-       #endif
-
-       if(curHumidity == NO_TEMPERATURE_DATA) // нет датчика на линии
-       {
-         // пытаемся найти резервирование
-          OneState* reservedState = MainController->GetReservedState(linkedModule,StatePH,Settings.SensorIndex);
-          if(!reservedState)
-            return (curHumidity == Settings.DataAlert); // на случай, если правило следит за отсутствием показаний с датчика
-         else // есть зарезервированный датчик с показаниями
-          {
-            HumidityPair tp = *reservedState;
-            #ifdef ALERT_INCLUDE_COMMA_VALUES
-            curHumidity = tp.Current.Value*100 + tp.Current.Fract;
-            #else 
-            curHumidity = tp.Current.Value;
-            #endif
-          } // else
-            
-       }
-
-       switch(Settings.Operand)
-       {
-          case roLessThan: return curHumidity < phAlert;
-          case roLessOrEqual: return curHumidity <= phAlert;
-          case roGreaterThan: return curHumidity > phAlert;
-          case roGreaterOrEqual: return curHumidity >= phAlert;
-          default: return false;
-       } // switch
-      
-    }
-    break;      
+      if(!ReadRuleValue(predicate.Kind,os,value)) // нет датчика на линии
+      {
+        // пытаемся найти резервирование
+        runtime.Volatile = 1; // резервный датчик может смениться без нашего ведома
+        OneState* reservedState = MainController->GetReservedState(linkedModule,(ModuleStates) predicate.StateType,Settings.SensorIndex);
+        if(!reservedState)
+          return predicate.NoDataResult; // на случай, если правило следит за отсутствием показаний с датчика
+          
+        ReadRuleValue(predicate.Kind,reservedState,value); // есть зарезервированный датчик с показаниями
+      }
 
-    case rtPinState: // следим за статусом пина
-    {
-       WORK_STATUS.PinMode(Settings.SensorIndex,INPUT);
-       int pinState = digitalRead(Settings.SensorIndex); // читаем из пина его значение
-       // dataAlertLong у нас может принимать одно значение: 1, поскольку мы сравниваем
-       // это значение с HIGH и LOW на пине. Поэтому не имеют смысла операнды > и <=,
-       // вместо них мы принудительно используем операнды >= и <.
-     
-       switch(Settings.Operand)
-       {
-          case roLessThan: return pinState < Settings.DataAlert; 
-          case roLessOrEqual: return pinState < Settings.DataAlert;
-          case roGreaterThan: return pinState >= Settings.DataAlert;
-          case roGreaterOrEqual: return pinState >= Settings.DataAlert;
-          default: return false;
-         
-       } // switch
+      if(predicate.ThresholdSource != tsPassed)
+      {
+        // попросили подставить температуру открытия или закрытия из настроек, они могут поменяться в любой момент
+        runtime.Volatile = 1;
+        GlobalSettings* sett = MainController->GetSettings();
+        threshold = predicate.ThresholdSource == tsOpenTemperature ? sett->GetOpenTemp() : sett->GetCloseTemp();
+        #ifdef ALERT_INCLUDE_COMMA_VALUES
+          threshold *= 100;
+        #endif
+      }
     }
     break;
-
-    case rtUnknown:
-     // нет того, за чем следим, считаем, что мы сработали по времени
-     return true;
   } // switch
 
-  return false;
+  if(!predicate.KnownOperand) // неизвестный операнд - не срабатываем
+    return false;
+
+  if(value == threshold)
+    return predicate.OrEqual;
+
+  return (value > threshold) == (predicate.Greater == 1);
 }
 //-------------------------------------------------------------------------------------------------------------------------------------------------------------------------
 const char* AlertRule::GetAlertRule() // конструируем правило, когда запрашивают его просмотр
@@ -756,6 +679,9 @@ uint8_t AlertRule::Load(uint16_t readAddr)
 
   // ищем связанный модуль
   linkedModule = MainController->GetModuleByID(GetLinkedModuleName());
+  targetModuleHandle = NO_MODULE_HANDLE;
+  ResetCache();
+  Compile();
 
   return (curReadAddr - readAddr) + 4;
   
@@ -780,6 +706,7 @@ bool AlertRule::Construct(AbstractModule* lm, const Command& command)
 {
   // конструируем команду
   linkedModule = lm;
+  ResetCache();
   Settings.LinkedModuleNameIndex = GetKnownModuleID(lm->GetID());
 
   // чистим имена связанных правил, об удалении памяти имён заботится родитель
@@ -863,6 +790,7 @@ bool AlertRule::Construct(AbstractModule* lm, const Command& command)
 
   // дальше идёт маска дней недели
   Settings.DayMask = (uint8_t) atoi(command.GetArg(curArgIdx++));
+  Compile(); // всё, что нужно для проверки правила, уже разобрано
   
   // далее идут правила, при срабатывании которых данное правило работать не будет
   curArg = command.GetArg(curArgIdx++);
@@ -938,6 +866,7 @@ bool AlertRule::Construct(AbstractModule* lm, const Command& command)
     SD_BUFFER[tcParams - tcBegin] = 0;
 
     Settings.TargetModuleNameIndex = GetKnownModuleID(tcModuleName);
+    targetModuleHandle = NO_MODULE_HANDLE;
 
     
     tcParams++;
@@ -1070,6 +999,9 @@ void AlertModule::SaveRules() // сохраняем настройки в EEPROM
 {
   uint16_t writeAddr = EEPROM_RULES_START_ADDR; // пишем с этого смещения
 
+  // все правила пишем одной пакетной записью - в память уйдут только изменённые страницы
+  MemBeginWrite();
+
   // сначала пишем заголовок
   MemWrite(writeAddr++,RULE_SETT_HEADER1);
   MemWrite(writeAddr++,RULE_SETT_HEADER2);
@@ -1101,6 +1033,7 @@ void AlertModule::SaveRules() // сохраняем настройки в EEPROM
       writeAddr += r->Save(writeAddr); // просим правило записать своё внутреннее состояние
   } // for
 
+  MemCommit();
 }
 //-------------------------------------------------------------------------------------------------------------------------------------------------------------------------
 char* AlertModule::GetParam(size_t idx)
@@ -1122,6 +1055,7 @@ bool AlertModule::AddRule(AbstractModule* m, const Command& c)
   if(r && !strcmp(r->GetName(),rName.c_str()))
   {
      // нашли такое правило, просто модифицируем его
+     rulesGraphChanged = true;
      return r->Construct(m,c);
   }
  } // for
@@ -1141,6 +1075,7 @@ bool AlertModule::AddRule(AbstractModule* m, const Command& c)
    alertRules[rulesCnt] = ar;
 
     rulesCnt++;
+    rulesGraphChanged = true;
     return true;
 }
 //-------------------------------------------------------------------------------------------------------------------------------------------------------------------------
@@ -1150,12 +1085,14 @@ void AlertModule::Setup()
   // загружаем правила
   LoadRules();
 
-  lastUpdateCall = 0;
+  // разрешение зависимостей правил - ресурсоёмкая операция, пусть контроллер вызывает нас согласно настроенному интервалу
+  MainController->ScheduleModule(this,ALERT_UPDATE_INTERVAL,schedulePriorityHigh);
 }
 //-------------------------------------------------------------------------------------------------------------------------------------------------------------------------
 void AlertModule::InitRules()
 {
   rulesCnt = 0; // кол-вo правил
+  rulesGraphChanged = true;
   for(uint8_t i=0;i<MAX_ALERT_RULES;i++)
   {
     alertRules[i] = NULL;
@@ -1165,12 +1102,7 @@ void AlertModule::InitRules()
 //-------------------------------------------------------------------------------------------------------------------------------------------------------------------------
 void AlertModule::Update(uint16_t dt)
 { 
-  // обновление модуля алертов тут
-
-  lastUpdateCall += dt;
-    
-  if(lastUpdateCall < ALERT_UPDATE_INTERVAL) // обновляем согласно настроенному интервалу
-    return;
+  // обновление модуля алертов тут, вызывается раз в ALERT_UPDATE_INTERVAL
      
 #ifdef USE_DS3231_REALTIME_CLOCK
   DS3231Clock rtc = MainController->GetClock();
@@ -1178,7 +1110,7 @@ void AlertModule::Update(uint16_t dt)
 #endif
 
 
-  RulesVector raisedAlerts;
+  RulesList raisedAlerts;
   
   for(uint8_t i=0;i<rulesCnt;i++)
   {
@@ -1187,14 +1119,16 @@ void AlertModule::Update(uint16_t dt)
       break;
 
       // сначала обновляем состояние правила
-      r->Update(lastUpdateCall
+      r->Update(dt
 #ifdef USE_DS3231_REALTIME_CLOCK
 ,tm.hour, tm.minute, tm.dayOfWeek
 #endif
         );
 
       
-      if(r->HasAlert())
+      r->runtime.Raised = r->HasAlert() ? 1 : 0;
+      
+      if(r->runtime.Raised)
       {
         // помещаем это правило в список сработавших правил
           raisedAlerts.push_back(r);
@@ -1202,8 +1136,11 @@ void AlertModule::Update(uint16_t dt)
       } // if(r->HasAlert())
   } // for
 
+  if(rulesGraphChanged) // правила поменялись - перестраиваем граф зависимостей
+    BuildRulesGraph();
+
   // проверяем список сработавших правил, на предмет связи их с другими сработавшими правилами
-  RulesVector workRules; // правила, с которыми будем работать после разрешения конфликтов
+  RulesList workRules; // правила, с которыми будем работать после разрешения конфликтов
 
   // разрешаем конфликты. Для этого надо пройти по всем цепочкам правил и разрешить все зависимости,
   // например: у нас есть три сработавших правила: 1 - просто, второе - не выполнять, если сработало
@@ -1221,7 +1158,8 @@ void AlertModule::Update(uint16_t dt)
   if(WORK_STATUS.IsModeChanged())
   {
     WORK_STATUS.SetModeUnchanged();
-    lastIterationRaisedRules.clear();
+    for(uint8_t i=0;i<rulesCnt;i++)
+      alertRules[i]->runtime.RaisedOnLastIteration = 0;
   }
   
   for(size_t i=0;i<sz;i++)
@@ -1241,13 +1179,15 @@ void AlertModule::Update(uint16_t dt)
       
          // копируем имя модуля в строку, потому что методы GetTargetCommandModuleName и GetTargetCommand пользуют общий буфер,
          // и перезатрут данные друг друга.
+         // модуль берём по закэшированному дескриптору, чтобы не искать его по имени на каждом срабатывании
+         AbstractModule* targetModule = r->GetTargetCommandModule();
          String moduleId = r->GetTargetCommandModuleName();
          cmd.Construct(moduleId.c_str(),r->GetTargetCommand(),ctSET);
          cmd.SetInternal(true); // говорим, что команда - от одного модуля к другому
 
         // НЕ БУДЕМ НИКУДА ПЛЕВАТЬСЯ ОТВЕТОМ ОТ МОДУЛЯ
         //cmd.SetIncomingStream(&Serial);
-        MainController->ProcessModuleCommand(cmd,NULL);
+        MainController->ProcessModuleCommand(cmd,targetModule);
 
         // дёргаем функцию обновления других вещей - типа, кооперативная работа
         yield();
@@ -1261,72 +1201,80 @@ void AlertModule::Update(uint16_t dt)
  
   } // for
 
-  lastIterationRaisedRules = workRules; // сохраняем список сработавших на этой итерации правил
-
-  lastUpdateCall = lastUpdateCall - ALERT_UPDATE_INTERVAL;
+  // запоминаем, какие правила сработали на этой итерации
+  for(uint8_t i=0;i<rulesCnt;i++)
+    alertRules[i]->runtime.RaisedOnLastIteration = 0;
+    
+  for(size_t i=0;i<sz;i++)
+    workRules[i]->runtime.RaisedOnLastIteration = 1;
   
 }
 //-------------------------------------------------------------------------------------------------------------------------------------------------------------------------
-bool AlertModule::IsRuleRaisedOnLastIteration(AlertRule* rule)
+void AlertModule::BuildRulesGraph()
 {
-    for(size_t i=0;i<lastIterationRaisedRules.size();i++)
+  // переводим имена связанных правил в биты мест правил в массиве, чтобы при разрешении
+  // конфликтов не искать правила по именам. Имена правил уникальны, поэтому сравниваем индексы имён.
+  rulesGraphChanged = false;
+  
+  for(uint8_t i=0;i<rulesCnt;i++)
+  {
+    AlertRule* rule = alertRules[i];
+    memset(rule->predicate.LinkedRules,0,sizeof(rule->predicate.LinkedRules));
+    rule->predicate.HasLinkedRules = 0;
+
+    size_t cnt = rule->linkedRulesIndices.size();
+    for(size_t j=0;j<cnt;j++)
     {
-      AlertRule* r = lastIterationRaisedRules[i];
-      if(r == rule)
+      uint8_t nameIdx = rule->linkedRulesIndices[j];
+      for(uint8_t k=0;k<rulesCnt;k++)
       {
-        return true;
-      }
-    }
-    
-    return false;
+        if(alertRules[k]->Settings.RuleNameIndex == nameIdx)
+        {
+          bitSet(rule->predicate.LinkedRules[k >> 3],k & 7);
+          rule->predicate.HasLinkedRules = 1;
+          break;
+        }
+      } // for
+    } // for
+  } // for
 }
 //-------------------------------------------------------------------------------------------------------------------------------------------------------------------------
-bool AlertModule::CanWorkWithRule(RulesVector& checkedRules, AlertRule* rule, RulesVector& raisedAlerts)
+bool AlertModule::CanWorkWithRule(AlertRule* rule)
 {
 
   yield(); // дёргаем многозадачность за хвост
   
-  size_t cnt = rule->GetLinkedRulesCount();
-  if(!cnt)
+  if(!rule->predicate.HasLinkedRules)
     return true; // нет связанных правил, при срабатывании которых мы должны игнорировать текущее
 
+  // если мы уже в цепочке проверки - значит, нашли кольцевую зависимость, с этим правилом работать нельзя
+  if(rule->runtime.OnStack)
+    return false;
 
-  // проверяем, есть ли мы уже в списке проверенных правил, если есть - считаем, что с этим правилом работать нельзя,
-  // и удаляем его из списка
-  size_t sz = checkedRules.size();
-  for(size_t i=0;i<sz;i++)
+  rule->runtime.OnStack = 1;
+  bool result = true;
+  
+  for(uint8_t i=0;i<rulesCnt;i++)
   {
-      if(checkedRules[i] == rule) // нашли кольцевую рекурсию
+    // проходимся по всем связанным с нами правилам, и разрешаем конфликты по цепочке
+    if(!bitRead(rule->predicate.LinkedRules[i >> 3],i & 7))
+      continue;
+      
+    AlertRule* linkedRule = alertRules[i];
+        
+      if(!linkedRule->runtime.Raised) // связанное правило не сработало
+        continue;
+
+      // связанное правило без зависимостей, либо с правилом, на которое мы завязаны, работать можно - игнорируем текущее
+      if(!linkedRule->predicate.HasLinkedRules || CanWorkWithRule(linkedRule))
       {
-        return false;
+        result = false;
+        break;
       }
   } // for
 
-  for(uint8_t i=0;i<cnt;i++)
-  {
-    // проходимся по всем именам связанных с нашим правил, и разрешаем конфликты по цепочке
-    const char* linkedRuleName = rule->GetLinkedRuleName(i);
-    AlertRule* linkedRule = GetLinkedRule(linkedRuleName,raisedAlerts);
-        
-      if(linkedRule) // нашли сработавшее правило, от которого мы зависим
-      {
-        if(!linkedRule->GetLinkedRulesCount()) // сразу нашли сработавшее связанное правило без зависимостей
-          return false; // с текущим правилом работать нельзя!
-          
-          checkedRules.push_back(rule); // помещаем текущий проверяемый узел в стек, чтобы не было кольцевой рекурсии
-
-          // К СОЖАЛЕНИЮ, РЕШАЕМ РЕКУРСИВНО :(
-          if(CanWorkWithRule(checkedRules,linkedRule,raisedAlerts)) // с правилом, на которое мы завязаны, работать можно, поэтому игнорируем текущее
-            return false;
-            
-          checkedRules.pop(); // извлекаем последний элемент
- 
-      } // if linkedRule
-    
-    
-  } // for
-return true;
-  
+  rule->runtime.OnStack = 0;
+  return result;
 }
 //-------------------------------------------------------------------------------------------------------------------------------------------------------------------------
 size_t AlertModule::AddParam(char* nm, bool& added)
@@ -1344,28 +1292,14 @@ size_t AlertModule::AddParam(char* nm, bool& added)
   return (paramsArray.size()-1);
 }
 //-------------------------------------------------------------------------------------------------------------------------------------------------------------------------
-AlertRule* AlertModule::GetLinkedRule(const char* linkedRuleName,RulesVector& raisedAlerts)
-{
-  size_t sz = raisedAlerts.size();
-  for(size_t i=0;i<sz;i++)
-  {
-      AlertRule* r = raisedAlerts[i];
-      if(!strcmp(r->GetName(),linkedRuleName))
-        return r;
-  }
-  return NULL;
-}
-//-------------------------------------------------------------------------------------------------------------------------------------------------------------------------
-void AlertModule::SolveConflicts(RulesVector& raisedAlerts,RulesVector& workRules)
+void AlertModule::SolveConflicts(RulesList& raisedAlerts,RulesList& workRules)
 {
   // разрешаем конфликты
-  RulesVector checkedRules; // список уже проверенных правил, для разрешения кольцевой рекурсии
-  
   size_t sz = raisedAlerts.size();
     for(size_t i=0;i<sz;i++)
     {
         AlertRule* rule = raisedAlerts[i];
-        if(CanWorkWithRule(checkedRules, rule, raisedAlerts)) // разрешили все зависимости
+        if(CanWorkWithRule(rule)) // разрешили все зависимости
             workRules.push_back(rule);
           
     } // for
@@ -1373,6 +1307,8 @@ void AlertModule::SolveConflicts(RulesVector& raisedAlerts,RulesVector& workRule
 //-------------------------------------------------------------------------------------------------------------------------------------------------------------------------
 bool  AlertModule::ExecCommand(const Command& command, bool wantAnswer)
 {
+  bool canPublish = true; // флаг, что можем публиковать через контроллер
+  
   if(wantAnswer) 
     PublishSingleton = UNKNOWN_COMMAND;
 
@@ -1531,6 +1467,7 @@ bool  AlertModule::ExecCommand(const Command& command, bool wantAnswer)
                   ClearParams();
 
                   rulesCnt = 0;
+                  rulesGraphChanged = true;
                   
                   PublishSingleton.Flags.Status = true;
                   PublishSingleton = RULE_DELETE; 
@@ -1560,6 +1497,7 @@ bool  AlertModule::ExecCommand(const Command& command, bool wantAnswer)
                       } // for
 
                     rulesCnt--;
+                    rulesGraphChanged = true;
 
                     //TODO: Удалять из параметров имя правила и у всех связанных правил удалять индекс этого имени!!!
  
@@ -1609,15 +1547,30 @@ bool  AlertModule::ExecCommand(const Command& command, bool wantAnswer)
                           if(rule) // нашли правило
                           {
                             PublishSingleton.Flags.Status = true;
-                            PublishSingleton = RULE_VIEW; 
-                            PublishSingleton << PARAM_DELIMITER << (command.GetArg(1)) << PARAM_DELIMITER
-                            << (rule->GetAlertRule());
-
-                            if(rule->HasTargetCommand())
+                            if(wantAnswer)
                             {
-                              PublishSingleton << PARAM_DELIMITER << F("CTSET=") << (rule->GetTargetCommandModuleName())
-                              << PARAM_DELIMITER;
-                              PublishSingleton << (rule->GetTargetCommand());
+                              // правило со связанными правилами и командой может быть длинным - пишем его прямо в поток,
+                              // каждую часть - сразу, как только она собрана в SD_BUFFER
+                              canPublish = false;
+                              Print* pStream = MainController->BeginPublish(this,command);
+                              if(pStream)
+                              {
+                                pStream->print(RULE_VIEW);
+                                pStream->print(PARAM_DELIMITER);
+                                pStream->print(command.GetArg(1));
+                                pStream->print(PARAM_DELIMITER);
+                                pStream->print(rule->GetAlertRule());
+
+                                if(rule->HasTargetCommand())
+                                {
+                                  pStream->print(PARAM_DELIMITER);
+                                  pStream->print(F("CTSET="));
+                                  pStream->print(rule->GetTargetCommandModuleName());
+                                  pStream->print(PARAM_DELIMITER);
+                                  pStream->print(rule->GetTargetCommand());
+                                }
+                              }
+                              MainController->EndPublish();
                             }
                             
                           }
@@ -1661,7 +1614,11 @@ bool  AlertModule::ExecCommand(const Command& command, bool wantAnswer)
   } // if ctGET
  
  // отвечаем на команду
-  MainController->Publish(this,command);
+  if(canPublish)
+    MainController->Publish(this,command);
+  else
+    PublishSingleton.Reset();
+    
   return true;
 }
 //-------------------------------------------------------------------------------------------------------------------------------------------------------------------------
@@ -91,6 +91,50 @@ typedef enum
   
 } RuleKnownCommands; // известные правилу команды, которые оно может перевести в краткую форму
 //--------------------------------------------------------------------------------------------------------------------------------------
+typedef struct
+{
+  uint8_t HasResult : 1; // результат проверки закэширован
+  uint8_t Result : 1; // закэшированный результат проверки
+  uint8_t Volatile : 1; // результат зависит от данных, изменения которых мы не отслеживаем (пин, настройки, резервный датчик)
+  uint8_t StateResolved : 1; // состояние, за которым следим, найдено у модуля
+  uint8_t Raised : 1; // правило сработало на текущей итерации
+  uint8_t RaisedOnLastIteration : 1; // правило сработало на предыдущей итерации
+  uint8_t OnStack : 1; // правило в цепочке проверки зависимостей (для разрешения кольцевых зависимостей)
+  uint8_t pad : 1;
+  
+} RuleRuntimeFlags; // флаги правила, вычисляемые во время работы
+//--------------------------------------------------------------------------------------------------------------------------------------
+typedef enum
+{
+  rpkAlways, // правило ни за чем не следит (или работает без датчика освещённости) - всегда срабатывает
+  rpkFixed, // показания Temperature/Humidity: целая часть и сотые доли
+  rpkLong, // показания освещённости
+  rpkPin // уровень на пине
+  
+} RulePredicateKind; // как получать показания для проверки правила
+//--------------------------------------------------------------------------------------------------------------------------------------
+typedef struct
+{
+  int32_t Threshold; // порог, в тех же единицах, что и показания (с сотыми долями при ALERT_INCLUDE_COMMA_VALUES)
+  uint8_t StateType; // тип состояния, за которым следим
+  uint8_t Kind : 2; // как получать показания, из RulePredicateKind
+  uint8_t Greater : 1; // срабатываем, когда показания больше порога (иначе - меньше)
+  uint8_t OrEqual : 1; // срабатываем и при равенстве порогу
+  uint8_t NoDataResult : 1; // результат, когда нет показаний ни с датчика, ни с резервного (правило следит за отсутствием показаний)
+  uint8_t ThresholdSource : 2; // откуда брать порог, из RuleDataSource
+  uint8_t KnownOperand : 1; // операнд распознан (с неизвестным операндом правило не срабатывает)
+
+  uint8_t AnyTime : 1; // время работы не задано - работаем весь день, если он есть в DayMask
+  uint8_t HasLinkedRules : 1; // есть связанные правила, при срабатывании которых текущее не выполняется
+  uint8_t pad : 6;
+  
+  uint8_t DayMask; // дни недели, в которые работает правило
+  uint16_t WindowStart; // начало работы, минут от начала суток
+  uint16_t WindowEnd; // конец работы, минут от начала суток; больше суток - работа переходит на следующие сутки
+  uint8_t LinkedRules[(MAX_ALERT_RULES+7)/8]; // связанные правила, по биту на место правила в массиве правил модуля
+  
+} RulePredicate; // правило, скомпилированное из настроек для быстрой проверки
+//--------------------------------------------------------------------------------------------------------------------------------------
 #define RULE_SETT_HEADER1 0x21
 #define RULE_SETT_HEADER2 0x17
 //--------------------------------------------------------------------------------------------------------------------------------------
@@ -102,8 +146,23 @@ class AlertRule
 
     char* rawCommand; // сырая команда, если Settings.TargetCommandType == commandUnparsed, то вся команда будет здесь    
     AbstractModule* linkedModule; // модуль, показания которого надо отслеживать
+    ModuleHandle targetModuleHandle; // дескриптор модуля, которому посылается команда, ищется один раз
     LinkedRulesToIdxVector linkedRulesIndices; // привязка имён связанных правил к их индексу у родителя
     const char* GetKnownModuleName(uint8_t type);
+
+    // кэш проверки правила: перепроверяем только тогда, когда изменились показания, за которыми следим
+    RuleRuntimeFlags runtime;
+    OneState* watchedState; // состояние, за которым следим, ищется один раз
+    uint16_t watchedLayoutVersion; // версия набора состояний, для которой найден watchedState
+    uint8_t watchedStateVersion; // версия показаний, для которой закэширован результат
+    OneState* GetWatchedState(ModuleStates type);
+    void ResetCache();
+
+    RulePredicate predicate; // настройки, разобранные один раз при создании или загрузке правила; связанные правила в нём отмечает AlertModule::BuildRulesGraph
+    void Compile(); // строит predicate по настройкам
+    bool CheckAlert(); // собственно проверка правила
+
+    friend class AlertModule;
     
   public:
     AlertRule();
@@ -125,6 +184,7 @@ class AlertRule
     const char* GetAlertRule();
 
     const char* GetTargetCommandModuleName();
+    AbstractModule* GetTargetCommandModule(); // модуль, которому посылается команда
     const char* GetLinkedModuleName();
     uint8_t GetKnownModuleID(const char* moduleName);
 
@@ -145,29 +205,27 @@ class AlertRule
     bool HasAlert(); // проверяем, есть ли алерт?
 };
 //--------------------------------------------------------------------------------------------------------------------------------------
-typedef Vector<AlertRule*> RulesVector;
+typedef FixedVector<AlertRule*,MAX_ALERT_RULES> RulesList; // список правил на одну итерацию, без выделения памяти в куче
 typedef Vector<char*> NamesVector;
 //--------------------------------------------------------------------------------------------------------------------------------------
 class AlertModule : public AbstractModule
 {
   private:
   
-    RulesVector lastIterationRaisedRules; // список правил, сработавших на текущей итерации
-    bool IsRuleRaisedOnLastIteration(AlertRule* rule);
+    bool IsRuleRaisedOnLastIteration(AlertRule* rule) { return rule->runtime.RaisedOnLastIteration; }
 
     NamesVector paramsArray; // всякие общие имена храним здесь
     void ClearParams();
 
-    unsigned long lastUpdateCall;
-
     uint8_t rulesCnt;
     AlertRule* alertRules[MAX_ALERT_RULES];
     void InitRules();
     bool AddRule(AbstractModule* m, const Command& c);
 
-    void SolveConflicts(RulesVector& raisedAlerts,RulesVector& workRules);
-    bool CanWorkWithRule(RulesVector& checkedRules, AlertRule* rule,RulesVector& raisedAlerts);
-    AlertRule* GetLinkedRule(const char* linkedRuleName,RulesVector& raisedAlerts);
+    bool rulesGraphChanged; // список правил или их связи изменились, надо перестроить граф зависимостей
+    void BuildRulesGraph();
+    void SolveConflicts(RulesList& raisedAlerts,RulesList& workRules);
+    bool CanWorkWithRule(AlertRule* rule);
 
     void LoadRules();
     void SaveRules();
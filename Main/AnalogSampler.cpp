@@ -0,0 +1,163 @@
+#include "AnalogSampler.h"
+//--------------------------------------------------------------------------------------------------------------------------------
+#ifdef USE_ANALOG_SAMPLER
+//--------------------------------------------------------------------------------------------------------------------------------
+AnalogSamplerClass AnalogSampler;
+//--------------------------------------------------------------------------------------------------------------------------------
+#if TARGET_BOARD != DUE_BOARD
+ISR(ADC_vect)
+{
+  AnalogSampler.onSample(ADC);
+}
+#endif
+//--------------------------------------------------------------------------------------------------------------------------------
+static uint16_t median3(uint16_t a, uint16_t b, uint16_t c)
+{
+  if(a > b)
+  {
+    uint16_t t = a;
+    a = b;
+    b = t;
+  }
+  // теперь a <= b
+  if(c <= a)
+    return a;
+  if(c >= b)
+    return b;
+  return c;
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+AnalogSamplerClass::AnalogSamplerClass()
+{
+  channelsCount = 0;
+  currentChannel = 0;
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+void AnalogSamplerClass::selectChannel(uint8_t idx)
+{
+  currentChannel = idx;
+
+#if TARGET_BOARD != DUE_BOARD
+  // следующий запуск АЦП по переполнению таймера 0 снимет отсчёт уже с нового канала
+  uint8_t mux = channels[idx].pin;
+  if(mux >= A0)
+    mux -= A0;
+
+  ADMUX = (1 << REFS0) | (mux & 0x07); // опорное - AVCC, как у analogRead
+  ADCSRB = (ADCSRB & ~(1 << MUX5)) | ((mux & 0x08) ? (1 << MUX5) : 0);
+#endif
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+uint8_t AnalogSamplerClass::addChannel(uint8_t pin)
+{
+  if(channelsCount >= ANALOG_SAMPLER_MAX_CHANNELS)
+    return NO_ANALOG_CHANNEL;
+
+  noInterrupts();
+
+  uint8_t idx = channelsCount;
+  channels[idx].pin = pin;
+  clearChannel(&(channels[idx]));
+  channelsCount++;
+
+#if TARGET_BOARD != DUE_BOARD
+  if(idx == 0)
+  {
+    // первый канал - запускаем АЦП: отсчёт по каждому переполнению таймера 0 (~1 кГц на все каналы), прерывание по готовности
+    selectChannel(0);
+    ADCSRB = (ADCSRB & ~0x07) | (1 << ADTS2);
+    ADCSRA = (1 << ADEN) | (1 << ADATE) | (1 << ADIE) | (1 << ADPS2) | (1 << ADPS1) | (1 << ADPS0);
+  }
+#endif
+
+  interrupts();
+
+  return idx;
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+void AnalogSamplerClass::reset(uint8_t channel)
+{
+  if(channel >= channelsCount)
+    return;
+
+  noInterrupts();
+  clearChannel(&(channels[channel]));
+  interrupts();
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+void AnalogSamplerClass::clearChannel(AnalogSamplerChannel* c)
+{
+  c->primed = 0;
+  c->blockSamples = 0;
+  c->blockSum = 0;
+  c->value = 0;
+  c->hasValue = false;
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+bool AnalogSamplerClass::available(uint8_t channel)
+{
+  if(channel >= channelsCount)
+    return false;
+
+  return channels[channel].hasValue;
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+uint16_t AnalogSamplerClass::read(uint8_t channel)
+{
+  if(channel >= channelsCount)
+    return 0;
+
+  noInterrupts();
+  uint16_t result = channels[channel].value;
+  interrupts();
+
+  return result;
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+void AnalogSamplerClass::update()
+{
+#if TARGET_BOARD == DUE_BOARD
+  if(channelsCount)
+    onSample(analogRead(channels[currentChannel].pin));
+#endif
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+void AnalogSamplerClass::onSample(uint16_t raw)
+{
+  AnalogSamplerChannel* c = &(channels[currentChannel]);
+
+  uint8_t next = currentChannel + 1;
+  if(next >= channelsCount)
+    next = 0;
+  selectChannel(next);
+
+  if(c->primed < 2)
+  {
+    // после сброса копим отсчёты для медианного фильтра
+    c->last[c->primed++] = raw;
+    return;
+  }
+
+  uint16_t sample = median3(c->last[0],c->last[1],raw);
+  c->last[0] = c->last[1];
+  c->last[1] = raw;
+
+  c->blockSum += sample;
+  if(++c->blockSamples < ANALOG_SAMPLER_OVERSAMPLING)
+    return;
+
+  // блок набран - его сумма и есть значение в 1/ANALOG_SAMPLER_OVERSAMPLING единицы АЦП
+  uint16_t block = c->blockSum;
+  c->blockSum = 0;
+  c->blockSamples = 0;
+
+  if(!c->hasValue)
+  {
+    c->value = block;
+    c->hasValue = true;
+  }
+  else
+    c->value = ((uint32_t) c->value*((1 << ANALOG_SAMPLER_FILTER_SHIFT) - 1) + block) >> ANALOG_SAMPLER_FILTER_SHIFT;
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+#endif // USE_ANALOG_SAMPLER
@@ -0,0 +1,61 @@
+#ifndef _ANALOG_SAMPLER_H
+#define _ANALOG_SAMPLER_H
+//--------------------------------------------------------------------------------------------------------------------------------
+#include <Arduino.h>
+#include "Globals.h"
+//--------------------------------------------------------------------------------------------------------------------------------
+#if defined(USE_PH_MODULE) || defined(USE_SOIL_MOISTURE_MODULE)
+#define USE_ANALOG_SAMPLER
+#endif
+//--------------------------------------------------------------------------------------------------------------------------------
+#ifdef USE_ANALOG_SAMPLER
+//--------------------------------------------------------------------------------------------------------------------------------
+#define ANALOG_SAMPLER_MAX_CHANNELS 6 // максимальное кол-во аналоговых каналов, опрашиваемых в фоне
+#define ANALOG_SAMPLER_OVERSAMPLING 16 // сколько отсчётов АЦП складывается в одно значение (степень двойки, не больше 64) - показания хранятся в 1/16 единицы АЦП
+#define ANALOG_SAMPLER_FILTER_SHIFT 3 // окно сглаживания: новое значение входит в показания с весом 1/2^ANALOG_SAMPLER_FILTER_SHIFT
+#define NO_ANALOG_CHANNEL 0xFF // канал не зарегистрирован
+//--------------------------------------------------------------------------------------------------------------------------------
+typedef struct
+{
+  uint8_t pin; // аналоговый пин
+  uint8_t primed; // сколько отсчётов накоплено для медианного фильтра после сброса (0-2)
+  uint16_t last[2]; // два предыдущих отсчёта, для медианы из трёх
+  uint8_t blockSamples; // отсчётов в текущем блоке
+  uint16_t blockSum; // сумма отсчётов текущего блока
+  uint16_t value; // сглаженные показания, в 1/ANALOG_SAMPLER_OVERSAMPLING единицы АЦП
+  bool hasValue; // есть ли показания после сброса
+
+} AnalogSamplerChannel;
+//--------------------------------------------------------------------------------------------------------------------------------
+// фоновое чтение аналоговых пинов: отсчёты АЦП по очереди снимаются со всех зарегистрированных каналов
+// (на Mega - в прерывании АЦП, запускаемом по переполнению таймера 0, на Due - по одному отсчёту за проход loop),
+// проходят через медиану из трёх (отсекаем выбросы), складываются блоками по ANALOG_SAMPLER_OVERSAMPLING отсчётов
+// и сглаживаются. Модули просто забирают готовое значение, не дожидаясь АЦП.
+//--------------------------------------------------------------------------------------------------------------------------------
+class AnalogSamplerClass
+{
+  private:
+    AnalogSamplerChannel channels[ANALOG_SAMPLER_MAX_CHANNELS];
+    uint8_t channelsCount;
+    uint8_t currentChannel; // канал, с которого снимается текущий отсчёт
+
+    void selectChannel(uint8_t idx);
+    void clearChannel(AnalogSamplerChannel* c);
+
+  public:
+    AnalogSamplerClass();
+
+    uint8_t addChannel(uint8_t pin); // регистрирует пин и запускает опрос, возвращает номер канала или NO_ANALOG_CHANNEL
+    void reset(uint8_t channel); // сбрасывает показания канала, например, после включения питания датчика
+    bool available(uint8_t channel); // есть ли показания у канала
+    uint16_t read(uint8_t channel); // сглаженные показания, в 1/ANALOG_SAMPLER_OVERSAMPLING единицы АЦП
+
+    void update(); // вызывается из loop, на Due снимает очередной отсчёт
+    void onSample(uint16_t raw); // обрабатывает отсчёт текущего канала и переключается на следующий
+};
+//--------------------------------------------------------------------------------------------------------------------------------
+extern AnalogSamplerClass AnalogSampler;
+//--------------------------------------------------------------------------------------------------------------------------------
+#endif // USE_ANALOG_SAMPLER
+//--------------------------------------------------------------------------------------------------------------------------------
+#endif
@@ -1,9 +1,8 @@
 #include "CommandBuffer.h"
-#include "Globals.h"
 //--------------------------------------------------------------------------------------------------------------------------------------
 CommandBuffer::CommandBuffer(Stream* s) : pStream(s)
 {
-    strBuff = new String();
+    ClearCommand();
 }
 //--------------------------------------------------------------------------------------------------------------------------------------
 bool CommandBuffer::HasCommand()
@@ -17,12 +16,14 @@ bool CommandBuffer::HasCommand()
       ch = pStream->read();
       if(ch == '\r' || ch == '\n')
       {
-        return strBuff->length() > 0; // вдруг лишние управляющие символы придут в начале строки?
+        return writeIdx > 0; // вдруг лишние управляющие символы придут в начале строки?
       } // if
 
-      *strBuff += ch;
+      strBuff[writeIdx++] = ch;
+      strBuff[writeIdx] = '\0';
+      
       // не даём вычитать больше символов, чем надо - иначе нас можно заспамить
-      if(strBuff->length() >= MAX_RECEIVE_BUFFER_LENGTH)
+      if(writeIdx >= MAX_RECEIVE_BUFFER_LENGTH)
       {
          ClearCommand();
          return false;
@@ -32,5 +33,3 @@ bool CommandBuffer::HasCommand()
     return false;
 }
 //--------------------------------------------------------------------------------------------------------------------------------------
-
-
@@ -2,20 +2,23 @@
 #define _COMMAND_BUFFER_H
 
 #include <Stream.h>
+#include "Globals.h"
 //--------------------------------------------------------------------------------------------------------------------------------------
-// класс для накопления команды из потока
+// класс для накопления команды из потока, в буфер фиксированного размера - без выделения памяти
 //--------------------------------------------------------------------------------------------------------------------------------------
 class CommandBuffer
 {
 private:
   Stream* pStream;
-  String* strBuff;
+  char strBuff[MAX_RECEIVE_BUFFER_LENGTH + 1];
+  size_t writeIdx;
 public:
   CommandBuffer(Stream* s);
 
   bool HasCommand();
-  const String& GetCommand() {return *strBuff;}
-  void ClearCommand() { delete strBuff; strBuff = new String(); }
+  // буфер команды можно разбирать по месту (CommandParser::ParseCommand(char*,...)), до вызова ClearCommand
+  char* GetCommand() {return strBuff;}
+  void ClearCommand() { writeIdx = 0; strBuff[0] = '\0'; }
   Stream* GetStream() {return pStream;}
 
 };
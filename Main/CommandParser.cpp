@@ -1,7 +1,7 @@
 #include <Arduino.h>
 #include "CommandParser.h"
 //--------------------------------------------------------------------------------------------------------------------------------------
-Command::Command()
+Command::Command() : ownedData(NULL)
 {
 
   Clear();  
@@ -14,12 +14,12 @@ Command::~Command()
 //--------------------------------------------------------------------------------------------------------------------------------------
 size_t Command::GetArgsCount() const
 { 
-  return arguments.size();
+  return argsCount;
 }
 //--------------------------------------------------------------------------------------------------------------------------------------
 const char* Command::GetArg(size_t idx) const
 {
-  if(idx < arguments.size())
+  if(idx < argsCount)
     return arguments[idx];
 
  return NULL;
@@ -40,39 +40,66 @@ void Command::Construct(const char* id, const char* rawArgs, uint8_t ct)
   Clear(); // сбрасываем все настройки
   
     Type = ct;
-    ModuleID = id;
+
+    if(!id)
+      id = "";
+
+    Store(id,strlen(id),rawArgs,ct);
+}
+//--------------------------------------------------------------------------------------------------------------------------------------
+void Command::ConstructInPlace(const char* id, char* rawArgs, uint8_t ct)
+{
+  Clear(); // сбрасываем все настройки
+
+    Type = ct;
+    ModuleID = id ? id : "";
 
     if(!rawArgs) // нет аргументов
       return;
-       
-    // разбиваем на аргументы
-    const char* startPtr = rawArgs;
-    size_t len = 0;
+
+    SplitArgs(rawArgs);
+}
+//--------------------------------------------------------------------------------------------------------------------------------------
+void Command::Store(const char* id, size_t idLen, const char* rawArgs, uint8_t ct)
+{
+  // ID модуля и аргументы копируем в один блок памяти: "ID\0ARGS\0"
+  size_t dataLen = idLen + 1;
+  if(rawArgs)
+    dataLen += strlen(rawArgs) + 1;
+
+  ownedData = new char[dataLen];
+  memcpy(ownedData,id,idLen);
+  ownedData[idLen] = '\0';
+  ModuleID = ownedData;
+  Type = ct;
+
+  if(!rawArgs) // нет аргументов
+    return;
+
+  char* argsCopy = ownedData + idLen + 1;
+  strcpy(argsCopy,rawArgs);
+  SplitArgs(argsCopy);
+}
+//--------------------------------------------------------------------------------------------------------------------------------------
+void Command::SplitArgs(char* rawArgs)
+{
+    // разбиваем на аргументы, заменяя разделители на '\0'
+    char* startPtr = rawArgs;
 
     while(*startPtr)
     {
-      const char* delimPtr = strchr(startPtr,'|');
-            
-      if(!delimPtr)
-      {
-        len = strlen(startPtr);
-        char* newArg = new char[len + 1];
-        memset(newArg,0,len+1);
-        strncpy(newArg,startPtr,len);
-        arguments.push_back(newArg);        
+      arguments[argsCount++] = startPtr;
 
+      // место под аргументы кончилось - последний аргумент забирает остаток строки вместе с разделителями
+      if(argsCount >= MAX_ARGS_IN_LIST)
         return;
-      } // if(!delimPtr)
-
-      size_t len = delimPtr - startPtr;
-
-     
-      char* newArg = new char[len + 1];
-      memset(newArg,0,len+1);
-      strncpy(newArg,startPtr,len);
-      arguments.push_back(newArg);
 
+      char* delimPtr = strchr(startPtr,'|');
+            
+      if(!delimPtr)
+        return;
 
+      *delimPtr = '\0';
       startPtr = delimPtr + 1;
       
     } // while    
@@ -82,17 +109,13 @@ void Command::Construct(const char* id, const char* rawArgs, uint8_t ct)
 void Command::Clear()
 {
   Type = ctUNKNOWN;
-  ModuleID = F("");
+  ModuleID = "";
   IncomingStream = NULL;
   bIsInternal = false;
+  argsCount = 0;
 
-  size_t sz = arguments.size();
-  for(size_t i=0;i<sz;i++)
-  {
-    char* ch = arguments[i];
-    delete[] ch;
-  } // for
-  arguments.clear();
+  delete[] ownedData;
+  ownedData = NULL;
 
 }
 //--------------------------------------------------------------------------------------------------------------------------------------  
@@ -113,12 +136,57 @@ bool CommandParser::ParseCommand(const String& command, Command& outCommand)
   if(command.length() < MIN_COMMAND_LENGTH)
     return false;
 
-  const char* readPtr = command.c_str();
-  
+  uint8_t commandType;
+  const char* readPtr = ParseHeader(command.c_str(),commandType);
+  if(!readPtr)
+    return false;
+
+  // ищем, есть ли разделитель в строке. Если он есть, значит, передали ещё и параметры помимо просто имени модуля
+  const char* delimPtr = strchr(readPtr,'|');
+  if(!delimPtr)
+  {
+    // без параметров, тупо конструируем и выходим
+     outCommand.Construct(readPtr,NULL,commandType);
+     return true;
+  }
+
+  // есть параметры, имя модуля копируется вместе с аргументами одним блоком, без промежуточного буфера
+  outCommand.Clear();
+  outCommand.Store(readPtr,(delimPtr - readPtr),delimPtr + 1,commandType);
+  return true;
+   
+}
+//--------------------------------------------------------------------------------------------------------------------------------------
+bool CommandParser::ParseCommand(char* command, Command& outCommand)
+{
+  Clear(); // clear first
+
+  if(!command || strlen(command) < MIN_COMMAND_LENGTH)
+    return false;
+
+  uint8_t commandType;
+  char* readPtr = (char*) ParseHeader(command,commandType);
+  if(!readPtr)
+    return false;
+
+  char* delimPtr = strchr(readPtr,'|');
+  if(delimPtr)
+  {
+    // отрезаем имя модуля от параметров прямо в переданной строке
+    *delimPtr = '\0';
+    delimPtr++;
+  }
+
+  outCommand.ConstructInPlace(readPtr,delimPtr,commandType);
+  return true;
+}
+//--------------------------------------------------------------------------------------------------------------------------------------
+const char* CommandParser::ParseHeader(const char* readPtr, uint8_t& commandType)
+{
   bool rightPrefix = !strncmp_P(readPtr,(const char*)CMD_PREFIX,CMD_PREFIX_LEN);// || !strncmp_P(readPtr,(const char*)CHILD_PREFIX,CMD_PREFIX_LEN);
 
   if(!rightPrefix)
-    return false;
+    return NULL;
 
 
   // перемещаемся за префикс (CT или CD)
@@ -128,37 +196,13 @@ bool CommandParser::ParseCommand(const String& command, Command& outCommand)
   bool isGet = !strncmp_P(readPtr,(const char*)CMD_GET,CMD_TYPE_LEN);
   bool rightType =  isGet || !strncmp_P(readPtr,(const char*)CMD_SET,CMD_TYPE_LEN);
   if(!rightType)
-    return false;
+    return NULL;
 
 
-  uint8_t commandType = isGet ? ctGET : ctSET;
+  commandType = isGet ? ctGET : ctSET;
 
   // перемещаемся за тип команды и знак '='
-  readPtr += CMD_TYPE_LEN + 1;
-
-  // ищем, есть ли разделитель в строке. Если он есть, значит, передали ещё и параметры помимо просто имени модуля
-  const char* delimPtr = strchr(readPtr,'|');
-  if(!delimPtr)
-  {
-    // без параметров, тупо конструируем и выходим
-     outCommand.Construct(readPtr,NULL,commandType);
-     return true;
-  }
-
-  // есть параметры, надо выцепить имя модуля
-  size_t len = (delimPtr - readPtr);
-
-  
-  char* moduleName = new char[len+1];
-  memset(moduleName,0,len+1);
-  strncpy(moduleName,readPtr,len);
-  
-  delimPtr++;
-
-  outCommand.Construct(moduleName,delimPtr,commandType);
-  delete[] moduleName;
-  return true;
-   
+  return readPtr + CMD_TYPE_LEN + 1;
 }
 //--------------------------------------------------------------------------------------------------------------------------------------
 
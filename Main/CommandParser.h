@@ -34,7 +34,10 @@ typedef enum
   
 } COMMAND_TYPE; // тип команды
 //--------------------------------------------------------------------------------------------------------------------------------------
-typedef Vector<char*> CommandArgsVec;
+// Команда не копирует аргументы по отдельности: все они - указатели в одну строку, разбитую на части
+// заменой символов '|' на '\0'. Строка может принадлежать вызывающему (ConstructInPlace, ParseCommand(char*) - 
+// тогда разбор не выделяет памяти вообще, а строка должна жить, пока живёт команда), либо копируется
+// одним блоком в кучу (Construct, ParseCommand(const String&)).
 //--------------------------------------------------------------------------------------------------------------------------------------
 class Command
 {
@@ -42,13 +45,20 @@ class Command
 
 
     Stream* IncomingStream; // поток, из которого пришла команда
-    CommandArgsVec arguments; // аргументы команды
+    char* arguments[MAX_ARGS_IN_LIST]; // аргументы команды, указывают внутрь разбираемой строки
+    uint8_t argsCount; // кол-во аргументов
     
     bool bIsInternal; // флаг того, что команда получена от другого зарегистрированного модуля
     uint8_t Type; // тип команды
-    String ModuleID; // ID модуля
+    const char* ModuleID; // ID модуля
+    char* ownedData; // копия строки команды, если мы её выделяли сами
 
     void Clear();
+    void Store(const char* moduleID, size_t moduleIDLen, const char* rawArgs, uint8_t ct); // копирует ID модуля и аргументы одним блоком и разбирает копию
+    void SplitArgs(char* rawArgs); // разбивает строку аргументов по месту
+
+    Command(const Command& rhs);
+    Command& operator=(const Command& rhs);
 
  public:
 
@@ -64,12 +74,16 @@ class Command
     void Construct(const char* moduleID,const char* rawArgs, uint8_t ct); // конструирует команду из переданных аргументов
     void Construct(const char* moduleID,const char* rawArgs, const char* ct); // конструирует команду из переданных аргументов
 
+    // конструирует команду без выделения памяти: разбивает rawArgs по месту, сохраняя указатели на moduleID и аргументы.
+    // Переданные буферы должны жить, пока используется команда!
+    void ConstructInPlace(const char* moduleID, char* rawArgs, uint8_t ct);
+
 
     // возвращает тип команды
     uint8_t GetType() const {return Type;}
 
     // возвращает ID программного модуля, которому адресована команда
-    String GetTargetModuleID() const {return ModuleID;}
+    const char* GetTargetModuleID() const {return ModuleID;}
 
     // возвращает количество переданных аргументов
     size_t GetArgsCount() const;
@@ -79,6 +93,8 @@ class Command
     
     Command();
     ~Command();
+
+    friend class CommandParser;
 };
 //--------------------------------------------------------------------------------------------------------------------------------------
 // парсер команд
@@ -86,12 +102,14 @@ class Command
 class CommandParser
 {
   private:
+    const char* ParseHeader(const char* command, uint8_t& commandType); // проверяет префикс и тип команды, возвращает указатель на ID модуля или NULL
     
   public:
     CommandParser();
 
     void Clear();
-    bool ParseCommand(const String& command, Command& outCommand);
+    bool ParseCommand(const String& command, Command& outCommand); // разбирает копию строки, одно выделение памяти на команду
+    bool ParseCommand(char* command, Command& outCommand); // разбирает строку по месту, без выделения памяти - строка должна жить, пока живёт команда
 };
 //--------------------------------------------------------------------------------------------------------------------------------------
 #endif
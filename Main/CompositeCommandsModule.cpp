@@ -73,6 +73,7 @@ void CompositeCommandsModule::SaveCommands()
 {
   // сохраняем команды в EEPROM
     uint16_t addr = COMPOSITE_COMMANDS_START_ADDR;
+    MemBeginWrite();
     
     size_t cnt = commands.size();
   // сначала пишем кол-во команд
@@ -98,6 +99,7 @@ void CompositeCommandsModule::SaveCommands()
     } // for
     
     // записали
+    MemCommit();
 }
 //--------------------------------------------------------------------------------------------------------------------------------------
 void CompositeCommandsModule::Update(uint16_t dt)
@@ -54,4 +54,10 @@
 // MQTT debug mode (Don't use configuration software, only Port Monitor!)
 //#define MQTT_DEBUG
 //--------------------------------------------------------------------------------------------------------------------------------
+// профилирование главного цикла: время работы Update каждого модуля, минимум свободной памяти, кол-во обработанных команд.
+// Статистика доступна по команде CTGET=STAT|PROF (работает и с конфигуратором).
+// Main loop profiling: Update() cost of each module, free RAM low-water mark, processed commands count.
+// Statistics is available by CTGET=STAT|PROF command (configuration software can be used).
+//#define USE_LOOP_PROFILER
+//--------------------------------------------------------------------------------------------------------------------------------
 #endif
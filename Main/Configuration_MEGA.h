@@ -232,6 +232,9 @@
 #define RS_485_SERIAL Serial3 // ВНИМАНИЕ! СЛЕДИТЕ ЗА ОТСУТСТВИЕМ КОНФЛИКТОВ С SERIAL. ЭТОТ ЖЕ SERIAL ИСПОЛЬЗУЕТСЯ Nextion, т.е. либо Nextion по Serial, либо - RS-485!!!
 #define RS_485_UCSR UCSR3A // регистр, связанный с номером UART RS_485_SERIAL
 #define RS_485_TXC TXC3 // бит ТХ, связанный с номером UART RS_485_SERIAL
+#define RS_485_UCSRB UCSR3B // регистр управления UART RS_485_SERIAL
+#define RS_485_TXCIE TXCIE3 // бит разрешения прерывания по окончании передачи UART RS_485_SERIAL
+#define RS_485_TX_vect USART3_TX_vect // прерывание по окончании передачи UART RS_485_SERIAL
 #define RS_485_DE_PIN 26 // номер пина, на котором будет происходить переключение приёма/передачи по RS-485
 #define RS485_SPEED 57600 // скорость работы по RS-485
 #define RS485_STATE_PUSH_FREQUENCY 1000 // через сколько миллисекунд писать в шину RS-485 слепок состояния контроллера
@@ -366,6 +369,7 @@
 //--------------------------------------------------------------------------------------------------------------------------------
 #define MAX_ALERT_RULES 30 // максимальное кол-во поддерживаемых правил
 #define MAX_DELTAS 20 // максимальное кол-во дельт. Внимание: на 20 дельт нужно примерно 500 байт в EEPROM, следите за непересечением адресов!!!
+#define MAX_MODULE_STATES 48 // сколько всего состояний (показаний датчиков, включая универсальные и дельты) могут зарегистрировать модули, место под них выделяется статически, около 11 байт на состояние
 
 //--------------------------------------------------------------------------------------------------------------------------------
 // настройки интервалов обновлений модулей
@@ -376,7 +380,10 @@
 #define LUMINOSITY_UPDATE_INTERVAL 3000 // через сколько мс обновлять показания с датчиков освещенности 
 #define HUMIDITY_UPDATE_INTERVAL 5000 // через сколько мс обновлять показания с датчиков влажности
 #define TEMP_UPDATE_INTERVAL 4990 // через сколько мс обновлять показания с датчиков температуры
+#define TEMP_SENSORS_RESOLUTION temp12bit // разрешение датчиков DS18B20 (temp9bit - 94 мс на конвертацию, temp10bit - 188 мс, temp11bit - 375 мс, temp12bit - 750 мс)
 #define DELTA_UPDATE_INTERVAL 5010 // через сколько миллисекунд обновлять показания дельт?
+#define ACTUATORS_UPDATE_INTERVAL 100 // как часто обновлять модули фрамуг и досветки (моторы, реле, диоды ручного режима), мс
+#define TRANSPORTS_UPDATE_INTERVAL 5 // как часто между обновлениями модулей обслуживать транспорты (Wi-Fi, GSM), мс
 
 //--------------------------------------------------------------------------------------------------------------------------------
 // настройки модуля освещенности (BH1750, MAX44009) (актуально при раскомментированной команде USE_LUMINOSITY_MODULE)
@@ -437,8 +444,6 @@
 //--------------------------------------------------------------------------------------------------------------------------------
 #define PCF8574_ADDRESS 0x27 // адрес микросхемы для контроля pH на шине I2C (0x20 - 0x27)
 #define PH_SENSOR_PIN A14 // номер аналогового пина, с которого читать показания датчика (0 - нет датчика, прикреплённого к меге)
-#define PH_SAMPLES_PER_MEASURE 10 // сколько делать замеров на одно измерение pH (1-255)
-#define PH_SAMPLES_INTERVAL 20 // сколько миллисекунд между замерами в одном цикле измерения делать (10 - 255)
 #define PH_UPDATE_INTERVAL 15678 // через сколько миллисекунд обновлять показания с датчика pH, прикреплённого к меге
 #define PH_DEFAULT_CALIBRATION 0 // поправочное число по умолчанию, в сотых долях (т.е. 1 - это 0,01 сотая, 10 - это 0,1 и т.п.)
 #define PH_DEFAULT_TARGET 700 // желаемое значение pH раствора на выходе, по умолчанию, целое число (700 = 7.00, 651 = 6.51 и т.п.)
@@ -482,6 +487,7 @@
 
 // ДЛЯ ПЛАТЫ ВЫВОДЫ ДАТЧИКОВ ВЛАЖНОСТИ ПОЧВЫ - A2, A3 
 #define SOIL_MOISTURE_SENSORS {A2, FREQUENCY_SOIL_MOISTURE}//,{A3, ANALOG_SOIL_MOISTURE} // АНАЛОГОВЫЕ пины, на которых сидят датчики влажности почвы (через запятую, кол-во равно SUPPORTED_SOIL_MOISTURE_SENSORS!)
+// частотные датчики лучше подключать к A8-A15 или пинам внешних прерываний - тогда они измеряются в фоне, по прерыванию, без задержек в pulseIn
 
 #define SOIL_MOISTURE_UPDATE_INTERVAL 10000 // через сколько мс обновлять показания с датчиков влажности почвы
 #define SOIL_MOISTURE_100_PERCENT 450 // какие показания analogRead соответствуют датчику, погруженному в воду
@@ -836,6 +842,7 @@
 #define WIFI_WAIT_AFTER_REBOOT_TIME 5000 // сколько мс ждать после перезагрузки ESP прежде, чем начать обрабатывать команды
 #define WIFI_MAX_ANSWER_TIME 60000 // через сколько мс, если не получен ответ на команду от модема, считать его зависшим
 #define WIFI_IPD_READING_TIMEOUT 1000 // таймаут на чтение входящих данных от ESP, миллисекунд (+IPD)
+#define USE_WIFI_BINARY_FRAMING // принимать данные от ESP двоичными кадрами вместо строк +IPD (если прошивка ESP это не умеет - работаем по-старому), закомментировать, чтобы всегда работать через +IPD
 #define WIFI_REBOOT_PIN 11 // номер пина, на котором будет управление питанием GSM-модема (актуально при раскомментированной команде USE_WIFI_REBOOT_PIN)
 #define WIFI_POWER_OFF LOW // уровень для выключения питания
 #define WIFI_POWER_ON HIGH // уровень для включения питания
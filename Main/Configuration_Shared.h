@@ -186,6 +186,9 @@
 #define HTTP_SERVER_IP "gardenboss.ru"   // адрес хоста, который мы опрашиваем на команды (IP или доменное имя)
 #define HTTP_SERVER_HOST "gardenboss.ru" // имя хоста (для заголовка Host)
 #define HTTP_POLL_INTERVAL 300 // через сколько секунд проверять на команды (минимум - 300 секунд, т.е. 5 минут)
+//#define HTTP_COMPACT_REPORT // раскомментировать, если сервер понимает сжатый отчёт: шлются только изменившиеся байты показаний и состояния (параметры q, b, ds)
+#define HTTP_COMPACT_KEYFRAME_INTERVAL 12 // через сколько сжатых отчётов посылать полный отчёт, даже если сервер подтверждал все предыдущие
+#define HTTP_COMPACT_SNAPSHOT_SIZE 160 // максимальный размер слепка показаний и состояния для сжатого отчёта, байт (слепков два - отправленный и подтверждённый)
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 // ||
@@ -295,6 +298,23 @@
   #endif
 #endif
 //--------------------------------------------------------------------------------------------------------------------------------
+// если ESP или GSM-модем работают провайдерами HTTP-запросов, то данные в IoT уходят через общую очередь HTTP-запросов
+// (HttpQueue.h), а такой модуль не держит для IoT своё отдельное соединение и не регистрируется шлюзом IoT
+//--------------------------------------------------------------------------------------------------------------------------------
+#if defined(USE_IOT_MODULE)
+  #if defined(USE_WIFI_MODULE) && defined(USE_WIFI_MODULE_AS_HTTP_PROVIDER)
+    #define IOT_THROUGH_HTTP_QUEUE
+    #undef USE_WIFI_MODULE_AS_IOT_GATE
+  #endif
+
+  #if defined(USE_SMS_MODULE) && defined(USE_GSM_MODULE_AS_HTTP_PROVIDER)
+    #ifndef IOT_THROUGH_HTTP_QUEUE
+      #define IOT_THROUGH_HTTP_QUEUE
+    #endif
+    #undef USE_GSM_MODULE_AS_IOT_GATE
+  #endif
+#endif
+//--------------------------------------------------------------------------------------------------------------------------------
 // настройки максимумов
 //--------------------------------------------------------------------------------------------------------------------------------
 #define MAX_ARGS_IN_LIST 20 // максимальное кол-во аргументов у команды, передаваемой контроллеру по UART
@@ -465,6 +485,10 @@
 #ifdef USE_DS3231_REALTIME_CLOCK
 #define CURDATETIME_COMMAND F("DATETIME") // вывести текущую дату и время CTGET=STAT|DATETIME
 #endif
+#ifdef USE_LOOP_PROFILER
+#define PROFILE_COMMAND F("PROF") // статистика профилирования главного цикла CTGET=STAT|PROF, по модулю - CTGET=STAT|PROF|MODULE_NAME, сброс - CTSET=STAT|PROF
+#define MEMSTAT_COMMAND F("MEM") // статистика записи в EEPROM CTGET=STAT|MEM, сбрасывается вместе со статистикой профилирования
+#endif
 
 //--------------------------------------------------------------------------------------------------------------------------------
 // настройки модуля управления по SMS
@@ -557,7 +581,8 @@
 #define UNI_RF_CHANNEL_COMMAND F("RF") // команда на получение/установку канала для nRF
 #define PINS_COMMAND F("PINS") // получить состояние пинов, CTGET=0|PINS, ответ OK=PINS|Кол-во_байт_в_пакете|HEX-пакет_занятых_пинов|HEX-пакет_режима_пинов
 //--------------------------------------------------------------------------------------------------------------------------------
-#define SD_BUFFER_LENGTH 128 // размер буфера для блочного чтения с SD
+#define SD_BUFFER_LENGTH 128 // размер буфера для блочного чтения с SD и записи лога
+#define PUBLISH_CHUNK_SIZE 32 // размер блока, которым ответы модулей отдаются в поток команды
 //--------------------------------------------------------------------------------------------------------------------------------
 // общий буфер для команд
 //--------------------------------------------------------------------------------------------------------------------------------
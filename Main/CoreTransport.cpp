@@ -2,12 +2,19 @@
 #include "Settings.h"
 #include "ModuleController.h"
 #include "Memory.h"
+#include "Crc8.h"
 #include "InteropStream.h"
 //--------------------------------------------------------------------------------------------------------------------------------------
 #include <SdFat.h>
 //--------------------------------------------------------------------------------------------------------------------------------------
 #define CIPSEND_COMMAND F("AT+CIPSENDBUF=")
 //--------------------------------------------------------------------------------------------------------------------------------------
+// пул приёмных буферов транспортов
+//--------------------------------------------------------------------------------------------------------------------------------------
+static uint8_t transportPoolStorage[TRANSPORT_POOL_BLOCKS*TRANSPORT_POOL_BLOCK_SIZE];
+static uint8_t transportPoolMap[(TRANSPORT_POOL_BLOCKS+7)/8];
+VectorPool TransportBuffersPool(transportPoolStorage,transportPoolMap,TRANSPORT_POOL_BLOCK_SIZE,TRANSPORT_POOL_BLOCKS);
+//--------------------------------------------------------------------------------------------------------------------------------------
 // CoreTransportClient
 //--------------------------------------------------------------------------------------------------------------------------------------
 CoreTransportClient::CoreTransportClient()
@@ -298,7 +305,9 @@ CoreESPTransport ESP;
 CoreESPTransport::CoreESPTransport() : CoreTransport(ESP_MAX_CLIENTS)
 {
   recursionGuard = 0;
+  lineScanPos = 0;
   flags.waitCipstartConnect = false;
+  flags.binaryFraming = false;
   cipstartConnectClient = NULL;
   workStream = NULL;
 
@@ -309,7 +318,8 @@ void CoreESPTransport::readFromStream()
   if(!workStream)
     return;
     
-  while(workStream->available())
+  // читаем, пока есть место в буфере, остальное подождёт в потоке
+  while(!receiveBuffer.full() && workStream->available())
   {
     receiveBuffer.push_back((uint8_t) workStream->read());
   }
@@ -538,6 +548,15 @@ void CoreESPTransport::sendCommand(ESPCommands command)
     }
     break;
 
+    case cmdCIPFRAME:
+    {
+      #ifdef WIFI_DEBUG
+        DEBUG_LOGLN(F("ESP: request binary frames..."));
+      #endif
+      sendCommand(F("AT+CIPFRAME=1"));
+    }
+    break;
+
     case cmdWantReady:
     {
       #ifdef WIFI_DEBUG
@@ -861,15 +880,15 @@ void CoreESPTransport::processKnownStatusFromESP(const String& line)
    }  
 }
 //--------------------------------------------------------------------------------------------------------------------------------------
-bool CoreESPTransport::checkIPD(const TransportReceiveBuffer& buff)
+bool CoreESPTransport::checkIPD(const ESPReceiveBuffer& buff)
 {
   if(buff.size() < 9) // минимальная длина для IPD, на примере +IPD,1,1:
     return false;
 
   if(buff[0] == '+' && buff[1] == 'I' && buff[2] == 'P' && buff[3] == 'D')
   {
-    size_t to = min(buff.size(),20); // заглядываем вперёд на 20 символов, не больше
-    for(size_t i=4;i<to;i++)
+    uint16_t to = min(buff.size(),20); // заглядываем вперёд на 20 символов, не больше
+    for(uint16_t i=4;i<to;i++)
     {
       if(buff[i] == ':') // буфер начинается на +IPD и содержит дальше ':', т.е. за ним уже идут данные
         return true;
@@ -879,6 +898,94 @@ bool CoreESPTransport::checkIPD(const TransportReceiveBuffer& buff)
   return false;
 }
 //--------------------------------------------------------------------------------------------------------------------------------------
+#ifdef USE_WIFI_BINARY_FRAMING
+//--------------------------------------------------------------------------------------------------------------------------------------
+static uint8_t espFrameCRC(const ESPReceiveBuffer& buff, uint16_t from, uint16_t to)
+{
+  uint8_t crc = 0;
+  for(uint16_t i=from;i<to;i++)
+    crc = Crc8Update(crc,buff[i]);
+
+  return crc;
+}
+//--------------------------------------------------------------------------------------------------------------------------------------
+void CoreESPTransport::processFrame()
+{
+  // в начале буфера - двоичный кадр, разбираем его только тогда, когда он получен целиком
+  if(receiveBuffer.size() < ESP_FRAME_HEADER_SIZE)
+    return;
+
+  uint16_t dataLength = receiveBuffer[4] | (receiveBuffer[5] << 8);
+  if(dataLength > ESP_FRAME_MAX_PAYLOAD)
+  {
+    // это не кадр, пропускаем байт начала и дальше разбираем строки
+    receiveBuffer.remove(1);
+    lineScanPos = 0;
+    return;
+  }
+
+  uint16_t frameLength = ESP_FRAME_HEADER_SIZE + dataLength + 1;
+  if(receiveBuffer.size() < frameLength)
+    return; // ждём остаток кадра
+
+  uint8_t frameType = receiveBuffer[1];
+  uint8_t clientID = receiveBuffer[2];
+  CoreTransportClient* cl = getClient(clientID);
+  
+  if(espFrameCRC(receiveBuffer,1,frameLength-1) != receiveBuffer[frameLength-1])
+  {
+    // контрольная сумма не сошлась - это может быть случайный байт начала кадра в потоке строк,
+    // поэтому, как и при неверной длине, пропускаем только его и дальше разбираем буфер заново
+    #ifdef WIFI_DEBUG
+      DEBUG_LOGLN(F("ESP: BAD FRAME CRC, RESYNC!"));
+    #endif
+    
+    receiveBuffer.remove(1);
+    lineScanPos = 0;
+    return;
+  }
+
+  if((frameType & ~ESP_FRAME_LAST) != ESP_FRAME_DATA || !cl)
+  {
+    // целый кадр, но не с данными клиента, которого мы знаем - пропускаем его
+    #ifdef WIFI_DEBUG
+      DEBUG_LOGLN(F("ESP: UNKNOWN FRAME, SKIP!"));
+    #endif
+    
+    receiveBuffer.remove(frameLength);
+    lineScanPos = 0;
+    return;
+  }
+
+  #ifdef WIFI_DEBUG
+    DEBUG_LOG(F("FRAME DETECTED, CLIENT #"));
+    DEBUG_LOG(String(clientID));
+    DEBUG_LOG(F(", LENGTH="));
+    DEBUG_LOGLN(String(dataLength));
+  #endif
+
+  receiveBuffer.remove(ESP_FRAME_HEADER_SIZE);
+  lineScanPos = 0;
+
+  // данные отдаём клиенту прямо из приёмного буфера, как и для +IPD
+  while(dataLength > 0)
+  {
+    uint16_t sliceLength;
+    const uint8_t* slice = receiveBuffer.contiguousData(sliceLength);
+    if(sliceLength > dataLength)
+      sliceLength = dataLength;
+
+    dataLength -= sliceLength;
+    
+    notifyDataAvailable(*cl, (uint8_t*) slice, sliceLength, dataLength == 0 && (frameType & ESP_FRAME_LAST));
+    receiveBuffer.remove(sliceLength);
+  }
+
+  receiveBuffer.remove(1); // CRC
+}
+//--------------------------------------------------------------------------------------------------------------------------------------
+#endif // USE_WIFI_BINARY_FRAMING
+//--------------------------------------------------------------------------------------------------------------------------------------
 void CoreESPTransport::update()
 { 
   if(!workStream) // нет рабочего потока
@@ -945,31 +1052,29 @@ void CoreESPTransport::update()
   String thisCommandLine;
 
   // тут проверяем, есть ли чего интересующего в буфере?
+  #ifdef USE_WIFI_BINARY_FRAMING
+  if(flags.binaryFraming && receiveBuffer.size() && receiveBuffer[0] == ESP_FRAME_START)
+  {
+    processFrame();
+  }
+  else
+  #endif
   if(checkIPD(receiveBuffer))
   {
       
     // в буфере лежит +IPD,ID,DATA_LEN:
-      int16_t idx = receiveBuffer.indexOf(','); // ищем первую запятую после +IPD
-      uint8_t* ptr = receiveBuffer.pData();
-      ptr += idx+1;
-      // перешли за запятую, парсим ID клиента
-      String connectedClientID;
-      while(*ptr != ',')
-      {
-        connectedClientID += (char) *ptr;
-        ptr++;
-      }
-      ptr++; // за запятую
-      String dataLen;
-      while(*ptr != ':')
-      {
-        dataLen += (char) *ptr;
-        ptr++;
-      }
-  
-      // получили ID клиента и длину его данных, которые - пока в потоке, и надо их быстро попакетно вычитать
-      int ipdClientID = connectedClientID.toInt();
-      size_t ipdClientDataLength = dataLen.toInt();
+      // разбираем ID клиента и длину данных прямо в буфере
+      uint16_t pos = 5; // за "+IPD,"
+      int ipdClientID = 0;
+      while(receiveBuffer[pos] != ',' && receiveBuffer[pos] != ':')
+        ipdClientID = ipdClientID*10 + (receiveBuffer[pos++] - '0');
+
+      if(receiveBuffer[pos] == ',')
+        pos++; // за запятую
+        
+      size_t ipdClientDataLength = 0;
+      while(receiveBuffer[pos] != ':')
+        ipdClientDataLength = ipdClientDataLength*10 + (receiveBuffer[pos++] - '0');
 
       #ifdef WIFI_DEBUG
         DEBUG_LOG(F("+IPD DETECTED, CLIENT #"));
@@ -979,94 +1084,61 @@ void CoreESPTransport::update()
       #endif
 
       // удаляем +IPD,ID,DATA_LEN:
-      receiveBuffer.remove(0,receiveBuffer.indexOf(':')+1);
+      receiveBuffer.remove(pos+1);
+      lineScanPos = 0;
 
       // у нас есть длина данных к вычитке, плюс сколько-то их лежит в буфере уже.
       // читать всё - мы не можем, т.к. данные могут быть гигантскими.
-      // следовательно, надо читать по пакетам.
+      // следовательно, отдаём их клиенту по пакетам, прямо из приёмного буфера, без копирования.
       CoreTransportClient* cl = getClient(ipdClientID);
+      size_t remainingDataLength = ipdClientDataLength;
 
-      if(receiveBuffer.size() >= ipdClientDataLength)
+      while(remainingDataLength > 0)
       {
-        // на время события мы должны обеспечить неизменность буфера, т.к.
-        // в обработчике события может быть вызван yield, у указатель на память станет невалидным!
-        
-        uint8_t* thisBuffer = new uint8_t[ipdClientDataLength];
-        memcpy(thisBuffer,receiveBuffer.pData(),ipdClientDataLength);
-
-        receiveBuffer.remove(0,ipdClientDataLength);
-
-        if(!receiveBuffer.size())
-          receiveBuffer.clear();
-          
-        // весь пакет - уже в буфере
-        notifyDataAvailable(*cl, thisBuffer, ipdClientDataLength, true);
-        delete [] thisBuffer;
-                
-      }
-      else
-      {
-        // не хватает части пакета в буфере.
-        
-        // теперь смотрим, сколько у нас данных ещё не послано клиентам
-        size_t remainingDataLength = ipdClientDataLength;
-
-        // нам осталось послать remainingDataLength данных клиентам,
-        // побив их на пакеты длиной максимум TRANSPORT_MAX_PACKET_LENGTH
-
-        // вычисляем длину одного пакета
-        size_t packetLength = min(TRANSPORT_MAX_PACKET_LENGTH,remainingDataLength);
+          // вычисляем длину одного пакета
+          uint16_t packetLength = min(TRANSPORT_MAX_PACKET_LENGTH,remainingDataLength);
 
-        while(remainingDataLength > 0)
-        {
-            // читаем, пока не хватает данных для одного пакета
-            while(receiveBuffer.size() < packetLength)
-            {
-                #ifdef USE_SMS_MODULE
-                  SIM800.readFromStream();
-                #endif
+          // читаем, пока не хватает данных для одного пакета
+          while(receiveBuffer.size() < packetLength)
+          {
+              #ifdef USE_SMS_MODULE
+                SIM800.readFromStream();
+              #endif
               
-                // данных не хватает, дочитываем
-                if(!workStream->available())
-                  continue;
-    
-                receiveBuffer.push_back((uint8_t) workStream->read());
-                
-            } // while
-
-            // вычитали один пакет, уведомляем клиентов, при этом может пополниться буфер,
-            // поэтому сохраняем пакет так, чтобы указатель на него был всегда валидным.
-            uint8_t* thisBuffer = new uint8_t[packetLength];
-            memcpy(thisBuffer,receiveBuffer.pData(),packetLength);
-
-            receiveBuffer.remove(0,packetLength);
-            if(!receiveBuffer.size())
-              receiveBuffer.clear();
-
-            notifyDataAvailable(*cl, thisBuffer, packetLength, (remainingDataLength - packetLength) == 0);
-            delete [] thisBuffer;
-            
-            remainingDataLength -= packetLength;
-            packetLength = min(TRANSPORT_MAX_PACKET_LENGTH,remainingDataLength);
-        } // while
-
+              readFromStream();
+          } // while
+
+          // пакет может переходить через конец кольцевого буфера - тогда отдаём его непрерывную часть,
+          // остаток уйдёт следующим пакетом
+          uint16_t sliceLength;
+          const uint8_t* slice = receiveBuffer.contiguousData(sliceLength);
+          if(sliceLength > packetLength)
+            sliceLength = packetLength;
+
+          remainingDataLength -= sliceLength;
+
+          // во время события буфер может пополниться, но данные пакета при этом не трогаются,
+          // поэтому удаляем их из буфера только после обработки события
+          notifyDataAvailable(*cl, (uint8_t*) slice, sliceLength, remainingDataLength == 0);
+          receiveBuffer.remove(sliceLength);
           
-      } // else
+      } // while
 
     
   } // if(checkIPD(receiveBuffer))
-  else if(flags.waitForDataWelcome && receiveBuffer[0] == '>')
+  else if(flags.waitForDataWelcome && receiveBuffer.size() && receiveBuffer[0] == '>')
   {
     flags.waitForDataWelcome = false;
     thisCommandLine = '>';
     hasAnswerLine = true;
 
-    receiveBuffer.remove(0,1);
+    receiveBuffer.remove(1);
+    lineScanPos = 0;
   }
   else // любые другие ответы от ESP
   {
-    // ищем до первого перевода строки
-    size_t cntr = 0;
+    // ищем до первого перевода строки, начиная с того места, где остановились в прошлый раз
+    uint16_t cntr = lineScanPos;
     for(;cntr<receiveBuffer.size();cntr++)
     {
       if(receiveBuffer[cntr] == '\n')
@@ -1079,21 +1151,30 @@ void CoreESPTransport::update()
 
     if(hasAnswerLine) // нашли перевод строки в потоке
     {
-      for(size_t i=0;i<cntr;i++)
+      thisCommandLine.reserve(cntr);
+      for(uint16_t i=0;i<cntr;i++)
       {
         if(receiveBuffer[i] != '\r' && receiveBuffer[i] != '\n')
           thisCommandLine += (char) receiveBuffer[i];
       } // for
 
-      receiveBuffer.remove(0,cntr);
+      receiveBuffer.remove(cntr);
+      lineScanPos = 0;
       
     } // if(hasAnswerLine)
+    else if(receiveBuffer.full())
+    {
+      // буфер забит строкой без перевода строки - это мусор, выкидываем его
+      #ifdef WIFI_DEBUG
+        DEBUG_LOGLN(F("ESP: receive buffer overflow!"));
+      #endif
+      receiveBuffer.clear();
+      lineScanPos = 0;
+    }
+    else
+      lineScanPos = cntr; // в следующий раз продолжим поиск отсюда
   } // else
 
-  // если в приёмном буфере ничего нету - просто почистим память
-  if(!receiveBuffer.size())
-    receiveBuffer.clear();
-
 
   if(hasAnswerLine && !thisCommandLine.length()) // пустая строка, не надо обрабатывать
     hasAnswerLine = false;
@@ -1500,6 +1581,22 @@ void CoreESPTransport::update()
                   }
                   break; // cmdWantReady
 
+                  case cmdCIPFRAME:
+                  {
+                    if(isKnownAnswer(thisCommandLine,knownAnswer))
+                    {
+                      // прошивка ESP, не знающая кадров, ответит ERROR - тогда данные идут через +IPD
+                      flags.binaryFraming = (knownAnswer == kaOK);
+                      
+                      #ifdef WIFI_DEBUG
+                        DEBUG_LOG(F("ESP: binary frames "));
+                        DEBUG_LOGLN(flags.binaryFraming ? F("ON.") : F("not supported."));
+                      #endif
+                      machineState = espIdle; // переходим к следующей команде
+                    }
+                  }
+                  break; // cmdCIPFRAME
+
                   case cmdEchoOff:
                   {
                     if(isKnownAnswer(thisCommandLine,knownAnswer))
@@ -1768,6 +1865,7 @@ void CoreESPTransport::restart()
 {
   // очищаем входной буфер
   receiveBuffer.clear();
+  lineScanPos = 0;
 
   // очищаем очередь клиентов, заодно им рассылаем события
   clearClientsQueue(true);
@@ -1779,6 +1877,7 @@ void CoreESPTransport::restart()
   flags.connectedToRouter = false;
   flags.wantReconnect = false;
   flags.onIdleTimer = false;
+  flags.binaryFraming = false; // после перезагрузки ESP шлёт +IPD, пока снова не попросим кадры
   
   timer = millis();
 
@@ -1811,6 +1910,9 @@ void CoreESPTransport::createInitCommands(bool addResetCommand)
   initCommandsQueue.push_back(cmdCIPMODE); // устанавливаем режим работы
   initCommandsQueue.push_back(cmdCWSAP); // создаём точку доступа
   initCommandsQueue.push_back(cmdCWMODE); // // переводим в смешанный режим
+  #ifdef USE_WIFI_BINARY_FRAMING
+  initCommandsQueue.push_back(cmdCIPFRAME); // просим данные клиентов двоичными кадрами
+  #endif
   initCommandsQueue.push_back(cmdEchoOff); // выключаем эхо
   
   if(addResetCommand)
@@ -2021,6 +2123,7 @@ CoreMQTT::CoreMQTT()
   mqttMessageId = 0;
   streamBuffer = new String();
   currentTopicNumber = 0;
+  topicsLoaded = false;
 }
 //--------------------------------------------------------------------------------------------------------------------------------------
 void CoreMQTT::AddTopic(const char* topicIndex, const char* topicName, const char* moduleName, const char* sensorType, const char* sensorIndex, const char* topicType)
@@ -2067,13 +2170,16 @@ void CoreMQTT::AddTopic(const char* topicIndex, const char* topicName, const cha
     DEBUG_LOGLN(fName);
   }
   #endif  
+
+  // список топиков изменился - перечитаем его с SD при следующей публикации
+  clearTopics();
 }
 //--------------------------------------------------------------------------------------------------------------------------------
 void CoreMQTT::DeleteAllTopics()
 {
   // удаляем все топики
   FileUtils::RemoveFiles(F("MQTT"));
-  currentTopicNumber = 0;
+  clearTopics();
 }
 //--------------------------------------------------------------------------------------------------------------------------------
 uint16_t CoreMQTT::GetSavedTopicsCount()
@@ -2109,6 +2215,47 @@ void CoreMQTT::clearPublishQueue()
   publishList.clear();
 }
 //--------------------------------------------------------------------------------------------------------------------------------------
+void CoreMQTT::processIncomingPackets(uint8_t* data, size_t dataLength)
+{
+  // поскольку публикуем пачками, брокер может вернуть несколько пакетов сразу - разбираем их по одному
+  size_t packetStart = 0;
+  
+  while(packetStart < dataLength)
+  {
+    // декодируем длину пакета
+    uint32_t multiplier = 1;
+    uint32_t remainingLength = 0;
+    size_t curReadPos = packetStart + 1;
+    uint8_t encodedByte;
+
+    do
+    {
+      if(curReadPos >= dataLength || multiplier > 0x200000) // malformed, отдаём остаток как есть
+      {
+        processIncomingPacket(&currentClient, data + packetStart, dataLength - packetStart);
+        return;
+      }
+      
+      encodedByte = data[curReadPos];
+      curReadPos++;
+      
+      remainingLength += (encodedByte & 127) * multiplier;
+      multiplier *= 128;
+      
+    } while ((encodedByte & 128) != 0);
+
+    size_t packetLength = (curReadPos - packetStart) + remainingLength;
+    
+    if(packetStart + packetLength > dataLength)
+      packetLength = dataLength - packetStart;
+
+    processIncomingPacket(&currentClient, data + packetStart, packetLength);
+
+    packetStart += packetLength;
+  } // while
+  
+}
+//--------------------------------------------------------------------------------------------------------------------------------------
 void CoreMQTT::processIncomingPacket(CoreTransportClient* client, uint8_t* packet, size_t dataLen)
 {
   UNUSED(client);
@@ -2365,7 +2512,7 @@ void CoreMQTT::OnClientDataAvailable(CoreTransportClient& client, uint8_t* data,
      #endif
 
     // по-любому обрабатываем обратку
-    processIncomingPacket(&currentClient, packetBuffer.pData(), packetBuffer.size());
+    processIncomingPackets(packetBuffer.pData(), packetBuffer.size());
 
     packetBuffer.clear();
   }
@@ -2384,7 +2531,7 @@ void CoreMQTT::OnClientDataAvailable(CoreTransportClient& client, uint8_t* data,
       if(!isDone) // ещё не все данные получены
         return;
       
-      processIncomingPacket(&currentClient, packetBuffer.pData(), packetBuffer.size());
+      processIncomingPackets(packetBuffer.pData(), packetBuffer.size());
 
       packetBuffer.clear();
   }
@@ -2663,10 +2810,9 @@ void CoreMQTT::update()
             DEBUG_LOGLN(F("MQTT: start send connect packet!"));
           #endif  
   
-          String mqttBuffer;
-          int16_t mqttBufferLength;
+          sendBuffer.empty();
           
-          constructConnectPacket(mqttBuffer,mqttBufferLength,
+          constructConnectPacket(sendBuffer,
             currentSettings.clientID.c_str() // client id
           , currentSettings.userName.length() ? currentSettings.userName.c_str() : NULL // user
           , currentSettings.password.length() ? currentSettings.password.c_str() : NULL // pass
@@ -2684,7 +2830,7 @@ void CoreMQTT::update()
           #endif
           
           // сформировали пакет CONNECT, теперь отсылаем его брокеру
-          currentClient.write((uint8_t*) mqttBuffer.c_str(),mqttBufferLength);
+          currentClient.write(sendBuffer.pData(),sendBuffer.size());
          
           timer = millis();
         }  // if(currentClient)
@@ -2709,13 +2855,12 @@ void CoreMQTT::update()
 
         if(currentClient.connected())
         {
-          String mqttBuffer;
-          int16_t mqttBufferLength;
+          sendBuffer.empty();
 
           // конструируем пакет подписки
           String topic = currentSettings.clientID;
           topic +=  F("/#");
-          constructSubscribePacket(mqttBuffer,mqttBufferLength, topic.c_str());
+          constructSubscribePacket(sendBuffer, topic.c_str());
   
           // переключаемся на ожидание результата отсылки пакета
           machineState = mqttWaitSendSubscribePacketDone;
@@ -2725,7 +2870,7 @@ void CoreMQTT::update()
           #endif
           
           // сформировали пакет SUBSCRIBE, теперь отсылаем его брокеру
-          currentClient.write((uint8_t*) mqttBuffer.c_str(),mqttBufferLength);
+          currentClient.write(sendBuffer.pData(),sendBuffer.size());
           timer = millis();
         }
         else
@@ -2751,114 +2896,46 @@ void CoreMQTT::update()
         {
           if(currentClient.connected())
           {
-            String mqttBuffer;
-            int16_t mqttBufferLength;
-  
-            String topicName, data;
+            sendBuffer.empty();
 
-            if(hasReportTopics)
-            {
-              // у нас есть топик для репорта
-              topicName =  currentSettings.clientID + REPORT_TOPIC_NAME;
-
-              // удаляем перевод строки
-              reportQueue[0]->trim();
-
-              // тут в имя топика надо добавить запрошенную команду, чтобы в клиенте можно было ориентироваться
-              // на конкретные топики отчёта
-              int16_t idx = reportQueue[0]->indexOf("=");
-              String commandStatus = reportQueue[0]->substring(0,idx);
-              reportQueue[0]->remove(0,idx+1);
-
-              // теперь в reportQueue[0] у нас лежит ответ после OK= или ER=
-              String delim = PARAM_DELIMITER;
-              idx = reportQueue[0]->indexOf(delim);
-              if(idx != -1)
-              {
-                // есть ответ с параметрами, выцепляем первый - это и будет дополнением к имени топика
-                topicName += reportQueue[0]->substring(0,idx);
-                reportQueue[0]->remove(0,idx);
-                *reportQueue[0] = commandStatus + *reportQueue[0];
-              }
-              else
-              {
-                // только один ответ - имя команды, без возвращённых параметров
-                topicName += *reportQueue[0];
-                *reportQueue[0] = commandStatus;
-              }
-              
+            // сначала собираем в пачку отчёты о выполнении команд и сторонние топики
+            while(reportQueue.size() && sendBuffer.size() < MQTT_PUBLISH_BATCH_SIZE)
+              putReport();
 
-              #ifdef MQTT_REPORT_AS_JSON
-                convertAnswerToJSON(*(reportQueue[0]),&data);
-              #else
-                data = *(reportQueue[0]);            
-              #endif
+            while(publishList.size() && sendBuffer.size() < MQTT_PUBLISH_BATCH_SIZE)
+              putPublishQueue();
 
-              // тут удаляем из очереди первое вхождение отчёта
-              if(reportQueue.size() < 2)
-                clearReportsQueue();
-              else
-              {
-                  delete reportQueue[0];
-                  for(size_t k=1;k<reportQueue.size();k++)
-                  {
-                    reportQueue[k-1] = reportQueue[k];
-                  }
-                  reportQueue.pop();
-              }
-            } // hasReportTopics
-            else
-            if(hasPublishTopics)
+            if(!hasReportTopics && !hasPublishTopics)
             {
-              // есть пакеты для публикации
-              MQTTPublishQueue pq = publishList[0];
-
-              // тут публикуем из пакета для публикации
-              topicName =  currentSettings.clientID + "/";
-              topicName += pq.topic;
-
-              if(pq.payload)
-                data = pq.payload;
+              // обычный режим работы, отсылаем показания с хранилища. В пачку идут топики подряд,
+              // пока не наберётся MQTT_PUBLISH_BATCH_SIZE байт или не закончится список
+              if(!topicsLoaded)
+                loadTopics();
 
-              // чистим память
-              delete [] pq.topic;
-              delete [] pq.payload;
-              
-              // и удаляем из списка
-              if(publishList.size() < 2)
-                publishList.clear();
-              else
+              while(topics.size() && sendBuffer.size() < MQTT_PUBLISH_BATCH_SIZE)
               {
-                for(size_t kk=1;kk<publishList.size();kk++)
-                {
-                  publishList[kk-1] = publishList[kk];  
-                }
-                publishList.pop();
+                putNextTopic();
+                
+                if(!currentTopicNumber) // дошли до конца списка, следующая пачка начнётся сначала
+                  break;
               }
-            } // hasPublishTopics
-            else
-            {
-                // обычный режим работы, отсылаем показания с хранилища
-                getNextTopic(topicName,data);
-
             } // else send topics
 
-              if(data.length() && topicName.length())
-              {
-                 // конструируем пакет публикации
-                 constructPublishPacket(mqttBuffer,mqttBufferLength,topicName.c_str(), data.c_str()); 
-      
-                // переключаемся на ожидание результата отсылки пакета
-                machineState = mqttWaitSendPublishPacketDone;
+            if(sendBuffer.size())
+            {
+              // переключаемся на ожидание результата отсылки пакета
+              machineState = mqttWaitSendPublishPacketDone;
 
-                #ifdef MQTT_DEBUG
-                  DEBUG_LOGLN(F("MQTT: WRITE PUBLISH PACKET TO CLIENT!"));
-                #endif
+              #ifdef MQTT_DEBUG
+                DEBUG_LOG(F("MQTT: WRITE PUBLISH PACKETS TO CLIENT, BYTES: "));
+                DEBUG_LOGLN(String(sendBuffer.size()));
+              #endif
 
-                // сформировали пакет PUBLISH, теперь отсылаем его брокеру
-                currentClient.write((uint8_t*) mqttBuffer.c_str(),mqttBufferLength);
-                timer = millis();
-              }
+              // сформировали пачку пакетов PUBLISH, теперь отсылаем её брокеру одной записью
+              currentClient.write(sendBuffer.pData(),sendBuffer.size());
+            }
+            
+            timer = millis();
           }
           else
           {
@@ -2897,77 +2974,115 @@ void CoreMQTT::update()
   
 }
 //--------------------------------------------------------------------------------------------------------------------------------------
-void CoreMQTT::getNextTopic(String& topicName, String& data)
+void CoreMQTT::clearTopics()
 {
-  topicName = "";
-  data = "";
+  for(size_t i=0;i<topics.size();i++)
+  {
+    delete [] topics[i].strings;
+  }
 
-  String topicFileName = MQTT_FILENAME_PATTERN;
-  topicFileName += String(currentTopicNumber);
+  topics.clear();
+  topicsLoaded = false;
+  currentTopicNumber = 0;
+}
+//--------------------------------------------------------------------------------------------------------------------------------------
+void CoreMQTT::loadTopics()
+{
+  // читаем все топики с SD за один проход, дальше публикуем из памяти
+  clearTopics();
+  topicsLoaded = true;
 
-  if(!SDFat.exists(topicFileName.c_str())) // нет топика
-  {
-    yield();
-    currentTopicNumber = 0; // переключаемся на первый топик
+  if(!MainController->HasSDCard()) // нет SD-карты - нет и топиков
     return;
-  }
 
-  // тут можем читать из файла настроек топика
-  SdFile f;
-  
-  if(!f.open(topicFileName.c_str(),FILE_READ)) // не получилось открыть файл
+  for(uint16_t topicNumber=0;;topicNumber++)
   {
+    String topicFileName = MQTT_FILENAME_PATTERN;
+    topicFileName += String(topicNumber);
+
+    SdFile f;
+    
+    if(!f.open(topicFileName.c_str(),FILE_READ)) // нет следующего топика
+    {
+      yield();
+      break;
+    }
+
+    // первой строкой идёт имя топика
+    String topicName;
+    FileUtils::readLine(f,topicName);
+  
+    // второй строкой - идёт имя модуля, в котором взять нужные показания
+    String moduleName;
+    FileUtils::readLine(f,moduleName);
+  
+    // в третьей строке - тип датчика, числовое значение соответствует перечислению ModuleStates
+    String sensorTypeString;
+    FileUtils::readLine(f,sensorTypeString);
+  
+    // в четвёртой строке - индекс датчика в модуле
+    String sensorIndexString;
+    FileUtils::readLine(f,sensorIndexString);
+  
+    // в пятой строке - тип топика: показания с датчиков (0), или статус контроллера (1).
+    // в случае статуса контроллера во второй строке - команда, которую надо запросить у контроллера
+    String topicType;
+    FileUtils::readLine(f,topicType);
+    
+    // не забываем закрыть файл
+    f.close();
     yield();
-    switchToNextTopic();
-    return;          
-  }
 
-  // теперь читаем настройки топика
-  // первой строкой идёт имя топика
-  FileUtils::readLine(f,topicName);
+    MQTTTopic topic;
+    topic.topicType = topicType == F("1") ? 1 : 0;
+    topic.sensorType = sensorTypeString.toInt();
+    topic.sensorIndex = sensorIndexString.toInt();
+
+    if(topic.topicType == 1) // топик со статусом контроллера
+    {
+      // тут тонкость - команда у нас с изменёнными параметрами, где все разделители заменены на символ @
+      // поэтому сразу меняем назад
+      moduleName.replace('@','|');
+    }
 
-  // добавляем ID клиента перед именем топика
-  topicName = currentSettings.clientID + "/" + topicName;  
+    // имя топика и команду (или имя модуля) храним в одном блоке памяти, через завершающий ноль.
+    // модуль ищем в момент публикации, т.к. он мог зарегистрироваться позже загрузки топиков
+    topic.strings = new char[topicName.length() + moduleName.length() + 2];
+    strcpy(topic.strings,topicName.c_str());
+    strcpy(topic.strings + topicName.length() + 1,moduleName.c_str());
 
-  // второй строкой - идёт имя модуля, в котором взять нужные показания
-  String moduleName;
-  FileUtils::readLine(f,moduleName);
+    topics.push_back(topic);
+    
+  } // for
 
-  // в третьей строке - тип датчика, числовое значение соответствует перечислению ModuleStates
-  String sensorTypeString;
-  FileUtils::readLine(f,sensorTypeString);
-  ModuleStates sensorType = (ModuleStates) sensorTypeString.toInt();
+  #ifdef MQTT_DEBUG
+    DEBUG_LOG(F("MQTT: topics loaded: "));
+    DEBUG_LOGLN(String(topics.size()));
+  #endif
+}
+//--------------------------------------------------------------------------------------------------------------------------------------
+void CoreMQTT::putNextTopic()
+{
+  if(currentTopicNumber >= topics.size())
+    currentTopicNumber = 0;
 
-  // в четвёртой строке - индекс датчика в модуле
-  String sensorIndexString;
-  FileUtils::readLine(f,sensorIndexString);
-  int sensorIndex = sensorIndexString.toInt();
+  MQTTTopic& topic = topics[currentTopicNumber];
+  switchToNextTopic();
 
-  // в пятой строке - тип топика: показания с датчиков (0), или статус контроллера (1).
-  // в случае статуса контроллера во второй строке - команда, которую надо запросить у контроллера
-  String topicType;
-  FileUtils::readLine(f,topicType);
-  
-  
-  // не забываем закрыть файл
-  f.close();
-  yield();
+  String data;
 
-  if(topicType == F("1")) // топик со статусом контроллера
+  if(topic.topicType == 1) // топик со статусом контроллера
   {
    
     #ifdef MQTT_DEBUG
       DEBUG_LOGLN(F("Status topic found - process command..."));
     #endif
-        
-     //Тут работаем с топиком статуса контроллера
 
-      // тут тонкость - команда у нас с изменёнными параметрами, где все разделители заменены на символ @
-      // поэтому перед выполнением - меняем назад
-      moduleName.replace('@','|');
+      // команда лежит сразу за именем топика
+      String command = topic.strings + strlen(topic.strings) + 1;
 
       yield();
-      ModuleInterop.QueryCommand(ctGET, moduleName, true);
+      ModuleInterop.QueryCommand(ctGET, command, true);
       yield();
 
       #ifdef MQTT_REPORT_AS_JSON
@@ -2975,44 +3090,114 @@ void CoreMQTT::getNextTopic(String& topicName, String& data)
       #else // ответ как есть, в виде RAW
         data = PublishSingleton.Text;
       #endif
-
-       switchToNextTopic();
-      
-      return; // нашли и отослали показания
-
     
   } // if
   else // топик с показаниями датчика
   {
-      // теперь получаем модуль у контроллера
-      AbstractModule* mod = MainController->GetModuleByID(moduleName.c_str());
+      // имя модуля лежит сразу за именем топика
+      AbstractModule* mod = MainController->GetModuleByID(topic.strings + strlen(topic.strings) + 1);
 
       if(!mod) // не нашли такой модуль
-      {
-        switchToNextTopic();
         return;
-      }
 
       // получаем состояние
-      OneState* os = mod->State.GetState(sensorType,sensorIndex);
+      OneState* os = mod->State.GetState((ModuleStates) topic.sensorType,topic.sensorIndex);
 
       if(!os) // нет такого состояния
-      {
-        switchToNextTopic();
-        return;          
-      }
+        return;
 
       // теперь получаем данные состояния
       if(os->HasData()) // данные с датчика есть, можем читать
         data = *os;
       else
         data = "-"; // нет данных с датчика  
-
-       switchToNextTopic();
-      
-      return; // нашли и отослали показания
        
   } // sensor data topic    
+
+  if(data.length())
+    constructPublishPacket(sendBuffer,currentSettings.clientID.c_str(),topic.strings,data.c_str());
+}
+//--------------------------------------------------------------------------------------------------------------------------------------
+void CoreMQTT::putReport()
+{
+  // у нас есть топик для репорта
+  String topicName =  currentSettings.clientID + REPORT_TOPIC_NAME;
+  String data;
+
+  // удаляем перевод строки
+  reportQueue[0]->trim();
+
+  // тут в имя топика надо добавить запрошенную команду, чтобы в клиенте можно было ориентироваться
+  // на конкретные топики отчёта
+  int16_t idx = reportQueue[0]->indexOf("=");
+  String commandStatus = reportQueue[0]->substring(0,idx);
+  reportQueue[0]->remove(0,idx+1);
+
+  // теперь в reportQueue[0] у нас лежит ответ после OK= или ER=
+  String delim = PARAM_DELIMITER;
+  idx = reportQueue[0]->indexOf(delim);
+  if(idx != -1)
+  {
+    // есть ответ с параметрами, выцепляем первый - это и будет дополнением к имени топика
+    topicName += reportQueue[0]->substring(0,idx);
+    reportQueue[0]->remove(0,idx);
+    *reportQueue[0] = commandStatus + *reportQueue[0];
+  }
+  else
+  {
+    // только один ответ - имя команды, без возвращённых параметров
+    topicName += *reportQueue[0];
+    *reportQueue[0] = commandStatus;
+  }
+  
+
+  #ifdef MQTT_REPORT_AS_JSON
+    convertAnswerToJSON(*(reportQueue[0]),&data);
+  #else
+    data = *(reportQueue[0]);            
+  #endif
+
+  // тут удаляем из очереди первое вхождение отчёта
+  if(reportQueue.size() < 2)
+    clearReportsQueue();
+  else
+  {
+      delete reportQueue[0];
+      for(size_t k=1;k<reportQueue.size();k++)
+      {
+        reportQueue[k-1] = reportQueue[k];
+      }
+      reportQueue.pop();
+  }
+
+  if(data.length() && topicName.length())
+    constructPublishPacket(sendBuffer,NULL,topicName.c_str(),data.c_str());
+}
+//--------------------------------------------------------------------------------------------------------------------------------------
+void CoreMQTT::putPublishQueue()
+{
+  // есть пакеты для публикации
+  MQTTPublishQueue pq = publishList[0];
+
+  // тут публикуем из пакета для публикации
+  if(pq.payload && *pq.payload && *pq.topic)
+    constructPublishPacket(sendBuffer,currentSettings.clientID.c_str(),pq.topic,pq.payload);
+
+  // чистим память
+  delete [] pq.topic;
+  delete [] pq.payload;
+  
+  // и удаляем из списка
+  if(publishList.size() < 2)
+    publishList.clear();
+  else
+  {
+    for(size_t kk=1;kk<publishList.size();kk++)
+    {
+      publishList[kk-1] = publishList[kk];  
+    }
+    publishList.pop();
+  }
 }
 //--------------------------------------------------------------------------------------------------------------------------------------
 void CoreMQTT::switchToNextTopic()
@@ -3021,13 +3206,8 @@ void CoreMQTT::switchToNextTopic()
     currentTopicNumber++;
     
     // проверим - не надо ли завернуть на старт?
-    String topicFileName = MQTT_FILENAME_PATTERN;
-    topicFileName += String(currentTopicNumber);
-    if(!SDFat.exists(topicFileName.c_str()))
-    {
-      yield();
-      currentTopicNumber = 0; // следующего файла нет, начинаем сначала
-    }
+    if(currentTopicNumber >= topics.size())
+      currentTopicNumber = 0; // следующего топика нет, начинаем сначала
   
 }
 //--------------------------------------------------------------------------------------------------------------------------------
@@ -3041,34 +3221,34 @@ void CoreMQTT::clearReportsQueue()
   reportQueue.clear();
 }
 //--------------------------------------------------------------------------------------------------------------------------------------
-void CoreMQTT::constructPublishPacket(String& mqttBuffer,int16_t& mqttBufferLength, const char* topic, const char* payload)
+void CoreMQTT::constructPublishPacket(MQTTBuffer& mqttBuffer, const char* topicPrefix, const char* topic, const char* payload)
 {
-  MQTTBuffer byteBuffer; // наш буфер из байт, в котором будет содержаться пакет
+  // длины нам известны заранее, поэтому пишем пакет сразу в буфер, без промежуточных копий.
+  // если передан префикс - топик публикуется как префикс/топик
+  size_t prefixLength = topicPrefix ? strlen(topicPrefix) + 1 : 0;
+  size_t topicLength = prefixLength + strlen(topic);
+  size_t payloadLength = strlen(payload);
+  size_t packetLength = 2 + topicLength + payloadLength;
 
-  // тут формируем пакет
+  constructFixedHeader(MQTT_PUBLISH_COMMAND,mqttBuffer,packetLength);
 
   // кодируем топик
-  encode(byteBuffer,topic);
+  mqttBuffer.push_back((topicLength >> 8));
+  mqttBuffer.push_back((topicLength & 0xFF));
 
-  // теперь пишем данные топика
-  int16_t sz = strlen(payload);
-  const char* readPtr = payload;
-  for(int i=0;i<sz;i++)
+  if(topicPrefix)
   {
-    byteBuffer.push_back(*readPtr++);
-  }   
-
-  size_t payloadSize = byteBuffer.size();
-
-  MQTTBuffer fixedHeader;
-  
-  constructFixedHeader(MQTT_PUBLISH_COMMAND,fixedHeader,payloadSize);
+    write(mqttBuffer,topicPrefix);
+    mqttBuffer.push_back('/');
+  }
+  write(mqttBuffer,topic);
 
-  writePacket(fixedHeader,byteBuffer,mqttBuffer,mqttBufferLength);
+  // теперь пишем данные топика
+  write(mqttBuffer,payload);
   
 }
 //--------------------------------------------------------------------------------------------------------------------------------
-void CoreMQTT::constructSubscribePacket(String& mqttBuffer,int16_t& mqttBufferLength, const char* topic)
+void CoreMQTT::constructSubscribePacket(MQTTBuffer& mqttBuffer, const char* topic)
 {
   MQTTBuffer byteBuffer; // наш буфер из байт, в котором будет содержаться пакет
 
@@ -3095,14 +3275,12 @@ void CoreMQTT::constructSubscribePacket(String& mqttBuffer,int16_t& mqttBufferLe
   
   constructFixedHeader(MQTT_SUBSCRIBE_COMMAND | MQTT_QOS1, fixedHeader, payloadSize);
 
-  writePacket(fixedHeader,byteBuffer,mqttBuffer,mqttBufferLength);  
+  writePacket(fixedHeader,byteBuffer,mqttBuffer);  
 }
 //--------------------------------------------------------------------------------------------------------------------------------
-void CoreMQTT::constructConnectPacket(String& mqttBuffer,int16_t& mqttBufferLength,const char* id, const char* user, const char* pass
+void CoreMQTT::constructConnectPacket(MQTTBuffer& mqttBuffer,const char* id, const char* user, const char* pass
 ,const char* willTopic,uint8_t willQoS, uint8_t willRetain, const char* willMessage)
 {
-  mqttBuffer = "";
-
   MQTTBuffer byteBuffer; // наш буфер из байт, в котором будет содержаться пакет
 
   // теперь формируем переменный заголовок
@@ -3153,38 +3331,24 @@ void CoreMQTT::constructConnectPacket(String& mqttBuffer,int16_t& mqttBufferLeng
    MQTTBuffer fixedHeader;
    constructFixedHeader(MQTT_CONNECT_COMMAND,fixedHeader,payloadSize);
 
-   writePacket(fixedHeader,byteBuffer,mqttBuffer,mqttBufferLength);
+   writePacket(fixedHeader,byteBuffer,mqttBuffer);
 
 
    // всё, пакет сформирован
     
 }
 //--------------------------------------------------------------------------------------------------------------------------------------
-void CoreMQTT::writePacket(MQTTBuffer& fixedHeader, MQTTBuffer& payload, String& mqttBuffer,int16_t& mqttBufferLength)
+void CoreMQTT::writePacket(MQTTBuffer& fixedHeader, MQTTBuffer& payload, MQTTBuffer& mqttBuffer)
 {
-  mqttBuffer = "";
-  
-// запомнили, сколько байт надо послать в ESP
-   mqttBufferLength = fixedHeader.size() + payload.size();
-
-   // теперь записываем это в строку, перед этим зарезервировав память, и заполнив строку пробелами
-   mqttBuffer.reserve(mqttBufferLength);
-   for(int16_t i=0;i<mqttBufferLength;i++)
-    mqttBuffer += ' ';
-
-  // теперь можем копировать данные в строку побайтово
-  int16_t writePos = 0;
-
-  // пишем фиксированный заголовок
+  // дописываем пакет в буфер: сначала фиксированный заголовок, потом - переменный
   for(size_t i=0;i<fixedHeader.size();i++)
   {
-    mqttBuffer[writePos++] = fixedHeader[i];
+    mqttBuffer.push_back(fixedHeader[i]);
   }
   
-  // и переменный
   for(size_t i=0;i<payload.size();i++)
   {
-    mqttBuffer[writePos++] = payload[i];
+    mqttBuffer.push_back(payload[i]);
   }  
 }
 //--------------------------------------------------------------------------------------------------------------------------------
@@ -3230,13 +3394,8 @@ void CoreMQTT::encode(MQTTBuffer& buff,const char* str)
     buff.push_back(0);
     buff.push_back(0);
 
-    const char* ptr = str;
-    int16_t strLen = 0;
-    while(*ptr)
-    {
-      buff.push_back(*ptr++);
-      strLen++;
-    }
+    write(buff,str);
+    size_t strLen = buff.size() - sz - 2;
 
     // теперь записываем актуальную длину
     buff[sz] = (strLen >> 8);
@@ -3244,6 +3403,12 @@ void CoreMQTT::encode(MQTTBuffer& buff,const char* str)
     
 }
 //--------------------------------------------------------------------------------------------------------------------------------------
+void CoreMQTT::write(MQTTBuffer& buff,const char* str)
+{
+  while(*str)
+    buff.push_back(*str++);
+}
+//--------------------------------------------------------------------------------------------------------------------------------------
 void CoreMQTT::begin(CoreTransport* transport)
 {
   // попросили начать работу
@@ -4054,8 +4219,7 @@ void CoreSIM800Transport::update()
 
         receiveBuffer.remove(0,ipdClientDataLength);
 
-        if(!receiveBuffer.size())
-          receiveBuffer.clear();
+        receiveBuffer.shrink(TRANSPORT_RECEIVE_BUFFER_KEEP);
           
         // весь пакет - уже в буфере
         notifyDataAvailable(*cl, thisBuffer, ipdClientDataLength, true);
@@ -4098,8 +4262,7 @@ void CoreSIM800Transport::update()
             memcpy(thisBuffer,receiveBuffer.pData(),packetLength);
 
             receiveBuffer.remove(0,packetLength);
-            if(!receiveBuffer.size())
-              receiveBuffer.clear();
+            receiveBuffer.shrink(TRANSPORT_RECEIVE_BUFFER_KEEP);
 
             notifyDataAvailable(*cl, thisBuffer, packetLength, (remainingDataLength - packetLength) == 0);
             delete [] thisBuffer;
@@ -4147,9 +4310,8 @@ void CoreSIM800Transport::update()
     } // if(hasAnswerLine)
   } // else
 
-  // если в приёмном буфере ничего нету - просто почистим память
-  if(!receiveBuffer.size())
-    receiveBuffer.clear();
+  // если в приёмном буфере ничего нету и он сильно разросся - освобождаем память, иначе оставляем её под следующие ответы
+  receiveBuffer.shrink(TRANSPORT_RECEIVE_BUFFER_KEEP);
 
   if(hasAnswerLine && thisCommandLine.startsWith(F("AT+")))
    {
@@ -227,7 +227,64 @@ struct TransportClientQueueData // данные по клиенту в очер
 //--------------------------------------------------------------------------------------------------------------------------------
 typedef Vector<TransportClientQueueData> TransportClientsQueue; // очередь клиентов на совершение какой-либо исходящей операции (коннект, дисконнект, запись)
 //--------------------------------------------------------------------------------------------------------------------------------
-typedef Vector<uint8_t> TransportReceiveBuffer;
+// приёмные буферы транспортов (SIM800, MQTT-клиент, входящие запросы к ESP) берут память из общего пула, а не из кучи;
+// ответ, не влезший в пул, уходит в кучу
+//--------------------------------------------------------------------------------------------------------------------------------
+#define TRANSPORT_POOL_BLOCK_SIZE 16 // размер блока пула приёмных буферов, байт
+#define TRANSPORT_POOL_BLOCKS 16 // кол-во блоков в пуле приёмных буферов
+extern VectorPool TransportBuffersPool;
+typedef PoolVector<uint8_t,&TransportBuffersPool> TransportReceiveBuffer;
+#define TRANSPORT_RECEIVE_BUFFER_KEEP 64 // столько байт памяти приёмного буфера оставляем выделенными после его опустошения, чтобы не перераспределять её на каждый ответ
+//--------------------------------------------------------------------------------------------------------------------------------
+// кольцевой приёмный буфер фиксированного размера. Данные в нём никогда не перемещаются, поэтому
+// на непрерывный участок данных можно отдавать указатель, пока этот участок не удалён из буфера -
+// дочитывание из потока в это время пишет только в свободное место.
+//--------------------------------------------------------------------------------------------------------------------------------
+template<uint16_t Size>
+class TransportRingBuffer
+{
+  private:
+    uint8_t buffer[Size];
+    uint16_t readIdx; // индекс первого байта данных
+    uint16_t count; // кол-во байт в буфере
+
+  public:
+    TransportRingBuffer() : readIdx(0), count(0) {}
+
+    uint16_t size() const { return count; }
+    bool full() const { return count >= Size; }
+    void clear() { readIdx = 0; count = 0; }
+
+    bool push_back(uint8_t b)
+    {
+      if(count >= Size) // места нет, байт останется в потоке
+        return false;
+
+      buffer[(readIdx + count) % Size] = b;
+      count++;
+      return true;
+    }
+
+    uint8_t operator[](uint16_t idx) const { return buffer[(readIdx + idx) % Size]; }
+
+    void remove(uint16_t cnt) // удаляет cnt байт из начала буфера
+    {
+      if(cnt > count)
+        cnt = count;
+        
+      readIdx = (readIdx + cnt) % Size;
+      count -= cnt;
+    }
+
+    const uint8_t* contiguousData(uint16_t& len) const // непрерывный участок данных с начала буфера, без копирования
+    {
+      len = Size - readIdx;
+      if(len > count)
+        len = count;
+        
+      return &(buffer[readIdx]);
+    }
+};
 //--------------------------------------------------------------------------------------------------------------------------------
 #ifdef USE_WIFI_MODULE
 //--------------------------------------------------------------------------------------------------------------------------------
@@ -245,7 +302,8 @@ typedef struct
   bool cipstartConnectKnownAnswerFound : 1;
 
   bool specialCommandDone : 1;
-  bool pad : 7;
+  bool binaryFraming : 1; // ESP присылает данные клиентов двоичными кадрами
+  bool pad : 6;
   
 } CoreESPTransportFlags;
 //--------------------------------------------------------------------------------------------------------------------------------
@@ -268,10 +326,32 @@ typedef enum
   cmdWaitSendDone, // ждём окончания отсылки данных
   cmdPING, // команда пингования
   cmdCIFSR, // команда получения MAC-адресов и IP
+  cmdCIPFRAME, // включаем двоичные кадры для данных клиентов
   
 } ESPCommands;
 //--------------------------------------------------------------------------------------------------------------------------------
-typedef Vector<ESPCommands> ESPCommandsList;
+#define ESP_MAX_INIT_COMMANDS 12 // максимальная длина очереди команд ESP
+#define ESP_RECEIVE_BUFFER_SIZE 256 // размер приёмного буфера ESP, не меньше TRANSPORT_MAX_PACKET_LENGTH
+typedef TransportRingBuffer<ESP_RECEIVE_BUFFER_SIZE> ESPReceiveBuffer;
+typedef FixedVector<ESPCommands,ESP_MAX_INIT_COMMANDS> ESPCommandsList;
+//--------------------------------------------------------------------------------------------------------------------------------
+/*
+ Двоичный кадр с данными клиента (вместо +IPD,ID,LEN:DATA), без экранирования - длина известна из заголовка:
+
+   0xF5 - начало кадра (в текстовых ответах ESP такого байта не бывает)
+   тип кадра (ESP_FRAME_DATA), старший бит - последний кадр порции данных, прочитанной из сокета
+   номер клиента
+   порядковый номер кадра
+   длина данных, 2 байта, младший - первым
+   данные
+   CRC-8 всего, что между началом кадра и CRC
+*/
+//--------------------------------------------------------------------------------------------------------------------------------
+#define ESP_FRAME_START 0xF5
+#define ESP_FRAME_DATA 1 // данные клиента
+#define ESP_FRAME_LAST 0x80 // флаг последнего кадра порции данных
+#define ESP_FRAME_HEADER_SIZE 6 // начало, тип, клиент, номер, длина
+#define ESP_FRAME_MAX_PAYLOAD 192 // больше данных ESP в один кадр не кладёт - кадр целиком помещается в приёмный буфер
 //--------------------------------------------------------------------------------------------------------------------------------
 typedef enum
 {
@@ -326,13 +406,15 @@ class CoreESPTransport : public CoreTransport
 
 
       // буфер для приёма команд от ESP
-      TransportReceiveBuffer receiveBuffer;
+      ESPReceiveBuffer receiveBuffer;
+      uint16_t lineScanPos; // до какого места в буфере уже искали конец строки
       uint16_t recursionGuard;
       
       CoreTransportClient* cipstartConnectClient;
       uint8_t cipstartConnectClientID;
 
-      bool checkIPD(const TransportReceiveBuffer& buff);
+      bool checkIPD(const ESPReceiveBuffer& buff);
+      void processFrame();
       void processKnownStatusFromESP(const String& line);
       void processConnect(const String& line);
       void processDisconnect(const String& line);
@@ -557,6 +639,19 @@ extern CoreSIM800Transport SIM800;
 //--------------------------------------------------------------------------------------------------------------------------------
 typedef Vector<uint8_t> MQTTBuffer;
 //--------------------------------------------------------------------------------------------------------------------------------
+#define MQTT_PUBLISH_BATCH_SIZE 256 // сколько байт пакетов PUBLISH стараемся собрать в одну запись в клиента (пачка закрывается, как только превысит это значение)
+//--------------------------------------------------------------------------------------------------------------------------------
+typedef struct
+{
+  char* strings; // имя топика и, через завершающий ноль, команда для топика статуса контроллера или имя модуля для топика с показаниями датчика
+  uint8_t sensorType; // тип датчика, из перечисления ModuleStates
+  uint8_t sensorIndex; // индекс датчика в модуле
+  uint8_t topicType; // тип топика: показания с датчиков (0), или статус контроллера (1)
+  
+} MQTTTopic;
+//--------------------------------------------------------------------------------------------------------------------------------
+typedef Vector<MQTTTopic> MQTTTopicsList;
+//--------------------------------------------------------------------------------------------------------------------------------
 typedef enum
 {
   mqttWaitClient, // ожидаем свободного клиента
@@ -617,8 +712,16 @@ class CoreMQTT : public IClientEventsSubscriber//, public Stream
 private:
 
   TransportReceiveBuffer packetBuffer;
+  MQTTBuffer sendBuffer; // буфер, в котором собираются исходящие пакеты, память не освобождается между отсылками
+
+  MQTTTopicsList topics; // закешированный список топиков с SD
+  bool topicsLoaded;
+  void loadTopics();
+  void clearTopics();
 
-  void getNextTopic(String& topicName, String& data);
+  void putNextTopic();
+  void putReport();
+  void putPublishQueue();
   void switchToNextTopic();
 
   MQTTSettings currentSettings;
@@ -644,14 +747,16 @@ private:
 
   void constructFixedHeader(byte command, MQTTBuffer& fixedHeader,size_t payloadSize);
 
-  void constructConnectPacket(String& mqttBuffer,int16_t& mqttBufferLength,const char* id, const char* user, const char* pass,const char* willTopic,uint8_t willQoS, uint8_t willRetain, const char* willMessage);
-  void constructSubscribePacket(String& mqttBuffer,int16_t& mqttBufferLength, const char* topic);
-  void constructPublishPacket(String& mqttBuffer,int16_t& mqttBufferLength, const char* topic, const char* payload);
+  void constructConnectPacket(MQTTBuffer& mqttBuffer,const char* id, const char* user, const char* pass,const char* willTopic,uint8_t willQoS, uint8_t willRetain, const char* willMessage);
+  void constructSubscribePacket(MQTTBuffer& mqttBuffer, const char* topic);
+  void constructPublishPacket(MQTTBuffer& mqttBuffer, const char* topicPrefix, const char* topic, const char* payload);
   
   void encode(MQTTBuffer& buff,const char* str);
+  void write(MQTTBuffer& buff,const char* str);
 
-  void writePacket(MQTTBuffer& fixedHeader,MQTTBuffer& payload, String& mqttBuffer,int16_t& mqttBufferLength);
+  void writePacket(MQTTBuffer& fixedHeader,MQTTBuffer& payload, MQTTBuffer& mqttBuffer);
 
+  void processIncomingPackets(uint8_t* data, size_t dataLength);
   void processIncomingPacket(CoreTransportClient* client, uint8_t* data, size_t dataLength);
 
   void convertAnswerToJSON(const String& answer, String* resultBuffer);
@@ -0,0 +1,22 @@
+#include "Crc8.h"
+//--------------------------------------------------------------------------------------------------------------------------------
+static const uint8_t CRC8_TABLE[16] PROGMEM = {
+  0x00, 0x9D, 0x23, 0xBE, 0x46, 0xDB, 0x65, 0xF8, 0x8C, 0x11, 0xAF, 0x32, 0xCA, 0x57, 0xE9, 0x74
+};
+//--------------------------------------------------------------------------------------------------------------------------------
+uint8_t Crc8Update(uint8_t crc, uint8_t data)
+{
+  crc ^= data;
+  crc = (crc >> 4) ^ pgm_read_byte(&(CRC8_TABLE[crc & 0x0F]));
+  crc = (crc >> 4) ^ pgm_read_byte(&(CRC8_TABLE[crc & 0x0F]));
+  return crc;
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+uint8_t Crc8(const uint8_t* data, size_t len, uint8_t crc)
+{
+  while(len--)
+    crc = Crc8Update(crc,*data++);
+
+  return crc;
+}
+//--------------------------------------------------------------------------------------------------------------------------------
@@ -0,0 +1,12 @@
+#ifndef _CRC8_H
+#define _CRC8_H
+//--------------------------------------------------------------------------------------------------------------------------------
+#include <Arduino.h>
+//--------------------------------------------------------------------------------------------------------------------------------
+// CRC-8 (полином 0x8C, как у OneWire::crc8), считается по полбайта за шаг через таблицу из 16 байт.
+// Используется кадрами шины RS-485 и двоичными кадрами обмена с ESP.
+//--------------------------------------------------------------------------------------------------------------------------------
+uint8_t Crc8Update(uint8_t crc, uint8_t data); // добавляет к контрольной сумме один байт
+uint8_t Crc8(const uint8_t* data, size_t len, uint8_t crc = 0); // контрольная сумма блока данных
+//--------------------------------------------------------------------------------------------------------------------------------
+#endif
@@ -35,7 +35,34 @@ void DS18B20Support::setResolution(DS18B20Resolution res)
    
 }
 //--------------------------------------------------------------------------------------------------------------------------------------
-bool DS18B20Support::readTemperature(DS18B20Temperature* result,DSSensorType type)
+uint16_t DS18B20Support::getConversionTime(DS18B20Resolution res)
+{
+  switch(res)
+  {
+    case temp9bit: return 94;
+    case temp10bit: return 188;
+    case temp11bit: return 375;
+    default: return 750;
+  }
+}
+//--------------------------------------------------------------------------------------------------------------------------------------
+bool DS18B20Support::startConversion()
+{
+  if(!pin)
+    return false;
+
+  OneWire ow(pin);
+
+  if(!ow.reset()) // нет датчика
+    return false;
+
+  ow.write(0xCC); // пофиг на адреса (SKIP ROM)
+  ow.write(0x44); // запускаем преобразование, результат будет готов через getConversionTime мс
+
+  return true;
+}
+//--------------------------------------------------------------------------------------------------------------------------------------
+bool DS18B20Support::readResult(DS18B20Temperature* result,DSSensorType type)
 {
   result->Whole = NO_TEMPERATURE_DATA; // нет данных с датчика
   result->Fract = 0;
@@ -51,10 +78,6 @@ bool DS18B20Support::readTemperature(DS18B20Temperature* result,DSSensorType typ
 
   byte data[9];
    
-  ow.write(0xCC); // пофиг на адреса (SKIP ROM)
-  ow.write(0x44); // запускаем преобразование
-
-  ow.reset();
   ow.write(0xCC); // пофиг на адреса (SKIP ROM)
   ow.write(0xBE); // читаем scratchpad датчика на пине
 
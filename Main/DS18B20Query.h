@@ -36,8 +36,13 @@ class DS18B20Support
     DS18B20Support() : pin(0) {};
 
     void begin(uint8_t _pin);
-    bool readTemperature(DS18B20Temperature* result, DSSensorType type);
     void setResolution(DS18B20Resolution res); 
+
+    // раздельный опрос: сначала запускаем конвертацию (не ждём её окончания),
+    // через getConversionTime миллисекунд - читаем результат
+    bool startConversion();
+    bool readResult(DS18B20Temperature* result, DSSensorType type);
+    static uint16_t getConversionTime(DS18B20Resolution res); // время конвертации для разрешения, мс
     
 };
 //--------------------------------------------------------------------------------------------------------------------------------------
@@ -94,6 +94,9 @@ void DeltaModule::Setup()
   // настройка модуля тут
   isDeltasInited = false;
   //settings = MainController->GetSettings();
+
+  // дельты загружаются на первом проходе, после регистрации всех модулей - просим вызвать нас сразу
+  MainController->ScheduleModule(this,1,schedulePriorityNormal);
 }
 //--------------------------------------------------------------------------------------------------------------------------------------
 void DeltaModule::SaveDeltas()
@@ -110,20 +113,19 @@ void DeltaModule::SaveDeltas()
 //--------------------------------------------------------------------------------------------------------------------------------------
 void DeltaModule::Update(uint16_t dt)
 { 
+  UNUSED(dt);
 
   // обновление модуля тут
   if(!isDeltasInited)
   {
-    // инициализируем дельты здесь, поскольку при вызове Setup настройки уже загружены, но наш модуль ещё не зарегистрирован в контроллере
+    // инициализируем дельты здесь, поскольку при вызове Setup настройки уже загружены, но модули, с датчиков которых считаются дельты, могут быть ещё не зарегистрированы
     isDeltasInited = true;
     InitDeltas();
-  }
 
-  lastUpdateCall += dt;
-  if(lastUpdateCall < DELTA_UPDATE_INTERVAL) // обновляем согласно настроенному интервалу
+    // дальше обновляем дельты согласно настроенному интервалу
+    MainController->ScheduleModule(this,DELTA_UPDATE_INTERVAL,schedulePriorityNormal);
     return;
-  else
-    lastUpdateCall = 0;
+  }
   
   UpdateDeltas(); // обновляем дельты
 
@@ -25,7 +25,6 @@ class DeltaModule : public AbstractModule // модуль регистрации
 
 //  GlobalSettings* settings; // указатель на настройки
   bool isDeltasInited; // флаг, что мы инициализировали настройки дельт
-  uint16_t lastUpdateCall;
 
   DeltasVector deltas; // наши дельты будут здесь
   size_t deltaReadIndex; // текущий индекс чтения дельты (для сохранения настроек)
@@ -42,7 +41,7 @@ class DeltaModule : public AbstractModule // модуль регистрации
   void SaveDeltas();
   
   public:
-    DeltaModule() : AbstractModule("DELTA"), lastUpdateCall(876) {}
+    DeltaModule() : AbstractModule("DELTA") {}
 
     bool ExecCommand(const Command& command, bool wantAnswer);
     void Setup();
@@ -18,6 +18,9 @@
   9. После завершения приёма данных соединение закрывается и вызывается OnHTTPResult с кодом HTTP_REQUEST_COMPLETED;
   10. Провайдер переходит в режим ожидания запроса на новую команду получения данных по HTTP.
 
+  Модули не обращаются к провайдерам напрямую, а ставят свой обработчик в общую очередь HTTPQueue (HttpQueue.h):
+  она выполняет запросы по одному, выбирает готового провайдера и делает паузу для провайдера, который не смог соединиться.
+
 */
 //--------------------------------------------------------------------------------------------------------------------------------
 // статусные коды запроса по HTTP
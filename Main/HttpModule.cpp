@@ -3,6 +3,7 @@
 #include "InteropStream.h"
 #include "TempSensors.h"
 #include "Globals.h"
+#include "HttpQueue.h"
 //--------------------------------------------------------------------------------------------------------------------------------
 #define HTTP_START_OF_HEADERS F("POST /check HTTP/1.1\r\nConnection: close\r\nContent-Type: application/x-www-form-urlencoded\r\nHost: ")
 #define HTTP_CONTENT_LENGTH_HEADER F("Content-Length: ")
@@ -51,41 +52,33 @@ void HttpModule::Setup()
   flags.currentAction = HTTP_ASK_FOR_COMMANDS; // пытаемся запросить команды
   flags.isEnabled = MainController->GetSettings()->IsHttpApiEnabled();
 
-  // инициализируем провайдеров нулями
-  providers[0] = NULL;
-  providers[1] = NULL;
-
-  flags.isFirstUpdateCall = true;
-  flags.currentProviderNumber = 0;
 
   commandsCheckTimer = 0;
   waitTimer = 0;
+
+  #ifdef HTTP_COMPACT_REPORT
+  memset(&compact,0,sizeof(compact));
+  #endif
 }
 //--------------------------------------------------------------------------------------------------------------------------------
 void HttpModule::CheckForIncomingCommands(byte wantedAction)
 {
-  HTTPQueryProvider* prov = providers[flags.currentProviderNumber];
-  if(!prov)
-  {
-   #ifdef HTTP_DEBUG
-    DEBUG_LOGLN(F("HTTP check for commands - NO PROVIDER!!!"));
-   #endif
-    return;
-  }
-
-   #ifdef HTTP_DEBUG
-    DEBUG_LOG(F("HTTP current provider: "));
-    DEBUG_LOGLN(String(flags.currentProviderNumber));
-   #endif
+   // ставим запрос в общую очередь HTTP-запросов, она сама выберет готового провайдера
+   if(!HTTPQueue.enqueue(this))
+   {
+    #ifdef HTTP_DEBUG
+      DEBUG_LOGLN(F("HTTP queue is full, try again after 5 seconds..."));
+    #endif
+      waitTimer = 5000;
+      return;
+   }
 
    // выставляем флаг, что мы в процессе обработки запроса
    flags.inProcessQuery = true;
 
    // и запоминаем, какое действие мы делаем
    flags.currentAction = wantedAction;
-   
-   // просим провайдера выполнить запрос
-   prov->MakeQuery(this);
+   flags.badAnswer = false;
 }
 //--------------------------------------------------------------------------------------------------------------------------------
 void HttpModule::OnAskForHost(String& host, int& port)
@@ -105,10 +98,8 @@ uint8_t HttpModule::MapFraction(uint8_t fraction)
   return tmp/100;
 }
 //--------------------------------------------------------------------------------------------------------------------------------
-void HttpModule::CollectControllerStatus(String* data)
+void HttpModule::WriteControllerStatus(HttpReportWriter& w)
 {
-  *data += F("&w=");
-
   ControllerState state = WORK_STATUS.GetState();
 
   /* 
@@ -132,6 +123,8 @@ void HttpModule::CollectControllerStatus(String* data)
      второй бит - насос перемешивания pH работает
      третий бит - насос повышения pH работает
      четвёртый бит - насос понижения pH работае
+
+     и в конце - состояние пинов, sizeof(ControllerState::PinsState) байт.
      
    */
 
@@ -149,38 +142,20 @@ void HttpModule::CollectControllerStatus(String* data)
     #endif // USE_TEMP_SENSORS
 
     // пишем кол-во окон
-    *data += WorkStatus::ToHex(windowsCount);
+    w.Write(windowsCount);
 
     #if  defined(USE_TEMP_SENSORS) && (SUPPORTED_WINDOWS > 0)
-      // теперь пишем состояние окон по каналам
-      // вычисляем кол-во байт, в которых будет храниться состояние окон
-      byte bytesNeeded = SUPPORTED_WINDOWS/8;
-      if(bytesNeeded < 1)
-        bytesNeeded = 1;
-        
-      if(SUPPORTED_WINDOWS > 8 && SUPPORTED_WINDOWS%8)
-        bytesNeeded++;
-
-      // получили кол-во байт, теперь создаём массив и пишем в него состояние
-      byte* currentWindowsState = new byte[bytesNeeded];
-      memset(currentWindowsState,0,bytesNeeded);
-      
-      for(byte i=0;i<SUPPORTED_WINDOWS;i++)
+      // теперь пишем состояние окон по каналам, каждые 8 окон - в своём байте
+      for(byte i=0;i<SUPPORTED_WINDOWS;i+=8)
       {
-        byte byteNum = i/8;
-        byte bitNum = i%8;
-        if(WindowModule->IsWindowOpen(i))
-          currentWindowsState[byteNum] = currentWindowsState[byteNum] | (1 << bitNum);
+        byte windowsState = 0;
+        for(byte bitNum=0;bitNum<8 && (i+bitNum) < SUPPORTED_WINDOWS;bitNum++)
+        {
+          if(WindowModule->IsWindowOpen(i+bitNum))
+            windowsState |= (1 << bitNum);
+        }
+        w.Write(windowsState);
       } // for
-
-      // теперь пишем это дело в строку
-      for(byte i=0;i<bytesNeeded;i++)
-      {
-        *data += WorkStatus::ToHex(currentWindowsState[i]);
-      }
-
-      // и не забываем чистить за собой
-      delete [] currentWindowsState;
     #endif // USE_TEMP_SENSORS
 
     // теперь собираем состояние каналов полива
@@ -196,38 +171,20 @@ void HttpModule::CollectControllerStatus(String* data)
     #endif // USE_WATERING_MODULE
 
     // пишем в поток
-    *data += WorkStatus::ToHex(waterChannelsCount);
+    w.Write(waterChannelsCount);
 
     #if defined(USE_WATERING_MODULE) && (WATER_RELAYS_COUNT > 0)
-      // теперь пишем состояние полива по каналам
-      // вычисляем кол-во байт, в которых будет храниться состояние каналов полива
-      byte waterBytesNeeded = WATER_RELAYS_COUNT/8;
-      if(waterBytesNeeded < 1)
-        waterBytesNeeded = 1;
-        
-      if(WATER_RELAYS_COUNT > 8 && WATER_RELAYS_COUNT%8)
-        waterBytesNeeded++;
-
-      // получили кол-во байт, теперь создаём массив и пишем в него состояние
-      byte* currentWaterState = new byte[waterBytesNeeded];
-      memset(currentWaterState,0,waterBytesNeeded);
-      
-      for(byte i=0;i<WATER_RELAYS_COUNT;i++)
+      // теперь пишем состояние полива по каналам, каждые 8 каналов - в своём байте
+      for(byte i=0;i<WATER_RELAYS_COUNT;i+=8)
       {
-        byte byteNum = i/8;
-        byte bitNum = i%8;
-        if(state.WaterChannelsState & (1 << i) )
-          currentWaterState[byteNum] = currentWaterState[byteNum] | (1 << bitNum);
+        byte channelsState = 0;
+        for(byte bitNum=0;bitNum<8 && (i+bitNum) < WATER_RELAYS_COUNT;bitNum++)
+        {
+          if(state.WaterChannelsState & (1 << (i+bitNum)))
+            channelsState |= (1 << bitNum);
+        }
+        w.Write(channelsState);
       } // for
-
-      // теперь пишем это дело в строку
-      for(byte i=0;i<waterBytesNeeded;i++)
-      {
-        *data += WorkStatus::ToHex(currentWaterState[i]);
-      }
-
-      // и не забываем чистить за собой
-      delete [] currentWaterState;
     #endif // USE_WATERING_MODULE
 
 
@@ -244,51 +201,24 @@ void HttpModule::CollectControllerStatus(String* data)
     #endif // USE_LUMINOSITY_MODULE
 
     // пишем в поток
-    *data += WorkStatus::ToHex(lightChannelsCount);
+    w.Write(lightChannelsCount);
 
     #if defined(USE_LUMINOSITY_MODULE) && (LAMP_RELAYS_COUNT > 0)
-      // теперь пишем состояние полива по каналам
-      // вычисляем кол-во байт, в которых будет храниться состояние каналов полива
-      byte lightBytesNeeded = LAMP_RELAYS_COUNT/8;
-      if(lightBytesNeeded < 1)
-        lightBytesNeeded = 1;
-        
-      if(LAMP_RELAYS_COUNT > 8 && LAMP_RELAYS_COUNT%8)
-        lightBytesNeeded++;
-
-      // получили кол-во байт, теперь создаём массив и пишем в него состояние
-      byte* currentLightState = new byte[lightBytesNeeded];
-      memset(currentLightState,0,lightBytesNeeded);
-      
-      for(byte i=0;i<LAMP_RELAYS_COUNT;i++)
+      // теперь пишем состояние досветки по каналам, каждые 8 каналов - в своём байте
+      for(byte i=0;i<LAMP_RELAYS_COUNT;i+=8)
       {
-        byte byteNum = i/8;
-        byte bitNum = i%8;
-        if(state.LightChannelsState & (1 << i) )
-          currentLightState[byteNum] = currentLightState[byteNum] | (1 << bitNum);
+        byte channelsState = 0;
+        for(byte bitNum=0;bitNum<8 && (i+bitNum) < LAMP_RELAYS_COUNT;bitNum++)
+        {
+          if(state.LightChannelsState & (1 << (i+bitNum)))
+            channelsState |= (1 << bitNum);
+        }
+        w.Write(channelsState);
       } // for
-
-      // теперь пишем это дело в строку
-      for(byte i=0;i<lightBytesNeeded;i++)
-      {
-        *data += WorkStatus::ToHex(currentLightState[i]);
-      }
-
-      // и не забываем чистить за собой
-      delete [] currentLightState;
     #endif // USE_LUMINOSITY_MODULE    
 
 
     // теперь пишем состояние модуля pH
-    /*
-     далее - состояние модуля pH, один байт:
-
-     бит 0x80 - есть модуль pH
-     первый бит - насос заполнения бака pH включен
-     второй бит - насос перемешивания pH работает
-     третий бит - насос повышения pH работает
-     четвёртый бит - насос понижения pH работае
-     */
      byte phState = 0;
 
      #ifdef USE_PH_MODULE
@@ -307,16 +237,29 @@ void HttpModule::CollectControllerStatus(String* data)
      #endif
 
      // пишем в поток
-     *data += WorkStatus::ToHex(phState);
+     w.Write(phState);
 
      // теперь пишем состояние пинов
      for(size_t i=0;i<sizeof(state.PinsState);i++)
      {
-        *data += WorkStatus::ToHex(state.PinsState[i]);
+        w.Write(state.PinsState[i]);
      }
    
 }
 //--------------------------------------------------------------------------------------------------------------------------------
+void HttpModule::CollectControllerStatus(String* data)
+{
+  // собираем слепок состояния в буфер и переводим его в HEX одним куском
+  uint8_t buffer[HTTP_STATUS_MAX_BYTES];
+  HttpReportWriter w(buffer,sizeof(buffer));
+  WriteControllerStatus(w);
+
+  data->reserve(data->length() + 3 + w.Length()*2);
+  *data += F("&w=");
+  for(uint8_t i=0;i<w.Length();i++)
+    *data += WorkStatus::ToHex(buffer[i]);
+}
+//--------------------------------------------------------------------------------------------------------------------------------
 void HttpModule::CollectSensorsData(String* data)
 {
   // тут собираем данные с датчиков
@@ -507,6 +450,197 @@ void HttpModule::CollectSensorsData(String* data)
   
 }
 //--------------------------------------------------------------------------------------------------------------------------------
+#ifdef HTTP_COMPACT_REPORT
+/*
+  Сжатый отчёт (HTTP_COMPACT_REPORT).
+
+  Показания датчиков и состояние контроллера собираются в двоичный слепок фиксированной раскладки:
+
+    если шлём показания датчиков - секции температуры, влажности, освещённости, влажности почвы и pH, каждая:
+      байт - кол-во датчиков (0 - нет модуля), затем по каждому датчику:
+        температура, почва, pH - целая часть и дробная (0-15), как в параметре s;
+        влажность - 2 байта влажности и 2 байта температуры;
+        освещённость - 4 байта long, младшим байтом вперёд;
+      нет показаний - целая часть 0x80 и дробная 0 (для освещённости - FF FF FF FF);
+
+    если шлём состояние контроллера - байты, как в параметре w.
+
+  Каждому отчёту присваивается номер, параметр q. Полный отчёт (параметры s и w, по которым сервер
+  восстанавливает слепок) шлётся в начале, после смены набора данных и каждые HTTP_COMPACT_KEYFRAME_INTERVAL отчётов.
+  В остальное время шлются только изменения относительно последнего отчёта, дошедшего до сервера:
+  параметр b - номер этого отчёта, параметр ds - HEX-строка из кусков "смещение, длина, новые байты".
+  Сервер, не знающий слепка с номером b, просто дожидается полного отчёта.
+ */
+//--------------------------------------------------------------------------------------------------------------------------------
+void HttpModule::WriteSensorsSection(HttpReportWriter& w, const char* moduleID, ModuleStates type, ModuleStates pairedType)
+{
+  AbstractModule* mod = MainController->GetModuleByID(moduleID);
+  if(!mod)
+  {
+    w.Write(0); // не найдено модуля
+    return;
+  }
+
+  uint8_t cnt = mod->State.GetStateCount(type);
+  w.Write(cnt);
+
+  for(uint8_t i=0;i<cnt;i++)
+  {
+    OneState* os = mod->State.GetStateByOrder(type,i);
+    OneState* os2 = pairedType != StateUnknown ? mod->State.GetStateByOrder(pairedType,i) : NULL;
+    bool hasData = os->HasData() && (!os2 || os2->HasData());
+
+    if(type == StateLuminosity)
+    {
+      long sensorData = hasData ? *((const int32_t*) os->GetCurrentData()) : NO_LUMINOSITY_DATA;
+      
+      byte* b = (byte*) &sensorData;
+      for(byte kk=0; kk < 4; kk++)
+        w.Write(*b++);
+
+      continue;
+    }
+
+    OneState* states[2] = {os, os2};
+    for(byte kk=0;kk<2 && states[kk];kk++)
+    {
+      if(hasData)
+      {
+        // температура и влажность хранятся одинаково - целая часть и сотые
+        const Temperature* t = (const Temperature*) states[kk]->GetCurrentData();
+        w.Write(t->Value);
+        w.Write(MapFraction(t->Fract));
+      }
+      else
+      {
+        w.Write(NO_TEMPERATURE_DATA);
+        w.Write(0);
+      }
+    } // for
+  } // for
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+void HttpModule::WriteSensorsSnapshot(HttpReportWriter& w)
+{
+  // порядок - такой же, как в CollectSensorsData
+  WriteSensorsSection(w,"STATE",StateTemperature,StateUnknown);
+  WriteSensorsSection(w,"HUMIDITY",StateHumidity,StateTemperature);
+  WriteSensorsSection(w,"LIGHT",StateLuminosity,StateUnknown);
+  WriteSensorsSection(w,"SOIL",StateSoilMoisture,StateUnknown);
+  WriteSensorsSection(w,"PH",StatePH,StateUnknown);
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+static uint8_t CompactRunEnd(const uint8_t* sent, const uint8_t* acked, uint8_t from, uint8_t len)
+{
+  // кусок изменений начинается с изменившегося байта и тянется, пока не встретится три неизменных байта подряд:
+  // два неизменных байта дешевле передать внутри куска, чем начинать новый (смещение и длина - тоже два байта)
+  uint8_t end = from + 1;
+  uint8_t equal = 0;
+  
+  for(uint8_t i=from+1;i<len;i++)
+  {
+    if(sent[i] != acked[i])
+    {
+      end = i + 1;
+      equal = 0;
+    }
+    else
+    if(++equal > 2)
+      break;
+  }
+
+  return end;
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+bool HttpModule::CollectCompactReport(String* data, bool withSensors, bool withStatus)
+{
+  // возвращает true, если в data записаны изменения, false - если надо слать полный отчёт
+  uint8_t mask = (withSensors ? 1 : 0) | (withStatus ? 2 : 0);
+  if(!mask)
+    return false;
+
+  HttpReportWriter w(compact.Sent,sizeof(compact.Sent));
+  
+  if(withSensors)
+    WriteSensorsSnapshot(w);
+
+  if(withStatus)
+    WriteControllerStatus(w);
+
+  if(w.Overflow())
+  {
+    // слепок не влез в буфер - шлём обычные полные отчёты без номера
+    compact.HasAcked = 0;
+    compact.WaitAck = 0;
+    return false;
+  }
+
+  compact.SentLength = w.Length();
+  compact.SentMask = mask;
+  compact.SentSequence++;
+  compact.WaitAck = 1;
+
+  *data += F("&q=");
+  *data += compact.SentSequence;
+
+  bool keyframe = !compact.HasAcked || compact.AckedMask != mask || compact.AckedLength != compact.SentLength 
+  || compact.SinceKeyframe >= HTTP_COMPACT_KEYFRAME_INTERVAL;
+
+  uint8_t len = compact.SentLength;
+  uint16_t deltaBytes = 0;
+  
+  if(!keyframe)
+  {
+    // считаем, сколько займут изменения
+    for(uint8_t i=0;i<len;)
+    {
+      if(compact.Sent[i] == compact.Acked[i])
+      {
+        i++;
+        continue;
+      }
+      uint8_t end = CompactRunEnd(compact.Sent,compact.Acked,i,len);
+      deltaBytes += 2 + (end - i);
+      i = end;
+    }
+
+    // изменилось почти всё - полный отчёт выйдет не длиннее
+    keyframe = deltaBytes >= len;
+  }
+
+  if(keyframe)
+  {
+    compact.SinceKeyframe = 0;
+    return false;
+  }
+
+  compact.SinceKeyframe++;
+
+  data->reserve(data->length() + 12 + deltaBytes*2);
+  *data += F("&b=");
+  *data += compact.AckedSequence;
+  *data += F("&ds=");
+
+  for(uint8_t i=0;i<len;)
+  {
+    if(compact.Sent[i] == compact.Acked[i])
+    {
+      i++;
+      continue;
+    }
+    uint8_t end = CompactRunEnd(compact.Sent,compact.Acked,i,len);
+    
+    *data += WorkStatus::ToHex(i);
+    *data += WorkStatus::ToHex(end - i);
+    for(;i<end;i++)
+      *data += WorkStatus::ToHex(compact.Sent[i]);
+  }
+
+  return true;
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+#endif // HTTP_COMPACT_REPORT
+//--------------------------------------------------------------------------------------------------------------------------------
 void HttpModule::OnAskForData(String* data)
 {
   #ifdef HTTP_DEBUG
@@ -547,18 +681,25 @@ void HttpModule::OnAskForData(String* data)
         #endif
 
         String sensorsData;
-        bool canSendSensorsData = sett->CanSendSensorsDataToHTTP();
-        if(canSendSensorsData)
-        {
-          // можем посылать данные датчиков
-          CollectSensorsData(&sensorsData);
-        }
-
         String controllerStatus;
+        bool canSendSensorsData = sett->CanSendSensorsDataToHTTP();
         bool canSendControllerStatus = sett->CanSendControllerStatusToHTTP();
-        if(canSendControllerStatus)
+
+        #ifdef HTTP_COMPACT_REPORT
+        // если сервер уже знает прошлый слепок - шлём только изменения, иначе - полный отчёт с номером
+        if(!CollectCompactReport(&sensorsData,canSendSensorsData,canSendControllerStatus))
+        #endif
         {
-          CollectControllerStatus(&controllerStatus);
+          if(canSendSensorsData)
+          {
+            // можем посылать данные датчиков
+            CollectSensorsData(&sensorsData);
+          }
+
+          if(canSendControllerStatus)
+          {
+            CollectControllerStatus(&controllerStatus);
+          }
         }
                 
         int contentLength = 2 + key.length() + 3 + tz.length() + addedLength + sensorsData.length() + controllerStatus.length(); // 2 - на имя переменной и знак равно, т.е. k=ТУТ_КЛЮЧ_API
@@ -587,11 +728,9 @@ void HttpModule::OnAskForData(String* data)
           *data += timeStr;                  
         #endif
 
-        if(canSendSensorsData)
-          *data += sensorsData;
-
-        if(canSendControllerStatus)
-          *data += controllerStatus;
+        // если что-то из данных слать нельзя - строка пустая
+        *data += sensorsData;
+        *data += controllerStatus;
 
 
         // запрос сформирован
@@ -688,7 +827,8 @@ void HttpModule::OnAnswerLineReceived(String& line, bool& enough)
   {
     enough = true;
     // пытаемся сменить провайдера
-    flags.currentProviderNumber = flags.currentProviderNumber == 0 ? 1 : 0;
+    flags.badAnswer = true;
+    HTTPQueue.preferOtherProvider();
 
      #ifdef HTTP_DEBUG
       DEBUG_LOGLN(F("HTTP - no 200 OK, change provider!"));
@@ -713,7 +853,8 @@ void HttpModule::OnAnswerLineReceived(String& line, bool& enough)
          // не 200 OK
             enough = true;
           // пытаемся сменить провайдера
-          flags.currentProviderNumber = flags.currentProviderNumber == 0 ? 1 : 0;
+          flags.badAnswer = true;
+          HTTPQueue.preferOtherProvider();
       
            #ifdef HTTP_DEBUG
             DEBUG_LOGLN(F("HTTP - no 200 OK, change provider!"));
@@ -1033,6 +1174,22 @@ void HttpModule::OnHTTPResult(uint16_t statusCode)
 
   flags.inProcessQuery = false; // говорим, что свободны как ветер
 
+  #ifdef HTTP_COMPACT_REPORT
+  if(flags.currentAction == HTTP_ASK_FOR_COMMANDS && compact.WaitAck)
+  {
+    // отчёт уходил с запросом команд; если запрос прошёл - сервер знает этот слепок, дальше шлём изменения относительно него
+    compact.WaitAck = 0;
+    if(statusCode == HTTP_REQUEST_COMPLETED && !flags.badAnswer)
+    {
+      memcpy(compact.Acked,compact.Sent,compact.SentLength);
+      compact.AckedLength = compact.SentLength;
+      compact.AckedSequence = compact.SentSequence;
+      compact.AckedMask = compact.SentMask;
+      compact.HasAcked = 1;
+    }
+  }
+  #endif
+
   if(flags.currentAction == HTTP_ASK_FOR_COMMANDS && statusCode != HTTP_REQUEST_COMPLETED)
   {
     // запрашивали команды, не удалось, поэтому попробуем ещё через 5 секунд
@@ -1049,52 +1206,14 @@ void HttpModule::OnHTTPResult(uint16_t statusCode)
     waitTimer = 5000;
   }
 
-  if(statusCode != HTTP_REQUEST_COMPLETED)
-  {
-
-    // тут проверяем - можем ли мы сменить провайдера и повторить запрос через другого? ести текущий результат - неудачен?
-  #ifdef HTTP_DEBUG
-    DEBUG_LOGLN(F("HTTP FAIL - try to change provider..."));
-  #endif
-    
-    byte curProviderIndex = flags.currentProviderNumber;
-    if(curProviderIndex == 1)
-      curProviderIndex = 0;
-    else
-      curProviderIndex = 1;
+  // смену провайдера после неудачного запроса делает очередь HTTP-запросов
 
-    if(providers[curProviderIndex])
-    {
-      // можем сменить, поэтому меняем 
-      #ifdef HTTP_DEBUG
-        DEBUG_LOG(F("HTTP - provider changed from "));
-        DEBUG_LOG(String(flags.currentProviderNumber));
-        DEBUG_LOG(F(" to "));
-        DEBUG_LOGLN(String(curProviderIndex));
-      #endif
-
-      flags.currentProviderNumber = curProviderIndex;
-    } // if  
-
-  } // status bad
-
-  
   flags.currentAction = HTTP_ASK_FOR_COMMANDS;
 }
 //--------------------------------------------------------------------------------------------------------------------------------
 void HttpModule::Update(uint16_t dt)
 { 
 
-  // сначала получаем всех провайдеров
-  if(flags.isFirstUpdateCall)
-  {
-    flags.isFirstUpdateCall = false;
-    providers[0] = MainController->GetHTTPProvider(0);
-    providers[1] = MainController->GetHTTPProvider(1);
-    // теперь мы можем работать с обеими провайдерами
-  }
-
-  
   if(flags.inProcessQuery || !flags.isEnabled) // занимаемся обработкой запроса или выключены
     return;
 
@@ -1107,60 +1226,6 @@ void HttpModule::Update(uint16_t dt)
 
   waitTimer = 0; // сбрасываем таймер ожидания
 
-  // тут выясняем, какой провайдер на текущий момент может выполнить запрос
-  bool wifiReady = providers[0] && providers[0]->CanMakeQuery();
-  bool gsmReady = providers[1] && providers[1]->CanMakeQuery();
-
-  // если ни один из провайдеров не может выполнить запрос - вываливаемся и пытаемся повторить позже
-  if(!(wifiReady || gsmReady))
-  {
-    #ifdef HTTP_DEBUG
-      DEBUG_LOGLN(F("HTTP - providers busy, try again after 5 seconds..."));
-    #endif 
-       
-    waitTimer = 5000; // через 5 секунд повторим
-    return;    
-    
-  }
-
-  // здесь мы не можем менять провайдера, поскольку он может поменяться по результатам вызова предыдущего.
-  // здесь мы можем только выяснить - готов ли текущий провайдер выполнить запрос, и если не готов - переключиться на следующего
-  // и попробовать через 5 секунд.
-  if(flags.currentProviderNumber == 0 && !wifiReady)
-  {
-    if(!gsmReady)
-    {
-      flags.currentProviderNumber = 1; // попробуем через GSM, он пока не готов, поэтому через 5 секунд
-      waitTimer = 5000;
-      return;
-    }
-    else
-      flags.currentProviderNumber = 1; // GSM уже готов
-  }
-
-  if(flags.currentProviderNumber == 1 && !gsmReady)
-  {
-    if(!wifiReady)
-    {
-      flags.currentProviderNumber = 0; // попробуем через ESP, она пока не готова, поэтому - через 5 секунд
-      waitTimer = 5000;
-      return;
-    }
-    else
-      flags.currentProviderNumber = 0; // ESP готова
-  }
-
-  // тут надо проверить, есть ли провайдер вообще?
-  if(!providers[flags.currentProviderNumber])
-  {
-    // нет такого провайдера, переключаемся на другого
-    if(flags.currentProviderNumber == 1)
-      flags.currentProviderNumber = 0;
-    else
-      flags.currentProviderNumber = 1;
-  }
-  
-
     // а теперь проверяем, есть ли у нас репорт для команд
     if(commandsToReport.size())
     {
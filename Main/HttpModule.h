@@ -11,8 +11,7 @@ struct HttpModuleFlags
   bool inProcessQuery: 1;
   byte currentAction: 2;
   byte isEnabled: 1;
-  bool isFirstUpdateCall: 1;
-  byte currentProviderNumber: 3;
+  bool badAnswer: 1; // сервер ответил не 200 OK
 };
 //--------------------------------------------------------------------------------------------------------------------------------
 enum
@@ -23,13 +22,53 @@ enum
 //--------------------------------------------------------------------------------------------------------------------------------
 typedef Vector<String*> HTTPReportList;
 //--------------------------------------------------------------------------------------------------------------------------------
-class HttpModule : public AbstractModule, public HTTPRequestHandler
+// максимальный размер слепка состояния контроллера (кол-во окон + их состояние, то же для полива и досветки, pH, пины)
+#define HTTP_STATUS_MAX_BYTES (4 + (SUPPORTED_WINDOWS+7)/8 + (WATER_RELAYS_COUNT+7)/8 + (LAMP_RELAYS_COUNT+7)/8 + sizeof(ControllerState::PinsState))
+//--------------------------------------------------------------------------------------------------------------------------------
+class HttpReportWriter // пишет байты отчёта в буфер фиксированного размера
 {
   private:
+    uint8_t* buffer;
+    uint16_t size;
+    uint16_t length;
+    bool overflow;
 
+  public:
+    HttpReportWriter(uint8_t* buf, uint16_t sz) : buffer(buf), size(sz), length(0), overflow(false) {}
+
+    void Write(uint8_t b)
+    {
+      if(length < size)
+        buffer[length++] = b;
+      else
+        overflow = true;
+    }
+    uint16_t Length() { return length; }
+    bool Overflow() { return overflow; } // не всё влезло в буфер
+};
+//--------------------------------------------------------------------------------------------------------------------------------
+#ifdef HTTP_COMPACT_REPORT
+struct HttpCompactReport
+{
+  uint8_t Sent[HTTP_COMPACT_SNAPSHOT_SIZE]; // слепок последнего отправленного отчёта
+  uint8_t Acked[HTTP_COMPACT_SNAPSHOT_SIZE]; // слепок последнего отчёта, дошедшего до сервера
+  uint8_t SentLength;
+  uint8_t AckedLength;
+  uint8_t SentSequence; // номер последнего отправленного отчёта
+  uint8_t AckedSequence; // номер последнего подтверждённого отчёта
+  uint8_t SentMask : 2; // что было в отправленном отчёте: 1 - показания датчиков, 2 - состояние контроллера
+  uint8_t AckedMask : 2;
+  uint8_t HasAcked : 1; // есть подтверждённый слепок, к которому можно слать изменения
+  uint8_t WaitAck : 1; // ждём результата отправки
+  uint8_t pad : 2;
+  uint8_t SinceKeyframe; // сколько сжатых отчётов отправлено после полного
+};
+#endif // HTTP_COMPACT_REPORT
+//--------------------------------------------------------------------------------------------------------------------------------
+class HttpModule : public AbstractModule, public HTTPRequestHandler
+{
+  private:
 
-   HTTPQueryProvider* providers[2]; // наши провайдеры - Wi-Fi и GSM
-  
    long waitTimer;
    unsigned long commandsCheckTimer;
    HttpModuleFlags flags;
@@ -39,6 +78,14 @@ class HttpModule : public AbstractModule, public HTTPRequestHandler
    void CheckForIncomingCommands(byte wantedAction);
    void CollectSensorsData(String* data);
    void CollectControllerStatus(String* data);
+   void WriteControllerStatus(HttpReportWriter& w);
+   
+   #ifdef HTTP_COMPACT_REPORT
+   HttpCompactReport compact;
+   void WriteSensorsSnapshot(HttpReportWriter& w);
+   void WriteSensorsSection(HttpReportWriter& w, const char* moduleID, ModuleStates type, ModuleStates pairedType);
+   bool CollectCompactReport(String* data, bool withSensors, bool withStatus);
+   #endif
    uint8_t MapFraction(uint8_t fraction);
   
   public:
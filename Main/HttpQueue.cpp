@@ -0,0 +1,142 @@
+#include "HttpQueue.h"
+#include "ModuleController.h"
+//--------------------------------------------------------------------------------------------------------------------------------
+HTTPQueueClass HTTPQueue;
+//--------------------------------------------------------------------------------------------------------------------------------
+HTTPQueueClass::HTTPQueueClass()
+{
+  current = NULL;
+  currentProvider = NO_HTTP_PROVIDER;
+  preferredProvider = 0;
+  starting = false;
+  memset(backoff,0,sizeof(backoff));
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+bool HTTPQueueClass::enqueue(HTTPRequestHandler* handler)
+{
+  if(!handler)
+    return false;
+    
+  return pending.push_back(handler);
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+void HTTPQueueClass::cancel(HTTPRequestHandler* handler)
+{
+  for(size_t i=0;i<pending.size();)
+  {
+    if(pending[i] == handler)
+      pending.remove(i,1);
+    else
+      i++;
+  }
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+void HTTPQueueClass::preferOtherProvider()
+{
+  uint8_t idx = currentProvider < 2 ? currentProvider : preferredProvider;
+  uint8_t other = idx ? 0 : 1;
+  
+  if(MainController->GetHTTPProvider(other))
+    preferredProvider = other;
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+HTTPQueryProvider* HTTPQueueClass::getReadyProvider(uint8_t idx, unsigned long now)
+{
+  HTTPQueryProvider* prov = MainController->GetHTTPProvider(idx);
+  if(!prov)
+    return NULL;
+
+  if(backoff[idx].Delay && (now - backoff[idx].FailedAt) < backoff[idx].Delay) // провайдер ещё отдыхает после неудачи
+    return NULL;
+
+  if(!prov->CanMakeQuery())
+    return NULL;
+
+  return prov;
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+void HTTPQueueClass::update()
+{
+  if(current || !pending.size()) // занимаемся запросом или нечего делать
+    return;
+
+  // ищем готового провайдера, начиная с предпочтительного - того, через которого прошёл последний запрос
+  unsigned long now = millis();
+  uint8_t idx = preferredProvider;
+  HTTPQueryProvider* prov = getReadyProvider(idx,now);
+  if(!prov)
+  {
+    idx = idx ? 0 : 1;
+    prov = getReadyProvider(idx,now);
+  }
+
+  if(!prov) // никто не готов, запросы подождут
+    return;
+
+  current = pending[0];
+  pending.remove(0,1);
+  currentProvider = idx;
+
+  starting = true;
+  prov->MakeQuery(this);
+  starting = false;
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+void HTTPQueueClass::OnAskForHost(String& host, int& port)
+{
+  if(current)
+    current->OnAskForHost(host,port);
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+void HTTPQueueClass::OnAskForData(String* data)
+{
+  if(current)
+    current->OnAskForData(data);
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+void HTTPQueueClass::OnAnswerLineReceived(String& line, bool& enough)
+{
+  if(current)
+    current->OnAnswerLineReceived(line,enough);
+  else
+    enough = true;
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+void HTTPQueueClass::OnHTTPResult(uint16_t statusCode)
+{
+  if(starting && statusCode == ERROR_HTTP_REQUEST_CANCELLED) // провайдер отменил свой предыдущий запрос, а не тот, что мы только что начали
+    return;
+    
+  HTTPRequestHandler* handler = current;
+  current = NULL; // обработчик результата может сразу поставить новый запрос в очередь
+
+  if(currentProvider < 2)
+  {
+    HTTPProviderBackoff* b = &(backoff[currentProvider]);
+    uint8_t other = currentProvider ? 0 : 1;
+
+    if(statusCode == HTTP_REQUEST_COMPLETED)
+    {
+      b->Delay = 0; // соединение было, провайдер в порядке (на какого провайдера переходить - мог уже решить обработчик ответа)
+    }
+    else
+    {
+      if(statusCode == ERROR_CANT_ESTABLISH_CONNECTION || statusCode == ERROR_MODEM_NOT_ANSWERING)
+      {
+        // не удалось соединиться - даём провайдеру отдохнуть, каждый раз всё дольше
+        b->FailedAt = millis();
+        b->Delay = b->Delay ? min(b->Delay*2,HTTP_QUEUE_BACKOFF_MAX) : HTTP_QUEUE_BACKOFF_MIN;
+      }
+
+      // следующий запрос попробуем через другого провайдера, если он есть
+      if(MainController->GetHTTPProvider(other))
+        preferredProvider = other;
+    }
+  } // if
+
+  currentProvider = NO_HTTP_PROVIDER;
+
+  if(handler)
+    handler->OnHTTPResult(statusCode);
+}
+//--------------------------------------------------------------------------------------------------------------------------------
@@ -0,0 +1,56 @@
+#ifndef _HTTP_QUEUE_H
+#define _HTTP_QUEUE_H
+//--------------------------------------------------------------------------------------------------------------------------------
+#include <Arduino.h>
+#include "HTTPInterfaces.h"
+#include "TinyVector.h"
+//--------------------------------------------------------------------------------------------------------------------------------
+#define HTTP_QUEUE_SIZE 4 // сколько запросов может ждать своей очереди
+#define HTTP_QUEUE_BACKOFF_MIN 5000 // через сколько миллисекунд повторять попытку через провайдера, который не смог установить соединение
+#define HTTP_QUEUE_BACKOFF_MAX 300000ul // максимальная пауза для провайдера, который раз за разом не может установить соединение
+#define NO_HTTP_PROVIDER 0xFF
+//--------------------------------------------------------------------------------------------------------------------------------
+typedef struct
+{
+  unsigned long FailedAt; // когда провайдер последний раз не смог установить соединение
+  unsigned long Delay; // сколько ждать до следующей попытки, 0 - провайдер свободен для запросов
+  
+} HTTPProviderBackoff;
+//--------------------------------------------------------------------------------------------------------------------------------
+// очередь HTTP-запросов: несколько источников ставят в неё свои обработчики, а очередь по одному отдаёт их
+// готовому провайдеру (ESP или SIM800) - с переключением на другого провайдера при неудаче и с растущей
+// паузой для провайдера, который не может установить соединение. Каждый запрос получает вызовы
+// HTTPRequestHandler на свой собственный обработчик, переданный в enqueue.
+//--------------------------------------------------------------------------------------------------------------------------------
+class HTTPQueueClass : public HTTPRequestHandler
+{
+  private:
+    FixedVector<HTTPRequestHandler*,HTTP_QUEUE_SIZE> pending;
+    HTTPRequestHandler* current; // обработчик запроса, который сейчас выполняется
+    uint8_t currentProvider; // через какого провайдера он выполняется
+    uint8_t preferredProvider; // с какого провайдера начинать поиск готового
+    bool starting; // внутри вызова MakeQuery
+    HTTPProviderBackoff backoff[2];
+
+    HTTPQueryProvider* getReadyProvider(uint8_t idx, unsigned long now);
+    
+  public:
+    HTTPQueueClass();
+
+    bool enqueue(HTTPRequestHandler* handler); // ставит запрос в очередь, false - очередь заполнена
+    void cancel(HTTPRequestHandler* handler); // убирает из очереди ещё не начатые запросы обработчика
+    bool busy() { return current != NULL; } // выполняется ли сейчас запрос
+    size_t waiting() { return pending.size(); } // сколько запросов ждут своей очереди
+    void preferOtherProvider(); // следующий запрос - через другого провайдера (например, текущий получил плохой ответ сервера)
+
+    void update(); // вызывается из loop, запускает следующий запрос, когда есть готовый провайдер
+
+    virtual void OnAskForHost(String& host, int& port);
+    virtual void OnAskForData(String* data);
+    virtual void OnAnswerLineReceived(String& line, bool& enough);
+    virtual void OnHTTPResult(uint16_t statusCode);
+};
+//--------------------------------------------------------------------------------------------------------------------------------
+extern HTTPQueueClass HTTPQueue;
+//--------------------------------------------------------------------------------------------------------------------------------
+#endif
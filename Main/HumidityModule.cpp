@@ -12,6 +12,9 @@ void HumidityModule::Setup()
 
   lastSi7021StrobeBreakPin = 0;
 
+  // опрос датчиков долгий - пусть контроллер вызывает нас согласно настроенному интервалу, разнося опрос с другими модулями
+  MainController->ScheduleModule(this,HUMIDITY_UPDATE_INTERVAL,schedulePriorityNormal);
+
 
   #if SUPPORTED_HUMIDITY_SENSORS > 0
 
@@ -131,13 +134,8 @@ const HumidityAnswer& HumidityModule::QuerySensor(uint8_t sensorNumber, uint8_t
 //--------------------------------------------------------------------------------------------------------------------------------------
 void HumidityModule::Update(uint16_t dt)
 { 
-  // обновление модуля тут
- 
-  lastUpdateCall += dt;
-  if(lastUpdateCall < HUMIDITY_UPDATE_INTERVAL) // обновляем согласно настроенному интервалу
-    return;
-  else
-    lastUpdateCall = 0; 
+  // обновление модуля тут, вызывается раз в HUMIDITY_UPDATE_INTERVAL
+  UNUSED(dt);
 
   // получаем данные с датчиков влажности
   #if SUPPORTED_HUMIDITY_SENSORS > 0
@@ -26,15 +26,11 @@ class HumidityModule : public AbstractModule // модуль управлени
     const HumidityAnswer& QuerySensor(uint8_t sensorNumber, uint8_t pin, uint8_t pin2,HumiditySensorType type); // опрашивает сенсор
 #endif
 
-    uint16_t lastUpdateCall;
-
     uint8_t lastSi7021StrobeBreakPin;
 
     
   public:
-    HumidityModule() : AbstractModule("HUMIDITY")
-    , lastUpdateCall(256) // разнесём опросы датчиков по времени
-    {}
+    HumidityModule() : AbstractModule("HUMIDITY") {}
 
     bool ExecCommand(const Command& command,bool wantAnswer);
     void Setup();
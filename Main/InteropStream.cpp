@@ -16,7 +16,7 @@ bool InteropStream::QueryCommand(COMMAND_TYPE cType, const String& command, bool
   String data = command; // копируем во внутренний буфер, т.к. входной параметр - const
    
   int delimIdx = data.indexOf('|');
-  const char* params = NULL;
+  char* params = NULL;
   if(delimIdx != -1)
   {
     data[delimIdx] = '\0';
@@ -26,7 +26,7 @@ bool InteropStream::QueryCommand(COMMAND_TYPE cType, const String& command, bool
   const char* moduleId = data.c_str();
   
   Command cmd;
-  cmd.Construct(moduleId,params,cType);
+  cmd.ConstructInPlace(moduleId,params,cType); // копия data живёт дольше команды, поэтому разбираем её по месту
  
   cmd.SetInternal(isInternalCommand); // устанавливаем флаг команды
   MainController->ProcessModuleCommand(cmd,NULL);
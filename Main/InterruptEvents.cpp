@@ -0,0 +1,58 @@
+#include "InterruptEvents.h"
+//--------------------------------------------------------------------------------------------------------------------------------
+InterruptEventsClass InterruptEvents;
+//--------------------------------------------------------------------------------------------------------------------------------
+static const uint8_t EVENT_PRIORITIES[ieEventTypesCount] PROGMEM = // приоритеты типов событий
+{
+  iepNormal, // ieWaterflowPulses
+};
+//--------------------------------------------------------------------------------------------------------------------------------
+InterruptEventsClass::InterruptEventsClass()
+{
+  memset(handlers,0,sizeof(handlers));
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+void InterruptEventsClass::setHandler(InterruptEventType type, InterruptEventHandler handler)
+{
+  if(type < ieEventTypesCount)
+    handlers[type] = handler;
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+bool InterruptEventsClass::post(InterruptEventType type, uint8_t source, uint16_t value)
+{
+  if(type >= ieEventTypesCount)
+    return false;
+    
+  InterruptEvent e = {(uint8_t) type, source, value};
+  return queues[pgm_read_byte(&(EVENT_PRIORITIES[type]))].push(e);
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+void InterruptEventsClass::dispatch()
+{
+  // за один вызов разбираем не больше, чем помещается во все очереди - чтобы поток событий не остановил loop
+  InterruptEvent e;
+  
+  for(uint16_t i=0;i<INTERRUPT_EVENTS_QUEUE_SIZE*iepPrioritiesCount;i++)
+  {
+    bool hasEvent = false;
+    
+    // после каждого события снова начинаем со старшего приоритета
+    for(uint8_t p=0;p<iepPrioritiesCount;p++)
+    {
+      if(queues[p].pop(e))
+      {
+        hasEvent = true;
+        break;
+      }
+    }
+
+    if(!hasEvent)
+      break;
+
+    InterruptEventHandler handler = handlers[e.Type];
+    if(handler)
+      handler(e);
+      
+  } // for
+}
+//--------------------------------------------------------------------------------------------------------------------------------
@@ -0,0 +1,100 @@
+#ifndef _INTERRUPT_EVENTS_H
+#define _INTERRUPT_EVENTS_H
+//--------------------------------------------------------------------------------------------------------------------------------
+#include <Arduino.h>
+//--------------------------------------------------------------------------------------------------------------------------------
+#define INTERRUPT_EVENTS_QUEUE_SIZE 16 // размер очереди событий одного приоритета (степень двойки, не больше 128)
+//--------------------------------------------------------------------------------------------------------------------------------
+typedef enum
+{
+  ieWaterflowPulses, // импульсы датчика расхода воды: Source - номер датчика, Value - кол-во импульсов
+
+  ieEventTypesCount // кол-во типов событий, всегда последний
+  
+} InterruptEventType;
+//--------------------------------------------------------------------------------------------------------------------------------
+typedef enum
+{
+  iepHigh, // разбираются первыми
+  iepNormal,
+
+  iepPrioritiesCount
+  
+} InterruptEventPriority;
+//--------------------------------------------------------------------------------------------------------------------------------
+typedef struct
+{
+  uint8_t Type; // тип события, из InterruptEventType
+  uint8_t Source; // кто прислал событие (номер датчика, канала и т.п.)
+  uint16_t Value; // данные события
+  
+} InterruptEvent;
+//--------------------------------------------------------------------------------------------------------------------------------
+typedef void (*InterruptEventHandler)(const InterruptEvent& e);
+//--------------------------------------------------------------------------------------------------------------------------------
+// барьер для компилятора: запись элемента очереди не должна переехать за публикацию индекса, и наоборот
+#define EVENTS_COMPILER_BARRIER() __asm__ __volatile__("" ::: "memory")
+//--------------------------------------------------------------------------------------------------------------------------------
+// очередь без блокировок для одного писателя (прерывание) и одного читателя (loop): писатель меняет только head,
+// читатель - только tail, индексы однобайтовые, поэтому запрещать прерывания не нужно ни той, ни другой стороне.
+//--------------------------------------------------------------------------------------------------------------------------------
+template<typename T, uint8_t Size>
+class SPSCQueue
+{
+  private:
+    T items[Size];
+    volatile uint8_t head; // куда пишет следующий элемент писатель
+    volatile uint8_t tail; // откуда читает следующий элемент читатель
+
+  public:
+    SPSCQueue() : head(0), tail(0) {}
+
+    bool push(const T& item) // вызывается писателем, false - очередь заполнена
+    {
+      uint8_t h = head;
+      uint8_t next = (h + 1) & (Size - 1);
+      if(next == tail)
+        return false;
+
+      items[h] = item;
+      EVENTS_COMPILER_BARRIER();
+      head = next;
+      return true;
+    }
+
+    bool pop(T& item) // вызывается читателем, false - очередь пуста
+    {
+      uint8_t t = tail;
+      if(t == head)
+        return false;
+
+      EVENTS_COMPILER_BARRIER();
+      item = items[t];
+      EVENTS_COMPILER_BARRIER();
+      tail = (t + 1) & (Size - 1);
+      return true;
+    }
+};
+//--------------------------------------------------------------------------------------------------------------------------------
+// передача работы из прерываний в loop: прерывание кладёт типизированное событие в очередь его приоритета,
+// loop разбирает очереди, начиная со старшего приоритета, и вызывает обработчик, назначенный типу события.
+// Все прерывания, которые шлют события, должны быть одного уровня (не прерывать друг друга) - тогда
+// писатель у каждой очереди фактически один.
+//--------------------------------------------------------------------------------------------------------------------------------
+class InterruptEventsClass
+{
+  private:
+    SPSCQueue<InterruptEvent,INTERRUPT_EVENTS_QUEUE_SIZE> queues[iepPrioritiesCount];
+    InterruptEventHandler handlers[ieEventTypesCount];
+
+  public:
+    InterruptEventsClass();
+
+    void setHandler(InterruptEventType type, InterruptEventHandler handler); // назначает обработчик событий типа
+    bool post(InterruptEventType type, uint8_t source, uint16_t value); // вызывается из прерывания, false - очередь заполнена
+    void dispatch(); // вызывается из loop, разбирает накопившиеся события
+};
+//--------------------------------------------------------------------------------------------------------------------------------
+extern InterruptEventsClass InterruptEvents;
+//--------------------------------------------------------------------------------------------------------------------------------
+#endif
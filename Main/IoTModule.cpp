@@ -1,5 +1,8 @@
 #include "IoTModule.h"
 #include "ModuleController.h"
+#ifdef IOT_THROUGH_HTTP_QUEUE
+#include "HttpQueue.h"
+#endif
 //--------------------------------------------------------------------------------------------------------------------------------------
 #if defined(USE_IOT_MODULE)
 IoTModule* _thisIotModule;
@@ -135,10 +138,102 @@ void IoTModule::SwitchToNextService()
      break;
    }
 
+  #ifdef IOT_THROUGH_HTTP_QUEUE
+   // сначала - через провайдеров HTTP-запросов, шлюзы останутся на случай неудачи
+   if(EnqueueHTTPRequest())
+    return;
+  #endif
    
    ProcessNextGate(); // обрабатываем следующий шлюз, уже с новым сервисом 
 }
 
+//--------------------------------------------------------------------------------------------------------------------------------------
+#ifdef IOT_THROUGH_HTTP_QUEUE
+//--------------------------------------------------------------------------------------------------------------------------------------
+bool IoTModule::EnqueueHTTPRequest()
+{
+  IoTSettings iotSettings = MainController->GetSettings()->GetIoTSettings();
+
+  switch(currentService)
+  {
+    case iotThingSpeak:
+      if(!iotSettings.Flags.ThingSpeakEnabled || !strlen(iotSettings.ThingSpeakChannelID))
+        return false;
+    break;
+  }
+
+  answerOk = false;
+  return HTTPQueue.enqueue(this);
+}
+//--------------------------------------------------------------------------------------------------------------------------------------
+void IoTModule::OnAskForHost(String& host, int& port)
+{
+  switch(currentService)
+  {
+    case iotThingSpeak:
+      host = THINGSPEAK_IP;
+      port = 80;
+    break;
+  }
+}
+//--------------------------------------------------------------------------------------------------------------------------------------
+void IoTModule::OnAskForData(String* data)
+{
+#ifdef IOT_DEBUG
+  DEBUG_LOGLN(F("IOT - provider asking for data..."));
+#endif
+
+  switch(currentService)
+  {
+    case iotThingSpeak:
+    {
+      IoTSettings iotSettings = MainController->GetSettings()->GetIoTSettings();
+
+      data->reserve(dataToSend->length() + 150);
+      *data = F("GET /update?headers=false&api_key=");
+      *data += iotSettings.ThingSpeakChannelID;
+      *data += F("&");
+      *data += *dataToSend;
+      *data += F(" HTTP/1.1\r\nAccept: */*\r\nUser-Agent: ");
+      *data += IOT_USER_AGENT;
+      *data += F("\r\nHost: ");
+      *data += THINGSPEAK_HOST;
+      *data += F("\r\nConnection: close\r\n\r\n");
+    }
+    break;
+  }
+
+  delete dataToSend;
+  dataToSend = new String();
+}
+//--------------------------------------------------------------------------------------------------------------------------------------
+void IoTModule::OnAnswerLineReceived(String& line, bool& enough)
+{
+  // нам нужна только строка статуса, у GSM-модемов она приходит после +TCPRECV
+  if(line.indexOf(F("HTTP/")) != -1)
+  {
+    answerOk = line.indexOf(F(" 200")) != -1;
+    enough = true;
+    return;
+  }
+
+  enough = line.endsWith(F("CLOSED")) || line.endsWith(F("Link Closed"));
+}
+//--------------------------------------------------------------------------------------------------------------------------------------
+void IoTModule::OnHTTPResult(uint16_t statusCode)
+{
+#ifdef IOT_DEBUG
+  DEBUG_LOG(F("IOT - HTTP request done: "));
+  DEBUG_LOGLN(String(statusCode));
+#endif
+
+  if(statusCode == HTTP_REQUEST_COMPLETED && !answerOk)
+    HTTPQueue.preferOtherProvider(); // сервис ответил не 200 OK - в следующий раз попробуем через другого провайдера
+
+  // дальше - как после шлюза: при неудаче пробуем оставшиеся шлюзы, если они есть
+  Done({statusCode == HTTP_REQUEST_COMPLETED && answerOk,currentService});
+}
+#endif // IOT_THROUGH_HTTP_QUEUE
 //--------------------------------------------------------------------------------------------------------------------------------------
 void IoTModule::Done(const IoTCallResult& result)
 {
@@ -3,8 +3,14 @@
 
 #include "AbstractModule.h"
 #include "IoT.h"
+#ifdef IOT_THROUGH_HTTP_QUEUE
+#include "HTTPInterfaces.h"
+#endif
 //--------------------------------------------------------------------------------------------------------------------------------------
 class IoTModule : public AbstractModule // модуль отсылки данных в IoT-хранилища
+#ifdef IOT_THROUGH_HTTP_QUEUE
+, public HTTPRequestHandler
+#endif
 {
   private:
 
@@ -27,6 +33,11 @@ class IoTModule : public AbstractModule // модуль отсылки данн
   void ProcessNextGate();
 
   AbstractModule* FindModule(byte index);
+
+#ifdef IOT_THROUGH_HTTP_QUEUE
+  bool answerOk; // сервис ответил 200 OK
+  bool EnqueueHTTPRequest(); // ставит отсыл данных текущему сервису в очередь HTTP-запросов
+#endif
   
 #endif
   
@@ -42,6 +53,13 @@ class IoTModule : public AbstractModule // модуль отсылки данн
     void Done(const IoTCallResult& result);
  #endif
 
+#ifdef IOT_THROUGH_HTTP_QUEUE
+    virtual void OnAskForHost(String& host, int& port);
+    virtual void OnAskForData(String* data);
+    virtual void OnAnswerLineReceived(String& line, bool& enough);
+    virtual void OnHTTPResult(uint16_t statusCode);
+#endif
+
 };
 //--------------------------------------------------------------------------------------------------------------------------------------
 #endif
@@ -14,11 +14,62 @@ String LogModule::_NEWLINE;
 //--------------------------------------------------------------------------------------------------------------------------------
 void LogModule::writeToFile(SdFile& f, const String& data)
 {
-  for(size_t i=0;i<data.length();i++)
+  f.write(data.c_str(),data.length());
+  yield();
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+void LogModule::BeginLogBuffer()
+{
+  logBufferPos = 0;
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+void LogModule::FlushLogBuffer()
+{
+  if(logBufferPos)
+    logFile.write(SD_BUFFER,logBufferPos);
+
+  logBufferPos = 0;
+  
+  yield(); // т.к. запись на SD-карту у нас может занимать какое-то время - дёргаем кооперативный режим
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+void LogModule::EndLogBuffer()
+{
+  FlushLogBuffer();
+  logFile.flush(); // сливаем данные на карту
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+void LogModule::PutToLogBuffer(char ch)
+{
+  SD_BUFFER[logBufferPos++] = ch;
+  
+  if(logBufferPos >= SD_BUFFER_LENGTH) // буфер заполнен - отдаём его SdFat, сектор на карту она пишет из своего кэша
+    FlushLogBuffer();
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+void LogModule::AppendToLogBuffer(const char* data, bool asCsv)
+{
+  bool quoted = false;
+  if(asCsv)
   {
-    f.write(data[i]);
-    yield();
+    // если в данных есть запрещённые символы - надо обрамить их в двойные кавычки, а кавычки - удвоить
+    quoted = strchr(data,'"') || strchr(data,';') || strchr(data,',') ||  // прописываем запятую принудительно, т.к. пользователь может переопределить COMMA_DELIMITER
+      strstr(data,LogModule::_COMMA.c_str()) || strstr(data,LogModule::_NEWLINE.c_str());
   }
+
+  if(quoted)
+    PutToLogBuffer('"');
+
+  while(*data)
+  {
+    if(quoted && *data == '"')
+      PutToLogBuffer('"');
+      
+    PutToLogBuffer(*data++);
+  }
+
+  if(quoted)
+    PutToLogBuffer('"');
 }
 //--------------------------------------------------------------------------------------------------------------------------------
 void LogModule::Setup()
@@ -29,6 +80,7 @@ void LogModule::Setup()
     currentLogFileName.reserve(20); // резервируем память, чтобы избежать фрагментации
 
    lastUpdateCall = 0;
+   logBufferPos = 0;
 
    lastDOW = -1;
    
@@ -37,6 +89,7 @@ void LogModule::Setup()
 #endif   
 
    loggingInterval = LOGGING_INTERVAL; // по умолчанию, берём из Globals.h. Позже - будет из настроек.
+   scheduleLogging();
   // настройка модуля тут
  }
  //--------------------------------------------------------------------------------------------------------------------------------
@@ -498,6 +551,9 @@ void LogModule::GatherLogInfo(const DS3231Time& tm)
   statesTypes.push_back(StateSoilMoisture); statesStrings.push_back(&soilMoistureType);
   statesTypes.push_back(StatePH); statesStrings.push_back(&phType);
  
+  // строки копим в буфере и пишем на карту целыми блоками
+  BeginLogBuffer();
+ 
   // он сказал - поехали
   size_t cnt = MainController->GetModulesCount();
   // он махнул рукой
@@ -541,7 +597,8 @@ void LogModule::GatherLogInfo(const DS3231Time& tm)
                       #endif
                       {
                           // пишем строку с данными               
-                          WriteLogLine(hhmm,moduleName,stateType,sensorIdx,*os);
+                          String sensorData = *os;
+                          WriteLogLine(hhmm.c_str(),moduleName.c_str(),stateType.c_str(),sensorIdx.c_str(),sensorData.c_str());
                       } // if                      
                   } // if (os)
               } // for
@@ -552,6 +609,7 @@ void LogModule::GatherLogInfo(const DS3231Time& tm)
                 
     } // for
 
+    EndLogBuffer(); // дописываем остаток буфера на карту
   
     // записали, выдохнули, расслабились.
     #ifdef LOGGING_DEBUG_MODE
@@ -560,19 +618,17 @@ void LogModule::GatherLogInfo(const DS3231Time& tm)
   
 }
 //--------------------------------------------------------------------------------------------------------------------------------
-void LogModule::WriteLogLine(const String& hhmm, const String& moduleName, const String& sensorType, const String& sensorIdx, const String& sensorData)
+void LogModule::WriteLogLine(const char* hhmm, const char* moduleName, const char* sensorType, const char* sensorIdx, const char* sensorData)
 {
-  // пишем строку с данными в лог
+  // пишем строку с данными в буфер лога, на карту она попадёт целым блоком
   // HH:MM,MODULE_NAME,SENSOR_TYPE,SENSOR_IDX,SENSOR_DATA\r\n
-  WRITE_TO_LOG(hhmm);             WRITE_TO_LOG(LogModule::_COMMA);
-  WRITE_TO_LOG(moduleName);       WRITE_TO_LOG(LogModule::_COMMA);
-  WRITE_TO_LOG(sensorType);       WRITE_TO_LOG(LogModule::_COMMA);
-  WRITE_TO_LOG(sensorIdx);        WRITE_TO_LOG(LogModule::_COMMA);
-  WRITE_TO_LOG(csv(sensorData));  WRITE_TO_LOG(LogModule::_NEWLINE);
-
-  logFile.flush(); // сливаем данные на карту
-
-  yield(); // т.к. запись на SD-карту у нас может занимать какое-то время - дёргаем кооперативный режим
+  const char* comma = LogModule::_COMMA.c_str();
+  
+  AppendToLogBuffer(hhmm);              AppendToLogBuffer(comma);
+  AppendToLogBuffer(moduleName);        AppendToLogBuffer(comma);
+  AppendToLogBuffer(sensorType);        AppendToLogBuffer(comma);
+  AppendToLogBuffer(sensorIdx);         AppendToLogBuffer(comma);
+  AppendToLogBuffer(sensorData,true);   AppendToLogBuffer(LogModule::_NEWLINE.c_str());
 
 }
 //--------------------------------------------------------------------------------------------------------------------------------
@@ -602,13 +658,25 @@ String LogModule::csv(const String& src)
   return input;
 }
 //--------------------------------------------------------------------------------------------------------------------------------
+void LogModule::scheduleLogging()
+{
+  // интервал логгирования бывает длиннее, чем умещается в расписании модуля (больше 65 секунд) - тогда просыпаемся
+  // несколько раз и досчитываем его сами
+  unsigned long left = loggingInterval - lastUpdateCall;
+  MainController->ScheduleModule(this,left > 0xFFFF ? 0xFFFF : left,schedulePriorityLow);
+}
+//--------------------------------------------------------------------------------------------------------------------------------
 void LogModule::Update(uint16_t dt)
 { 
   lastUpdateCall += dt;
   if(lastUpdateCall < loggingInterval) // не надо обновлять ничего - не пришло время
+  {
+    scheduleLogging();
     return;
-  else
-    lastUpdateCall = 0;
+  }
+  
+  lastUpdateCall = 0;
+  scheduleLogging();
 
   if(!MainController->HasSDCard())//hasSD) // нет карты или карту не удалось инициализировать
   {
@@ -23,8 +23,19 @@ class LogModule : public AbstractModule // модуль логгирования
 
   int8_t lastDOW;
 
+  void scheduleLogging(); // просит контроллер вызвать Update к следующему логгированию
+
   void writeToFile(SdFile& f, const String& data);
 
+  // буферизованная запись в лог: строки копятся в общем буфере SD_BUFFER (чтение файлов с карты идёт тоже из loop, не одновременно
+  // с записью лога) и отдаются SdFat блоками, на карту данные уходят один раз за интервал логгирования
+  uint16_t logBufferPos; // сколько байт лежит в буфере
+  void BeginLogBuffer();
+  void PutToLogBuffer(char ch);
+  void AppendToLogBuffer(const char* data, bool asCsv = false);
+  void FlushLogBuffer();
+  void EndLogBuffer();
+
   SdFile logFile; // текущий файл для логгирования
   SdFile actionFile; // файл с записями о произошедших действиях
   String currentLogFileName; // текущее имя файла, с которым мы работаем сейчас
@@ -45,7 +56,7 @@ class LogModule : public AbstractModule // модуль логгирования
   String csv(const String& input);
 
   // HH:MM,MODULE_NAME,SENSOR_TYPE,SENSOR_IDX,SENSOR_DATA\r\n
-  void WriteLogLine(const String& hhmm, const String& moduleName, const String& sensorType, const String& sensorIdx, const String& sensorData);
+  void WriteLogLine(const char* hhmm, const char* moduleName, const char* sensorType, const char* sensorIdx, const char* sensorData);
   
   public:
     LogModule() : AbstractModule("LOG") {}
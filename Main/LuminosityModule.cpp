@@ -77,6 +77,8 @@ long BH1750Support::GetCurrentLuminosity()
 //--------------------------------------------------------------------------------------------------------------------------------------
 void LuminosityModule::Setup()
 {
+  // реле досветки и диоду ручного режима хватает обновления раз в ACTUATORS_UPDATE_INTERVAL, опрос датчиков - реже, по своему счётчику
+  MainController->ScheduleModule(this,ACTUATORS_UPDATE_INTERVAL,schedulePriorityHigh);
 
  #if LIGHT_SENSORS_COUNT > 0
 
@@ -189,6 +189,41 @@ void Adafruit_MCP23017::writeGPIOAB(uint16_t ba) {
 	Wire.endTransmission();
 }
 
+/**
+ * Writes the A and/or B register of a pair (addrA and addrA+1) in a single transaction,
+ * using sequential addressing. Bit 0 of ports selects port A, bit 1 selects port B.
+ */
+void Adafruit_MCP23017::writeRegisterAB(uint8_t addrA, uint16_t value, uint8_t ports) {
+	if(!(ports & 0b11))
+		return;
+
+	Wire.beginTransmission(MCP23017_ADDRESS | i2caddr);
+	if(ports & 0b01) {
+		wiresend(addrA);
+		wiresend(value & 0xFF);
+		if(ports & 0b10)
+			wiresend(value >> 8);
+	} else {
+		wiresend(addrA + 1);
+		wiresend(value >> 8);
+	}
+	Wire.endTransmission();
+}
+
+/**
+ * Writes the direction of all 16 pins (1 - input, 0 - output) to the selected ports.
+ */
+void Adafruit_MCP23017::writeModeAB(uint16_t dirs, uint8_t ports) {
+	writeRegisterAB(MCP23017_IODIRA,dirs,ports);
+}
+
+/**
+ * Writes the output latches of all 16 pins to the selected ports.
+ */
+void Adafruit_MCP23017::writePortAB(uint16_t val, uint8_t ports) {
+	writeRegisterAB(MCP23017_OLATA,val,ports);
+}
+
 void Adafruit_MCP23017::digitalWrite(uint8_t pin, uint8_t d) {
 	uint8_t gpio;
 	uint8_t bit=bitForPin(pin);
@@ -32,6 +32,8 @@ public:
   uint8_t digitalRead(uint8_t p);
 
   void writeGPIOAB(uint16_t);
+  void writeModeAB(uint16_t dirs, uint8_t ports);
+  void writePortAB(uint16_t val, uint8_t ports);
   uint16_t readGPIOAB();
   uint8_t readGPIO(uint8_t b);
 
@@ -50,6 +52,7 @@ public:
 
   uint8_t readRegister(uint8_t addr);
   void writeRegister(uint8_t addr, uint8_t value);
+  void writeRegisterAB(uint8_t addrA, uint16_t value, uint8_t ports);
 
   /**
    * Utility private method to update a register associated with a pin (whether port A/B)
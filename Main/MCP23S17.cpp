@@ -163,6 +163,26 @@ void MCP23S17::writeRegister(uint8_t addr) {
     ::digitalWrite(_cs, HIGH);
 }
 
+/*! This private function writes the port A and/or port B register pair (addrA and addrA+1,
+ *  as stored in the _reg array) in a single transaction using sequential addressing.
+ *  Bit 0 of ports selects port A, bit 1 selects port B.
+ */
+void MCP23S17::writeRegisterAB(uint8_t addrA, uint8_t ports) {
+    if (addrA > 20 || !(ports & 0b11)) {
+        return;
+    }
+    uint8_t addr = (ports & 0b01) ? addrA : addrA + 1;
+    uint8_t cmd = 0b01000000 | ((_addr & 0b111) << 1);
+    ::digitalWrite(_cs, LOW);
+    _spi->transfer(cmd);
+    _spi->transfer(addr);
+    _spi->transfer(_reg[addr]);
+    if ((ports & 0b11) == 0b11) {
+        _spi->transfer(_reg[addr + 1]);
+    }
+    ::digitalWrite(_cs, HIGH);
+}
+
 /*! This private function performs a bulk read on all the registers in the chip to
  *  ensure the _reg array contains all the correct current values.
  */
@@ -386,6 +406,24 @@ void MCP23S17::writePort(uint16_t val) {
     writeRegister(OLATB);
 }
 
+/*! Writes the direction of all 16 pins (1 - input, 0 - output) to the ports selected
+ *  by the ports mask (bit 0 - port A, bit 1 - port B) in a single transaction.
+ */
+void MCP23S17::writeModeAB(uint16_t dirs, uint8_t ports) {
+    _reg[IODIRA] = dirs & 0xFF;
+    _reg[IODIRB] = dirs >> 8;
+    writeRegisterAB(IODIRA, ports);
+}
+
+/*! Writes the output latches of all 16 pins to the ports selected by the ports mask
+ *  (bit 0 - port A, bit 1 - port B) in a single transaction.
+ */
+void MCP23S17::writePortAB(uint16_t val, uint8_t ports) {
+    _reg[OLATA] = val & 0xFF;
+    _reg[OLATB] = val >> 8;
+    writeRegisterAB(OLATA, ports);
+}
+
 /*! This enables the interrupt functionality of a pin.  The interrupt type can be one of:
  *
  *  * CHANGE
@@ -72,6 +72,7 @@ class MCP23S17 {
 
         void readRegister(uint8_t addr); 
         void writeRegister(uint8_t addr);
+        void writeRegisterAB(uint8_t addrA, uint8_t ports);
         void readAll();
         void writeAll();
     
@@ -94,6 +95,8 @@ class MCP23S17 {
         uint16_t readPort();
         void writePort(uint8_t port, uint8_t val);
         void writePort(uint16_t val);
+        void writeModeAB(uint16_t dirs, uint8_t ports);
+        void writePortAB(uint16_t val, uint8_t ports);
         void enableInterrupt(uint8_t pin, uint8_t type);
         void disableInterrupt(uint8_t pin);
         void setMirror(boolean m);
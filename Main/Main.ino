@@ -50,6 +50,9 @@
 #include "AlertModule.h"
 #include "ZeroStreamListener.h"
 #include "Memory.h"
+#include "AnalogSampler.h"
+#include "HttpQueue.h"
+#include "InterruptEvents.h"
 #include "InteropStream.h"
 
 #ifdef USE_HTTP_MODULE
@@ -502,7 +505,8 @@ void loop()
   
     // вычисляем время, прошедшее с момента последнего вызова
     unsigned long curMillis = millis();
-    uint16_t dt = curMillis - lastMillis;
+    unsigned long elapsed = curMillis - lastMillis;
+    uint16_t dt = elapsed > 0xFFFF ? 0xFFFF : elapsed; // после долгой остановки дельта не должна переваливать через ноль
     
     lastMillis = curMillis; // сохраняем последнее значение вызова millis()
 
@@ -573,8 +577,15 @@ void loop()
     commandsFromSerial.ClearCommand(); // очищаем полученную команду
    } // if
     
+   #ifdef USE_ANALOG_SAMPLER
+    AnalogSampler.update(); // на Due снимаем очередной отсчёт АЦП, на Mega отсчёты снимаются в прерывании
+   #endif
+
+    HTTPQueue.update(); // запускаем следующий HTTP-запрос из очереди, если есть готовый провайдер
+    InterruptEvents.dispatch(); // разбираем события, присланные из прерываний
+   
     // обновляем состояние всех зарегистрированных модулей
-   controller.UpdateModules(dt,ModuleUpdateProcessed);
+   controller.UpdateModules(ModuleUpdateProcessed);
 
 
    
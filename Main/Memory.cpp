@@ -60,6 +60,70 @@ void* MemFind(const void *haystack, size_t n, const void *needle, size_t m)
   AT24C512* memoryBank;
 #endif
 //--------------------------------------------------------------------------------------------------------------------------------
+#ifdef USE_LOOP_PROFILER
+MemoryStatData memoryStat = {0,0,0,0};
+//--------------------------------------------------------------------------------------------------------------------------------
+MemoryStatData* MemGetStat()
+{
+  return &memoryStat;
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+void MemResetStat()
+{
+  memset(&memoryStat,0,sizeof(MemoryStatData));
+}
+#endif // USE_LOOP_PROFILER
+//--------------------------------------------------------------------------------------------------------------------------------
+static uint8_t memWriteDepth = 0; // уровень вложенности MemBeginWrite
+//--------------------------------------------------------------------------------------------------------------------------------
+#if EEPROM_USED_MEMORY != EEPROM_BUILTIN
+//--------------------------------------------------------------------------------------------------------------------------------
+// кеш внешней памяти: одна строка, выровненная по MEMORY_CACHE_LINE_SIZE. Чтение заполняет строку одной транзакцией I2C,
+// запись меняет байты в строке и запоминает границы изменённого диапазона, который потом пишется в память страничной записью
+//--------------------------------------------------------------------------------------------------------------------------------
+#define NO_CACHE_LINE 0xFFFFFFFF
+static uint32_t memCacheLine = NO_CACHE_LINE; // адрес начала закешированной строки
+static uint8_t memCache[MEMORY_CACHE_LINE_SIZE];
+static uint8_t memDirtyFrom = MEMORY_CACHE_LINE_SIZE; // начало изменённого диапазона в строке
+static uint8_t memDirtyTo = 0; // конец изменённого диапазона в строке, не включая
+//--------------------------------------------------------------------------------------------------------------------------------
+static void MemFlush()
+{
+  if(memDirtyFrom >= memDirtyTo) // нечего писать
+    return;
+
+  #ifdef USE_LOOP_PROFILER
+    unsigned long startedAt = micros();
+  #endif
+
+  // неизменённые байты внутри диапазона тоже уйдут в память, но одной страничной записью это дешевле, чем побайтно
+  memoryBank->write(memCacheLine + memDirtyFrom, memCache + memDirtyFrom, memDirtyTo - memDirtyFrom);
+
+  #ifdef USE_LOOP_PROFILER
+    memoryStat.Flushes++;
+    memoryStat.BytesWritten += memDirtyTo - memDirtyFrom;
+    memoryStat.WaitMicros += micros() - startedAt;
+  #endif
+
+  memDirtyFrom = MEMORY_CACHE_LINE_SIZE;
+  memDirtyTo = 0;
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+static void MemSelectLine(unsigned int address)
+{
+  uint32_t line = address - (address % MEMORY_CACHE_LINE_SIZE);
+  if(line == memCacheLine)
+    return;
+
+  // переключаемся на другую строку - сначала сохраняем изменения в текущей
+  MemFlush();
+  
+  memoryBank->read(line, memCache, MEMORY_CACHE_LINE_SIZE);
+  memCacheLine = line;
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+#endif // EEPROM_USED_MEMORY != EEPROM_BUILTIN
+//--------------------------------------------------------------------------------------------------------------------------------
 void MemInit()
 {
 #if EEPROM_USED_MEMORY == EEPROM_BUILTIN
@@ -81,16 +145,9 @@ uint8_t MemRead(unsigned int address)
 {
   #if EEPROM_USED_MEMORY == EEPROM_BUILTIN
     return EEPROM.read(address);
-  #elif EEPROM_USED_MEMORY == EEPROM_AT24C32
-     return memoryBank->read(address);
-  #elif EEPROM_USED_MEMORY == EEPROM_AT24C64
-    return memoryBank->read(address);
-  #elif EEPROM_USED_MEMORY == EEPROM_AT24C128
-   return memoryBank->read(address);
-  #elif EEPROM_USED_MEMORY == EEPROM_AT24C256
-   return memoryBank->read(address);
-  #elif EEPROM_USED_MEMORY == EEPROM_AT24C512
-    return memoryBank->read(address);
+  #else
+    MemSelectLine(address);
+    return memCache[address % MEMORY_CACHE_LINE_SIZE];
   #endif      
 
 }
@@ -98,17 +155,69 @@ uint8_t MemRead(unsigned int address)
 void MemWrite(unsigned int address, uint8_t val)
 {
   #if EEPROM_USED_MEMORY == EEPROM_BUILTIN
+  
+    if(EEPROM.read(address) == val) // не тратим ресурс ячейки на запись того же значения
+    {
+      #ifdef USE_LOOP_PROFILER
+        memoryStat.BytesSkipped++;
+      #endif
+      return;
+    }
+    
+    #ifdef USE_LOOP_PROFILER
+      unsigned long startedAt = micros();
+    #endif
+    
     EEPROM.write(address, val);
-  #elif EEPROM_USED_MEMORY == EEPROM_AT24C32
-     memoryBank->write(address,val);
-  #elif EEPROM_USED_MEMORY == EEPROM_AT24C64
-    memoryBank->write(address,val);
-  #elif EEPROM_USED_MEMORY == EEPROM_AT24C128
-   memoryBank->write(address,val);
-  #elif EEPROM_USED_MEMORY == EEPROM_AT24C256
-   memoryBank->write(address,val);
-  #elif EEPROM_USED_MEMORY == EEPROM_AT24C512
-    memoryBank->write(address,val);
+    
+    #ifdef USE_LOOP_PROFILER
+      memoryStat.Flushes++;
+      memoryStat.BytesWritten++;
+      memoryStat.WaitMicros += micros() - startedAt;
+    #endif
+    
+  #else
+  
+    MemSelectLine(address);
+    
+    uint8_t offset = address % MEMORY_CACHE_LINE_SIZE;
+    if(memCache[offset] == val) // не тратим ресурс ячейки на запись того же значения
+    {
+      #ifdef USE_LOOP_PROFILER
+        memoryStat.BytesSkipped++;
+      #endif
+      return;
+    }
+
+    memCache[offset] = val;
+    
+    if(offset < memDirtyFrom)
+      memDirtyFrom = offset;
+      
+    if(offset >= memDirtyTo)
+      memDirtyTo = offset + 1;
+
+    if(!memWriteDepth) // не в пакетной записи - пишем сразу
+      MemFlush();
+      
+  #endif
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+void MemBeginWrite()
+{
+  memWriteDepth++;
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+void MemCommit()
+{
+  if(!memWriteDepth)
+    return;
+
+  memWriteDepth--;
+  
+  #if EEPROM_USED_MEMORY != EEPROM_BUILTIN
+    if(!memWriteDepth)
+      MemFlush();
   #endif
 }
 //--------------------------------------------------------------------------------------------------------------------------------
@@ -2,11 +2,31 @@
 #define _MEMORY_H
 //--------------------------------------------------------------------------------------------------------------------------------
 #include <Arduino.h>
+#include "Globals.h"
+//--------------------------------------------------------------------------------------------------------------------------------
+#define MEMORY_CACHE_LINE_SIZE 32 // размер строки кеша внешней памяти, байт. Строка выровнена по своему размеру, поэтому никогда не пересекает страницу AT24CX (32/64/128 байт)
+//--------------------------------------------------------------------------------------------------------------------------------
+#ifdef USE_LOOP_PROFILER
+typedef struct
+{
+  uint32_t Flushes; // сколько раз изменённые байты кеша сбрасывались в память
+  uint32_t BytesWritten; // сколько байт реально записано в память
+  uint32_t BytesSkipped; // сколько байт не записано, поскольку их значение не изменилось
+  uint32_t WaitMicros; // суммарное время записи в память, микросекунд
+  
+} MemoryStatData; // статистика записи в EEPROM
+#endif // USE_LOOP_PROFILER
 //--------------------------------------------------------------------------------------------------------------------------------
 void MemInit();
 uint8_t MemRead(unsigned int address);
 void MemWrite(unsigned int address, uint8_t val);
+void MemBeginWrite(); // начинает пакетную запись: изменения копятся в кеше и пишутся в память страницами, вызовы могут быть вложенными
+void MemCommit(); // завершает пакетную запись, на последнем вложенном вызове сбрасывает изменения в память
 void* MemFind(const void *haystack, size_t n, const void *needle, size_t m);
+#ifdef USE_LOOP_PROFILER
+MemoryStatData* MemGetStat();
+void MemResetStat();
+#endif
 //--------------------------------------------------------------------------------------------------------------------------------
 
 #endif
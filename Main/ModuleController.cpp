@@ -6,6 +6,10 @@
 #if defined(USE_WIFI_MODULE) || defined(USE_SMS_MODULE)
 #include "CoreTransport.h"
 #endif
+#ifdef USE_LOOP_PROFILER
+#include "StatModule.h" // для freeRam
+#include "Memory.h"
+#endif
 //--------------------------------------------------------------------------------------------------------------------------------------
 PublishStruct PublishSingleton;
 ModuleController* MainController = NULL;
@@ -169,10 +173,40 @@ ModuleController::ModuleController() : cParser(NULL)
 #endif
 {
   reservationResolver = NULL;
+  lastUpdateAt = 0;
+  transportsRunAt = 0;
   httpQueryProviders[0] = NULL;
   httpQueryProviders[1] = NULL;
   PublishSingleton.Text.reserve(SHARED_BUFFER_LENGTH); // 500 байт для ответа от модуля должно хватить.
+
+  #ifdef USE_LOOP_PROFILER
+    ResetProfile();
+  #endif
+}
+//--------------------------------------------------------------------------------------------------------------------------------------
+#ifdef USE_LOOP_PROFILER
+void ModuleController::ResetProfile()
+{
+  loopProfile.StartedAt = millis();
+  loopProfile.Loops = 0;
+  loopProfile.TotalMicros = 0;
+  loopProfile.MaxMicros = 0;
+  loopProfile.Commands = 0;
+  loopProfile.MinFreeRam = 0x7FFF;
+  MemResetStat();
+
+  size_t sz = modulesProfile.size();
+  for(size_t i=0;i<sz;i++)
+  {
+    ModuleProfileData* pd = &(modulesProfile[i]);
+    pd->Calls = 0;
+    pd->TotalMicros = 0;
+    pd->MaxMicros = 0;
+    pd->Overruns = 0;
+    pd->MaxLateness = 0;
+  }
 }
+#endif
 //--------------------------------------------------------------------------------------------------------------------------------------
 #ifdef USE_DS3231_REALTIME_CLOCK
 DS3231Clock& ModuleController::GetClock()
@@ -190,6 +224,8 @@ void ModuleController::begin()
  #ifdef USE_FEEDBACK_MANAGER
  FeedbackManager.Setup();
  #endif
+
+ WORK_STATUS.McpFlush(); // выставляем на расширителях всё, что модули настроили при старте
  
 }
 //--------------------------------------------------------------------------------------------------------------------------------------
@@ -265,62 +301,163 @@ void ModuleController::RegisterModule(AbstractModule* mod)
 {
   if(mod)
   {
-    mod->Setup(); // настраиваем
+    // регистрируем модуль до вызова Setup, чтобы он мог настроить своё расписание через ScheduleModule
     modules.push_back(mod);
+
+    // вставляем дескриптор модуля в индекс, сохраняя сортировку по ID
+    ModuleHandle handle = modules.size() - 1;
+    const char* id = mod->GetID();
+    modulesIndex.push_back(handle);
+    
+    size_t pos = modulesIndex.size() - 1;
+    while(pos > 0 && strcmp(modules[modulesIndex[pos-1]]->GetID(),id) > 0)
+    {
+      modulesIndex[pos] = modulesIndex[pos-1];
+      pos--;
+    }
+    modulesIndex[pos] = handle;
+
+    ModuleTask task = {millis(),0,0}; // по умолчанию - обновляем модуль на каждом проходе
+    modulesTasks.push_back(task);
+
+    #ifdef USE_LOOP_PROFILER
+      ModuleProfileData pd = {0,0,0,0,0,0};
+      modulesProfile.push_back(pd);
+    #endif
+
+    mod->Setup(); // настраиваем
   }
 }
 //--------------------------------------------------------------------------------------------------------------------------------------
-void ModuleController::streamWrite(Stream* s, const String& str)
+void ModuleController::ScheduleModule(AbstractModule* mod, uint16_t interval, uint8_t priority, uint32_t budgetMicros)
 {
-    for(size_t i=0;i<str.length();i++)
-    {
-      #ifdef USE_WIFI_MODULE
-        ESP.readFromStream();
-      #endif
-
-     #ifdef USE_SMS_MODULE
-     // и модуль GSM тоже тут обновим
-     SIM800.readFromStream();
-     #endif       
-      
-      s->write(str[i]);
-     
-    } // for
+  size_t sz = modules.size();
+  for(size_t i=0;i<sz;i++)
+  {
+    if(modules[i] != mod)
+      continue;
+
+    ModuleTask* task = &(modulesTasks[i]);
+    task->Interval = interval;
+    task->Priority = priority;
+    task->LastRunAt = millis();
+
+    #ifdef USE_LOOP_PROFILER
+      modulesProfile[i].BudgetMicros = budgetMicros;
+    #else
+      UNUSED(budgetMicros);
+    #endif
+    
+    break;
+  } // for
 }
 //--------------------------------------------------------------------------------------------------------------------------------------
-void ModuleController::PublishToCommandStream(AbstractModule* module,const Command& sourceCommand)
+void PublishStream::begin(Stream* s)
+{
+  target = s;
+  writeIdx = 0;
+}
+//--------------------------------------------------------------------------------------------------------------------------------------
+void PublishStream::end()
 {
+  sendChunk();
+  target = NULL;
+}
+//--------------------------------------------------------------------------------------------------------------------------------------
+void PublishStream::sendChunk()
+{
+  if(target && writeIdx)
+    target->write(buffer,writeIdx);
+
+  writeIdx = 0;
 
+  // пока отдавали блок - транспорты могли получить данные, обновляем их
+  #ifdef USE_WIFI_MODULE
+    ESP.readFromStream();
+  #endif
+
+  #ifdef USE_SMS_MODULE
+  // и модуль GSM тоже тут обновим
+  SIM800.readFromStream();
+  #endif
+}
+//--------------------------------------------------------------------------------------------------------------------------------------
+size_t PublishStream::write(uint8_t ch)
+{
+  if(!target)
+    return 0;
+    
+  buffer[writeIdx++] = ch;
+  if(writeIdx >= PUBLISH_CHUNK_SIZE)
+    sendChunk();
+
+  return 1;
+}
+//--------------------------------------------------------------------------------------------------------------------------------------
+size_t PublishStream::write(const uint8_t* data, size_t len)
+{
+  if(!target)
+    return 0;
+
+  size_t written = len;
+  while(len)
+  {
+    size_t toCopy = PUBLISH_CHUNK_SIZE - writeIdx;
+    if(toCopy > len)
+      toCopy = len;
+
+    memcpy(&(buffer[writeIdx]),data,toCopy);
+    writeIdx += toCopy;
+    data += toCopy;
+    len -= toCopy;
+
+    if(writeIdx >= PUBLISH_CHUNK_SIZE)
+      sendChunk();
+  } // while
+
+  return written;
+}
+//--------------------------------------------------------------------------------------------------------------------------------------
+Print* ModuleController::BeginPublish(AbstractModule* module,const Command& sourceCommand)
+{
   Stream* ps = sourceCommand.GetIncomingStream();
- 
-  // Публикуем в переданный стрим
   if(!ps)
-  { 
-    PublishSingleton.Flags.Busy = false; // освобождаем структуру
-    return;
-  }
-
-     //ps->print(PublishSingleton.Flags.Status ? OK_ANSWER : ERR_ANSWER);
-     streamWrite(ps,PublishSingleton.Flags.Status ? OK_ANSWER : ERR_ANSWER);
+    return NULL;
 
-     streamWrite(ps,COMMAND_DELIMITER);
-     //ps->print(COMMAND_DELIMITER);
+  publishStream.begin(ps);
+  
+  publishStream.print(PublishSingleton.Flags.Status ? OK_ANSWER : ERR_ANSWER);
+  publishStream.print(COMMAND_DELIMITER);
 
-    if(PublishSingleton.Flags.AddModuleIDToAnswer && module) // надо добавить имя модуля в ответ
-    {
-       streamWrite(ps,module->GetID());
-       //ps->print(module->GetID());
+  if(PublishSingleton.Flags.AddModuleIDToAnswer && module) // надо добавить имя модуля в ответ
+  {
+    publishStream.print(module->GetID());
+    publishStream.print(PARAM_DELIMITER);
+  }
 
-       streamWrite(ps,PARAM_DELIMITER);
-       //ps->print(PARAM_DELIMITER);
-    }
+  return &publishStream;
+}
+//--------------------------------------------------------------------------------------------------------------------------------------
+void ModuleController::EndPublish()
+{
+  if(publishStream.isActive())
+  {
+    publishStream.print(NEWLINE);
+    publishStream.end();
+  }
 
-     streamWrite(ps,PublishSingleton.Text);
-     streamWrite(ps,NEWLINE);
-     //ps->println(PublishSingleton.Text);
+  PublishSingleton.Flags.Busy = false; // освобождаем структуру
+}
+//--------------------------------------------------------------------------------------------------------------------------------------
+void ModuleController::PublishToCommandStream(AbstractModule* module,const Command& sourceCommand)
+{
+  // Публикуем в переданный стрим
+  Print* ps = BeginPublish(module,sourceCommand);
+  
+  if(ps)
+    ps->print(PublishSingleton.Text);
 
-   
-   PublishSingleton.Flags.Busy = false; // освобождаем структуру
+  EndPublish();
 }
 //--------------------------------------------------------------------------------------------------------------------------------------
 void ModuleController::Publish(AbstractModule* module,const Command& sourceCommand)
@@ -330,14 +467,39 @@ void ModuleController::Publish(AbstractModule* module,const Command& sourceComma
 //--------------------------------------------------------------------------------------------------------------------------------------
 AbstractModule* ModuleController::GetModuleByID(const String& id)
 {
-  size_t sz = modules.size();
-  for(size_t i=0;i<sz;i++)
-  { 
-    AbstractModule* mod = modules[i];
-    if(!strcmp(mod->GetID(),id.c_str()) )
-      return mod;
-  } // for
-  return NULL;
+  return GetModuleByID(id.c_str());
+}
+//--------------------------------------------------------------------------------------------------------------------------------------
+AbstractModule* ModuleController::GetModuleByID(const char* id)
+{
+  return GetModuleByHandle(GetModuleHandle(id));
+}
+//--------------------------------------------------------------------------------------------------------------------------------------
+ModuleHandle ModuleController::GetModuleHandle(const char* id)
+{
+  if(!id)
+    return NO_MODULE_HANDLE;
+
+  // двоичный поиск по отсортированному индексу
+  int left = 0;
+  int right = (int) modulesIndex.size() - 1;
+
+  while(left <= right)
+  {
+    int middle = (left + right)/2;
+    ModuleHandle handle = modulesIndex[middle];
+    int cmp = strcmp(id,modules[handle]->GetID());
+
+    if(!cmp)
+      return handle;
+
+    if(cmp < 0)
+      right = middle - 1;
+    else
+      left = middle + 1;
+  } // while
+
+  return NO_MODULE_HANDLE;
 }
 //--------------------------------------------------------------------------------------------------------------------------------------
 void ModuleController::ProcessModuleCommand(const Command& c, AbstractModule* mod)
@@ -356,6 +518,10 @@ if(!mod) // ничего не передали, надо искать модул
   return;
  }
  
+ #ifdef USE_LOOP_PROFILER
+  loopProfile.Commands++;
+ #endif
+
  // нашли модуль
  PublishSingleton.Reset(); // очищаем структуру для публикации
  PublishSingleton.Flags.Busy = true; // говорим, что структура занята для публикации
@@ -372,25 +538,121 @@ void ModuleController::Alarm(AlertRule* rule)
   #endif
 }
 //--------------------------------------------------------------------------------------------------------------------------------------
-void ModuleController::UpdateModules(uint16_t dt, CallbackUpdateFunc func)
+static uint16_t elapsedToDelta(unsigned long elapsed)
+{
+  // после долгой остановки (больше 65 секунд) не даём дельте перевалить через ноль
+  return elapsed > 0xFFFF ? 0xFFFF : (uint16_t) elapsed;
+}
+//--------------------------------------------------------------------------------------------------------------------------------------
+void ModuleController::runModuleTask(size_t idx, unsigned long now, CallbackUpdateFunc func)
+{
+  AbstractModule* mod = modules[idx];
+  ModuleTask* task = &(modulesTasks[idx]);
+  unsigned long elapsed = now - task->LastRunAt;
+  task->LastRunAt = now;
+
+  #ifdef USE_LOOP_PROFILER
+    ModuleProfileData* pd = &(modulesProfile[idx]);
+    if(task->Interval && elapsed - task->Interval > pd->MaxLateness)
+      pd->MaxLateness = elapsed - task->Interval;
+      
+    unsigned long moduleStartedAt = micros();
+  #endif
+
+    // ОБНОВЛЯЕМ СОСТОЯНИЕ МОДУЛЯ
+    mod->Update(elapsedToDelta(elapsed));
+
+  #ifdef USE_LOOP_PROFILER
+    // считаем время только самого Update, без функции обратного вызова
+    uint32_t moduleMicros = micros() - moduleStartedAt;
+    pd->Calls++;
+    pd->TotalMicros += moduleMicros;
+    if(moduleMicros > pd->MaxMicros)
+      pd->MaxMicros = moduleMicros;
+    if(pd->BudgetMicros && moduleMicros > pd->BudgetMicros)
+      pd->Overruns++;
+  #endif
+
+  if(!func)
+    return;
+
+  // транспорты обслуживаем с постоянным шагом: и на долгом проходе, и без лишних вызовов на быстром
+  unsigned long transportsNow = millis();
+  if(transportsNow - transportsRunAt < TRANSPORTS_UPDATE_INTERVAL)
+    return;
+    
+  transportsRunAt = transportsNow;
+  func(mod);
+}
+//--------------------------------------------------------------------------------------------------------------------------------------
+void ModuleController::UpdateModules(CallbackUpdateFunc func)
 {  
   
- #ifdef USE_FEEDBACK_MANAGER
- FeedbackManager.Update(dt); // обновляем состояние менеджера обратной связи
+ #ifdef USE_LOOP_PROFILER
+  unsigned long loopStartedAt = micros();
  #endif
+
+  unsigned long now = millis();
   
+ #ifdef USE_FEEDBACK_MANAGER
+ FeedbackManager.Update(elapsedToDelta(now - lastUpdateAt)); // обновляем состояние менеджера обратной связи
+ #endif
+ lastUpdateAt = now;
+
+  // периодические модули с высоким приоритетом (исполнительные механизмы, правила) вызываем, как только подошёл их срок.
+  // Из остальных, кому пора работать, - не больше одного за проход: с наибольшим приоритетом, при равенстве - самый опоздавший
   size_t sz = modules.size();
+  size_t dueIdx = sz;
+  unsigned long dueLateness = 0;
+  
   for(size_t i=0;i<sz;i++)
-  { 
-    AbstractModule* mod = modules[i];
-   
-      // ОБНОВЛЯЕМ СОСТОЯНИЕ МОДУЛЕЙ
-      mod->Update(dt);
+  {
+    ModuleTask* task = &(modulesTasks[i]);
+    if(!task->Interval)
+      continue;
 
-    if(func) // вызываем функцию после обновления каждого модуля
-      func(mod);
-  
+    unsigned long elapsed = now - task->LastRunAt;
+    if(elapsed < task->Interval)
+      continue;
+
+    if(task->Priority >= schedulePriorityHigh)
+    {
+      runModuleTask(i,now,func);
+      continue;
+    }
+
+    unsigned long lateness = elapsed - task->Interval;
+    if(dueIdx == sz || task->Priority > modulesTasks[dueIdx].Priority || (task->Priority == modulesTasks[dueIdx].Priority && lateness > dueLateness))
+    {
+      dueIdx = i;
+      dueLateness = lateness;
+    }
   } // for
+
+  if(dueIdx != sz)
+    runModuleTask(dueIdx,now,func);
+
+  // остальные модули обновляем на каждом проходе, как раньше
+  for(size_t i=0;i<sz;i++)
+  { 
+    if(!modulesTasks[i].Interval)
+      runModuleTask(i,now,func);
+  } // for
+
+  // изменения, накопленные модулями в теневых регистрах расширителей, пишем разом
+  WORK_STATUS.McpFlush();
+
+ #ifdef USE_LOOP_PROFILER
+  uint32_t loopMicros = micros() - loopStartedAt;
+  loopProfile.Loops++;
+  loopProfile.TotalMicros += loopMicros;
+  if(loopMicros > loopProfile.MaxMicros)
+    loopProfile.MaxMicros = loopMicros;
+
+  int curFreeRam = freeRam();
+  if(curFreeRam < loopProfile.MinFreeRam)
+    loopProfile.MinFreeRam = curFreeRam;
+ #endif
 }
 //--------------------------------------------------------------------------------------------------------------------------------------
 
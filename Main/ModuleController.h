@@ -26,9 +26,77 @@
 class AbstractModule; // forward declaration
 class AlertRule;
 typedef Vector<AbstractModule*> ModulesVec;
+typedef Vector<ModuleHandle> ModulesIndexVec;
 //--------------------------------------------------------------------------------------------------------------------------------------
 typedef void (*CallbackUpdateFunc)(AbstractModule* mod);
 //--------------------------------------------------------------------------------------------------------------------------------------
+typedef struct
+{
+  unsigned long LastRunAt; // значение millis() на момент последнего вызова Update модуля
+  uint16_t Interval; // интервал вызова Update, миллисекунд (0 - Update вызывается на каждом проходе)
+  uint8_t Priority; // из периодических модулей, которым пора работать, первым вызывается модуль с бОльшим приоритетом
+  
+} ModuleTask; // расписание обновления одного модуля
+//--------------------------------------------------------------------------------------------------------------------------------------
+typedef enum
+{
+  schedulePriorityLow, // логгирование, отчёты
+  schedulePriorityNormal, // опрос датчиков
+  schedulePriorityHigh // правила и исполнительные механизмы (фрамуги, досветка), вызываются вне очереди
+  
+} SchedulePriority; // приоритеты периодических модулей
+//--------------------------------------------------------------------------------------------------------------------------------------
+typedef Vector<ModuleTask> ModuleTasksVec;
+//--------------------------------------------------------------------------------------------------------------------------------------
+#ifdef USE_LOOP_PROFILER
+//--------------------------------------------------------------------------------------------------------------------------------------
+typedef struct
+{
+  uint32_t Calls; // сколько раз вызывалась функция Update модуля
+  uint32_t TotalMicros; // суммарное время работы Update модуля, микросекунд
+  uint32_t MaxMicros; // максимальное время одного вызова Update модуля, микросекунд
+  uint32_t BudgetMicros; // допустимое время одного вызова Update, микросекунд (0 - не контролируется)
+  uint32_t Overruns; // сколько раз Update работал дольше BudgetMicros
+  uint32_t MaxLateness; // максимальное опоздание вызова периодического модуля относительно его срока, миллисекунд
+  
+} ModuleProfileData; // статистика профилирования одного модуля
+//--------------------------------------------------------------------------------------------------------------------------------------
+typedef Vector<ModuleProfileData> ModuleProfileVec;
+//--------------------------------------------------------------------------------------------------------------------------------------
+typedef struct
+{
+  unsigned long StartedAt; // значение millis() на момент сброса статистики
+  uint32_t Loops; // кол-во проходов обновления модулей
+  uint32_t TotalMicros; // суммарное время проходов обновления модулей, микросекунд
+  uint32_t MaxMicros; // максимальное время одного прохода, микросекунд
+  uint32_t Commands; // кол-во обработанных команд
+  int MinFreeRam; // минимальное кол-во свободной памяти, замеченное между проходами
+  
+} LoopProfileData; // статистика профилирования главного цикла
+//--------------------------------------------------------------------------------------------------------------------------------------
+#endif // USE_LOOP_PROFILER
+//--------------------------------------------------------------------------------------------------------------------------------------
+class PublishStream : public Print // поток для публикации ответов: копит данные в небольшом буфере и отдаёт их блоками
+{
+  private:
+    Stream* target; // поток команды, в который публикуем
+    uint8_t buffer[PUBLISH_CHUNK_SIZE];
+    uint8_t writeIdx;
+
+    void sendChunk(); // отдаёт накопленный блок в поток и даёт поработать транспортам
+
+  public:
+    PublishStream() : target(NULL), writeIdx(0) {}
+
+    void begin(Stream* s);
+    void end();
+    bool isActive() {return target != NULL;}
+
+    virtual size_t write(uint8_t ch);
+    virtual size_t write(const uint8_t* data, size_t len);
+    using Print::write;
+};
+//--------------------------------------------------------------------------------------------------------------------------------------
 class FileUtils
 {
   public:
@@ -45,6 +113,12 @@ class ModuleController
 {
  private:
   ModulesVec modules; // список зарегистрированных модулей
+  ModulesIndexVec modulesIndex; // дескрипторы модулей, отсортированные по ID модуля - для двоичного поиска
+  ModuleTasksVec modulesTasks; // расписание обновления каждого модуля, в порядке регистрации
+  unsigned long lastUpdateAt; // значение millis() на момент предыдущего прохода обновления модулей
+  unsigned long transportsRunAt; // значение millis() на момент последнего обслуживания транспортов
+
+  void runModuleTask(size_t idx, unsigned long now, CallbackUpdateFunc func); // вызывает Update модуля и обновляет его расписание
   
   CommandParser* cParser; // парсер текстовых команд
 
@@ -67,11 +141,16 @@ class ModuleController
 #endif
 
   void PublishToCommandStream(AbstractModule* module,const Command& sourceCommand); // публикация в поток команды
-  void streamWrite(Stream* s, const String& str);
+  PublishStream publishStream; // поток для публикации ответов блоками
 
 #ifdef USE_ALARM_DISPATCHER
   AlarmDispatcher alarmDispatcher;
 #endif
+
+#ifdef USE_LOOP_PROFILER
+  ModuleProfileVec modulesProfile; // статистика по каждому модулю, в порядке регистрации
+  LoopProfileData loopProfile; // статистика главного цикла
+#endif
   
 public:
   ModuleController();
@@ -109,14 +188,35 @@ public:
   size_t GetModulesCount() {return modules.size(); }
   AbstractModule* GetModule(size_t idx) {return modules[idx]; }
   AbstractModule* GetModuleByID(const String& id);
+  AbstractModule* GetModuleByID(const char* id);
+
+  ModuleHandle GetModuleHandle(const char* id); // ищет модуль по ID за O(log n), возвращает его дескриптор или NO_MODULE_HANDLE
+  AbstractModule* GetModuleByHandle(ModuleHandle handle) { return handle < modules.size() ? modules[handle] : NULL; }
 
   void RegisterModule(AbstractModule* mod);
   void ProcessModuleCommand(const Command& c, AbstractModule* thisModule=NULL);
   
-  void UpdateModules(uint16_t dt, CallbackUpdateFunc func);
+  // модуль может попросить вызывать свой Update не на каждом проходе, а раз в interval миллисекунд (вызывается из Setup модуля).
+  // Модули с приоритетом schedulePriorityHigh вызываются, как только подошёл их срок. Из остальных за один проход вызывается
+  // не больше одного - с наибольшим приоритетом, при равенстве - самый опоздавший, поэтому тяжёлые опросы датчиков разносятся
+  // по разным проходам, а транспорты обслуживаются между ними.
+  // budgetMicros - допустимое время одного вызова Update, превышения считаются в статистике профилирования.
+  // Модуль может перенастроить расписание и из своего Update - следующий вызов будет через новый интервал.
+  void ScheduleModule(AbstractModule* mod, uint16_t interval, uint8_t priority=0, uint32_t budgetMicros=0);
+  uint16_t GetModuleInterval(size_t idx) { return modulesTasks[idx].Interval; }
+  
+  // func - обслуживание транспортов: вызывается после обновления очередного модуля, но не чаще раза в TRANSPORTS_UPDATE_INTERVAL,
+  // сколько бы модулей ни обновлялось за проход
+  void UpdateModules(CallbackUpdateFunc func);
   
   void Publish(AbstractModule* module,const Command& sourceCommand); // каждый модуль по необходимости дергает этот метод для публикации событий/ответов на запрос
 
+  // потоковая публикация больших ответов, без накопления их в PublishSingleton.Text:
+  // BeginPublish пишет заголовок ответа (OK=/ERR= и, если надо, ID модуля) согласно флагам PublishSingleton
+  // и возвращает поток для записи данных ответа (NULL - у команды нет потока), EndPublish - завершает ответ.
+  Print* BeginPublish(AbstractModule* module,const Command& sourceCommand);
+  void EndPublish();
+
   void SetCommandParser(CommandParser* c) {cParser = c;};
   CommandParser* GetCommandParser() {return cParser;}
 
@@ -127,6 +227,12 @@ public:
   #ifdef USE_ALARM_DISPATCHER
     AlarmDispatcher* GetAlarmDispatcher(){ return &alarmDispatcher;}
   #endif
+
+  #ifdef USE_LOOP_PROFILER
+    void ResetProfile(); // сбрасывает статистику профилирования
+    LoopProfileData* GetLoopProfile() { return &loopProfile; }
+    ModuleProfileData* GetModuleProfile(size_t idx) { return &(modulesProfile[idx]); }
+  #endif
   
 };
 //--------------------------------------------------------------------------------------------------------------------------------------
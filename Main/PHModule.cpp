@@ -1,6 +1,7 @@
 #include "PHModule.h"
 #include "ModuleController.h"
 #include "Memory.h"
+#include "AnalogSampler.h"
 #include <Wire.h>
 //-------------------------------------------------------------------------------------------------------------------------------------------------------
 #ifdef USE_PH_MODULE
@@ -249,9 +250,7 @@ void PhModule::Setup()
   // настройка модуля тут
   phSensorPin = PH_SENSOR_PIN;
   measureTimer = 0;
-  flags.inMeasure = false;
-  samplesDone = 0;
-  samplesTimer = 0;
+  phAnalogChannel = NO_ANALOG_CHANNEL;
   calibration = 0;
   ph4Voltage = 0;
   ph7Voltage = 0;
@@ -268,6 +267,7 @@ void PhModule::Setup()
     State.AddState(StatePH,0); // добавляем датчик pH, прикреплённый к меге
     WORK_STATUS.PinMode(phSensorPin,INPUT);
     digitalWrite(phSensorPin,HIGH);
+    phAnalogChannel = AnalogSampler.addChannel(phSensorPin); // показания с пина набираются в фоне
   }
 
   // настраиваем пины PCF8574
@@ -312,6 +312,8 @@ void PhModule::SaveSettings()
 {
   uint16_t addr = PH_SETTINGS_EEPROM_ADDR;
 
+  MemBeginWrite();
+
   MemWrite(addr++,SETT_HEADER1);
   MemWrite(addr++,SETT_HEADER2);
 
@@ -368,7 +370,7 @@ void PhModule::SaveSettings()
   for(size_t i=0;i<sizeof(phReagentPumpTime);i++)
     MemWrite(addr++,*pB++);
 
-  
+  MemCommit();
 }
 //-------------------------------------------------------------------------------------------------------------------------------------------------------
 void PhModule::ReadSettings()
@@ -498,27 +500,16 @@ void PhModule::Update(uint16_t dt)
   // обновление модуля тут
   if(phSensorPin > 0)
   {
-    // у нас есть датчик, жёстко прикреплённый к меге, можно читать с него данные.
-    // если вы сейчас измеряем, то надо проверять, не истёк ли интервал между семплированиями.
-    // если истёк - начинаем замерять. если нет - ничего не делаем.
-
-    // как только достигнем нужного кол-ва семплов - подсчитываем значение pH и обновляем его
+    // у нас есть датчик, жёстко прикреплённый к меге. Отсчёты с него в фоне снимает AnalogSampler,
+    // отсекая выбросы и усредняя, поэтому раз в интервал просто забираем готовое значение и считаем pH.
+    measureTimer += dt;
 
-    // если же мы не измеряем, то проверяем - не истёк ли интервал между замерами.
-    // если истёк - начинаем измерения.
-
-    if(flags.inMeasure)
+    if(measureTimer > PH_UPDATE_INTERVAL && AnalogSampler.available(phAnalogChannel))
     {
-      // в процессе замера
-      if(samplesDone >= PH_SAMPLES_PER_MEASURE)
-      {
-         // набрали нужное кол-во семплов
-         samplesTimer = 0;
-         flags.inMeasure = false;
          measureTimer = 0;
 
-         // теперь преобразуем полученное значение в среднее
-         float avgSample = (dataArray*1.0)/samplesDone;
+         // среднее значение АЦП, с дробной частью
+         float avgSample = (AnalogSampler.read(phAnalogChannel)*1.0)/ANALOG_SAMPLER_OVERSAMPLING;
 
           // считаем вольтаж
           float voltage = avgSample*5.0/1024;
@@ -556,48 +547,8 @@ void PhModule::Update(uint16_t dt)
 
          // сохраняем состояние с датчика
          State.UpdateState(StatePH,0,(void*)&h);     
-
-         samplesDone = 0;
-        
-      } // if(samplesDone >= PH_SAMPLES_PER_MEASURE)
-      else
-      {
-        // ещё набираем семплы
-        samplesTimer += dt; // обновляем таймер
-        if(samplesTimer > PH_SAMPLES_INTERVAL)
-        {
-          // настало время очередного замера
-          samplesTimer = 0; // сбрасываем таймер
-          samplesDone++; // увеличиваем кол-во семплов
-
-          // читаем из порта и запоминаем прочитанное
-          dataArray += analogRead(phSensorPin);
-          
-        } // PH_SAMPLES_INTERVAL
         
-      } // else
-      
-    } // inMeasure
-    else
-    {
-      // ничего не измеряем, сохраняем дельту в таймер между замерами
-      measureTimer += dt;
-
-      if(measureTimer > PH_UPDATE_INTERVAL)
-      {
-        // настала пора переключиться на замер
-        measureTimer = 0;
-        flags.inMeasure = true;
-        samplesDone = 0;
-        samplesTimer = 0;
-
-        // очищаем массив данных
-        dataArray = 0;
-
-        // читаем первый раз, игнорируем значение, чтобы выровнять датчик
-        analogRead(phSensorPin);
-      }
-    } // else
+    } // if(measureTimer > PH_UPDATE_INTERVAL)
     
   } // if(phSensorPin > 0)
 
@@ -33,10 +33,9 @@ class PCF8574
 //-------------------------------------------------------------------------------------------------------------------------------------------------------
 typedef struct
 {
-    bool inMeasure : 1;
     bool isMixPumpOn : 1;
     bool isInAddReagentsMode : 1;
-    byte pad : 5;
+    byte pad : 6;
   
 } PHModuleFlags;
 //-------------------------------------------------------------------------------------------------------------------------------------------------------
@@ -47,9 +46,8 @@ class PhModule : public AbstractModule // модуль контроля pH
     PHModuleFlags flags;
 
     byte phSensorPin;
+    uint8_t phAnalogChannel; // канал фонового чтения АЦП для датчика pH
     unsigned long measureTimer;
-    byte samplesDone;
-    byte samplesTimer;
 
     int calibration; // калибровка, в сотых долях
     int16_t ph4Voltage; // показания в милливольтах для тестового раствора 4 pH
@@ -63,8 +61,6 @@ class PhModule : public AbstractModule // модуль контроля pH
     uint16_t phMixPumpTime; // время работы насоса перемешивания, с
     uint16_t phReagentPumpTime; // время работы подачи реагента, с
 
-    unsigned long dataArray;
-
     void ReadSettings();
     void SaveSettings();
 
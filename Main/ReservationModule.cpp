@@ -62,6 +62,8 @@ void ReservationModule::SaveReservations()
 {
   uint16_t addr = RESERVATION_ADDR;
 
+  MemBeginWrite();
+
   // пишем заголовок
   MemWrite(addr++,SETT_HEADER1);
   MemWrite(addr++,SETT_HEADER2);
@@ -92,7 +94,7 @@ void ReservationModule::SaveReservations()
     } // for
   } // for
   
-  
+  MemCommit();
 }
 //--------------------------------------------------------------------------------------------------------------------------------------
 // возвращает первое попавшееся состояние с данными, основываясь на списках резервирования для указанного типа
@@ -15,6 +15,8 @@ void GlobalSettings::WriteDeltaSettings(DeltaCountFunction OnDeltaGetCount, Delt
 
   uint16_t writeAddr = DELTA_SETTINGS_EEPROM_ADDR;
 
+  MemBeginWrite(); // копим изменения и пишем их страницами
+
   // записываем заголовок
   MemWrite(writeAddr++,SETT_HEADER1);
   MemWrite(writeAddr++,SETT_HEADER2);
@@ -81,7 +83,7 @@ void GlobalSettings::WriteDeltaSettings(DeltaCountFunction OnDeltaGetCount, Delt
   } // for
 
   // записали, отдыхаем
-    
+  MemCommit();
   
 }
 //--------------------------------------------------------------------------------------------------------------------------------------
@@ -193,8 +195,10 @@ void GlobalSettings::write16(uint16_t address, uint16_t val)
 {
   byte* b = (byte*) &val;
 
+  MemBeginWrite();
   for(byte i=0;i<2;i++)
     MemWrite(address + i, *b++);
+  MemCommit();
       
 }
 //--------------------------------------------------------------------------------------------------------------------------------------
@@ -216,8 +220,10 @@ void GlobalSettings::write32(uint16_t address, unsigned long val)
 {
   byte* b = (byte*) &val;
 
+  MemBeginWrite();
   for(byte i=0;i<4;i++)
     MemWrite(address + i, *b++);  
+  MemCommit();
 }
 //--------------------------------------------------------------------------------------------------------------------------------------
 String GlobalSettings::readString(uint16_t address, byte maxlength)
@@ -237,6 +243,7 @@ String GlobalSettings::readString(uint16_t address, byte maxlength)
 //--------------------------------------------------------------------------------------------------------------------------------------
 void GlobalSettings::writeString(uint16_t address, const String& v, byte maxlength)
 {
+  MemBeginWrite();
 
   for(byte i=0;i<maxlength;i++)
   {
@@ -248,7 +255,8 @@ void GlobalSettings::writeString(uint16_t address, const String& v, byte maxleng
 
   // пишем завершающий ноль
   MemWrite(address++,'\0');
-  
+
+  MemCommit();
 }
 //--------------------------------------------------------------------------------------------------------------------------------------
 uint8_t GlobalSettings::GetChannelWateringWeekDays(uint8_t idx)
@@ -369,8 +377,10 @@ void GlobalSettings::SetIoTSettings(IoTSettings& sett)
     byte writePtr = IOT_SETTINGS_EEPROM_ADDR;
     byte* readPtr = (byte*) &sett;
 
+     MemBeginWrite();
      for(size_t i=0;i<sizeof(IoTSettings);i++)
         MemWrite(writePtr++, *readPtr++);
+     MemCommit();
 }
 //--------------------------------------------------------------------------------------------------------------------------------------
 IoTSettings GlobalSettings::GetIoTSettings()
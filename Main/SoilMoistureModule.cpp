@@ -1,9 +1,11 @@
 #include "SoilMoistureModule.h"
 #include "ModuleController.h"
+#include "AnalogSampler.h"
 //--------------------------------------------------------------------------------------------------------------------------------------
 #ifdef USE_SOIL_MOISTURE_MODULE
 
 #define PULSE_TIMEOUT 50000 // 50 миллисекунд на чтение фронта максимум
+#define SOIL_MOISTURE_CAPTURE_DURATION 250 // сколько миллисекунд копить периоды частотных датчиков перед вычислением показаний
 //--------------------------------------------------------------------------------------------------------------------------------------
 #pragma pack(push,1)
 typedef struct
@@ -16,13 +18,177 @@ typedef struct
 //--------------------------------------------------------------------------------------------------------------------------------------
 #if SUPPORTED_SOIL_MOISTURE_SENSORS > 0
 static SoilMoistureSensorSettings SOIL_MOISTURE_SENSORS_ARRAY[] = { SOIL_MOISTURE_SENSORS };
+//--------------------------------------------------------------------------------------------------------------------------------------
+// фоновое измерение частотных датчиков: прерывание по смене уровня на пине датчика копит длительности
+// высоких и низких уровней, показания считаются по среднему за много периодов, без ожидания фронтов в pulseIn.
+// На Due прерывание есть на любом пине, на Mega - на пинах внешних прерываний и на A8-A15 (PCINT2).
+// Датчики на пинах без прерываний опрашиваются, как раньше, через pulseIn.
+//--------------------------------------------------------------------------------------------------------------------------------------
+typedef struct
+{
+  uint32_t lastEdgeAt; // значение micros() на момент последней смены уровня
+  uint32_t highMicros; // суммарная длительность высоких уровней
+  uint32_t lowMicros; // суммарная длительность низких уровней
+  uint16_t highCount; // кол-во измеренных высоких уровней
+  uint16_t lowCount; // кол-во измеренных низких уровней
+  bool started; // была ли смена уровня после начала замера
+  bool attached; // датчик измеряется по прерыванию
+  
+} SoilFrequencyCapture;
+//--------------------------------------------------------------------------------------------------------------------------------------
+static volatile SoilFrequencyCapture SOIL_FREQUENCY_CAPTURES[SUPPORTED_SOIL_MOISTURE_SENSORS];
+static volatile bool soilCaptureActive = false; // идёт ли замер
+static uint8_t SOIL_ANALOG_CHANNELS[SUPPORTED_SOIL_MOISTURE_SENSORS]; // каналы фонового чтения АЦП для аналоговых датчиков
+//--------------------------------------------------------------------------------------------------------------------------------------
+static void soilCaptureEdge(uint8_t idx, uint8_t level) // вызывается из прерывания при смене уровня на пине датчика
+{
+  if(!soilCaptureActive)
+    return;
+
+  volatile SoilFrequencyCapture* c = &(SOIL_FREQUENCY_CAPTURES[idx]);
+  uint32_t now = micros();
+  
+  if(c->started)
+  {
+    uint32_t len = now - c->lastEdgeAt;
+    if(level) // фронт - закончился низкий уровень
+    {
+      c->lowMicros += len;
+      c->lowCount++;
+    }
+    else // спад - закончился высокий уровень
+    {
+      c->highMicros += len;
+      c->highCount++;
+    }
+  }
+  
+  c->started = true;
+  c->lastEdgeAt = now;
+}
+//--------------------------------------------------------------------------------------------------------------------------------------
+template<uint8_t idx>
+static void soilCaptureISR()
+{
+  if(idx < SUPPORTED_SOIL_MOISTURE_SENSORS)
+    soilCaptureEdge(idx,digitalRead(SOIL_MOISTURE_SENSORS_ARRAY[idx].pin));
+}
+//--------------------------------------------------------------------------------------------------------------------------------------
+typedef void (*SoilCaptureFunc)(void);
+static const SoilCaptureFunc SOIL_CAPTURE_ISRS[] = { soilCaptureISR<0>, soilCaptureISR<1>, soilCaptureISR<2>, soilCaptureISR<3> };
+#define SOIL_CAPTURE_ISRS_COUNT (sizeof(SOIL_CAPTURE_ISRS)/sizeof(SOIL_CAPTURE_ISRS[0]))
+//--------------------------------------------------------------------------------------------------------------------------------------
+#if defined(__AVR_ATmega1280__) || defined(__AVR_ATmega2560__)
+static int8_t SOIL_PCINT_SENSORS[8] = {-1,-1,-1,-1,-1,-1,-1,-1}; // индекс датчика для каждого из пинов A8-A15
+static uint8_t soilPCIntLastState = 0; // предыдущее состояние порта K
+//--------------------------------------------------------------------------------------------------------------------------------------
+ISR(PCINT2_vect)
+{
+  uint8_t state = PINK;
+  uint8_t changed = state ^ soilPCIntLastState;
+  soilPCIntLastState = state;
+
+  for(uint8_t bit=0; changed; bit++, changed >>= 1)
+  {
+    if((changed & 1) && SOIL_PCINT_SENSORS[bit] != -1)
+      soilCaptureEdge(SOIL_PCINT_SENSORS[bit],state & (1 << bit));
+  }
+}
+#endif
+//--------------------------------------------------------------------------------------------------------------------------------------
+static bool soilCaptureAttach(uint8_t idx, uint8_t pin) // настраивает прерывание для датчика, false - на пине прерываний нет
+{
+  #if defined(__AVR_ATmega1280__) || defined(__AVR_ATmega2560__)
+    if(pin >= A8 && pin <= A15)
+    {
+      uint8_t bit = pin - A8;
+      SOIL_PCINT_SENSORS[bit] = idx;
+      soilPCIntLastState = PINK;
+      PCMSK2 |= (1 << bit);
+      PCIFR |= (1 << PCIF2);
+      PCICR |= (1 << PCIE2);
+      return true;
+    }
+  #endif
+
+  int irq = digitalPinToInterrupt(pin);
+  if(irq == NOT_AN_INTERRUPT || idx >= SOIL_CAPTURE_ISRS_COUNT)
+    return false;
+
+  attachInterrupt(irq,SOIL_CAPTURE_ISRS[idx],CHANGE);
+  return true;
+}
+//--------------------------------------------------------------------------------------------------------------------------------------
+static bool soilCaptureStart() // начинает новый замер, false - датчиков с измерением по прерыванию нет
+{
+  bool anyAttached = false;
+  
+  noInterrupts();
+  for(uint8_t i=0;i<SUPPORTED_SOIL_MOISTURE_SENSORS;i++)
+  {
+    volatile SoilFrequencyCapture* c = &(SOIL_FREQUENCY_CAPTURES[i]);
+    c->highMicros = c->lowMicros = 0;
+    c->highCount = c->lowCount = 0;
+    c->started = false;
+    anyAttached = anyAttached || c->attached;
+  }
+  soilCaptureActive = anyAttached;
+  interrupts();
+
+  return anyAttached;
+}
+//--------------------------------------------------------------------------------------------------------------------------------------
+#ifdef USE_SOIL_MOISTURE_SENSORS_POWER_MANAGEMENT
+static bool soilAnalogRestart() // сбрасывает показания аналоговых датчиков, false - аналоговых датчиков нет
+{
+  bool anyAnalog = false;
+  for(uint8_t i=0;i<SUPPORTED_SOIL_MOISTURE_SENSORS;i++)
+  {
+    if(SOIL_ANALOG_CHANNELS[i] == NO_ANALOG_CHANNEL)
+      continue;
+
+    AnalogSampler.reset(SOIL_ANALOG_CHANNELS[i]);
+    anyAnalog = true;
+  }
+  return anyAnalog;
+}
+#endif // USE_SOIL_MOISTURE_SENSORS_POWER_MANAGEMENT
+//--------------------------------------------------------------------------------------------------------------------------------------
+static bool soilCaptureRead(uint8_t idx, Humidity& h) // вычисляет показания датчика по итогам замера, false - датчик не измеряется по прерыванию
+{
+  volatile SoilFrequencyCapture* c = &(SOIL_FREQUENCY_CAPTURES[idx]);
+  if(!c->attached)
+    return false;
+
+  noInterrupts();
+  uint32_t highMicros = c->highMicros;
+  uint32_t lowMicros = c->lowMicros;
+  uint16_t highCount = c->highCount;
+  uint16_t lowCount = c->lowCount;
+  interrupts();
+
+  if(!highCount || !lowCount) // уровень не менялся - ошибка шины, оставляем h без показаний
+    return true;
+
+  uint32_t avgHigh = highMicros/highCount;
+  uint32_t avgLow = lowMicros/lowCount;
+  if(!(avgHigh + avgLow))
+    return true;
+  
+  uint32_t moistureInt = (avgHigh*10000UL)/(avgHigh + avgLow);
+  h.Value = moistureInt/100;
+  h.Fract = moistureInt%100;
+
+  return true;
+}
+//--------------------------------------------------------------------------------------------------------------------------------------
 #endif
 //--------------------------------------------------------------------------------------------------------------------------------------
 void SoilMoistureModule::Setup()
 {
   // настройка модуля тут
 
-  machineState = SOIL_WAIT_INTERVAL;
+  waitFor(SOIL_WAIT_INTERVAL,SOIL_MOISTURE_UPDATE_INTERVAL);
   
   #if SUPPORTED_SOIL_MOISTURE_SENSORS > 0
 
@@ -48,10 +214,16 @@ void SoilMoistureModule::Setup()
     for(uint8_t i=0;i<SUPPORTED_SOIL_MOISTURE_SENSORS;i++)
     {
       WORK_STATUS.PinMode(SOIL_MOISTURE_SENSORS_ARRAY[i].pin, INPUT, false);
+      SOIL_FREQUENCY_CAPTURES[i].attached = false;
+      SOIL_ANALOG_CHANNELS[i] = NO_ANALOG_CHANNEL;
+      if(SOIL_MOISTURE_SENSORS_ARRAY[i].type == ANALOG_SOIL_MOISTURE)
+        SOIL_ANALOG_CHANNELS[i] = AnalogSampler.addChannel(SOIL_MOISTURE_SENSORS_ARRAY[i].pin); // показания набираются в фоне
+        
       if(SOIL_MOISTURE_SENSORS_ARRAY[i].type == FREQUENCY_SOIL_MOISTURE)
       {
         pinMode(SOIL_MOISTURE_SENSORS_ARRAY[i].pin,INPUT);
         digitalWrite(SOIL_MOISTURE_SENSORS_ARRAY[i].pin,HIGH);
+        SOIL_FREQUENCY_CAPTURES[i].attached = soilCaptureAttach(i,SOIL_MOISTURE_SENSORS_ARRAY[i].pin);
       }
       State.AddState(StateSoilMoisture,i); // добавляем датчики влажности почвы
     } // for
@@ -60,17 +232,13 @@ void SoilMoistureModule::Setup()
 //--------------------------------------------------------------------------------------------------------------------------------------
 void SoilMoistureModule::Update(uint16_t dt)
 { 
-
-  // обновление модуля тут
+  // обновление модуля тут, вызывается, когда истёк интервал текущего шага опроса (см. waitFor)
+  UNUSED(dt);
+  
   switch(machineState)
   {
-    case SOIL_WAIT_INTERVAL: // ждём истечения интервала между опросами датчиков
+    case SOIL_WAIT_INTERVAL: // истёк интервал между опросами датчиков
     {
-      lastUpdateCall += dt;
-      if(lastUpdateCall < SOIL_MOISTURE_UPDATE_INTERVAL) // обновляем согласно настроенному интервалу
-        return;
-      else
-      {
         // включаем датчики
         #if SUPPORTED_SOIL_MOISTURE_SENSORS > 0
           #ifdef USE_SOIL_MOISTURE_SENSORS_POWER_MANAGEMENT
@@ -87,40 +255,60 @@ void SoilMoistureModule::Update(uint16_t dt)
                 #endif
               #endif
               
+              waitFor(SOIL_WAIT_POWER,SOIL_MOISTURE_POWER_ON_DELAY); // ждём истечения времени инициализации по питанию
+              return;
+              
           #endif // USE_SOIL_MOISTURE_SENSORS_POWER_MANAGEMENT
          #endif // SUPPORTED_SOIL_MOISTURE_SENSORS > 0
-              
-        lastUpdateCall = 0;
-        machineState = SOIL_WAIT_POWER;
-      }
-          
     }
-    break; // SOIL_WAIT_INTERVAL
+    // питанием не управляем - сразу опрашиваем
+    // fall through
 
-    case SOIL_WAIT_POWER: // ждём истечения времени инициализации по питанию
+    case SOIL_WAIT_POWER: // истекло время инициализации по питанию
     {
-      #ifdef USE_SOIL_MOISTURE_SENSORS_POWER_MANAGEMENT
-          lastUpdateCall += dt;
-          if(lastUpdateCall < SOIL_MOISTURE_POWER_ON_DELAY)
-            return;
-          else
-          {
-            readFromSensors();
-            lastUpdateCall = 0;
-            machineState = SOIL_WAIT_INTERVAL;
-          }
-      #else
-        readFromSensors();
-        lastUpdateCall = 0;
-        machineState = SOIL_WAIT_INTERVAL;
+      #if SUPPORTED_SOIL_MOISTURE_SENSORS > 0
+      {
+        bool needCapture = soilCaptureStart();
+        #ifdef USE_SOIL_MOISTURE_SENSORS_POWER_MANAGEMENT
+          // датчики только что включены - аналоговым надо заново набрать показания
+          needCapture = soilAnalogRestart() || needCapture;
+        #endif
+        if(needCapture)
+        {
+          // даём датчикам накопить периоды и отсчёты
+          waitFor(SOIL_WAIT_CAPTURE,SOIL_MOISTURE_CAPTURE_DURATION);
+          return;
+        }
+      }
       #endif
+
+      readFromSensors();
+      waitFor(SOIL_WAIT_INTERVAL,SOIL_MOISTURE_UPDATE_INTERVAL);
     }
     break; // SOIL_WAIT_POWER
+
+    case SOIL_WAIT_CAPTURE: // датчики накопили периоды и отсчёты
+    {
+      #if SUPPORTED_SOIL_MOISTURE_SENSORS > 0
+        soilCaptureActive = false;
+      #endif
+      
+      readFromSensors();
+      waitFor(SOIL_WAIT_INTERVAL,SOIL_MOISTURE_UPDATE_INTERVAL);
+    }
+    break; // SOIL_WAIT_CAPTURE
     
   } // switch
 
 }
 //--------------------------------------------------------------------------------------------------------------------------------------
+void SoilMoistureModule::waitFor(uint8_t state, uint16_t interval)
+{
+  // следующий шаг опроса - по расписанию контроллера, между шагами модуль не вызывается
+  machineState = state;
+  MainController->ScheduleModule(this,interval,schedulePriorityNormal);
+}
+//--------------------------------------------------------------------------------------------------------------------------------------
 void SoilMoistureModule::readFromSensors()
 {
     #if SUPPORTED_SOIL_MOISTURE_SENSORS > 0
@@ -131,17 +319,27 @@ void SoilMoistureModule::readFromSensors()
         {
           case ANALOG_SOIL_MOISTURE: // аналоговый датчик влажности почвы
           {
-              int val = analogRead(SOIL_MOISTURE_SENSORS_ARRAY[i].pin);
+              Humidity h;
+              if(!AnalogSampler.available(SOIL_ANALOG_CHANNELS[i]))
+              {
+                // показаний ещё нет
+                State.UpdateState(StateSoilMoisture,i,(void*)&h);
+                break;
+              }
+              
+              // сглаженные показания АЦП, в 1/ANALOG_SAMPLER_OVERSAMPLING единицы
+              long val = AnalogSampler.read(SOIL_ANALOG_CHANNELS[i]);
       
               // теперь нам надо отразить показания между SOIL_MOISTURE_100_PERCENT и SOIL_MOISTURE_0_PERCENT
       
-              int percentsInterval = map(val,min(SOIL_MOISTURE_0_PERCENT,SOIL_MOISTURE_100_PERCENT),max(SOIL_MOISTURE_0_PERCENT,SOIL_MOISTURE_100_PERCENT),0,10000);
+              const long minVal = min(SOIL_MOISTURE_0_PERCENT,SOIL_MOISTURE_100_PERCENT)*(long)ANALOG_SAMPLER_OVERSAMPLING;
+              const long maxVal = max(SOIL_MOISTURE_0_PERCENT,SOIL_MOISTURE_100_PERCENT)*(long)ANALOG_SAMPLER_OVERSAMPLING;
+              int percentsInterval = map(val,minVal,maxVal,0,10000);
       
               // теперь, если у нас значение 0% влажности больше, чем значение 100% влажности - надо от 10000 отнять полученное значение
               if(SOIL_MOISTURE_0_PERCENT > SOIL_MOISTURE_100_PERCENT)
                 percentsInterval = 10000 - percentsInterval;
            
-              Humidity h;
               h.Value = percentsInterval/100;
               h.Fract  = percentsInterval%100;
               if(h.Value > 99)
@@ -169,6 +367,12 @@ void SoilMoistureModule::readFromSensors()
             int8_t pin = SOIL_MOISTURE_SENSORS_ARRAY[i].pin;
             Humidity h;
 
+            if(soilCaptureRead(i,h)) // датчик измерялся в фоне, по прерыванию
+            {
+              State.UpdateState(StateSoilMoisture,i,(void*)&h);
+              break;
+            }
+
             int highTime = pulseIn(pin,HIGH, PULSE_TIMEOUT);
 
             if(!highTime) // ALWAYS HIGH,  BUS ERROR
@@ -7,20 +7,21 @@
 enum
 {
   SOIL_WAIT_INTERVAL,
-  SOIL_WAIT_POWER
+  SOIL_WAIT_POWER,
+  SOIL_WAIT_CAPTURE
 };
 //--------------------------------------------------------------------------------------------------------------------------------------
 class SoilMoistureModule : public AbstractModule // модуль датчиков влажности почвы
 {
   private:
   
-    uint16_t lastUpdateCall;
     uint8_t machineState;
 
     void readFromSensors();
+    void waitFor(uint8_t state, uint16_t interval); // переходит к следующему шагу опроса через interval миллисекунд
   
   public:
-    SoilMoistureModule() : AbstractModule("SOIL"), lastUpdateCall(SOIL_MOISTURE_UPDATE_INTERVAL-387) {}
+    SoilMoistureModule() : AbstractModule("SOIL") {}
 
     bool ExecCommand(const Command& command, bool wantAnswer);
     void Setup();
@@ -1,7 +1,10 @@
 #include "StatModule.h"
 #include "ModuleController.h"
+#include "Memory.h"
 //--------------------------------------------------------------------------------------------------------------------------------------
-#if (TARGET_BOARD == DUE_BOARD)
+#if defined(HOST_BUILD)
+    #include <HostHardware.h>
+#elif (TARGET_BOARD == DUE_BOARD)
     #include <malloc.h>
     #include <stdlib.h>
     #include <stdio.h>
@@ -9,7 +12,7 @@
 //--------------------------------------------------------------------------------------------------------------------------------------
 // выводит свободную память
 //--------------------------------------------------------------------------------------------------------------------------------------
-#if (TARGET_BOARD == MEGA_BOARD)
+#if (TARGET_BOARD == MEGA_BOARD) && !defined(HOST_BUILD)
 struct __freelist 
 {
   size_t sz;
@@ -31,7 +34,9 @@ int freeListSize()
 //--------------------------------------------------------------------------------------------------------------------------------------
 int freeRam() 
 {
-  #if (TARGET_BOARD == MEGA_BOARD)
+  #if defined(HOST_BUILD)
+    return Host::FreeRam(); // сборка под Linux (Host/), память считает прослойка
+  #elif (TARGET_BOARD == MEGA_BOARD)
    extern int __heap_start, *__brkval;
    int free_memory;
     if ((int)__brkval == 0) 
@@ -84,6 +89,23 @@ bool  StatModule::ExecCommand(const Command& command, bool wantAnswer)
   {
       if(wantAnswer) 
         PublishSingleton = NOT_SUPPORTED;
+
+    #ifdef USE_LOOP_PROFILER
+      if(argsCount > 0)
+      {
+        String t = command.GetArg(0);
+        if(t == PROFILE_COMMAND) // сбросить статистику профилирования
+        {
+          MainController->ResetProfile();
+          PublishSingleton.Flags.Status = true;
+          if(wantAnswer)
+          {
+            PublishSingleton = PROFILE_COMMAND;
+            PublishSingleton << PARAM_DELIMITER << REG_SUCC;
+          }
+        }
+      }
+    #endif
   }
   else
   if(command.GetType() == ctGET) //получить статистику
@@ -131,6 +153,75 @@ bool  StatModule::ExecCommand(const Command& command, bool wantAnswer)
           PublishSingleton.Flags.Status = true;
         }
       #endif  
+      #ifdef USE_LOOP_PROFILER
+        else if(t == PROFILE_COMMAND)
+        {
+          if(argsCount < 2)
+          {
+            // общая статистика: PROF|секунд_сбора|проходов|среднее_мкс|максимум_мкс|мин_своб_памяти|команд|команд_в_секунду
+            LoopProfileData* lp = MainController->GetLoopProfile();
+            unsigned long elapsed = millis() - lp->StartedAt;
+            
+            PublishSingleton.Flags.Status = true;
+            if(wantAnswer)
+            {
+              PublishSingleton = PROFILE_COMMAND;
+              PublishSingleton << PARAM_DELIMITER << (elapsed/1000);
+              PublishSingleton << PARAM_DELIMITER << lp->Loops;
+              PublishSingleton << PARAM_DELIMITER << (lp->Loops ? lp->TotalMicros/lp->Loops : 0);
+              PublishSingleton << PARAM_DELIMITER << lp->MaxMicros;
+              PublishSingleton << PARAM_DELIMITER << lp->MinFreeRam;
+              PublishSingleton << PARAM_DELIMITER << lp->Commands;
+              PublishSingleton << PARAM_DELIMITER << (elapsed ? (unsigned long)(((uint64_t)lp->Commands*1000)/elapsed) : 0);
+            }
+          }
+          else
+          {
+            // статистика по модулю: PROF|ИМЯ_МОДУЛЯ|вызовов|среднее_мкс|максимум_мкс|интервал_мс|бюджет_мкс|превышений_бюджета|макс_опоздание_мс
+            const char* moduleName = command.GetArg(1);
+            size_t cnt = MainController->GetModulesCount();
+            for(size_t i=0;i<cnt;i++)
+            {
+              AbstractModule* mod = MainController->GetModule(i);
+              if(strcmp(mod->GetID(),moduleName))
+                continue;
+
+              ModuleProfileData* pd = MainController->GetModuleProfile(i);
+              PublishSingleton.Flags.Status = true;
+              if(wantAnswer)
+              {
+                PublishSingleton = PROFILE_COMMAND;
+                PublishSingleton << PARAM_DELIMITER << mod->GetID();
+                PublishSingleton << PARAM_DELIMITER << pd->Calls;
+                PublishSingleton << PARAM_DELIMITER << (pd->Calls ? pd->TotalMicros/pd->Calls : 0);
+                PublishSingleton << PARAM_DELIMITER << pd->MaxMicros;
+                PublishSingleton << PARAM_DELIMITER << MainController->GetModuleInterval(i);
+                PublishSingleton << PARAM_DELIMITER << pd->BudgetMicros;
+                PublishSingleton << PARAM_DELIMITER << pd->Overruns;
+                PublishSingleton << PARAM_DELIMITER << pd->MaxLateness;
+              }
+              break;
+            } // for
+
+            if(!PublishSingleton.Flags.Status && wantAnswer)
+              PublishSingleton = UNKNOWN_MODULE;
+          }
+        }
+        else if(t == MEMSTAT_COMMAND)
+        {
+          // статистика EEPROM: MEM|сбросов_в_память|записано_байт|пропущено_неизменённых_байт|время_записи_мс
+          MemoryStatData* ms = MemGetStat();
+          PublishSingleton.Flags.Status = true;
+          if(wantAnswer)
+          {
+            PublishSingleton = MEMSTAT_COMMAND;
+            PublishSingleton << PARAM_DELIMITER << ms->Flushes;
+            PublishSingleton << PARAM_DELIMITER << ms->BytesWritten;
+            PublishSingleton << PARAM_DELIMITER << ms->BytesSkipped;
+            PublishSingleton << PARAM_DELIMITER << (ms->WaitMicros/1000);
+          }
+        }
+      #endif
         else
         {
           // неизвестная команда
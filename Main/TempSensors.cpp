@@ -379,25 +379,26 @@ void TempSensors::Setup()
 
   lastUpdateCall = 0;
   smallSensorsChange = 0;
+
+  // фрамугам и диоду ручного режима хватает обновления раз в ACTUATORS_UPDATE_INTERVAL, опрос датчиков - реже, по своему счётчику
+  MainController->ScheduleModule(this,ACTUATORS_UPDATE_INTERVAL,schedulePriorityHigh);
   
    // добавляем датчики температуры
    #if SUPPORTED_SENSORS > 0
 
-   DS18B20Temperature tempData;
-   tempData.Whole = 0;
-   tempData.Fract = 0;
    for(uint8_t i=0;i<SUPPORTED_SENSORS;i++)
    {
     State.AddState(StateTemperature,i);
-    // запускаем конвертацию с датчиков при старте, через 2 секунды нам вернётся измеренная температура
     tempSensor.begin(TEMP_SENSORS[i].pin);
-
-    tempSensor.setResolution(temp12bit); // устанавливаем разрешение датчика
-    
-    tempSensor.readTemperature(&tempData,(DSSensorType)TEMP_SENSORS[i].type);
+    tempSensor.setResolution(TEMP_SENSORS_RESOLUTION); // устанавливаем разрешение датчика
    }
    #endif
 
+  // запускаем конвертацию с датчиков при старте, показания будут прочитаны сразу после её окончания
+  conversionStarted = false;
+  conversionTimer = 0;
+  StartTemperatureConversion();
+
   
    SetupWindows(); // настраиваем фрамуги
 
@@ -479,13 +480,59 @@ void TempSensors::Update(uint16_t dt)
  #endif 
 
 
+  if(conversionStarted)
+  {
+    // ждём окончания конвертации, не блокируя главный цикл
+    conversionTimer += dt;
+    if(conversionTimer >= DS18B20Support::getConversionTime(TEMP_SENSORS_RESOLUTION))
+      ReadTemperatureResults();
+  }
+
   lastUpdateCall += dt;
   if(lastUpdateCall < TEMP_UPDATE_INTERVAL) // обновляем согласно настроенному интервалу
     return;
   else
     lastUpdateCall = 0;
 
-  // опрашиваем наши датчики
+  StartTemperatureConversion();
+}
+//--------------------------------------------------------------------------------------------------------------------------------------
+void TempSensors::StartTemperatureConversion()
+{
+  if(conversionStarted) // предыдущая конвертация ещё не вычитана
+    return;
+    
+  #if SUPPORTED_SENSORS > 0
+  for(uint8_t i=0;i<SUPPORTED_SENSORS;i++)
+  {
+    // на одной линии конвертацию запускаем один раз - команда широковещательная (SKIP ROM)
+    bool alreadyStarted = false;
+    for(uint8_t j=0;j<i;j++)
+    {
+      if(TEMP_SENSORS[j].pin == TEMP_SENSORS[i].pin)
+      {
+        alreadyStarted = true;
+        break;
+      }
+    }
+    
+    if(alreadyStarted)
+      continue;
+      
+    tempSensor.begin(TEMP_SENSORS[i].pin);
+    tempSensor.startConversion();
+  } // for
+
+  conversionStarted = true;
+  conversionTimer = 0;
+  #endif
+}
+//--------------------------------------------------------------------------------------------------------------------------------------
+void TempSensors::ReadTemperatureResults()
+{
+  conversionStarted = false;
+  
+  // вычитываем результаты конвертации со всех датчиков за один проход
   #if SUPPORTED_SENSORS > 0
   Temperature t;
   for(uint8_t i=0;i<SUPPORTED_SENSORS;i++)
@@ -497,7 +544,7 @@ void TempSensors::Update(uint16_t dt)
     
     DS18B20Temperature tempData;
     
-    if(tempSensor.readTemperature(&tempData,(DSSensorType)TEMP_SENSORS[i].type))
+    if(tempSensor.readResult(&tempData,(DSSensorType)TEMP_SENSORS[i].type))
     {
       t.Value = tempData.Whole;
     
@@ -517,8 +564,6 @@ void TempSensors::Update(uint16_t dt)
   #endif
 
   smallSensorsChange = 0;
-
-
 }
 //--------------------------------------------------------------------------------------------------------------------------------------
 void TempSensors::WindowFeedback(uint8_t windowNumber, bool isCloseSwitchTriggered, bool isOpenSwitchTriggered, bool hasPosition, uint8_t positionPercents, bool isFirstFeedback)
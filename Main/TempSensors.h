@@ -114,6 +114,13 @@ class TempSensors : public AbstractModule // модуль опроса темп
 
     DS18B20Support tempSensor;
     //DS18B20Temperature tempData;
+
+    // опрос датчиков в два этапа: широковещательно запускаем конвертацию на всех линиях,
+    // возвращаемся в главный цикл и по истечении времени конвертации - разом читаем результаты
+    bool conversionStarted;
+    uint16_t conversionTimer;
+    void StartTemperatureConversion();
+    void ReadTemperatureResults();
     
   public:
     TempSensors() : AbstractModule("STATE"){}
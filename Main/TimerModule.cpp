@@ -135,6 +135,7 @@ void TimerModule::LoadTimers()
 void TimerModule::SaveTimers()
 {
   uint16_t addr = TIMERS_EEPROM_ADDR;
+  MemBeginWrite();
   MemWrite(addr++,SETT_HEADER1);
   MemWrite(addr++,SETT_HEADER2);
 
@@ -148,6 +149,7 @@ void TimerModule::SaveTimers()
       // EEPROM.put(addr,timers[i].Settings);
      // addr += sizeof(PeriodicTimerSettings);   
    } // for
+   MemCommit();
 }
 //--------------------------------------------------------------------------------------------------------------------------------
 void TimerModule::Setup()
@@ -53,7 +53,7 @@ public:
       if (count > (d_size - index) ) { count = d_size - index; }
       Data *writeTo = (d_data + index);
       d_size = (d_size - count);
-      memmove(writeTo, d_data + index + count,d_size - index);
+      memmove(writeTo, d_data + index + count,(d_size - index)*sizeof(Data)); // сдвигаем элементы, а не байты
     }
 
     void push_back(Data const &x)
@@ -75,17 +75,28 @@ public:
       d_size = 0;
     }
 
-    void clear() //here
+    void clear() // очищает вектор и освобождает память; чтобы сохранить память под следующие элементы - используйте empty()
     {
-        if(d_data)
-          memset(d_data, 0, d_size);
         d_capacity = 0;
         d_size = 0;
         free(d_data);
         d_data = NULL;
     }
 
+    void reserve(size_t capacity) // заранее выделяет память под нужное кол-во элементов, чтобы избежать перераспределений
+    {
+        if(capacity > d_capacity)
+          reallocate(capacity);
+    }
+
+    void shrink(size_t maxCapacity) // освобождает память пустого вектора, если её выделено больше maxCapacity элементов
+    {
+        if(!d_size && d_capacity > maxCapacity)
+          clear();
+    }
+
     size_t size() const { return d_size; }; // Size getter
+    size_t capacity() const { return d_capacity; }
 
     Data const &operator[](size_t idx) const { return d_data[idx]; }; // Const getter
 
@@ -96,12 +107,305 @@ public:
 private:
     void resize()
     {
-        d_capacity = d_capacity ? d_capacity * 2 : 1;
+        reallocate(d_capacity ? d_capacity * 2 : 1);
+    };// Allocates double the old space
+
+    void reallocate(size_t newCapacity)
+    {
+        d_capacity = newCapacity;
         Data *newdata = (Data *)malloc(d_capacity*sizeof(Data)); //allocates new memory
         memcpy(newdata, d_data, d_size * sizeof(Data));  //copies all the old memory over
         free(d_data);                                          //free old
         d_data = newdata;
-    };// Allocates double the old space
+    };
+};
+//--------------------------------------------------------------------------------------------------------------------------------
+// вектор фиксированной ёмкости: данные хранятся внутри самого объекта, куча не используется.
+// Подходит для коротких списков с известным максимумом элементов; лишние элементы не добавляются.
+//--------------------------------------------------------------------------------------------------------------------------------
+template<typename Data, size_t Capacity>
+class FixedVector {
+
+    size_t d_size;
+    Data d_data[Capacity];
+    
+public:
+    FixedVector() : d_size(0) {};
+
+    int indexOf(Data const &x)
+    {
+      for(size_t i=0;i<d_size;i++)
+      {
+        if(d_data[i] == x)
+          return (int) i;
+      }
+      return -1;
+    }
+
+    void remove(size_t index, size_t count)
+    {
+      if (index >= d_size) { return; }
+      if (count > (d_size - index) ) { count = d_size - index; }
+      d_size = (d_size - count);
+      memmove(d_data + index, d_data + index + count,(d_size - index)*sizeof(Data));
+    }
+
+    bool push_back(Data const &x)
+    {
+        if(d_size >= Capacity) // места нет
+          return false;
+
+        d_data[d_size++] = x;
+        return true;
+    };
+
+    void pop()
+    {
+        if(d_size)
+          --d_size;
+    };
+
+    void empty() { d_size = 0; }
+    void clear() { d_size = 0; }
+
+    size_t size() const { return d_size; };
+    size_t capacity() const { return Capacity; }
+    bool full() const { return d_size >= Capacity; }
+
+    Data const &operator[](size_t idx) const { return d_data[idx]; };
+
+    Data &operator[](size_t idx) { return d_data[idx]; };
+
+    Data *pData() { return d_data; }
+};
+
+//--------------------------------------------------------------------------------------------------------------------------------
+// пул памяти для PoolVector: статический массив, поделённый на блоки одного размера. Вектор занимает в нём
+// непрерывную цепочку свободных блоков, так что память часто растущих и опустошаемых буферов не дробит кучу.
+// Память пула и карта занятых блоков передаются снаружи (обычно - статические массивы), конструктор ничего не
+// выделяет, поэтому пул готов к работе ещё до конструкторов глобальных объектов.
+//--------------------------------------------------------------------------------------------------------------------------------
+class VectorPool {
+
+    uint8_t *p_storage; // блоки подряд
+    uint8_t *p_usedMap; // по биту на блок, 1 - блок занят
+    uint16_t p_blockSize;
+    uint16_t p_blocksCount;
+
+    bool isUsed(uint16_t block) const { return p_usedMap[block >> 3] & (1 << (block & 7)); }
+
+    void mark(uint16_t first, uint16_t count, bool used)
+    {
+      for(uint16_t i=first;i<first+count;i++)
+      {
+        if(used)
+          p_usedMap[i >> 3] |= (1 << (i & 7));
+        else
+          p_usedMap[i >> 3] &= ~(1 << (i & 7));
+      }
+    }
+
+    bool isFree(uint16_t first, uint16_t count) const
+    {
+      if(first + count > p_blocksCount)
+        return false;
+        
+      for(uint16_t i=first;i<first+count;i++)
+      {
+        if(isUsed(i))
+          return false;
+      }
+      return true;
+    }
+
+    uint16_t blocksFor(size_t bytes) const { return (bytes + p_blockSize - 1)/p_blockSize; }
+    uint16_t blockOf(const void* ptr) const { return ((const uint8_t*)ptr - p_storage)/p_blockSize; }
+
+public:
+    constexpr VectorPool(uint8_t* storage, uint8_t* usedMap, uint16_t blockSize, uint16_t blocksCount)
+      : p_storage(storage), p_usedMap(usedMap), p_blockSize(blockSize), p_blocksCount(blocksCount) {}
+
+    bool owns(const void* ptr) const
+    {
+      return ptr && (const uint8_t*)ptr >= p_storage && (const uint8_t*)ptr < p_storage + p_blockSize*p_blocksCount;
+    }
+
+    void* alloc(size_t bytes, size_t& granted) // первая подходящая цепочка свободных блоков, NULL - такой нет
+    {
+      uint16_t need = blocksFor(bytes);
+      if(!need)
+        return NULL;
+        
+      for(uint16_t first=0;first + need <= p_blocksCount;first++)
+      {
+        if(isFree(first,need))
+        {
+          mark(first,need,true);
+          granted = need*p_blockSize;
+          return p_storage + first*p_blockSize;
+        }
+      }
+      return NULL;
+    }
+
+    bool grow(void* ptr, size_t oldBytes, size_t newBytes, size_t& granted) // расширяет цепочку на месте, если следующие блоки свободны
+    {
+      uint16_t first = blockOf(ptr);
+      uint16_t had = blocksFor(oldBytes);
+      uint16_t need = blocksFor(newBytes);
+
+      if(need <= had || !isFree(first + had,need - had))
+        return false;
+
+      mark(first + had,need - had,true);
+      granted = need*p_blockSize;
+      return true;
+    }
+
+    void release(void* ptr, size_t bytes)
+    {
+      if(owns(ptr))
+        mark(blockOf(ptr),blocksFor(bytes),false);
+    }
+
+    uint16_t freeBlocks() const
+    {
+      uint16_t cnt = 0;
+      for(uint16_t i=0;i<p_blocksCount;i++)
+      {
+        if(!isUsed(i))
+          cnt++;
+      }
+      return cnt;
+    }
+
+    uint16_t blockSize() const { return p_blockSize; }
+};
+//--------------------------------------------------------------------------------------------------------------------------------
+// вектор, память которого берётся из пула Pool (см. VectorPool), а если в пуле не нашлось места - из кучи.
+// Растёт сначала на месте, если блоки за ним свободны. Интерфейс - как у Vector, копирование запрещено.
+// Пул задаётся адресом глобального объекта, чтобы вектор оставался членом класса с конструктором по умолчанию:
+//   extern VectorPool SomePool;
+//   typedef PoolVector<uint8_t,&SomePool> SomeBuffer;
+//--------------------------------------------------------------------------------------------------------------------------------
+template<typename Data, VectorPool* Pool>
+class PoolVector {
+
+    size_t d_size;
+    size_t d_capacity;
+    Data *d_data;
+
+    PoolVector(PoolVector const &);
+    PoolVector &operator=(PoolVector const &);
+
+public:
+    PoolVector() : d_size(0), d_capacity(0), d_data(0) {};
+
+    ~PoolVector()
+    {
+        clear();
+    };
+
+    int indexOf(Data const &x)
+    {
+      for(size_t i=0;i<d_size;i++)
+      {
+        if(d_data[i] == x)
+          return (int) i;
+      }
+      return -1;
+    }
+
+    void remove(size_t index, size_t count)
+    {
+      if (index >= d_size) { return; }
+      if (count > (d_size - index) ) { count = d_size - index; }
+      d_size = (d_size - count);
+      memmove(d_data + index, d_data + index + count,(d_size - index)*sizeof(Data));
+    }
+
+    void push_back(Data const &x)
+    {
+        if (d_capacity == d_size)
+            reallocate(d_capacity ? d_capacity * 2 : 1);
+
+        d_data[d_size++] = x;
+    };
+
+    void pop()
+    {
+        if(d_size)
+          --d_size;
+    };
+
+    void empty()
+    {
+      d_size = 0;
+    }
+
+    void clear() // очищает вектор и возвращает память в пул (или в кучу)
+    {
+        if(Pool->owns(d_data))
+          Pool->release(d_data,d_capacity*sizeof(Data));
+        else
+          free(d_data);
+          
+        d_capacity = 0;
+        d_size = 0;
+        d_data = NULL;
+    }
+
+    void reserve(size_t capacity)
+    {
+        if(capacity > d_capacity)
+          reallocate(capacity);
+    }
+
+    void shrink(size_t maxCapacity) // возвращает память пустого вектора, если её выделено больше maxCapacity элементов
+    {
+        if(!d_size && d_capacity > maxCapacity)
+          clear();
+    }
+
+    bool pooled() const { return Pool->owns(d_data); } // память - из пула, а не из кучи
+
+    size_t size() const { return d_size; };
+    size_t capacity() const { return d_capacity; }
+
+    Data const &operator[](size_t idx) const { return d_data[idx]; };
+
+    Data &operator[](size_t idx) { return d_data[idx]; };
+
+    Data *pData() { return d_data; }
+
+private:
+    void reallocate(size_t newCapacity)
+    {
+        size_t granted = 0;
+        
+        // сначала пробуем дорасти на месте
+        if(Pool->owns(d_data) && Pool->grow(d_data,d_capacity*sizeof(Data),newCapacity*sizeof(Data),granted))
+        {
+          d_capacity = granted/sizeof(Data);
+          return;
+        }
+
+        Data *newdata = (Data *) Pool->alloc(newCapacity*sizeof(Data),granted);
+        if(newdata)
+          newCapacity = granted/sizeof(Data); // остаток последнего блока - тоже наш
+        else
+          newdata = (Data *)malloc(newCapacity*sizeof(Data)); // в пуле места нет - берём из кучи
+
+        memcpy(newdata, d_data, d_size * sizeof(Data));
+
+        if(Pool->owns(d_data))
+          Pool->release(d_data,d_capacity*sizeof(Data));
+        else
+          free(d_data);
+          
+        d_data = newdata;
+        d_capacity = newCapacity;
+    };
 };
 
 #endif
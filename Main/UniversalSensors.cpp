@@ -1,6 +1,7 @@
 #include "UniversalSensors.h"
 #include <OneWire.h>
 #include "Memory.h"
+#include "Crc8.h"
 #include "InteropStream.h"
 //-------------------------------------------------------------------------------------------------------------------------------------------------------
 UniRegDispatcher UniDispatcher;
@@ -16,9 +17,43 @@ UniRawScratchpad SHARED_SCRATCHPAD; // общий скратчпад для кл
 //-------------------------------------------------------------------------------------------------------------------------------------------------------
 UniRS485Gate::UniRS485Gate()
 {
+  gateState = rs485Idle;
+  currentJob = rs485JobNone;
+  currentStats = NULL;
+  expectAnswer = false;
+  frameV2 = false;
+  packetLength = sizeof(RS485Packet);
+  bytesReaded = 0;
+  nextJobToCheck = rs485JobControl;
+  transmitStartedAt = transmitDoneAt = lastByteAt = 0;
+  transmitDone = false;
+  
 #ifdef USE_UNI_EXECUTION_MODULE  
   updateTimer = 0;
+  stateDue = false;
 #endif  
+
+#ifdef USE_RS485_EXTERNAL_CONTROL_MODULE
+  controlModuleTimer = 0;
+  controlDue = false;
+  memset(&controlStats,0,sizeof(controlStats));
+#endif
+
+#if defined(USE_FEEDBACK_MANAGER) && defined(USE_TEMP_SENSORS) && SUPPORTED_WINDOWS > 0
+  feedbackTimer = 1000;
+  feedbackModule = -1;
+  feedbackStatePending = false;
+  anyFeedbackReceived = false;
+  currentWindowNumber = 0;
+  memset(feedbackStats,0,sizeof(feedbackStats));
+#endif
+
+#ifdef USE_UNIVERSAL_MODULES
+  currentQueuePos = 0;
+  sensorsTimer = 0;
+  sensorDue = false;
+  queueInited = false;
+#endif
 }
 //-------------------------------------------------------------------------------------------------------------------------------------------------------
 #ifdef USE_UNIVERSAL_MODULES
@@ -31,8 +66,23 @@ bool UniRS485Gate::isInOnlineQueue(const RS485QueueItem& item)
   return false;
 }
 //-------------------------------------------------------------------------------------------------------------------------------------------------------
+RS485QueueItem* UniRS485Gate::findQueueItem(byte sType, byte sIndex)
+{
+  for(size_t i=0;i<queue.size();i++)
+    if(queue[i].sensorType == sType && queue[i].sensorIndex == sIndex)
+      return &(queue[i]);
+  return NULL;
+}
+//-------------------------------------------------------------------------------------------------------------------------------------------------------
 #endif // USE_UNIVERSAL_MODULES
 //-------------------------------------------------------------------------------------------------------------------------------------------------------
+#if (TARGET_BOARD == MEGA_BOARD)
+ISR(RS_485_TX_vect)
+{
+  RS485.onTransmitComplete();
+}
+#endif
+//-------------------------------------------------------------------------------------------------------------------------------------------------------
 void UniRS485Gate::enableSend()
 {
   digitalWrite(RS_485_DE_PIN,HIGH); // переводим контроллер RS-485 на передачу
@@ -66,42 +116,6 @@ void UniRS485Gate::Setup()
   }
 
   
-}
-//-------------------------------------------------------------------------------------------------------------------------------------------------------
-byte UniRS485Gate::crc8(const byte *addr, byte len)
-{
-  byte crc = 0;
-  while (len--) 
-    {
-    byte inbyte = *addr++;
-    for (byte i = 8; i; i--)
-      {
-      byte mix = (crc ^ inbyte) & 0x01;
-      crc >>= 1;
-      if (mix) 
-        crc ^= 0x8C;
-      inbyte >>= 1;
-      }  // end of for
-    }  // end of while
-  return crc;  
-}
-//-------------------------------------------------------------------------------------------------------------------------------------------------------
-void UniRS485Gate::waitTransmitComplete()
-{
-  // ждём завершения передачи по UART
- #if (TARGET_BOARD == MEGA_BOARD) 
-  while(!(RS_485_UCSR & _BV(RS_485_TXC) ))
-  {
-    //yield(); // даём вычитать из буферов ESP и SIM800
-  }
- #elif (TARGET_BOARD == DUE_BOARD) 
-  while((RS_485_UCSR->US_CSR & RS_485_TXC) == 0)
-  {
-    //yield(); // даём вычитать из буферов ESP и SIM800    
-  }
- #else
-  #error "Unknown target board!"
- #endif
 }
 //-------------------------------------------------------------------------------------------------------------------------------------------------------
 void UniRS485Gate::executeCommands(const RS485Packet& packet)
@@ -283,204 +297,191 @@ void UniRS485Gate::writeToStream(Stream* s, const uint8_t* buffer, size_t len)
   */
 }
 //-------------------------------------------------------------------------------------------------------------------------------------------------------
-void UniRS485Gate::sendControllerStatePacket()
+void UniRS485Gate::onTransmitComplete()
 {
-    enableSend();
-    
-    RS485Packet packet;
-    memset(&packet,0,sizeof(RS485Packet));
-    
-    packet.header1 = 0xAB;
-    packet.header2 = 0xBA;
-    packet.tail1 = 0xDE;
-    packet.tail2 = 0xAD;
-
-    packet.direction = RS485FromMaster;
-    packet.type = RS485ControllerStatePacket;
-
-    void* dest = packet.data;
-    ControllerState curState = WORK_STATUS.GetState();
-    void* src = &curState;
-    memcpy(dest,src,sizeof(ControllerState));
-
-    const byte* b = (const byte*) &packet;
-    packet.crc8 = crc8(b,sizeof(RS485Packet)-1);
+  // модуль отвечает сразу после последнего байта запроса - отпускаем шину, пока он не начал
+  enableReceive();
+  
+ #if (TARGET_BOARD == MEGA_BOARD)
+  RS_485_UCSRB &= ~_BV(RS_485_TXCIE); // прерывание нужно только на этот пакет
+ #endif
 
-    // пишем в шину RS-495 слепок состояния контроллера
-    //RS_485_SERIAL.write((const uint8_t *)&packet,sizeof(RS485Packet));
-    writeToStream(&RS_485_SERIAL,(const uint8_t *)&packet,sizeof(RS485Packet));
+  transmitDoneAt = micros();
+  transmitDone = true;
+}
+//-------------------------------------------------------------------------------------------------------------------------------------------------------
+bool UniRS485Gate::isTransmitComplete()
+{
+  // завершилась ли передача по UART (флаг сбрасывается при записи в порт)
+ #if (TARGET_BOARD == MEGA_BOARD) 
+  return (RS_485_UCSR & _BV(RS_485_TXC)) != 0;
+ #elif (TARGET_BOARD == DUE_BOARD) 
+  return (RS_485_UCSR->US_CSR & RS_485_TXC) != 0;
+ #else
+  #error "Unknown target board!"
+ #endif
+}
+//-------------------------------------------------------------------------------------------------------------------------------------------------------
+void UniRS485Gate::preparePacket(byte type)
+{
+  memset(&packet,0,sizeof(RS485Packet));
+  
+  packet.header1 = 0xAB;
+  packet.header2 = 0xBA;
+  packet.tail1 = 0xDE;
+  packet.tail2 = 0xAD;
 
-    // теперь ждём завершения передачи
-    waitTransmitComplete();
+  packet.direction = RS485FromMaster;
+  packet.type = type;
 
-     enableReceive();
+  frameV2 = false;
+  packetLength = sizeof(RS485Packet);
 }
 //-------------------------------------------------------------------------------------------------------------------------------------------------------
-void UniRS485Gate::Update(uint16_t dt)
+void UniRS485Gate::prepareFrameV2(byte type, byte length)
 {
+  memset(&frame,0,sizeof(RS485FrameV2));
 
-  static RS485Packet packet;
-
-  #ifdef USE_RS485_EXTERNAL_CONTROL_MODULE
-  ///////////////////////////////////////////////////////////////////////
-  // Опрашиваем модули управления
-  ///////////////////////////////////////////////////////////////////////
-  static uint16_t controlModuleTimer = 0;
-  controlModuleTimer += dt;
-  
-  if(controlModuleTimer > 2000)
-  {
-      // пора опрашивать модули управления
-    
-      controlModuleTimer = 0;
-      
-      enableSend();
-      
-      #ifdef RS485_DEBUG
-        DEBUG_LOGLN(F("Request information from control modules..."));        
-      #endif
+  frame.header1 = RS485_V2_HEADER1;
+  frame.header2 = RS485_V2_HEADER2;
+  frame.length = length;
+  frame.direction = RS485FromMaster;
+  frame.type = type;
 
-      memset(&packet,0,sizeof(RS485Packet));
-      packet.header1 = 0xAB;
-      packet.header2 = 0xBA;
-      packet.tail1 = 0xDE;
-      packet.tail2 = 0xAD;
+  frameV2 = true;
+  packetLength = length + RS485_V2_OVERHEAD;
+}
+//-------------------------------------------------------------------------------------------------------------------------------------------------------
+void UniRS485Gate::startTransmit(RS485Job job, RS485SlaveStats* stats, bool waitAnswer)
+{
+  // считаем контрольную сумму и отдаём пакет в UART - дальше он уходит в шину без нас.
+  // и у пакета, и у кадра второй версии контрольная сумма - последний байт
+  byte* b = (byte*) &packet;
+  b[packetLength-1] = Crc8(b,packetLength-1);
 
-      packet.direction = RS485FromMaster;
-      packet.type = RS485RequestCommandsPacket;
+  currentJob = job;
+  currentStats = stats;
+  expectAnswer = waitAnswer;
 
-      CommandsToExecutePacket* cePacket = (CommandsToExecutePacket*) &(packet.data);
-      cePacket->moduleID = 0;
+  if(stats && waitAnswer)
+    stats->Requests++;
 
-      const byte* b = (const byte*) &packet;
-      packet.crc8 = crc8(b,sizeof(RS485Packet)-1);
+  enableSend();
+  transmitDone = false;
+  writeToStream(&RS_485_SERIAL,(const uint8_t *)&packet,packetLength);
 
-      //RS_485_SERIAL.write((const uint8_t *)&packet,sizeof(RS485Packet));
-      writeToStream(&RS_485_SERIAL,(const uint8_t *)&packet,sizeof(RS485Packet));
-    
-      // теперь ждём завершения передачи
-      waitTransmitComplete();
+  transmitStartedAt = micros();
+  gateState = rs485Transmitting;
 
-      // начинаем принимать
-      enableReceive();
+  if(!waitAnswer)
+    return;
 
-      yield();
+ #if (TARGET_BOARD == MEGA_BOARD)
+  // на приём переключимся в прерывании по окончании передачи. Флаг TXC сброшен записью в порт,
+  // так что прерывание придёт, только когда из сдвигового регистра уйдёт последний байт пакета
+  RS_485_UCSRB |= _BV(RS_485_TXCIE);
+ #else
+  // обработчик прерывания USART на DUE занят ядром Arduino - ждём, пока пакет уйдёт в шину, здесь
+  RS_485_SERIAL.flush();
+  onTransmitComplete();
+ #endif
+}
+//-------------------------------------------------------------------------------------------------------------------------------------------------------
+bool UniRS485Gate::isPacketValid()
+{
+  bool formatOk;
 
-            memset(&packet,0,sizeof(RS485Packet));
-            byte* writePtr = (byte*) &packet;
-            byte bytesReaded = 0; // кол-во прочитанных байт
-            
-            // запоминаем время начала чтения
-            unsigned long startReadingTime = micros();
-            // вычисляем таймаут как время для чтения десяти байт.
-            // в RS485_SPEED - у нас скорость в битах в секунду. Для чтения десяти байт надо вычитать 100 бит.
-            const unsigned long readTimeout  = (10000000ul/RS485_SPEED)*RS485_BYTES_TIMEOUT; // кол-во микросекунд, необходимое для вычитки десяти байт
-
-            // начинаем читать данные
-            while(1)
-            {
-              if( micros() - startReadingTime > readTimeout)
-              {
-                
-                #ifdef RS485_DEBUG
-                  DEBUG_LOG(F("Control module #"));
-                  DEBUG_LOG(String(0));
-                  DEBUG_LOGLN(F(" not answering!"));
-                #endif
-                
-                break;
-              } // if
-    
-              if(RS_485_SERIAL.available())
-              {
-                startReadingTime = micros(); // сбрасываем таймаут
-                *writePtr++ = (byte) RS_485_SERIAL.read();
-                bytesReaded++;
-              } // if available
+  if(frameV2)
+    formatOk = frame.header1 == RS485_V2_HEADER1 && frame.header2 == RS485_V2_HEADER2 && frame.length <= RS485_V2_MAX_PAYLOAD;
+  else
+    formatOk = packet.header1 == 0xAB && packet.header2 == 0xBA && packet.tail1 == 0xDE && packet.tail2 == 0xAD;
+  
+  if(!formatOk)
+  {
+    #ifdef RS485_DEBUG
+      DEBUG_LOGLN(F("Head or tail of packet is invalid :("));
+    #endif
+    return false;
+  }
+  
+  const byte* b = (const byte*) &packet;
+  byte crc = Crc8(b,packetLength-1);
+  if(crc != b[packetLength-1])
+  {
+    #ifdef RS485_DEBUG
+      DEBUG_LOGLN(F("Bad checksum :("));
+    #endif
+    return false;
+  }
 
-              if(bytesReaded == sizeof(RS485Packet)) // прочитали весь пакет
-              {
-                #ifdef RS485_DEBUG
-                  DEBUG_LOGLN(F("Packet received from control module!"));
-                #endif
-                
-                break;
-              }
-          
-           } // while
+  return true;
+}
+//-------------------------------------------------------------------------------------------------------------------------------------------------------
+void UniRS485Gate::sendControllerStatePacket()
+{
+    preparePacket(RS485ControllerStatePacket);
 
-            // затем опять переключаемся на передачу
-            enableSend();
+    void* dest = packet.data;
+    ControllerState curState = WORK_STATUS.GetState();
+    void* src = &curState;
+    memcpy(dest,src,sizeof(ControllerState));
 
-        // теперь парсим пакет
-        if(bytesReaded == sizeof(RS485Packet))
-        {
-          bool headOk = packet.header1 == 0xAB && packet.header2 == 0xBA;
-          bool tailOk = packet.tail1 == 0xDE && packet.tail2 == 0xAD;
-          
-          if(headOk && tailOk)
-          {
-            #ifdef RS485_DEBUG
-              DEBUG_LOGLN(F("Header and tail ok."));
-            #endif
-         
-            // вычисляем crc
-            byte crc = crc8((const byte*)&packet,sizeof(RS485Packet)-1);
-            if(crc == packet.crc8)
-            {
-              #ifdef RS485_DEBUG
-                DEBUG_LOGLN(F("Checksum ok."));
-              #endif
-              
-              // теперь проверяем, нам ли пакет
-              if(packet.direction == RS485FromSlave && packet.type == RS485RequestCommandsPacket)
-              {
-                #ifdef RS485_DEBUG
-                  DEBUG_LOGLN(F("Packet type ok, start analyze commands..."));
-                #endif
+    // пишем в шину RS-495 слепок состояния контроллера, ответа на него нет
+    startTransmit(rs485JobState,NULL,false);
+}
+//-------------------------------------------------------------------------------------------------------------------------------------------------------
+#ifdef USE_RS485_EXTERNAL_CONTROL_MODULE
+//-------------------------------------------------------------------------------------------------------------------------------------------------------
+void UniRS485Gate::requestControlModule()
+{
+  #ifdef RS485_DEBUG
+    DEBUG_LOGLN(F("Request information from control modules..."));        
+  #endif
 
-                  executeCommands(packet);
+  preparePacket(RS485RequestCommandsPacket);
 
-                  // и посылаем квитанцию
-                  packet.direction = RS485FromMaster;
-                  packet.type = RS485CommandsToExecuteReceipt;
-                  packet.crc8 = crc8(b,sizeof(RS485Packet)-1);
+  CommandsToExecutePacket* cePacket = (CommandsToExecutePacket*) &(packet.data);
+  cePacket->moduleID = 0;
 
-                  //RS_485_SERIAL.write((const uint8_t *)&packet,sizeof(RS485Packet));
-                  writeToStream(&RS_485_SERIAL,(const uint8_t *)&packet,sizeof(RS485Packet));
+  startTransmit(rs485JobControl,&controlStats,true);
+}
+//-------------------------------------------------------------------------------------------------------------------------------------------------------
+void UniRS485Gate::handleControlAnswer()
+{
+  // теперь проверяем, нам ли пакет
+  if(!(packet.direction == RS485FromSlave && packet.type == RS485RequestCommandsPacket))
+    return;
     
-                   // теперь ждём завершения передачи
-                  waitTransmitComplete();
-
-                #ifdef RS485_DEBUG
-                  DEBUG_LOGLN(F("Commands from control module executed."));
-                #endif                  
+  #ifdef RS485_DEBUG
+    DEBUG_LOGLN(F("Packet type ok, start analyze commands..."));
+  #endif
 
-              }
-            } // if crc ok
-            
-          } // if(headOk && tailOk)
-                
-        } // if(bytesReaded == sizeof(RS485Packet))
-      
-    
-  } // if
-  ///////////////////////////////////////////////////////////////////////
-  // Конец опроса модулей управления
-  ///////////////////////////////////////////////////////////////////////
-  #endif // USE_RS485_EXTERNAL_CONTROL_MODULE
-  
-  bool controllerStateWasSentOnThisIteration = false;
+  executeCommands(packet);
 
   #if defined(USE_FEEDBACK_MANAGER) && defined(USE_TEMP_SENSORS) && SUPPORTED_WINDOWS > 0
-  
-    // тут работаем с модулями обратной связи
-    
-    static uint16_t feedbackCounter = 1000;
-    feedbackCounter += dt;
-    
-    if(feedbackCounter > FEEDBACK_MANAGER_UPDATE_INTERVAL)
-    {
+    // команды могли поменять состояние окон - модули обратной связи должны узнать о нём раньше, чем мы их опросим
+    if(feedbackModule >= 0)
+      feedbackStatePending = true;
+  #endif
+
+  // и посылаем квитанцию
+  packet.direction = RS485FromMaster;
+  packet.type = RS485CommandsToExecuteReceipt;
+  startTransmit(rs485JobControl,NULL,false);
+
+  #ifdef RS485_DEBUG
+    DEBUG_LOGLN(F("Commands from control module executed."));
+  #endif                  
+}
+//-------------------------------------------------------------------------------------------------------------------------------------------------------
+#endif // USE_RS485_EXTERNAL_CONTROL_MODULE
+//-------------------------------------------------------------------------------------------------------------------------------------------------------
+#if defined(USE_FEEDBACK_MANAGER) && defined(USE_TEMP_SENSORS) && SUPPORTED_WINDOWS > 0
+//-------------------------------------------------------------------------------------------------------------------------------------------------------
+void UniRS485Gate::requestFeedbackModule()
+{
+  if(feedbackStatePending)
+  {
       // здесь нам надо сперва послать пакет с состоянием контроллера, по-любому!
       // это связано с тем, что может быть рассинхрон по времени опроса состояний, например:
       // попросили закрыть окно, при этом концевик открытия у модуля - сработал.
@@ -489,302 +490,747 @@ void UniRS485Gate::Update(uint16_t dt)
       // то в ней будет состояние "Окно открыто". Следовательно, внутреннее состояние контроллера изменится,
       // и запрошенной команды к модулю - не уйдёт. Поэтому ВСЕГДА перед опросом модулей обратной связи
       // мы должны посылать им актуальное состояние контроллера!
-       sendControllerStatePacket();
-       controllerStateWasSentOnThisIteration = true;
+      feedbackStatePending = false;
       
-      feedbackCounter = 0;
-      // пора собирать информацию по обратной связи
-      byte currentWindowNumber = 0; // с каким окном сейчас работаем
-      bool anyFeedbackReceived = false;
+      #ifdef USE_UNI_EXECUTION_MODULE
+        // исполнительные модули получат это же состояние
+        stateDue = false;
+        updateTimer = 0;
+      #endif
       
-        for(int i=0;i<16;i++) // у нас 16 адресов на шине
-        {
-            memset(&packet,0,sizeof(RS485Packet));
-            
-            packet.header1 = 0xAB;
-            packet.header2 = 0xBA;
-            packet.tail1 = 0xDE;
-            packet.tail2 = 0xAD;
-    
-            packet.direction = RS485FromMaster;
-            packet.type = RS485WindowsPositionPacket;
+      sendControllerStatePacket();
+      return;
+  }
 
-            // говорим, что мы хотим получить информацию с модуля определённого номера
-            WindowFeedbackPacket* wfPacket = (WindowFeedbackPacket*) &(packet.data);
-            wfPacket->moduleNumber = i;
+  preparePacket(RS485WindowsPositionPacket);
 
-              #ifdef RS485_DEBUG
-      
-              // отладочная информация
-              DEBUG_LOG(F("Send query for feedback packet #"));
-              DEBUG_LOGLN(String(wfPacket->moduleNumber));
-                    
-              #endif
+  // говорим, что мы хотим получить информацию с модуля определённого номера
+  WindowFeedbackPacket* wfPacket = (WindowFeedbackPacket*) &(packet.data);
+  wfPacket->moduleNumber = feedbackModule;
 
-            // считаем контрольную сумму
-            const byte* b = (const byte*) &packet;
-            packet.crc8 = crc8(b,sizeof(RS485Packet)-1);  
+  #ifdef RS485_DEBUG
+    DEBUG_LOG(F("Send query for feedback packet #"));
+    DEBUG_LOGLN(String(wfPacket->moduleNumber));
+  #endif
 
-            enableSend();
-            
-           // посылаем пакет   
-           // пишем в шину RS-495 запрос об обратной связи
-            //RS_485_SERIAL.write((const uint8_t *)&packet,sizeof(RS485Packet));
-            writeToStream(&RS_485_SERIAL,(const uint8_t *)&packet,sizeof(RS485Packet));
-    
-            // теперь ждём завершения передачи
-            waitTransmitComplete();
+  startTransmit(rs485JobFeedback,&(feedbackStats[feedbackModule]),true);
+}
+//-------------------------------------------------------------------------------------------------------------------------------------------------------
+void UniRS485Gate::feedbackModuleDone()
+{
+  // переходим к следующему адресу на шине, их у нас 16
+  feedbackModule++;
+  if(feedbackModule < 16)
+    return;
 
-            // начинаем принимать
-            ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-            // переключаемся на приём
-            enableReceive();
+  feedbackModule = -1; // цикл опроса закончен
+  
+  if(anyFeedbackReceived)
+  {
+     // получили хотя бы один фидбак - надо проинформировать менеджера, что мы закончили текущий цикл
+     FeedbackManager.WindowFeedbackDone();
+  }
+}
+//-------------------------------------------------------------------------------------------------------------------------------------------------------
+void UniRS485Gate::handleFeedbackAnswer()
+{
+  // теперь проверяем, нам ли пакет
+  if(!(packet.direction == RS485FromSlave && packet.type == RS485WindowsPositionPacket))
+  {
+    #ifdef RS485_DEBUG
+      DEBUG_LOGLN(F("Wrong packet type :("));
+    #endif
+    return;
+  }
 
-            // поскольку мы сразу же переключились на приём - можем дать поработать критичному ко времени коду
-            yield();
+  #ifdef RS485_DEBUG
+    DEBUG_LOGLN(F("Packet type ok"));
+  #endif
 
-            // и получаем наши байты
-            memset(&packet,0,sizeof(RS485Packet));
-            byte* writePtr = (byte*) &packet;
-            byte bytesReaded = 0; // кол-во прочитанных байт
-            
-            // запоминаем время начала чтения
-            unsigned long startReadingTime = micros();
-            // вычисляем таймаут как время для чтения десяти байт.
-            // в RS485_SPEED - у нас скорость в битах в секунду. Для чтения десяти байт надо вычитать 100 бит.
-            const unsigned long readTimeout  = (10000000ul/RS485_SPEED)*RS485_BYTES_TIMEOUT; // кол-во микросекунд, необходимое для вычитки десяти байт
-
-            // начинаем читать данные
-            while(1)
-            {
-              if( micros() - startReadingTime > readTimeout)
-              {
-                
-                #ifdef RS485_DEBUG
-                  DEBUG_LOG(F("Feedback module #"));
-                  DEBUG_LOG(String(i));
-                  DEBUG_LOGLN(F(" not answering!"));
-                #endif
-                
-                break;
-              } // if
-    
-              if(RS_485_SERIAL.available())
-              {
-                startReadingTime = micros(); // сбрасываем таймаут
-                *writePtr++ = (byte) RS_485_SERIAL.read();
-                bytesReaded++;
-              } // if available
+  anyFeedbackReceived = true; // получили фидбак по крайней мере от одного модуля
 
-              if(bytesReaded == sizeof(RS485Packet)) // прочитали весь пакет
-              {
-                #ifdef RS485_DEBUG
-                  DEBUG_LOGLN(F("Packet received from slave!"));
-                #endif
-                
-                break;
-              }
-          
-           } // while
+  // тут пришли данные, надо разбирать
+  WindowFeedbackPacket* wfPacket = (WindowFeedbackPacket*) &(packet.data);
+  int moduleSupportedWindows = wfPacket->windowsSupported;
+  // теперь разбираем, что там в пакете
+  byte* windowsStatus = wfPacket->windowsStatus;
 
-            // затем опять переключаемся на передачу
-            enableSend();
+  // проходим по всем поддерживаемым модулем окнам
+  byte currentByteNumber = 0;
+  int8_t currentBitNumber = 7;
+  
+  for(int k=0;k<moduleSupportedWindows;k++)
+  {
+    // на каждое окно у нас 10 бит информации
+    // в старших семи битах - информация о позиции
+    // в третьем бите - флаг наличия информации о позиции
+    // второй бит - сработал ли концевик закрытия
+    // первый бит - сработал ли концевик открытия
+    byte position = 0;
+    for(int z=0;z<7;z++)
+    {
+      byte b = bitRead(windowsStatus[currentByteNumber],currentBitNumber);
+      position |= b;
+      position <<= 1;
 
-        // теперь парсим пакет
-        if(bytesReaded == sizeof(RS485Packet))
-        {
-          // пакет получен полностью, парсим его
-          #ifdef RS485_DEBUG
-            DEBUG_LOGLN(F("Packet from feedback received, parse it..."));
-          #endif
-          
-          bool headOk = packet.header1 == 0xAB && packet.header2 == 0xBA;
-          bool tailOk = packet.tail1 == 0xDE && packet.tail2 == 0xAD;
-          
-          if(headOk && tailOk)
-          {
-            #ifdef RS485_DEBUG
-              DEBUG_LOGLN(F("Header and tail ok."));
-            #endif
-            
-            // вычисляем crc
-            byte crc = crc8((const byte*)&packet,sizeof(RS485Packet)-1);
-            if(crc == packet.crc8)
-            {
-              #ifdef RS485_DEBUG
-                DEBUG_LOGLN(F("Checksum ok."));
-              #endif
-              
-              // теперь проверяем, нам ли пакет
-              if(packet.direction == RS485FromSlave && packet.type == RS485WindowsPositionPacket)
-              {
-                #ifdef RS485_DEBUG
-                  DEBUG_LOGLN(F("Packet type ok"));
-                #endif
+      currentBitNumber--;
+      if(currentBitNumber < 0)
+      {
+        currentBitNumber = 7;
+        currentByteNumber++;
+      }
+    } // for
 
-                anyFeedbackReceived = true; // получили фидбак по крайней мере от одного модуля
+      #ifdef RS485_DEBUG
+        DEBUG_LOG(F("Position of window #"));
+        DEBUG_LOG(String(currentWindowNumber));
+        DEBUG_LOG(F(" is "));
+        DEBUG_LOGLN(String(position));
+      #endif
 
-                // тут пришли данные, надо разбирать
-                WindowFeedbackPacket* wfPacket = (WindowFeedbackPacket*) &(packet.data);
-                int moduleSupportedWindows = wfPacket->windowsSupported;
-                // теперь разбираем, что там в пакете
-                byte* windowsStatus = wfPacket->windowsStatus;
+      // теперь читаем бит - есть ли позиция
+      byte hasPosition = bitRead(windowsStatus[currentByteNumber],currentBitNumber);
+      currentBitNumber--;
+      if(currentBitNumber < 0)
+      {
+        currentBitNumber = 7;
+        currentByteNumber++;
+      }
 
-                // проходим по всем поддерживаемым модулем окнам
-                byte currentByteNumber = 0;
-                int8_t currentBitNumber = 7;
-                
-                for(int k=0;k<moduleSupportedWindows;k++)
-                {
-                  // на каждое окно у нас 10 бит информации
-                  // в старших семи битах - информация о позиции
-                  // в третьем бите - флаг наличия информации о позиции
-                  // второй бит - сработал ли концевик закрытия
-                  // первый бит - сработал ли концевик открытия
-                  byte position = 0;
-                  for(int z=0;z<7;z++)
-                  {
-                    byte b = bitRead(windowsStatus[currentByteNumber],currentBitNumber);
-                    position |= b;
-                    position <<= 1;
-
-                    currentBitNumber--;
-                    if(currentBitNumber < 0)
-                    {
-                      currentBitNumber = 7;
-                      currentByteNumber++;
-                    }
-                  } // for
-
-                    #ifdef RS485_DEBUG
-                      DEBUG_LOG(F("Position of window #"));
-                      DEBUG_LOG(String(currentWindowNumber));
-                      DEBUG_LOG(F(" is "));
-                      DEBUG_LOGLN(String(position));
-                    #endif
-
-                    // теперь читаем бит - есть ли позиция
-                    byte hasPosition = bitRead(windowsStatus[currentByteNumber],currentBitNumber);
-                    currentBitNumber--;
-                    if(currentBitNumber < 0)
-                    {
-                      currentBitNumber = 7;
-                      currentByteNumber++;
-                    }
-
-                    #ifdef RS485_DEBUG
-                      DEBUG_LOG(F("hasPosition of window #"));
-                      DEBUG_LOG(String(currentWindowNumber));
-                      DEBUG_LOG(F(" is "));
-                      DEBUG_LOGLN(String(hasPosition));
-                    #endif
-                                        
-                    // теперь читаем бит - сработал ли концевик закрытия
-                    byte isCloseSwitchTriggered = bitRead(windowsStatus[currentByteNumber],currentBitNumber);
-                    currentBitNumber--;
-                    if(currentBitNumber < 0)
-                    {
-                      currentBitNumber = 7;
-                      currentByteNumber++;
-                    }
-
-                    #ifdef RS485_DEBUG
-                      DEBUG_LOG(F("isCloseSensorTriggered of window #"));
-                      DEBUG_LOG(String(currentWindowNumber));
-                      DEBUG_LOG(F(" is "));
-                      DEBUG_LOGLN(String(isCloseSwitchTriggered));
-                    #endif
-
-                    // теперь читаем бит - сработал ли концевик открытия
-                    byte isOpenSwitchTriggered = bitRead(windowsStatus[currentByteNumber],currentBitNumber);
-                    currentBitNumber--;
-                    if(currentBitNumber < 0)
-                    {
-                      currentBitNumber = 7;
-                      currentByteNumber++;
-                    }
-
-                    #ifdef RS485_DEBUG
-                      DEBUG_LOG(F("isOpenSwitchTriggered of window #"));
-                      DEBUG_LOG(String(currentWindowNumber));
-                      DEBUG_LOG(F(" is "));
-                      DEBUG_LOGLN(String(isOpenSwitchTriggered));
-                    #endif
-
-                   // теперь просим менеджера сообщить окну информацию о позиции
-                   FeedbackManager.WindowFeedback(currentWindowNumber, isCloseSwitchTriggered, isOpenSwitchTriggered, hasPosition, position);
-
-                  currentWindowNumber++;
-                  if(currentWindowNumber >= SUPPORTED_WINDOWS) // всё, дошли до последнего окна
-                    break;
-                } // for
-
-
-              } // type ok
-              #ifdef RS485_DEBUG
-              else
-              {
-                DEBUG_LOGLN(F("Wrong packet type :("));
-              }
-              #endif
-            } // if(crc)
-            #ifdef RS485_DEBUG
-            else
-            {
-              DEBUG_LOGLN(F("Bad checksum :("));
-            }
-            #endif
-          }
-          #ifdef RS485_DEBUG
-          else
-          {
-            DEBUG_LOGLN(F("Head or tail of packet is invalid :("));
-          } // else
-          #endif
-        }
-        #ifdef RS485_DEBUG
-        else
-        {
-          DEBUG_LOGLN(F("Uncompleted feedback packet :("));
-        } // else
-        #endif
-            ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-           yield(); // даём поработать модулям 
-        } // for по каждому модулю
+      #ifdef RS485_DEBUG
+        DEBUG_LOG(F("hasPosition of window #"));
+        DEBUG_LOG(String(currentWindowNumber));
+        DEBUG_LOG(F(" is "));
+        DEBUG_LOGLN(String(hasPosition));
+      #endif
+                          
+      // теперь читаем бит - сработал ли концевик закрытия
+      byte isCloseSwitchTriggered = bitRead(windowsStatus[currentByteNumber],currentBitNumber);
+      currentBitNumber--;
+      if(currentBitNumber < 0)
+      {
+        currentBitNumber = 7;
+        currentByteNumber++;
+      }
 
-        if(anyFeedbackReceived)
-        {
-           // получили хотя бы один фидбак - надо проинформировать менеджера, что мы закончили текущий цикл
-           FeedbackManager.WindowFeedbackDone();
-        }
-    } // if можно проверять
-    
-  #endif // USE_FEEDBACK_MANAGER
-  
-  #ifdef USE_UNI_EXECUTION_MODULE
+      #ifdef RS485_DEBUG
+        DEBUG_LOG(F("isCloseSensorTriggered of window #"));
+        DEBUG_LOG(String(currentWindowNumber));
+        DEBUG_LOG(F(" is "));
+        DEBUG_LOGLN(String(isCloseSwitchTriggered));
+      #endif
 
-  // посылаем в шину данные для исполнительных модулей
-  
-    updateTimer += dt;
-    if(updateTimer > RS485_STATE_PUSH_FREQUENCY)
-    {
-      updateTimer = 0;
+      // теперь читаем бит - сработал ли концевик открытия
+      byte isOpenSwitchTriggered = bitRead(windowsStatus[currentByteNumber],currentBitNumber);
+      currentBitNumber--;
+      if(currentBitNumber < 0)
+      {
+        currentBitNumber = 7;
+        currentByteNumber++;
+      }
 
-      // тут посылаем слепок состояния контроллера
-       if(!controllerStateWasSentOnThisIteration)
-        sendControllerStatePacket();
+      #ifdef RS485_DEBUG
+        DEBUG_LOG(F("isOpenSwitchTriggered of window #"));
+        DEBUG_LOG(String(currentWindowNumber));
+        DEBUG_LOG(F(" is "));
+        DEBUG_LOGLN(String(isOpenSwitchTriggered));
+      #endif
 
-        
-    }
-  #endif // USE_UNI_EXECUTION_MODULE
+     // теперь просим менеджера сообщить окну информацию о позиции
+     FeedbackManager.WindowFeedback(currentWindowNumber, isCloseSwitchTriggered, isOpenSwitchTriggered, hasPosition, position);
 
-  #ifdef USE_UNIVERSAL_MODULES
+    currentWindowNumber++;
+    if(currentWindowNumber >= SUPPORTED_WINDOWS) // всё, дошли до последнего окна
+      break;
+  } // for
 
 
-   static byte _is_inited = false;
-   if(!_is_inited)
-   {
-      _is_inited = true;
+}
+//-------------------------------------------------------------------------------------------------------------------------------------------------------
+#endif // USE_FEEDBACK_MANAGER
+//-------------------------------------------------------------------------------------------------------------------------------------------------------
+#ifdef USE_UNIVERSAL_MODULES
+//-------------------------------------------------------------------------------------------------------------------------------------------------------
+void UniRS485Gate::requestSensor()
+{
+  // датчики, показания которых уже пришли вместе с другим датчиком их модуля, на этом круге пропускаем
+  for(size_t i=0;i<queue.size() && queue[currentQueuePos].batchUpdated;i++)
+  {
+    queue[currentQueuePos].batchUpdated = false;
+    sensorDone();
+  }
+  
+  RS485QueueItem* qi = &(queue[currentQueuePos]);
+
+  // мы не можем обновлять состояние датчика в дефолтные значения здесь, поскольку
+  // мы не знаем, откуда с него могут придти данные. В случае с работой через 1-Wire
+  // состояние автоматически обновляется, поскольку считается, что если модуль есть
+  // на линии - с него будут данные. У нас же ситуация обстоит по-другому:
+  // мы проходим все зарегистрированные универсальные датчики, и не можем
+  // делать вывод - висит ли модуль с датчиком на линии RS-485, или работает по радиоканалу,
+  // или - работает по 1-Wire. Поэтому мы не вправе делать никаких предположений и менять
+  // показания датчика на вид <нет данных>, поскольку очерёдность вызовов опроса
+  // универсальных модулей по разным шлюзам не определена. 
+  // поэтому мы сбрасываем состояния только тех датчиков, которые хотя бы однажды
+  // откликнулись по шине RS-495.
+
+  if(isInOnlineQueue(*qi) && qi->badReadingAttempts >= RS485_RESET_SENSOR_AFTER_N_BAD_READINGS)
+  {
+    byte sType = qi->sensorType;
+    byte sIndex = qi->sensorIndex;
+    // датчик был онлайн, сбрасываем его показания в "нет данных" перед опросом
+    UniDispatcher.AddUniSensor((UniSensorType)sType,sIndex);
+    qi->badReadingAttempts = 0;
+    qi->protocol = rs485ProtocolUnknown; // модуль пропал - когда появится, заново выясним, какой формат он понимает
+    qi->lost = true;
+
+              // проверяем тип датчика, которому надо выставить "нет данных"
+              switch(qi->sensorType)
+              {
+                case uniTemp:
+                {
+                  // температура
+                  Temperature t;
+                  // получаем состояния
+                  UniSensorState states;
+                  if(UniDispatcher.GetRegisteredStates((UniSensorType)sType,sIndex,states))
+                  {
+                    if(states.State1)
+                      states.State1->Update(&t);
+                  } // if
+                }
+                break;
+
+                case uniHumidity:
+                {
+                  // влажность
+                  Humidity h;
+                  // получаем состояния
+                  UniSensorState states;
+                  if(UniDispatcher.GetRegisteredStates((UniSensorType)sType,sIndex,states))
+                  {
+                    if(states.State1)
+                      states.State1->Update(&h);
+                                        
+                    if(states.State2)
+                      states.State2->Update(&h);
+                  } // if                        
+                }
+                break;
+
+                case uniLuminosity:
+                {
+                  // освещённость
+                  long lum = NO_LUMINOSITY_DATA;
+                  // получаем состояния
+                  UniSensorState states;
+                  if(UniDispatcher.GetRegisteredStates((UniSensorType)sType,sIndex,states))
+                  {
+                    if(states.State1)
+                      states.State1->Update(&lum);
+                  } // if                        
+                  
+                  
+                }
+                break;
+
+                case uniSoilMoisture: // влажность почвы
+                case uniPH: // показания pH
+                {
+                  
+                  Humidity h;
+                  // получаем состояния
+                  UniSensorState states;
+                  if(UniDispatcher.GetRegisteredStates((UniSensorType)sType,sIndex,states))
+                  {
+                    if(states.State1)
+                      states.State1->Update(&h);
+                  } // if                        
+                  
+                }
+                break;
+                
+              } // switch
+    
+  } // if in online queue
+
+  byte* dest;
+  if(qi->protocol == rs485ProtocolV1)
+  {
+    preparePacket(RS485SensorDataPacket); // это пакет - запрос на показания с датчиков
+    dest = packet.data;
+  }
+  else
+  {
+    prepareFrameV2(RS485SensorDataPacket,2); // в ответ на кадр модуль пришлёт показания всех своих датчиков
+    dest = frame.data;
+  }
+  
+  // в первом байте - тип датчика для опроса
+  *dest = qi->sensorType;
+  dest++;
+  // во втором байте - индекс датчика, зарегистрированный в системе
+  *dest = qi->sensorIndex;
+
+  #ifdef RS485_DEBUG
+    DEBUG_LOG(F("Request data for sensor type="));
+    DEBUG_LOG(String(qi->sensorType));
+    DEBUG_LOG(F(" and index="));
+    DEBUG_LOGLN(String(qi->sensorIndex));
+  #endif
+
+  startTransmit(rs485JobSensor,&(qi->stats),true);
+}
+//-------------------------------------------------------------------------------------------------------------------------------------------------------
+void UniRS485Gate::handleSensorAnswer()
+{
+  if(frameV2)
+  {
+    handleSensorFrameV2();
+    return;
+  }
+  
+  RS485QueueItem* qi = &(queue[currentQueuePos]);
+  
+  // теперь проверяем, нам ли пакет
+  if(!(packet.direction == RS485FromSlave && packet.type == RS485SensorDataPacket))
+  {
+    #ifdef RS485_DEBUG
+      DEBUG_LOGLN(F("Wrong packet type :("));
+    #endif
+    return;
+  }
+
+  #ifdef RS485_DEBUG
+    DEBUG_LOGLN(F("Packet type ok"));
+  #endif
+
+  const byte* readDataPtr = packet.data;
+  // проверяем - байт типа и байт индекса должны совпадать с посланными в шину
+  if(readDataPtr[0] == qi->sensorType && readDataPtr[1] == qi->sensorIndex)
+  {
+    applySensorData(qi,readDataPtr + 2);
+
+    // пакеты первой версии понимают все модули: вернувшийся модуль мог ответить так, хотя знает и вторую
+    if(qi->lost)
+      qi->protocol = rs485ProtocolUnknown;
+    qi->lost = false;
+  }
+  #ifdef RS485_DEBUG
+  else
+  {
+    DEBUG_LOGLN(F("Received data from unknown sensor :("));
+  }
+  #endif
+}
+//-------------------------------------------------------------------------------------------------------------------------------------------------------
+void UniRS485Gate::handleSensorFrameV2()
+{
+  RS485QueueItem* qi = &(queue[currentQueuePos]);
+
+  if(!(frame.direction == RS485FromSlave && frame.type == RS485SensorDataPacket))
+  {
+    #ifdef RS485_DEBUG
+      DEBUG_LOGLN(F("Wrong frame type :("));
+    #endif
+    return;
+  }
+
+  // модуль ответил кадром второй версии - дальше опрашиваем его только так
+  qi->protocol = rs485ProtocolV2;
+
+  // первой записью идёт запрошенный датчик, следом - остальные датчики модуля
+  const byte* readDataPtr = frame.data;
+  for(byte pos = 0; pos + RS485_V2_SENSOR_RECORD_SIZE <= frame.length; pos += RS485_V2_SENSOR_RECORD_SIZE, readDataPtr += RS485_V2_SENSOR_RECORD_SIZE)
+  {
+    RS485QueueItem* item = findQueueItem(readDataPtr[0],readDataPtr[1]);
+    if(!item)
+    {
+      #ifdef RS485_DEBUG
+        DEBUG_LOGLN(F("Received data from unknown sensor :("));
+      #endif
+      continue;
+    }
+
+    applySensorData(item,readDataPtr + 2);
+    item->protocol = rs485ProtocolV2;
+    item->lost = false;
+    
+    if(item != qi)
+      item->batchUpdated = true;
+  } // for
+}
+//-------------------------------------------------------------------------------------------------------------------------------------------------------
+void UniRS485Gate::applySensorData(RS485QueueItem* qi, const byte* readDataPtr)
+{
+  byte sType = qi->sensorType;
+  byte sIndex = qi->sensorIndex;
+  
+  #ifdef RS485_DEBUG
+    DEBUG_LOGLN(F("Reading sensor data..."));
+  #endif
+
+  // добавляем наш тип сенсора в систему, если этого ещё не сделано
+  UniDispatcher.AddUniSensor((UniSensorType)sType,sIndex);
+
+  // добавляем датчик в список онлайн-датчиков
+  if(!isInOnlineQueue(*qi))
+    sensorsOnlineQueue.push_back(*qi);
+
+  // сбрасываем кол-во неудачных попыток чтения
+  qi->badReadingAttempts = 0;
+
+  // проверяем тип датчика, с которого читали показания
+  switch(sType)
+  {
+    case uniTemp:
+    {
+      // температура
+      // получаем данные температуры
+      Temperature t;
+      t.Value = (int8_t) *readDataPtr++;
+      t.Fract = *readDataPtr;
+
+      // convert to Fahrenheit if needed
+      #ifdef MEASURE_TEMPERATURES_IN_FAHRENHEIT
+       t = Temperature::ConvertToFahrenheit(t);
+      #endif                              
+
+      #ifdef RS485_DEBUG
+        DEBUG_LOG(F("Temperature: "));
+        DEBUG_LOGLN(t);
+      #endif
+
+      // получаем состояния
+      UniSensorState states;
+      if(UniDispatcher.GetRegisteredStates((UniSensorType)sType,sIndex,states))
+      {
+        if(states.State1)
+        {
+          #ifdef RS485_DEBUG
+            DEBUG_LOGLN(F("Update data in controller..."));
+          #endif
+          
+          states.State1->Update(&t);
+        }
+      } // if
+    }
+    break;
+
+    case uniHumidity:
+    {
+      // влажность
+      Humidity h;
+      h.Value = (int8_t) *readDataPtr++;
+      h.Fract = *readDataPtr++;
+
+      // температура
+      Temperature t;
+      t.Value = (int8_t) *readDataPtr++;
+      t.Fract = *readDataPtr++;
+
+      // convert to Fahrenheit if needed
+      #ifdef MEASURE_TEMPERATURES_IN_FAHRENHEIT
+       t = Temperature::ConvertToFahrenheit(t);
+      #endif                              
+
+      #ifdef RS485_DEBUG
+        DEBUG_LOG(F("Humidity: "));
+        DEBUG_LOGLN(h);
+      #endif
+
+      // получаем состояния
+      UniSensorState states;
+      if(UniDispatcher.GetRegisteredStates((UniSensorType)sType,sIndex,states))
+      {
+          #ifdef RS485_DEBUG
+            DEBUG_LOGLN(F("Update data in controller..."));
+          #endif
+
+        if(states.State1)
+          states.State1->Update(&h);
+
+        if(states.State2)
+          states.State2->Update(&t);
+          
+      } // if                        
+    }
+    break;
+
+    case uniLuminosity:
+    {
+      // освещённость
+      long lum;
+      memcpy(&lum,readDataPtr,sizeof(long));
+
+      #ifdef RS485_DEBUG
+        DEBUG_LOG(F("Luminosity: "));
+        DEBUG_LOGLN(String(lum));
+      #endif
+
+      // получаем состояния
+      UniSensorState states;
+      if(UniDispatcher.GetRegisteredStates((UniSensorType)sType,sIndex,states))
+      {
+        if(states.State1)
+        {
+          #ifdef RS485_DEBUG
+            DEBUG_LOGLN(F("Update data in controller..."));
+          #endif
+          
+          states.State1->Update(&lum);
+        }
+      } // if                        
+      
+      
+    }
+    break;
+
+    case uniSoilMoisture: // влажность почвы
+    case uniPH:  // показания pH
+    {
+      
+      Humidity h;
+      h.Value = (int8_t) *readDataPtr++;
+      h.Fract = *readDataPtr;
+
+      #ifdef RS485_DEBUG
+        if(sType == uniSoilMoisture)
+          DEBUG_LOG(F("Soil moisture: "));
+        else
+          DEBUG_LOG(F("pH: "));
+          
+        DEBUG_LOGLN(h);
+      #endif
+
+      // получаем состояния
+      UniSensorState states;
+      if(UniDispatcher.GetRegisteredStates((UniSensorType)sType,sIndex,states))
+      {
+        if(states.State1)
+        {
+          #ifdef RS485_DEBUG
+            DEBUG_LOGLN(F("Update data in controller..."));
+          #endif
+          
+          states.State1->Update(&h);
+        }
+      } // if                        
+      
+    }
+    break;
+    
+  } // switch
+}
+//-------------------------------------------------------------------------------------------------------------------------------------------------------
+void UniRS485Gate::sensorDone()
+{
+  currentQueuePos++;
+  if(currentQueuePos >= queue.size()) // достигли конца очереди, начинаем сначала
+    currentQueuePos = 0;
+}
+//-------------------------------------------------------------------------------------------------------------------------------------------------------
+#endif // USE_UNIVERSAL_MODULES
+//-------------------------------------------------------------------------------------------------------------------------------------------------------
+void UniRS485Gate::finishJob(bool answered)
+{
+  // ответ получен (или не дождались его) - переходим к следующему модулю в очереди этого вида опроса
+  RS485Job job = currentJob;
+  currentJob = rs485JobNone;
+  currentStats = NULL;
+  gateState = rs485Idle;
+
+  switch(job)
+  {
+    #if defined(USE_FEEDBACK_MANAGER) && defined(USE_TEMP_SENSORS) && SUPPORTED_WINDOWS > 0
+    case rs485JobFeedback:
+      feedbackModuleDone();
+    break;
+    #endif
+
+    #ifdef USE_UNIVERSAL_MODULES
+    case rs485JobSensor:
+      if(!answered)
+      {
+        RS485QueueItem* qi = &(queue[currentQueuePos]);
+        qi->badReadingAttempts++; // поймали таймаут, увеличиваем кол-во неудачных попыток чтения
+        
+        if(qi->protocol == rs485ProtocolUnknown)
+          qi->protocol = rs485ProtocolV1; // на кадр второй версии модуль промолчал - опрашиваем по-старому
+      }
+      sensorDone();
+    break;
+    #endif
+
+    default:
+    break;
+  }
+
+  UNUSED(answered);
+}
+//-------------------------------------------------------------------------------------------------------------------------------------------------------
+void UniRS485Gate::onPacketReceived()
+{
+  // затем опять переключаемся на передачу
+  enableSend();
+
+  if(currentStats)
+  {
+    unsigned long latency = micros() - transmitDoneAt;
+    currentStats->LastLatency = latency > 0xFFFF ? 0xFFFF : latency;
+    if(currentStats->LastLatency > currentStats->MaxLatency)
+      currentStats->MaxLatency = currentStats->LastLatency;
+  }
+
+  #ifdef RS485_DEBUG
+    DEBUG_LOGLN(F("Packet received from slave!"));
+  #endif
+
+  if(!isPacketValid())
+  {
+    if(currentStats)
+      currentStats->CrcErrors++;
+      
+    finishJob(false);
+    return;
+  }
+
+  RS485Job job = currentJob;
+  
+  switch(job)
+  {
+    #ifdef USE_RS485_EXTERNAL_CONTROL_MODULE
+    case rs485JobControl:
+      currentJob = rs485JobNone;
+      gateState = rs485Idle;
+      handleControlAnswer(); // может сразу начать посылку квитанции
+      if(gateState == rs485Idle)
+        finishJob(true);
+    return;
+    #endif
+
+    #if defined(USE_FEEDBACK_MANAGER) && defined(USE_TEMP_SENSORS) && SUPPORTED_WINDOWS > 0
+    case rs485JobFeedback:
+      handleFeedbackAnswer();
+    break;
+    #endif
+
+    #ifdef USE_UNIVERSAL_MODULES
+    case rs485JobSensor:
+      handleSensorAnswer();
+    break;
+    #endif
+
+    default:
+    break;
+  }
+
+  finishJob(true);
+}
+//-------------------------------------------------------------------------------------------------------------------------------------------------------
+bool UniRS485Gate::startNextJob()
+{
+  // по кругу ищем вид опроса, которому пора работать, начиная со следующего за последним отработавшим -
+  // так ни модули управления, ни обратная связь, ни датчики не ждут, пока кто-то другой опросит всю шину
+  for(byte i=0;i<rs485JobsCount;i++)
+  {
+    byte job = nextJobToCheck;
+    nextJobToCheck++;
+    if(nextJobToCheck >= rs485JobsCount)
+      nextJobToCheck = rs485JobControl;
+
+    switch(job)
+    {
+      #ifdef USE_RS485_EXTERNAL_CONTROL_MODULE
+      case rs485JobControl:
+        if(controlDue)
+        {
+          controlDue = false;
+          requestControlModule();
+          return true;
+        }
+      break;
+      #endif
+
+      #ifdef USE_UNI_EXECUTION_MODULE
+      case rs485JobState:
+        if(stateDue)
+        {
+          stateDue = false;
+          sendControllerStatePacket();
+          return true;
+        }
+      break;
+      #endif
+
+      #if defined(USE_FEEDBACK_MANAGER) && defined(USE_TEMP_SENSORS) && SUPPORTED_WINDOWS > 0
+      case rs485JobFeedback:
+        if(feedbackModule >= 0)
+        {
+          requestFeedbackModule();
+          return true;
+        }
+      break;
+      #endif
+
+      #ifdef USE_UNIVERSAL_MODULES
+      case rs485JobSensor:
+        if(sensorDue && queue.size())
+        {
+          sensorDue = false;
+          requestSensor();
+          return true;
+        }
+      break;
+      #endif
+
+      default:
+      break;
+    } // switch
+  } // for
+
+  return false;
+}
+//-------------------------------------------------------------------------------------------------------------------------------------------------------
+void UniRS485Gate::updateTimers(uint16_t dt)
+{
+  #ifdef USE_RS485_EXTERNAL_CONTROL_MODULE
+    controlModuleTimer += dt;
+    if(controlModuleTimer > 2000)
+    {
+      // пора опрашивать модули управления
+      controlModuleTimer = 0;
+      controlDue = true;
+    }
+  #endif
+
+  #if defined(USE_FEEDBACK_MANAGER) && defined(USE_TEMP_SENSORS) && SUPPORTED_WINDOWS > 0
+    feedbackTimer += dt;
+    if(feedbackTimer > FEEDBACK_MANAGER_UPDATE_INTERVAL && feedbackModule < 0)
+    {
+      // пора собирать информацию по обратной связи, начинаем с отсыла состояния контроллера
+      feedbackTimer = 0;
+      feedbackModule = 0;
+      feedbackStatePending = true;
+      currentWindowNumber = 0;
+      anyFeedbackReceived = false;
+    }
+  #endif
+
+  #ifdef USE_UNI_EXECUTION_MODULE
+    // посылаем в шину данные для исполнительных модулей
+    updateTimer += dt;
+    if(updateTimer > RS485_STATE_PUSH_FREQUENCY)
+    {
+      updateTimer = 0;
+      stateDue = true;
+    }
+  #endif
+
+  #ifdef USE_UNIVERSAL_MODULES
+    if(!queueInited)
+    {
+      queueInited = true;
       // инициализируем очередь
        for(byte sensorType=uniTemp;sensorType<=uniPH;sensorType++)
        {
@@ -793,9 +1239,9 @@ void UniRS485Gate::Update(uint16_t dt)
           for(byte k=0;k<cnt;k++)
           {
             RS485QueueItem qi;
+            memset(&qi,0,sizeof(qi));
             qi.sensorType = sensorType;
             qi.sensorIndex = k;
-            qi.badReadingAttempts = 0;
             queue.push_back(qi);
           } // for
           
@@ -803,448 +1249,162 @@ void UniRS485Gate::Update(uint16_t dt)
     
        currentQueuePos = 0;
        sensorsTimer = 0;      
-    
-   } // if
-  
+    } // if
 
     sensorsTimer += dt;
     if(sensorsTimer > RS485_ONE_SENSOR_UPDATE_INTERVAL)
     {
+      // настало время опроса очередного датчика на шине
       sensorsTimer = 0;
+      sensorDue = true;
+    }
+  #endif // USE_UNIVERSAL_MODULES
 
-      // настало время опроса датчиков на шине
-      if(queue.size())
-      {
-        // есть очередь для опроса
-        RS485QueueItem* qi = &(queue[currentQueuePos]);
-        currentQueuePos++;
-
-        // мы не можем обновлять состояние датчика в дефолтные значения здесь, поскольку
-        // мы не знаем, откуда с него могут придти данные. В случае с работой через 1-Wire
-        // состояние автоматически обновляется, поскольку считается, что если модуль есть
-        // на линии - с него будут данные. У нас же ситуация обстоит по-другому:
-        // мы проходим все зарегистрированные универсальные датчики, и не можем
-        // делать вывод - висит ли модуль с датчиком на линии RS-485, или работает по радиоканалу,
-        // или - работает по 1-Wire. Поэтому мы не вправе делать никаких предположений и менять
-        // показания датчика на вид <нет данных>, поскольку очерёдность вызовов опроса
-        // универсальных модулей по разным шлюзам не определена. 
-        // поэтому мы сбрасываем состояния только тех датчиков, которые хотя бы однажды
-        // откликнулись по шине RS-495.
-
-        if(isInOnlineQueue(*qi) && qi->badReadingAttempts >= RS485_RESET_SENSOR_AFTER_N_BAD_READINGS)
-        {
-          byte sType = qi->sensorType;
-          byte sIndex = qi->sensorIndex;
-          // датчик был онлайн, сбрасываем его показания в "нет данных" перед опросом
-          UniDispatcher.AddUniSensor((UniSensorType)sType,sIndex);
-          qi->badReadingAttempts = 0;
-
-                    // проверяем тип датчика, которому надо выставить "нет данных"
-                    switch(qi->sensorType)
-                    {
-                      case uniTemp:
-                      {
-                        // температура
-                        Temperature t;
-                        // получаем состояния
-                        UniSensorState states;
-                        if(UniDispatcher.GetRegisteredStates((UniSensorType)sType,sIndex,states))
-                        {
-                          if(states.State1)
-                            states.State1->Update(&t);
-                        } // if
-                      }
-                      break;
-
-                      case uniHumidity:
-                      {
-                        // влажность
-                        Humidity h;
-                        // получаем состояния
-                        UniSensorState states;
-                        if(UniDispatcher.GetRegisteredStates((UniSensorType)sType,sIndex,states))
-                        {
-                          if(states.State1)
-                            states.State1->Update(&h);
-                                              
-                          if(states.State2)
-                            states.State2->Update(&h);
-                        } // if                        
-                      }
-                      break;
-
-                      case uniLuminosity:
-                      {
-                        // освещённость
-                        long lum = NO_LUMINOSITY_DATA;
-                        // получаем состояния
-                        UniSensorState states;
-                        if(UniDispatcher.GetRegisteredStates((UniSensorType)sType,sIndex,states))
-                        {
-                          if(states.State1)
-                            states.State1->Update(&lum);
-                        } // if                        
-                        
-                        
-                      }
-                      break;
-
-                      case uniSoilMoisture: // влажность почвы
-                      case uniPH: // показания pH
-                      {
-                        
-                        Humidity h;
-                        // получаем состояния
-                        UniSensorState states;
-                        if(UniDispatcher.GetRegisteredStates((UniSensorType)sType,sIndex,states))
-                        {
-                          if(states.State1)
-                            states.State1->Update(&h);
-                        } // if                        
-                        
-                      }
-                      break;
-                      
-                    } // switch
-          
-        } // if in online queue
-        
-        
-        if(currentQueuePos >= queue.size()) // достигли конца очереди, начинаем сначала
-          currentQueuePos = 0;
-
-
-        memset(&packet,0,sizeof(RS485Packet)); 
-        packet.header1 = 0xAB;
-        packet.header2 = 0xBA;
-        packet.tail1 = 0xDE;
-        packet.tail2 = 0xAD;
+  UNUSED(dt);
+}
+//-------------------------------------------------------------------------------------------------------------------------------------------------------
+void UniRS485Gate::Update(uint16_t dt)
+{
+  // шлюз не ждёт ответа модуля (а на MEGA - и окончания передачи, её ловит прерывание): каждый вызов только проверяет,
+  // что изменилось на шине, и, если шина свободна, начинает обмен со следующим модулем
+  updateTimers(dt);
 
-        packet.direction = RS485FromMaster; // направление - от нас ведомым
-        packet.type = RS485SensorDataPacket; // это пакет - запрос на показания с датчиков
+  // вычисляем таймаут как время для чтения десяти байт.
+  // в RS485_SPEED - у нас скорость в битах в секунду. Для чтения десяти байт надо вычитать 100 бит.
+  const unsigned long readTimeout  = (10000000ul/RS485_SPEED)*RS485_BYTES_TIMEOUT; // кол-во микросекунд, необходимое для вычитки десяти байт
+  
+  // пакет уходит за время передачи sizeof(RS485Packet) байт, если флаг окончания передачи так и не выставился - не висим на нём вечно
+  const unsigned long transmitTimeout = (10000000ul/RS485_SPEED)*(sizeof(RS485Packet)*2) + readTimeout;
 
-        byte* dest = packet.data;
-        // в первом байте - тип датчика для опроса
-        *dest = qi->sensorType;
-        dest++;
-        // во втором байте - индекс датчика, зарегистрированный в системе
-        *dest = qi->sensorIndex;
+  for(byte step=0;step<3;step++) // за один вызов - не больше пары переходов, чтобы не задерживать остальные модули
+  {
+    switch(gateState)
+    {
+      case rs485Idle:
+        if(!startNextJob()) // некого опрашивать
+          return;
+      break;
 
-        // считаем контрольную сумму
-        const byte* b = (const byte*) &packet;
-        packet.crc8 = crc8(b,sizeof(RS485Packet)-1);
+      case rs485Transmitting:
+      {
+        if(!expectAnswer)
+        {
+          if(!isTransmitComplete() && (micros() - transmitStartedAt) < transmitTimeout)
+            return; // пакет ещё уходит в шину
 
+          transmitDoneAt = micros();
+          finishJob(true);
+          break;
+        }
 
-        #ifdef RS485_DEBUG
+        if(!transmitDone)
+        {
+          if(!isTransmitComplete() && (micros() - transmitStartedAt) < transmitTimeout)
+            return; // пакет ещё уходит в шину
 
-        // отладочная информация
-        DEBUG_LOG(F("Request data for sensor type="));
-        DEBUG_LOG(String(qi->sensorType));
-        DEBUG_LOG(F(" and index="));
-        DEBUG_LOGLN(String(qi->sensorIndex));
+          // прерывание так и не пришло - переключаемся сами, не висим на нём вечно
+          noInterrupts();
+          onTransmitComplete();
+          interrupts();
+        }
 
-        #endif
+        // на приём шлюз переключился сразу по окончании передачи, ответ ждём от этого момента
+        bytesReaded = 0;
+        packetLength = frameV2 ? RS485_V2_LENGTH_BYTES : sizeof(RS485Packet); // длину кадра второй версии узнаем из его начала
+        lastByteAt = transmitDoneAt;
+        gateState = rs485Receiving;
+      }
+      break;
 
-        enableSend();
-        // пакет готов к отправке, отправляем его
-        //RS_485_SERIAL.write((const uint8_t *)&packet,sizeof(RS485Packet));
-        writeToStream(&RS_485_SERIAL,(const uint8_t *)&packet,sizeof(RS485Packet));
+      case rs485Receiving:
+      {
+        byte* writePtr = ((byte*) &packet) + bytesReaded;
+        bool anyReaded = false;
         
-        waitTransmitComplete(); // ждём окончания посыла
-        // теперь переключаемся на приём
-        enableReceive();
-
-        // поскольку мы сразу же переключились на приём - можем дать поработать критичному ко времени коду
-        yield();
-
-        // и получаем наши байты
-        memset(&packet,0,sizeof(RS485Packet));
-        byte* writePtr = (byte*) &packet;
-        byte bytesReaded = 0; // кол-во прочитанных байт
-        // запоминаем время начала чтения
-        unsigned long startReadingTime = micros();
-        // вычисляем таймаут как время для чтения десяти байт.
-        // в RS485_SPEED - у нас скорость в битах в секунду. Для чтения десяти байт надо вычитать 100 бит.
-        const unsigned long readTimeout  = (10000000ul/RS485_SPEED)*RS485_BYTES_TIMEOUT; // кол-во микросекунд, необходимое для вычитки десяти байт
-
-        // начинаем читать данные
-        while(1)
+        while(RS_485_SERIAL.available() && bytesReaded < packetLength)
         {
-          if( micros() - startReadingTime > readTimeout)
-          {
-
-            qi->badReadingAttempts++; // поймали таймаут, увеличиваем кол-во неудачных попыток чтения
-            
-            #ifdef RS485_DEBUG
-              DEBUG_LOGLN(F("TIMEOUT REACHED!!!"));
-            #endif
-            
-            break;
-          } // if
-
-          if(RS_485_SERIAL.available())
-          {
-            startReadingTime = micros(); // сбрасываем таймаут
-            *writePtr++ = (byte) RS_485_SERIAL.read();
-            bytesReaded++;
-          } // if available
+          *writePtr++ = (byte) RS_485_SERIAL.read();
+          bytesReaded++;
+          anyReaded = true;
 
-          if(bytesReaded == sizeof(RS485Packet)) // прочитали весь пакет
+          if(frameV2 && bytesReaded == RS485_V2_LENGTH_BYTES)
           {
-            #ifdef RS485_DEBUG
-              DEBUG_LOGLN(F("Packet received from slave!"));
-            #endif
-            
-            break;
+            // прочитали длину кадра, битую длину не даём вылезти за буфер - такой кадр не пройдёт проверку
+            byte payload = frame.length > RS485_V2_MAX_PAYLOAD ? RS485_V2_MAX_PAYLOAD : frame.length;
+            packetLength = payload + RS485_V2_OVERHEAD;
           }
-          
-        } // while
+        }
 
-        // затем опять переключаемся на передачу
-        enableSend();
+        if(bytesReaded == packetLength) // прочитали весь пакет
+        {
+          onPacketReceived();
+          break;
+        }
 
-        // теперь парсим пакет
-        if(bytesReaded == sizeof(RS485Packet))
+        if(anyReaded)
         {
-          // пакет получен полностью, парсим его
-          #ifdef RS485_DEBUG
-            DEBUG_LOGLN(F("Packet from slave received, parse it..."));
-          #endif
-          
-          bool headOk = packet.header1 == 0xAB && packet.header2 == 0xBA;
-          bool tailOk = packet.tail1 == 0xDE && packet.tail2 == 0xAD;
-          if(headOk && tailOk)
-          {
-            #ifdef RS485_DEBUG
-              DEBUG_LOGLN(F("Header and tail ok."));
-            #endif
-            
-            // вычисляем crc
-            byte crc = crc8((const byte*)&packet,sizeof(RS485Packet)-1);
-            if(crc == packet.crc8)
-            {
-              #ifdef RS485_DEBUG
-                DEBUG_LOGLN(F("Checksum ok."));
-              #endif
-              
-              // теперь проверяем, нам ли пакет
-              if(packet.direction == RS485FromSlave && packet.type == RS485SensorDataPacket)
-              {
-                #ifdef RS485_DEBUG
-                  DEBUG_LOGLN(F("Packet type ok"));
-                #endif
-
-                byte* readDataPtr = packet.data;
-                // проверяем - байт типа и байт индекса должны совпадать с посланными в шину
-                byte sType = *readDataPtr++;
-                byte sIndex = *readDataPtr++;
-                
-                if(sType == qi->sensorType && sIndex == qi->sensorIndex)
-                {
-                  #ifdef RS485_DEBUG
-                    DEBUG_LOGLN(F("Reading sensor data..."));
-                  #endif
-
-                  // добавляем наш тип сенсора в систему, если этого ещё не сделано
-                  UniDispatcher.AddUniSensor((UniSensorType)sType,sIndex);
-
-                  // добавляем датчик в список онлайн-датчиков
-                  if(!isInOnlineQueue(*qi))
-                    sensorsOnlineQueue.push_back(*qi);
-
-                  // сбрасываем кол-во неудачных попыток чтения
-                  qi->badReadingAttempts = 0;
-
-                    // проверяем тип датчика, с которого читали показания
-                    switch(sType)
-                    {
-                      case uniTemp:
-                      {
-                        // температура
-                        // получаем данные температуры
-                        Temperature t;
-                        t.Value = (int8_t) *readDataPtr++;
-                        t.Fract = *readDataPtr;
-
-                        // convert to Fahrenheit if needed
-                        #ifdef MEASURE_TEMPERATURES_IN_FAHRENHEIT
-                         t = Temperature::ConvertToFahrenheit(t);
-                        #endif                              
-
-                        #ifdef RS485_DEBUG
-                          DEBUG_LOG(F("Temperature: "));
-                          DEBUG_LOGLN(t);
-                        #endif
-
-                        // получаем состояния
-                        UniSensorState states;
-                        if(UniDispatcher.GetRegisteredStates((UniSensorType)sType,sIndex,states))
-                        {
-                          if(states.State1)
-                          {
-                            #ifdef RS485_DEBUG
-                              DEBUG_LOGLN(F("Update data in controller..."));
-                            #endif
-                            
-                            states.State1->Update(&t);
-                          }
-                        } // if
-                      }
-                      break;
-
-                      case uniHumidity:
-                      {
-                        // влажность
-                        Humidity h;
-                        h.Value = (int8_t) *readDataPtr++;
-                        h.Fract = *readDataPtr++;
-
-                        // температура
-                        Temperature t;
-                        t.Value = (int8_t) *readDataPtr++;
-                        t.Fract = *readDataPtr++;
-
-                        // convert to Fahrenheit if needed
-                        #ifdef MEASURE_TEMPERATURES_IN_FAHRENHEIT
-                         t = Temperature::ConvertToFahrenheit(t);
-                        #endif                              
-
-                        #ifdef RS485_DEBUG
-                          DEBUG_LOG(F("Humidity: "));
-                          DEBUG_LOGLN(h);
-                        #endif
-
-                        // получаем состояния
-                        UniSensorState states;
-                        if(UniDispatcher.GetRegisteredStates((UniSensorType)sType,sIndex,states))
-                        {
-                            #ifdef RS485_DEBUG
-                              DEBUG_LOGLN(F("Update data in controller..."));
-                            #endif
-
-                          if(states.State1)
-                            states.State1->Update(&h);
-
-                          if(states.State2)
-                            states.State2->Update(&t);
-                            
-                        } // if                        
-                      }
-                      break;
-
-                      case uniLuminosity:
-                      {
-                        // освещённость
-                        long lum;
-                        memcpy(&lum,readDataPtr,sizeof(long));
-
-                        #ifdef RS485_DEBUG
-                          DEBUG_LOG(F("Luminosity: "));
-                          DEBUG_LOGLN(String(lum));
-                        #endif
-
-                        // получаем состояния
-                        UniSensorState states;
-                        if(UniDispatcher.GetRegisteredStates((UniSensorType)sType,sIndex,states))
-                        {
-                          if(states.State1)
-                          {
-                            #ifdef RS485_DEBUG
-                              DEBUG_LOGLN(F("Update data in controller..."));
-                            #endif
-                            
-                            states.State1->Update(&lum);
-                          }
-                        } // if                        
-                        
-                        
-                      }
-                      break;
-
-                      case uniSoilMoisture: // влажность почвы
-                      case uniPH:  // показания pH
-                      {
-                        
-                        Humidity h;
-                        h.Value = (int8_t) *readDataPtr++;
-                        h.Fract = *readDataPtr;
-
-                        #ifdef RS485_DEBUG
-                          if(sType == uniSoilMoisture)
-                            DEBUG_LOG(F("Soil moisture: "));
-                          else
-                            DEBUG_LOG(F("pH: "));
-                            
-                          DEBUG_LOGLN(h);
-                        #endif
-
-                        // получаем состояния
-                        UniSensorState states;
-                        if(UniDispatcher.GetRegisteredStates((UniSensorType)sType,sIndex,states))
-                        {
-                          if(states.State1)
-                          {
-                            #ifdef RS485_DEBUG
-                              DEBUG_LOGLN(F("Update data in controller..."));
-                            #endif
-                            
-                            states.State1->Update(&h);
-                          }
-                        } // if                        
-                        
-                      }
-                      break;
-                      
-                    } // switch
-                }
-                #ifdef RS485_DEBUG
-                else
-                {
-                  DEBUG_LOGLN(F("Received data from unknown sensor :("));
-                }
-                #endif
-              }
-              #ifdef RS485_DEBUG
-              else
-              {
-                DEBUG_LOGLN(F("Wrong packet type :("));
-              }
-              #endif
-            }
-            #ifdef RS485_DEBUG
-            else
-            {
-              DEBUG_LOGLN(F("Bad checksum :("));
-            }
-            #endif
-          }
-          #ifdef RS485_DEBUG
-          else
-          {
-            DEBUG_LOGLN(F("Head or tail of packet is invalid :("));
-          } // else
-          #endif
+          lastByteAt = micros(); // сбрасываем таймаут
+          return;
         }
+
+        if(micros() - lastByteAt <= readTimeout)
+          return; // ждём ответа дальше
+
+        // модуль не ответил или ответил не полностью
         #ifdef RS485_DEBUG
-        else
-        {
-          DEBUG_LOGLN(F("Received uncompleted packet :("));
-        } // else
+          DEBUG_LOGLN(F("TIMEOUT REACHED!!!"));
         #endif
+
+        enableSend();
+        if(currentStats)
+          currentStats->Timeouts++;
           
-        
-      } // if(queue.size())
-      #ifdef RS485_DEBUG
-      else
-      {
-        DEBUG_LOGLN(F("No queue size :("));
+        finishJob(false);
       }
-      #endif
-        
-      
-    } // if(sensorsTimer > _upd_interval)
+      break;
+    } // switch
+  } // for
+}
+//-------------------------------------------------------------------------------------------------------------------------------------------------------
+static void printRS485Stats(Print* p, const __FlashStringHelper* kind, byte idx, const RS485SlaveStats& st)
+{
+  if(!st.Requests) // модуль не опрашивался
+    return;
     
-  #endif // USE_UNIVERSAL_MODULES
+  p->print(PARAM_DELIMITER);
+  p->print(kind);
+  p->print(idx);
+  p->print(PARAM_DELIMITER);
+  p->print(st.Requests);
+  p->print(PARAM_DELIMITER);
+  p->print(st.Timeouts);
+  p->print(PARAM_DELIMITER);
+  p->print(st.CrcErrors);
+  p->print(PARAM_DELIMITER);
+  p->print(st.LastLatency);
+  p->print(PARAM_DELIMITER);
+  p->print(st.MaxLatency);
+}
+//-------------------------------------------------------------------------------------------------------------------------------------------------------
+void UniRS485Gate::PrintStats(Print* p)
+{
+  // по каждому опрошенному модулю: вид и номер (C - модуль управления, F - обратная связь, S - датчик, номер в очереди опроса),
+  // кол-во запросов, таймаутов, битых пакетов, последняя и максимальная задержка ответа в микросекундах
+  #ifdef USE_RS485_EXTERNAL_CONTROL_MODULE
+    printRS485Stats(p,F("C"),0,controlStats);
+  #endif
+
+  #if defined(USE_FEEDBACK_MANAGER) && defined(USE_TEMP_SENSORS) && SUPPORTED_WINDOWS > 0
+    for(byte i=0;i<16;i++)
+      printRS485Stats(p,F("F"),i,feedbackStats[i]);
+  #endif
+
+  #ifdef USE_UNIVERSAL_MODULES
+    for(size_t i=0;i<queue.size();i++)
+      printRS485Stats(p,F("S"),i,queue[i].stats);
+  #endif
+
+  UNUSED(p);
 }
 //-------------------------------------------------------------------------------------------------------------------------------------------------------
 UniRS485Gate RS485;
@@ -2269,12 +2429,14 @@ void UniRegDispatcher::SaveState()
 {
   //Тут сохранение текущего состояния в EEPROM
   uint16_t addr = UNI_SENSOR_INDICIES_EEPROM_ADDR;  
+  MemBeginWrite();
   MemWrite(addr++,currentTemperatureCount);
   MemWrite(addr++,currentHumidityCount);
   MemWrite(addr++,currentLuminosityCount);
   MemWrite(addr++,currentSoilMoistureCount);
   MemWrite(addr++,rfChannel);
   MemWrite(addr++,currentPHCount);
+  MemCommit();
 }
 //-------------------------------------------------------------------------------------------------------------------------------------------------------
 bool UniRegDispatcher::GetRegisteredStates(UniSensorType type, uint8_t sensorIndex, UniSensorState& resultStates)
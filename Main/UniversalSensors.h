@@ -380,6 +380,48 @@ typedef struct
   
 } RS485Packet; // пакет, гоняющийся по RS-485 туда/сюда (30 байт)
 //----------------------------------------------------------------------------------------------------------------
+/*
+ Кадр второй версии - переменной длины, в одном кадре может быть несколько записей:
+
+   0xAC - первый байт заголовка
+   0xCA - второй байт заголовка
+   длина - кол-во байт записей
+   направление и тип - как в пакете первой версии
+   записи
+   CRC - контрольная сумма всего, что до неё
+
+ Для модуля с датчиками запрос содержит тип и индекс одного датчика, а в ответ модуль шлёт записи
+ (тип, индекс, 4 байта показаний) по всем своим датчикам, первой - запрошенный. Так модуль с тремя
+ датчиками отдаёт показания за один обмен, вместо трёх. Модуль, не знающий второй версии, кадр
+ не поймёт и промолчит - тогда шлюз опрашивает его пакетами первой версии.
+*/
+//----------------------------------------------------------------------------------------------------------------
+#define RS485_V2_HEADER1 0xAC
+#define RS485_V2_HEADER2 0xCA
+#define RS485_V2_OVERHEAD 6 // заголовок, длина, направление, тип и CRC
+#define RS485_V2_LENGTH_BYTES 3 // сколько байт кадра надо прочитать, чтобы узнать его длину
+#define RS485_V2_MAX_PAYLOAD (sizeof(RS485Packet) - RS485_V2_OVERHEAD) // кадр не длиннее пакета первой версии, принимаем в тот же буфер
+#define RS485_V2_SENSOR_RECORD_SIZE 6 // запись с показаниями: тип датчика, индекс, 4 байта показаний
+//----------------------------------------------------------------------------------------------------------------
+typedef struct
+{
+  byte header1;
+  byte header2;
+  byte length; // кол-во байт записей в data
+  byte direction;
+  byte type;
+  byte data[sizeof(RS485Packet) - RS485_V2_OVERHEAD + 1]; // записи, сразу за ними - CRC
+  
+} RS485FrameV2; // кадр второй версии
+//----------------------------------------------------------------------------------------------------------------
+typedef enum
+{
+  rs485ProtocolUnknown, // ещё не знаем, пробуем вторую версию
+  rs485ProtocolV1, // модуль понимает только пакеты первой версии
+  rs485ProtocolV2 // модуль отвечает кадрами второй версии
+  
+} RS485Protocol;
+//----------------------------------------------------------------------------------------------------------------
 typedef struct
 {
   byte moduleNumber; // номер модуля, от 1 до 4-х
@@ -424,13 +466,47 @@ typedef struct
 } CommandsToExecutePacket; // пакет с командами на выполнение
 //----------------------------------------------------------------------------------------------------------------
 typedef struct
+{
+  uint16_t Requests; // сколько раз опрашивали модуль
+  uint16_t Timeouts; // сколько раз модуль не ответил или ответил не полностью
+  uint16_t CrcErrors; // сколько раз пришёл битый пакет
+  uint16_t LastLatency; // задержка последнего ответа, микросекунд (от конца запроса до конца ответа)
+  uint16_t MaxLatency; // максимальная задержка ответа, микросекунд
+  
+} RS485SlaveStats; // статистика обмена с одним модулем на шине RS-485
+//----------------------------------------------------------------------------------------------------------------
+typedef struct
 {
   byte sensorType; // тип датчика
   byte sensorIndex; // зарегистрированный в системе индекс
   byte badReadingAttempts; // кол-во неудачных чтений с датчика
+  byte protocol : 2; // RS485Protocol, каким форматом опрашиваем модуль датчика
+  byte batchUpdated : 1; // показания пришли в кадре другого датчика этого же модуля, на этом круге не опрашиваем
+  byte lost : 1; // модуль пропадал с шины - ответит пакетом первой версии, ещё раз попробуем кадр второй
+  RS485SlaveStats stats; // статистика обмена с модулем датчика
   
 } RS485QueueItem; // запись в очереди на чтение показаний из шины
 //----------------------------------------------------------------------------------------------------------------
+typedef enum
+{
+  rs485Idle, // шина свободна
+  rs485Transmitting, // пакет уходит в шину
+  rs485Receiving // ждём ответа модуля
+  
+} RS485GateState;
+//----------------------------------------------------------------------------------------------------------------
+typedef enum
+{
+  rs485JobNone,
+  rs485JobControl, // опрос модулей управления
+  rs485JobState, // отсыл состояния контроллера исполнительным модулям
+  rs485JobFeedback, // опрос модулей обратной связи
+  rs485JobSensor, // опрос датчиков универсальных модулей
+
+  rs485JobsCount
+  
+} RS485Job; // виды обмена по шине, опрашиваются по кругу
+//----------------------------------------------------------------------------------------------------------------
 typedef Vector<RS485QueueItem> RS485Queue; // очередь к опросу
 //----------------------------------------------------------------------------------------------------------------
 class UniRS485Gate // класс для работы универсальных модулей через RS-485
@@ -440,19 +516,71 @@ class UniRS485Gate // класс для работы универсальных
     void Setup();
     void Update(uint16_t dt);
 
+    void PrintStats(Print* p); // пишет статистику обмена с модулями, по каждому - через PARAM_DELIMITER
+    void onTransmitComplete(); // пакет ушёл из UART (на MEGA - из прерывания): сразу переключаемся на приём
+
   private:
+
+    union
+    {
+      RS485Packet packet; // пакет, который отправляем или принимаем
+      RS485FrameV2 frame; // он же - в виде кадра второй версии
+    };
+    bool frameV2; // обмен идёт кадрами второй версии
+    byte packetLength; // длина отправляемого или ожидаемого пакета
+    RS485GateState gateState;
+    RS485Job currentJob; // какой обмен идёт на шине
+    RS485SlaveStats* currentStats; // статистика модуля, с которым идёт обмен
+    bool expectAnswer; // ждём ли ответа на отправленный пакет
+    byte bytesReaded; // сколько байт ответа уже прочитано
+    byte nextJobToCheck; // с какого вида обмена начинать поиск следующего
+    unsigned long transmitStartedAt;
+    volatile unsigned long transmitDoneAt;
+    volatile bool transmitDone; // выставляется в onTransmitComplete
+    unsigned long lastByteAt;
   
 #ifdef USE_UNI_EXECUTION_MODULE
     unsigned long updateTimer;
+    bool stateDue;
 #endif    
 
+#ifdef USE_RS485_EXTERNAL_CONTROL_MODULE
+    uint16_t controlModuleTimer;
+    bool controlDue;
+    RS485SlaveStats controlStats;
+    
+    void requestControlModule();
+    void handleControlAnswer();
+#endif
+
+#if defined(USE_FEEDBACK_MANAGER) && defined(USE_TEMP_SENSORS) && SUPPORTED_WINDOWS > 0
+    uint16_t feedbackTimer;
+    int8_t feedbackModule; // какой модуль обратной связи опрашиваем, -1 - цикл опроса не идёт
+    bool feedbackStatePending; // перед опросом надо послать модулям состояние контроллера
+    bool anyFeedbackReceived;
+    byte currentWindowNumber; // с каким окном сейчас работаем
+    RS485SlaveStats feedbackStats[16];
+
+    void requestFeedbackModule();
+    void handleFeedbackAnswer();
+    void feedbackModuleDone();
+#endif
+
     void sendControllerStatePacket();
 
-    void waitTransmitComplete();
+    bool isTransmitComplete();
     void writeToStream(Stream* s, const uint8_t* buffer, size_t len);
     void enableSend();
     void enableReceive();
-    byte crc8(const byte *addr, byte len);
+
+    void preparePacket(byte type);
+    void prepareFrameV2(byte type, byte length);
+    void startTransmit(RS485Job job, RS485SlaveStats* stats, bool waitAnswer);
+    bool isPacketValid();
+    void onPacketReceived();
+    void finishJob(bool answered);
+    bool startNextJob();
+    void updateTimers(uint16_t dt);
 
     void executeCommands(const RS485Packet& packet);
 
@@ -463,6 +591,15 @@ class UniRS485Gate // класс для работы универсальных
     RS485Queue queue;
     byte currentQueuePos;
     unsigned long sensorsTimer;
+    bool sensorDue;
+    bool queueInited;
+
+    void requestSensor();
+    void handleSensorAnswer();
+    void handleSensorFrameV2();
+    void applySensorData(RS485QueueItem* qi, const byte* readDataPtr);
+    RS485QueueItem* findQueueItem(byte sType, byte sIndex);
+    void sensorDone();
   #endif  
     
 };
@@ -2,22 +2,37 @@
 #include "ModuleController.h"
 #include "Globals.h"
 #include "Memory.h"
+#include "InterruptEvents.h"
 //--------------------------------------------------------------------------------------------------------------------------------------
 #if WATERFLOW_SENSORS_COUNT > 0
-volatile unsigned int pin2FlowPulses; // зафиксированные срабатывания датчика Холла на пине 2
+// Импульсы датчиков передаются из прерывания в loop событиями ieWaterflowPulses. Если очередь событий заполнена
+// (loop надолго занят), импульсы копятся в прерывании и уходят со следующим событием, поэтому не теряются.
+unsigned int flowPulses[WATERFLOW_SENSORS_COUNT]; // импульсы, полученные loop с последнего опроса датчиков
+//--------------------------------------------------------------------------------------------------------------------------------------
+void waterflowPulsesHandler(const InterruptEvent& e) // вызывается из loop при разборе событий прерываний
+{
+  if(e.Source < WATERFLOW_SENSORS_COUNT)
+    flowPulses[e.Source] += e.Value;
+}
+//--------------------------------------------------------------------------------------------------------------------------------------
+unsigned int pin2PendingPulses; // импульсы на пине 2, ещё не отправленные событием (трогает только прерывание)
 int pin2Interrupt;
 void pin2FlowFunc() //  регистрируем срабатывания датчика Холла на пине 2
 {
-   pin2FlowPulses++;
+   pin2PendingPulses++;
+   if(InterruptEvents.post(ieWaterflowPulses,0,pin2PendingPulses))
+    pin2PendingPulses = 0;
 }
 #endif
 //--------------------------------------------------------------------------------------------------------------------------------------
 #if WATERFLOW_SENSORS_COUNT > 1
-volatile unsigned int pin3FlowPulses; // зафиксированные срабатывания датчика Холла на пине 3
+unsigned int pin3PendingPulses; // импульсы на пине 3, ещё не отправленные событием (трогает только прерывание)
 int pin3Interrupt;
 void pin3FlowFunc() //  регистрируем срабатывания датчика Холла на пине 3
 {
-   pin3FlowPulses++;
+   pin3PendingPulses++;
+   if(InterruptEvents.post(ieWaterflowPulses,1,pin3PendingPulses))
+    pin3PendingPulses = 0;
 }
 #endif
 //--------------------------------------------------------------------------------------------------------------------------------------
@@ -85,9 +100,12 @@ void WaterflowModule::Setup()
 
   // регистрируем датчики
   #if WATERFLOW_SENSORS_COUNT > 0
+  memset(flowPulses,0,sizeof(flowPulses));
+  InterruptEvents.setHandler(ieWaterflowPulses,waterflowPulsesHandler);
+  
   // первый
   WORK_STATUS.PinMode(FIRST_WATERFLOW_PIN,INPUT,false);
-  pin2FlowPulses = 0;
+  pin2PendingPulses = 0;
   pin2Interrupt = digitalPinToInterrupt(FIRST_WATERFLOW_PIN);
   State.AddState(StateWaterFlowInstant,0);
   State.AddState(StateWaterFlowIncremental,0);
@@ -99,7 +117,7 @@ void WaterflowModule::Setup()
   #if WATERFLOW_SENSORS_COUNT > 1
   // второй
   WORK_STATUS.PinMode(SECOND_WATERFLOW_PIN,INPUT,false);
-  pin3FlowPulses = 0;
+  pin3PendingPulses = 0;
   pin3Interrupt = digitalPinToInterrupt(SECOND_WATERFLOW_PIN);
   State.AddState(StateWaterFlowInstant,1);
   State.AddState(StateWaterFlowIncremental,1);
@@ -136,10 +154,12 @@ void WaterflowModule::UpdateFlow(WaterflowStruct* wf,unsigned int delta, unsigne
         unsigned long toWrite = wf->totalLitres;
           
         const byte* readAddr = (const byte*) &toWrite;
+        MemBeginWrite();
         MemWrite(addr++,*readAddr++);
         MemWrite(addr++,*readAddr++);
         MemWrite(addr++,*readAddr++);
         MemWrite(addr++,*readAddr);
+        MemCommit();
 
     }
   
@@ -161,7 +181,8 @@ void WaterflowModule::Update(uint16_t dt)
     #if WATERFLOW_SENSORS_COUNT > 0
     
     // первый датчик
-    unsigned int pin2CurPulses = pin2FlowPulses;
+    unsigned int pin2CurPulses = flowPulses[0];
+    flowPulses[0] = 0;
 
     UpdateFlow(&pin2Flow,delta,pin2CurPulses,0); // обновляем состояние, при необходимости - пишем его в EEPROM
 
@@ -169,17 +190,14 @@ void WaterflowModule::Update(uint16_t dt)
     State.UpdateState(StateWaterFlowInstant,0,(void*) &(pin2Flow.flowMilliLitres));
     State.UpdateState(StateWaterFlowIncremental,0,(void*) &(pin2Flow.totalLitres));
 
-    detachInterrupt(pin2Interrupt); // запрещаем прерывание, чтобы сохранить разницу возможных накопленных тиков, пока мы вычисляли значение
-    pin2FlowPulses -= pin2CurPulses;
-    attachInterrupt(pin2Interrupt, pin2FlowFunc, FALLING); 
-
 
     #endif
 
     #if WATERFLOW_SENSORS_COUNT > 1
     
     // второй датчик
-    unsigned int pin3CurPulses = pin3FlowPulses;
+    unsigned int pin3CurPulses = flowPulses[1];
+    flowPulses[1] = 0;
 
     UpdateFlow(&pin3Flow,delta,pin3CurPulses,sizeof(unsigned long)); // обновляем состояние, при необходимости - пишем его в EEPROM
 
@@ -187,10 +205,6 @@ void WaterflowModule::Update(uint16_t dt)
     State.UpdateState(StateWaterFlowInstant,1,(void*) &(pin3Flow.flowMilliLitres));
     State.UpdateState(StateWaterFlowIncremental,1,(void*) &(pin3Flow.totalLitres));
 
-    detachInterrupt(pin3Interrupt); // запрещаем прерывание, чтобы сохранить разницу возможных накопленных тиков, пока мы вычисляли значение
-    pin3FlowPulses -= pin3CurPulses;
-    attachInterrupt(pin3Interrupt, pin3FlowFunc, FALLING); 
-
 
     #endif
     
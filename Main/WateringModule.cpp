@@ -381,6 +381,8 @@ void WateringChannel::DoSaveState(byte addressOffset,unsigned long wateringTimer
      //Тут сохранение в EEPROM статуса, что мы на сегодня уже полили сколько-то времени на канале
     uint16_t wrAddr = WATERING_STATUS_EEPROM_ADDR + addressOffset*5; // адрес записи
     
+    MemBeginWrite();
+    
     // сохраняем в EEPROM день недели, для которого запомнили значение таймера
     MemWrite(wrAddr++,today);
     
@@ -388,6 +390,8 @@ void WateringChannel::DoSaveState(byte addressOffset,unsigned long wateringTimer
     byte* readAddr = (byte*) &timeToWatering;
     for(int i=0;i<4;i++)
       MemWrite(wrAddr++,*readAddr++);
+
+    MemCommit();
     
  #else
     WTR_LOG(F("[WTR] - NO state for channel - no realtime clock!\r\n"));
@@ -661,8 +665,10 @@ void WateringModule::ResetChannelsState()
   uint16_t wrAddr = WATERING_STATUS_EEPROM_ADDR;
   uint8_t bytes_to_write = 5 + WATER_RELAYS_COUNT*5;
   
+  MemBeginWrite();
   for(uint8_t i=0;i<bytes_to_write;i++)
     MemWrite(wrAddr++,0); // для каждого канала по отдельности  
+  MemCommit();
 }
 //-----------------------------------------------------------------------------------------------------------------------------------------------------------------------------------
 void WateringModule::TurnChannelsOff() // выключает все каналы
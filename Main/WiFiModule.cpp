@@ -359,40 +359,40 @@ void WiFiModule::ProcessUnknownClientQuery(CoreTransportClient& client, uint8_t*
       return;
    }
     
-   String ctGetPrefix = F("CTGET=");
-   String ctSetPrefix = F("CTSET=");
+   // дописываем завершающий ноль, чтобы можно было разобрать команду прямо в приёмном буфере, без копирования
+   externalClientData.push_back('\0');
 
-   const char* isGetFound = (const char*) MemFind(externalClientData.pData(),externalClientData.size(),ctGetPrefix.c_str(),ctGetPrefix.length());
-   const char* isSetFound = (const char*) MemFind(externalClientData.pData(),externalClientData.size(),ctSetPrefix.c_str(),ctSetPrefix.length());
+   char* buffStart = (char*) externalClientData.pData();
+   char* endOfData = buffStart + externalClientData.size() - 1;
+   
+   size_t dataLen = externalClientData.size() - 1;
+   
+   char* readPtr = (char*) MemFind(buffStart,dataLen,"CTGET=",6);
+   if(!readPtr)
+    readPtr = (char*) MemFind(buffStart,dataLen,"CTSET=",6);
 
-   if(isGetFound || isSetFound)
+   if(readPtr)
    {
-      const char* readPtr = isGetFound ? isGetFound : isSetFound;
-      const char* endOfData = (const char*) (externalClientData.pData() + externalClientData.size());
-
-      String command;
-      while(readPtr < endOfData)
+      char* endOfLine = readPtr;
+      while(endOfLine < endOfData)
       {
-        if(*readPtr == '\r' || *readPtr == '\n')
+        if(*endOfLine == '\r' || *endOfLine == '\n')
           break;
 
-        command += *readPtr;
-        readPtr++;
+        endOfLine++;
       } // while
-
-      // всё, нам больше не нужны данные с внешнего клиента
-      externalClientData.clear();
+      *endOfLine = '\0';
 
       #ifdef WIFI_DEBUG
         DEBUG_LOG(F("ESP: incoming command are: "));
-        DEBUG_LOGLN(command);
+        DEBUG_LOGLN(readPtr);
       #endif
 
       // теперь выполняем команду
       CommandExecuteResult fakeStream;
       CommandParser cParser;
       Command cmd;
-      if(cParser.ParseCommand(command, cmd))
+      if(cParser.ParseCommand(readPtr, cmd))
       {
               
         cmd.SetIncomingStream(&fakeStream); 
@@ -403,7 +403,7 @@ void WiFiModule::ProcessUnknownClientQuery(CoreTransportClient& client, uint8_t*
       
       } // if(cParser->ParseCommand(command, cmd))
     
-   } // if(isGetFound || isSetFound)
+   } // if(readPtr)
    
    // просто очищаем буфер, он нам не нужен
    externalClientData.clear();
@@ -96,7 +96,7 @@ void ZeroStreamListener::Update(uint16_t dt)
 
 }
 //-------------------------------------------------------------------------------------------------------------------------------------------------------
-void ZeroStreamListener::PrintSensorsValues(uint8_t totalCount,ModuleStates wantedState,AbstractModule* module, Stream* outStream)
+void ZeroStreamListener::PrintSensorsValues(uint8_t totalCount,ModuleStates wantedState,AbstractModule* module, Print* outStream)
 {
   if(!totalCount) // нечего писать
     return;
@@ -242,18 +242,44 @@ bool  ZeroStreamListener::ExecCommand(const Command& command, bool wantAnswer)
             #endif
             
         }
+        #ifdef USE_RS485_GATE
+        else if(t == F("RS485")) // статистика обмена с модулями на шине RS-485, CTGET=0|RS485
+        {
+          if(wantAnswer)
+          {
+            // модулей на шине может быть много - пишем ответ прямо в поток
+            canPublish = false;
+            PublishSingleton.Flags.Status = true;
+            PublishSingleton.Flags.AddModuleIDToAnswer = false;
+            Print* pStream = MainController->BeginPublish(this,command);
+            if(pStream)
+            {
+              pStream->print(t);
+              RS485.PrintStats(pStream);
+            }
+            MainController->EndPublish();
+          }
+        }
+        #endif // USE_RS485_GATE
         else if(t == F("PSTATE")) // информация о состоянии пинов
         {
-           PublishSingleton.Flags.Status = true;
-           PublishSingleton = "";
-           PublishSingleton.Flags.AddModuleIDToAnswer = false;
-
-           ControllerState st = WORK_STATUS.GetState();
-           for(size_t i=0;i<sizeof(st.PinsState);i++)
+          PublishSingleton.Flags.Status = true;
+          PublishSingleton.Flags.AddModuleIDToAnswer = false;
+          if(wantAnswer)
+          {
+           // состояние всех пинов - длинная hex-строка, пишем её прямо в поток
+           canPublish = false;
+           Print* pStream = MainController->BeginPublish(this,command);
+           if(pStream)
            {
-              PublishSingleton << WorkStatus::ToHex(st.PinsState[i]);
+             ControllerState st = WORK_STATUS.GetState();
+             for(size_t i=0;i<sizeof(st.PinsState);i++)
+             {
+                pStream->print(WorkStatus::ToHex(st.PinsState[i]));
+             }
            }
-          
+           MainController->EndPublish();
+          }
         }
         else if(t == F("GUID"))
         {
@@ -300,21 +326,31 @@ bool  ZeroStreamListener::ExecCommand(const Command& command, bool wantAnswer)
         else if(t == PINS_COMMAND) {
           // получить информацию по пинам
           PublishSingleton.Flags.Status = true;
-          PublishSingleton = PINS_COMMAND;
-          PublishSingleton << PARAM_DELIMITER;
-          PublishSingleton << PINS_MAP_SIZE;
-          PublishSingleton << PARAM_DELIMITER;
+          PublishSingleton.Flags.AddModuleIDToAnswer = false;
+          if(wantAnswer)
+          {
+            // две карты пинов в hex - пишем прямо в поток
+            canPublish = false;
+            Print* pStream = MainController->BeginPublish(this,command);
+            if(pStream)
+            {
+              pStream->print(PINS_COMMAND);
+              pStream->print(PARAM_DELIMITER);
+              pStream->print(PINS_MAP_SIZE);
+              pStream->print(PARAM_DELIMITER);
 
-          for(byte i=0;i<PINS_MAP_SIZE;i++) {
-            PublishSingleton << WorkStatus::ToHex(WORK_STATUS.UsedPins.PinsUsed[i]);
-          }
+              for(byte i=0;i<PINS_MAP_SIZE;i++) {
+                pStream->print(WorkStatus::ToHex(WORK_STATUS.UsedPins.PinsUsed[i]));
+              }
 
-          PublishSingleton << PARAM_DELIMITER;
+              pStream->print(PARAM_DELIMITER);
 
-          for(byte i=0;i<PINS_MAP_SIZE;i++) {
-            PublishSingleton << WorkStatus::ToHex(WORK_STATUS.UsedPins.PinsMode[i]);
-          }          
-          
+              for(byte i=0;i<PINS_MAP_SIZE;i++) {
+                pStream->print(WorkStatus::ToHex(WORK_STATUS.UsedPins.PinsMode[i]));
+              }
+            }
+            MainController->EndPublish();
+          }
         }
         #if defined(USE_UNIVERSAL_MODULES) && defined(USE_UNI_REGISTRATION_LINE)
         else
@@ -400,17 +436,18 @@ bool  ZeroStreamListener::ExecCommand(const Command& command, bool wantAnswer)
         {
           if(wantAnswer)
           {
-            // входящий поток установлен, значит, можем писать прямо в него
+            // входящий поток установлен, значит, можем писать прямо в него, без накопления ответа в памяти
             canPublish = false; // скажем, что мы не хотим публиковать через контроллер - будем писать в поток сами
-            Stream* pStream = command.GetIncomingStream();
-            pStream->print(OK_ANSWER);
-            pStream->print(COMMAND_DELIMITER);
+            PublishSingleton.Flags.Status = true;
+            PublishSingleton.Flags.AddModuleIDToAnswer = false;
+            Print* pStream = MainController->BeginPublish(this,command);
 
-            WORK_STATUS.WriteStatus(pStream,true); // просим записать статус
+            if(pStream)
+              WORK_STATUS.WriteStatus(pStream,true); // просим записать статус
 
             // тут можем писать остальные статусы, типа показаний датчиков и т.п.:
 
-            size_t modulesCount = MainController->GetModulesCount(); // получаем кол-во зарегистрированных модулей
+            size_t modulesCount = pStream ? MainController->GetModulesCount() : 0; // получаем кол-во зарегистрированных модулей
 
             // пробегаем по всем модулям
             String moduleName;
@@ -488,7 +525,7 @@ bool  ZeroStreamListener::ExecCommand(const Command& command, bool wantAnswer)
             } // for
             
 
-            pStream->print(NEWLINE); // пишем перевод строки
+            MainController->EndPublish(); // пишем перевод строки
             
           } // wantAnswer
           
@@ -497,22 +534,30 @@ bool  ZeroStreamListener::ExecCommand(const Command& command, bool wantAnswer)
         {
           PublishSingleton.Flags.AddModuleIDToAnswer = false;
           PublishSingleton.Flags.Status = true;
-          PublishSingleton = F("");
-          size_t cnt = MainController->GetModulesCount();
-          for(size_t i=0;i<cnt;i++)
+          if(wantAnswer)
           {
-            AbstractModule* mod = MainController->GetModule(i);
-
-            if(mod != this)
+            // список модулей растёт с конфигурацией - пишем его прямо в поток
+            canPublish = false;
+            Print* pStream = MainController->BeginPublish(this,command);
+            size_t cnt = pStream ? MainController->GetModulesCount() : 0;
+            bool first = true;
+            for(size_t i=0;i<cnt;i++)
             {
-              if(PublishSingleton.Text.length())
-                PublishSingleton << PARAM_DELIMITER;
-              
-              PublishSingleton << mod->GetID();
-             
-            }// if
-              
-          } // for
+              AbstractModule* mod = MainController->GetModule(i);
+
+              if(mod != this)
+              {
+                if(!first)
+                  pStream->print(PARAM_DELIMITER);
+
+                pStream->print(mod->GetID());
+                first = false;
+
+              }// if
+
+            } // for
+            MainController->EndPublish();
+          }
         }
         else
         {
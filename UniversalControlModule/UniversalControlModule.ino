@@ -203,21 +203,20 @@ bool GotRS485Packet()
   return rs485WritePtr > ( sizeof(RS485Packet)-1 );
 }
 //----------------------------------------------------------------------------------------------------------------
+// CRC-8 (полином 0x8C) по полбайта за шаг, совпадает с контрольной суммой контроллера
+const byte CRC8_TABLE[16] PROGMEM = {
+  0x00, 0x9D, 0x23, 0xBE, 0x46, 0xDB, 0x65, 0xF8, 0x8C, 0x11, 0xAF, 0x32, 0xCA, 0x57, 0xE9, 0x74
+};
+//----------------------------------------------------------------------------------------------------------------
 byte crc8(const byte *addr, byte len)
 {
   byte crc = 0;
   while (len--) 
-    {
-    byte inbyte = *addr++;
-    for (byte i = 8; i; i--)
-      {
-      byte mix = (crc ^ inbyte) & 0x01;
-      crc >>= 1;
-      if (mix) 
-        crc ^= 0x8C;
-      inbyte >>= 1;
-      }  // end of for
-    }  // end of while
+  {
+    crc ^= *addr++;
+    crc = (crc >> 4) ^ pgm_read_byte(&(CRC8_TABLE[crc & 0x0F]));
+    crc = (crc >> 4) ^ pgm_read_byte(&(CRC8_TABLE[crc & 0x0F]));
+  }
   return crc;  
 }
 //-------------------------------------------------------------------------------------------------------------------------------------------------------
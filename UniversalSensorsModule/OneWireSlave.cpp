@@ -24,6 +24,11 @@ namespace
 	const byte ReceiveCommand = (byte)-1;
 
 	void(*timerEvent)() = 0;
+
+	// Dallas CRC-8 (polynomial 0x8C), four bits per step
+	const byte Crc8Table[16] PROGMEM = {
+		0x00, 0x9D, 0x23, 0xBE, 0x46, 0xDB, 0x65, 0xF8, 0x8C, 0x11, 0xAF, 0x32, 0xCA, 0x57, 0xE9, 0x74
+	};
 }
 
 OneWireSlave OWSlave;
@@ -230,13 +235,9 @@ byte OneWireSlave::crc8(const byte* data, short numBytes)
 	byte crc = 0;
 
 	while (numBytes--) {
-		byte inbyte = *data++;
-		for (byte i = 8; i; i--) {
-			byte mix = (crc ^ inbyte) & 0x01;
-			crc >>= 1;
-			if (mix) crc ^= 0x8C;
-			inbyte >>= 1;
-		}
+		crc ^= *data++;
+		crc = (crc >> 4) ^ pgm_read_byte(&Crc8Table[crc & 0x0F]);
+		crc = (crc >> 4) ^ pgm_read_byte(&Crc8Table[crc & 0x0F]);
 	}
 	return crc;
 }
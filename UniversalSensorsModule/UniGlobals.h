@@ -128,6 +128,23 @@ typedef struct
   
 } RS485Packet; // пакет, гоняющийся по RS-485 туда/сюда (30 байт)
 //----------------------------------------------------------------------------------------------------------------
+#define RS485_V2_HEADER1 0xAC
+#define RS485_V2_HEADER2 0xCA
+#define RS485_V2_OVERHEAD 6 // заголовок, длина, направление, тип и CRC
+#define RS485_V2_MAX_PAYLOAD (sizeof(RS485Packet) - RS485_V2_OVERHEAD) // кадр не длиннее пакета первой версии
+#define RS485_V2_SENSOR_RECORD_SIZE 6 // запись с показаниями: тип датчика, индекс, 4 байта показаний
+//----------------------------------------------------------------------------------------------------------------
+typedef struct
+{
+  byte header1;
+  byte header2;
+  byte length; // кол-во байт записей в data
+  byte direction;
+  byte type;
+  byte data[sizeof(RS485Packet) - RS485_V2_OVERHEAD + 1]; // записи, сразу за ними - CRC
+  
+} RS485FrameV2; // кадр второй версии, переменной длины (принимается в тот же буфер, что и пакет)
+//----------------------------------------------------------------------------------------------------------------
 typedef struct
 {
   int8_t Humidity;
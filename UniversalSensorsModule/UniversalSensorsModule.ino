@@ -215,7 +215,15 @@ volatile unsigned long oneWireLastCommandTimer = 0;
    0xAD - второй байт окончания
    CRC - контрольная сумма пакета
 
- 
+ Кадр второй версии, переменной длины:
+
+   0xAC 0xCA - заголовок
+   длина записей, направление, тип
+   записи
+   CRC - контрольная сумма кадра
+
+ На запрос показаний одного датчика кадром второй версии отвечаем показаниями всех
+ своих датчиков в одном кадре - первым идёт запрошенный.
  */
 //----------------------------------------------------------------------------------------------------------------
 RS485Packet rs485Packet; // пакет, в который мы принимаем данные
@@ -242,7 +250,7 @@ void ProcessRS485Packet()
      bool startPacketFound = false;
      while(readPtr < sizeof(RS485Packet))
      {
-       if(rsPacketPtr[readPtr] == 0xAB)
+       if(rsPacketPtr[readPtr] == 0xAB || rsPacketPtr[readPtr] == RS485_V2_HEADER1)
        {
         startPacketFound = true;
         break;
@@ -360,11 +368,90 @@ void ProcessRS485Packet()
   } // else
 }
 //----------------------------------------------------------------------------------------------------------------
+byte* WriteSensorRecord(byte* writePtr, const sensor* s)
+{
+  *writePtr++ = s->type;
+  *writePtr++ = s->index;
+  memcpy(writePtr,s->data,4);
+  return writePtr + 4;
+}
+//----------------------------------------------------------------------------------------------------------------
+void ProcessRS485FrameV2()
+{
+  RS485FrameV2* frame = (RS485FrameV2*) &rs485Packet;
+  byte frameLength = frame->length + RS485_V2_OVERHEAD;
+  
+  // кадр получен, сразу обнуляем указатель записи
+  rs485WritePtr = 0;
+
+  if(OneWireSlave::crc8((const byte*) frame,frameLength - 1) != frame->data[frame->length])
+    return;
+
+  if(frame->direction != RS485FromMaster || frame->type != RS485SensorDataPacket || frame->length < 2)
+    return;
+
+  sensor* sensors[] = { &(scratchpadS.sensor1), &(scratchpadS.sensor2), &(scratchpadS.sensor3) };
+  
+  // ищем запрошенный датчик
+  byte sensorType = frame->data[0];
+  byte sensorIndex = frame->data[1];
+  sensor* sMatch = NULL;
+  
+  for(byte i=0;i<3;i++)
+  {
+    if(sensors[i]->type == sensorType && sensors[i]->index == sensorIndex)
+    {
+      sMatch = sensors[i];
+      break;
+    }
+  }
+
+  if(!sMatch) // не нашли у нас такого датчика
+    return;
+
+  // первой записью - запрошенный датчик, следом - остальные наши датчики
+  byte* writePtr = WriteSensorRecord(frame->data,sMatch);
+  for(byte i=0;i<3;i++)
+  {
+    if(sensors[i] == sMatch || sensors[i]->type == uniNone)
+      continue;
+      
+    writePtr = WriteSensorRecord(writePtr,sensors[i]);
+  }
+
+  frame->length = writePtr - frame->data;
+  frame->direction = RS485FromSlave;
+  frameLength = frame->length + RS485_V2_OVERHEAD;
+  *writePtr = OneWireSlave::crc8((const byte*) frame,frameLength - 1);
+
+  RS485Send();
+  Serial.write((const uint8_t *)frame,frameLength);
+  RS485waitTransmitComplete();
+  RS485Receive();
+}
+//----------------------------------------------------------------------------------------------------------------
 void ProcessIncomingRS485Packets() // обрабатываем входящие пакеты по RS-485
 {
   while(Serial.available())
   {
     rsPacketPtr[rs485WritePtr++] = (byte) Serial.read();
+
+    if(rsPacketPtr[0] == RS485_V2_HEADER1)
+    {
+      // кадр второй версии, его длину узнаём из третьего байта
+      RS485FrameV2* frame = (RS485FrameV2*) &rs485Packet;
+      
+      if(rs485WritePtr > 1 && frame->header2 != RS485_V2_HEADER2)
+        rs485WritePtr = 0; // не кадр, а мусор
+      else
+      if(rs485WritePtr > 2 && frame->length > RS485_V2_MAX_PAYLOAD)
+        rs485WritePtr = 0; // битая длина
+      else
+      if(rs485WritePtr > 2 && rs485WritePtr >= frame->length + RS485_V2_OVERHEAD)
+        ProcessRS485FrameV2();
+        
+      continue;
+    }
    
     if(GotRS485Packet())
       ProcessRS485Packet();